@@ -0,0 +1,48 @@
+#include "MBEMappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MBEMappedFile::MBEMappedFile(const char *path) :
+    _bytes(nullptr), _length(0), _valid(false)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0)
+    {
+        if (info.st_size == 0)
+        {
+            _valid = true;
+        }
+        else
+        {
+            void *mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED)
+            {
+                // We almost always read mapped files front to back, so let the kernel read ahead aggressively
+                madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL);
+                _bytes = static_cast<const uint8_t *>(mapping);
+                _length = (size_t)info.st_size;
+                _valid = true;
+            }
+        }
+    }
+
+    // The mapping holds its own reference to the file, so the descriptor can be closed right away
+    close(fd);
+}
+
+MBEMappedFile::~MBEMappedFile()
+{
+    if (_bytes)
+    {
+        munmap(const_cast<uint8_t *>(_bytes), _length);
+    }
+}
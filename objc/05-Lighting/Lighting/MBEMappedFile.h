@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// A read-only, memory-mapped view of a file. The mapping lives as long as the
+/// object does, so pointers obtained from `bytes()` must not outlive it.
+class MBEMappedFile
+{
+public:
+    explicit MBEMappedFile(const char *path);
+    ~MBEMappedFile();
+
+    /// Returns false if the file could not be opened or mapped. An empty file
+    /// is valid and has a length of zero.
+    bool isValid() const { return _valid; }
+
+    const uint8_t *bytes() const { return _bytes; }
+    size_t length() const { return _length; }
+
+private:
+    MBEMappedFile(const MBEMappedFile &) = delete;
+    MBEMappedFile &operator=(const MBEMappedFile &) = delete;
+
+    const uint8_t *_bytes;
+    size_t _length;
+    bool _valid;
+};
@@ -4,4 +4,8 @@
 @interface MBEMesh : NSObject
 @property (nonatomic, readonly) id<MTLBuffer> vertexBuffer;
 @property (nonatomic, readonly) id<MTLBuffer> indexBuffer;
+/// The type of the elements of `indexBuffer`. Meshes use 16-bit indices unless they say otherwise.
+@property (nonatomic, readonly) MTLIndexType indexType;
+/// The number of indices in `indexBuffer`, derived from its length and `indexType`
+@property (nonatomic, readonly) NSUInteger indexCount;
 @end
@@ -0,0 +1,577 @@
+#include "MBEMeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Forsyth's scoring parameters, from "Linear-Speed Vertex Cache Optimisation"
+    const int MaxCacheSize = 32;
+    const float CacheDecayPower = 1.5f;
+    const float LastTriangleScore = 0.75f;
+    const float ValenceBoostScale = 2.0f;
+    const float ValenceBoostPower = 0.5f;
+    const int MaxValenceForTable = 64;
+
+    const uint32_t InvalidIndex = 0xffffffff;
+
+    struct MBEVertexScoreTable
+    {
+        float cache[MaxCacheSize];
+        float valence[MaxValenceForTable];
+
+        MBEVertexScoreTable()
+        {
+            for (int i = 0; i < MaxCacheSize; ++i)
+            {
+                if (i < 3)
+                {
+                    // The vertices of the triangle we just emitted get a fixed score so that we don't
+                    // favor immediately reusing the same edge, which tends to produce long thin strips
+                    cache[i] = LastTriangleScore;
+                }
+                else
+                {
+                    const float scaler = 1.0f / (MaxCacheSize - 3);
+                    cache[i] = powf(1.0f - (i - 3) * scaler, CacheDecayPower);
+                }
+            }
+
+            valence[0] = 0;
+            for (int i = 1; i < MaxValenceForTable; ++i)
+            {
+                valence[i] = ValenceBoostScale * powf((float)i, -ValenceBoostPower);
+            }
+        }
+    };
+
+    float VertexScore(const MBEVertexScoreTable &table, int cachePosition, uint32_t remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+        {
+            // Vertices that no longer have triangles to emit shouldn't attract anything
+            return -1;
+        }
+
+        float score = (cachePosition >= 0) ? table.cache[cachePosition] : 0;
+
+        // Boost vertices with few remaining triangles, so that we finish them off rather than leaving
+        // lone triangles behind that will cost a full cache miss later
+        if (remainingTriangles < (uint32_t)MaxValenceForTable)
+        {
+            score += table.valence[remainingTriangles];
+        }
+        else
+        {
+            score += ValenceBoostScale * powf((float)remainingTriangles, -ValenceBoostPower);
+        }
+
+        return score;
+    }
+
+    template <typename Index>
+    MBEVertexCacheStatistics AnalyzeVertexCache(const Index *indices, size_t indexCount, size_t vertexCount)
+    {
+        MBEVertexCacheStatistics statistics = { 0, 0 };
+        if (indexCount < 3 || vertexCount == 0)
+        {
+            return statistics;
+        }
+
+        // Each vertex remembers the "time" at which it entered the FIFO; it's still resident if fewer than
+        // cacheSize insertions have happened since then
+        std::vector<size_t> insertionTime(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        size_t clock = MBEVertexCacheSimulationSize + 1;
+        size_t misses = 0;
+        size_t uniqueVertices = 0;
+
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            const Index v = indices[i];
+            if (clock - insertionTime[v] > MBEVertexCacheSimulationSize)
+            {
+                insertionTime[v] = clock++;
+                ++misses;
+            }
+            if (!referenced[v])
+            {
+                referenced[v] = true;
+                ++uniqueVertices;
+            }
+        }
+
+        statistics.acmr = (float)misses / (indexCount / 3);
+        statistics.atvr = (float)misses / uniqueVertices;
+        return statistics;
+    }
+
+    template <typename Index>
+    void OptimizeVertexCache(Index *indices, size_t indexCount, size_t vertexCount)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2 || vertexCount == 0)
+        {
+            return;
+        }
+
+        static const MBEVertexScoreTable scoreTable;
+
+        // Build the vertex-to-triangle adjacency in compressed rows. As triangles are emitted, they are
+        // swapped to the end of each vertex's row, so the first `remaining[v]` entries stay active.
+        std::vector<uint32_t> remaining(vertexCount, 0);
+        for (size_t i = 0; i < triangleCount * 3; ++i)
+        {
+            ++remaining[indices[i]];
+        }
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remaining[v];
+        }
+
+        std::vector<uint32_t> adjacency(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t t = 0; t < triangleCount; ++t)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+                }
+            }
+        }
+
+        std::vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            vertexScore[v] = VertexScore(scoreTable, -1, remaining[v]);
+        }
+
+        std::vector<float> triangleScore(triangleCount);
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        }
+
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<Index> output(triangleCount * 3);
+
+        uint32_t cache[MaxCacheSize + 3];
+        uint32_t nextCache[MaxCacheSize + 3];
+        int cacheSize = 0;
+
+        size_t bestTriangle = 0;
+        for (size_t t = 1; t < triangleCount; ++t)
+        {
+            if (triangleScore[t] > triangleScore[bestTriangle])
+            {
+                bestTriangle = t;
+            }
+        }
+
+        size_t inputCursor = 0;
+
+        for (size_t outputTriangle = 0; outputTriangle < triangleCount; ++outputTriangle)
+        {
+            if (bestTriangle == InvalidIndex)
+            {
+                // Nothing in the cache has triangles left, so take the next unemitted triangle in input order.
+                // The cursor only moves forward, so this costs O(n) over the whole run.
+                while (emitted[inputCursor])
+                {
+                    ++inputCursor;
+                }
+                bestTriangle = inputCursor;
+            }
+
+            const Index *triangle = &indices[bestTriangle * 3];
+            std::copy(triangle, triangle + 3, &output[outputTriangle * 3]);
+            emitted[bestTriangle] = true;
+
+            // Retire the triangle from the adjacency of its vertices
+            for (int k = 0; k < 3; ++k)
+            {
+                const uint32_t v = triangle[k];
+                uint32_t *row = &adjacency[adjacencyOffsets[v]];
+                for (uint32_t j = 0; j < remaining[v]; ++j)
+                {
+                    if (row[j] == bestTriangle)
+                    {
+                        std::swap(row[j], row[remaining[v] - 1]);
+                        --remaining[v];
+                        break;
+                    }
+                }
+            }
+
+            // The emitted vertices move to the front of the LRU cache; everything else shifts back
+            int nextCacheSize = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                // Degenerate triangles repeat a vertex, which must only occupy one cache entry
+                if (std::find(nextCache, nextCache + nextCacheSize, (uint32_t)triangle[k]) == nextCache + nextCacheSize)
+                {
+                    nextCache[nextCacheSize++] = triangle[k];
+                }
+            }
+            for (int i = 0; i < cacheSize; ++i)
+            {
+                const uint32_t v = cache[i];
+                if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                {
+                    nextCache[nextCacheSize++] = v;
+                }
+            }
+
+            // Vertices that fall out of the cache keep their slot in the over-sized array for one round,
+            // so that their (now lower) scores are propagated to their triangles
+            bestTriangle = InvalidIndex;
+            float bestScore = -1;
+            for (int i = 0; i < nextCacheSize; ++i)
+            {
+                const uint32_t v = nextCache[i];
+                const int position = (i < MaxCacheSize) ? i : -1;
+
+                const float score = VertexScore(scoreTable, position, remaining[v]);
+                const float delta = score - vertexScore[v];
+                vertexScore[v] = score;
+
+                const uint32_t *row = &adjacency[adjacencyOffsets[v]];
+                for (uint32_t j = 0; j < remaining[v]; ++j)
+                {
+                    const uint32_t t = row[j];
+                    triangleScore[t] += delta;
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        bestTriangle = t;
+                    }
+                }
+            }
+
+            cacheSize = std::min(nextCacheSize, MaxCacheSize);
+            std::copy(nextCache, nextCache + cacheSize, cache);
+        }
+
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    struct MBEFloat3
+    {
+        float x, y, z;
+    };
+
+    MBEFloat3 PositionAt(const float *positions, size_t positionStride, uint32_t index)
+    {
+        const float *p = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(positions) + index * positionStride);
+        MBEFloat3 position = { p[0], p[1], p[2] };
+        return position;
+    }
+
+    // Simulates the FIFO cache over triangles [start, end) from an empty cache and returns the miss count
+    template <typename Index>
+    size_t CountCacheMisses(const Index *indices, size_t start, size_t end, std::vector<size_t> &insertionTime, size_t &clock)
+    {
+        // Advancing the clock past the cache size makes every vertex look evicted, which empties the cache
+        clock += MBEVertexCacheSimulationSize + 1;
+
+        size_t misses = 0;
+        for (size_t t = start; t < end; ++t)
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const Index v = indices[t * 3 + k];
+                if (clock - insertionTime[v] > MBEVertexCacheSimulationSize)
+                {
+                    insertionTime[v] = clock++;
+                    ++misses;
+                }
+            }
+        }
+        return misses;
+    }
+
+    template <typename Index>
+    void OptimizeOverdraw(Index *indices, size_t indexCount, const float *positions, size_t positionStride,
+                          size_t vertexCount, float threshold)
+    {
+        const size_t triangleCount = indexCount / 3;
+        if (triangleCount < 2 || vertexCount == 0)
+        {
+            return;
+        }
+
+        std::vector<size_t> insertionTime(vertexCount, 0);
+        size_t clock = 0;
+
+        // Hard boundaries fall where the cache-optimized order starts over with a triangle that shares
+        // nothing with the cache; reordering at those points costs nothing
+        std::vector<size_t> hardBoundaries;
+        clock += MBEVertexCacheSimulationSize + 1;
+        for (size_t t = 0; t < triangleCount; ++t)
+        {
+            size_t misses = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                const Index v = indices[t * 3 + k];
+                if (clock - insertionTime[v] > MBEVertexCacheSimulationSize)
+                {
+                    insertionTime[v] = clock++;
+                    ++misses;
+                }
+            }
+            if (misses == 3)
+            {
+                hardBoundaries.push_back(t);
+            }
+        }
+        hardBoundaries.push_back(triangleCount);
+
+        // Split each hard cluster further wherever the running ACMR of the current piece is already within
+        // the threshold of the whole cluster's ACMR
+        std::vector<size_t> boundaries;
+        for (size_t h = 0; h + 1 < hardBoundaries.size(); ++h)
+        {
+            const size_t start = hardBoundaries[h];
+            const size_t end = hardBoundaries[h + 1];
+
+            const size_t clusterMisses = CountCacheMisses(indices, start, end, insertionTime, clock);
+            const float clusterThreshold = threshold * (float)clusterMisses / (end - start);
+
+            boundaries.push_back(start);
+
+            clock += MBEVertexCacheSimulationSize + 1;
+            size_t pieceStart = start;
+            size_t pieceMisses = 0;
+            for (size_t t = start; t < end; ++t)
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    const Index v = indices[t * 3 + k];
+                    if (clock - insertionTime[v] > MBEVertexCacheSimulationSize)
+                    {
+                        insertionTime[v] = clock++;
+                        ++pieceMisses;
+                    }
+                }
+
+                const size_t pieceTriangles = t + 1 - pieceStart;
+                if (t + 1 < end && (float)pieceMisses / pieceTriangles <= clusterThreshold)
+                {
+                    boundaries.push_back(t + 1);
+                    pieceStart = t + 1;
+                    pieceMisses = 0;
+                    clock += MBEVertexCacheSimulationSize + 1;
+                }
+            }
+        }
+        boundaries.push_back(triangleCount);
+
+        const size_t clusterCount = boundaries.size() - 1;
+        if (clusterCount < 2)
+        {
+            return;
+        }
+
+        // Area-weighted centroids and normals of each cluster and of the whole mesh
+        std::vector<float> sortKeys(clusterCount);
+        std::vector<MBEFloat3> clusterCentroids(clusterCount);
+        std::vector<MBEFloat3> clusterNormals(clusterCount);
+        MBEFloat3 meshCentroid = { 0, 0, 0 };
+        float meshArea = 0;
+
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            MBEFloat3 centroid = { 0, 0, 0 };
+            MBEFloat3 normal = { 0, 0, 0 };
+            float clusterArea = 0;
+
+            for (size_t t = boundaries[c]; t < boundaries[c + 1]; ++t)
+            {
+                const MBEFloat3 p0 = PositionAt(positions, positionStride, indices[t * 3]);
+                const MBEFloat3 p1 = PositionAt(positions, positionStride, indices[t * 3 + 1]);
+                const MBEFloat3 p2 = PositionAt(positions, positionStride, indices[t * 3 + 2]);
+
+                const MBEFloat3 e1 = { p1.x - p0.x, p1.y - p0.y, p1.z - p0.z };
+                const MBEFloat3 e2 = { p2.x - p0.x, p2.y - p0.y, p2.z - p0.z };
+                const MBEFloat3 n = { e1.y * e2.z - e1.z * e2.y, e1.z * e2.x - e1.x * e2.z, e1.x * e2.y - e1.y * e2.x };
+                const float area = sqrtf(n.x * n.x + n.y * n.y + n.z * n.z);
+
+                centroid.x += (p0.x + p1.x + p2.x) * (area / 3);
+                centroid.y += (p0.y + p1.y + p2.y) * (area / 3);
+                centroid.z += (p0.z + p1.z + p2.z) * (area / 3);
+                normal.x += n.x;
+                normal.y += n.y;
+                normal.z += n.z;
+                clusterArea += area;
+            }
+
+            meshCentroid.x += centroid.x;
+            meshCentroid.y += centroid.y;
+            meshCentroid.z += centroid.z;
+            meshArea += clusterArea;
+
+            const float inverseArea = (clusterArea > 0) ? 1 / clusterArea : 0;
+            centroid.x *= inverseArea;
+            centroid.y *= inverseArea;
+            centroid.z *= inverseArea;
+
+            const float normalLength = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+            const float inverseLength = (normalLength > 0) ? 1 / normalLength : 0;
+            normal.x *= inverseLength;
+            normal.y *= inverseLength;
+            normal.z *= inverseLength;
+
+            clusterCentroids[c] = centroid;
+            clusterNormals[c] = normal;
+        }
+
+        const float inverseMeshArea = (meshArea > 0) ? 1 / meshArea : 0;
+        meshCentroid.x *= inverseMeshArea;
+        meshCentroid.y *= inverseMeshArea;
+        meshCentroid.z *= inverseMeshArea;
+
+        // Clusters that face outward from the mesh center are the most likely to occlude the rest of the
+        // mesh from any viewpoint, so they sort first
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            const MBEFloat3 &centroid = clusterCentroids[c];
+            const MBEFloat3 &normal = clusterNormals[c];
+            sortKeys[c] = (centroid.x - meshCentroid.x) * normal.x +
+                          (centroid.y - meshCentroid.y) * normal.y +
+                          (centroid.z - meshCentroid.z) * normal.z;
+        }
+
+        std::vector<size_t> order(clusterCount);
+        for (size_t c = 0; c < clusterCount; ++c)
+        {
+            order[c] = c;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<Index> output;
+        output.reserve(triangleCount * 3);
+        for (size_t i = 0; i < clusterCount; ++i)
+        {
+            const size_t c = order[i];
+            output.insert(output.end(), indices + boundaries[c] * 3, indices + boundaries[c + 1] * 3);
+        }
+
+        std::copy(output.begin(), output.end(), indices);
+    }
+
+    template <typename Index>
+    size_t OptimizeVertexFetch(void *vertices, size_t vertexStride, size_t vertexCount, Index *indices, size_t indexCount)
+    {
+        std::vector<uint32_t> remap(vertexCount, InvalidIndex);
+        uint32_t nextVertex = 0;
+
+        for (size_t i = 0; i < indexCount; ++i)
+        {
+            const Index v = indices[i];
+            if (remap[v] == InvalidIndex)
+            {
+                remap[v] = nextVertex++;
+            }
+            indices[i] = (Index)remap[v];
+        }
+
+        uint8_t *bytes = static_cast<uint8_t *>(vertices);
+        std::vector<uint8_t> reordered((size_t)nextVertex * vertexStride);
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            if (remap[v] != InvalidIndex)
+            {
+                memcpy(&reordered[remap[v] * vertexStride], bytes + v * vertexStride, vertexStride);
+            }
+        }
+
+        if (!reordered.empty())
+        {
+            memcpy(bytes, reordered.data(), reordered.size());
+        }
+
+        return nextVertex;
+    }
+
+    template <typename Index>
+    MBEMeshOptimizationReport OptimizeMesh(void *vertices, size_t vertexStride, size_t vertexCount,
+                                           Index *indices, size_t indexCount)
+    {
+        MBEMeshOptimizationReport report;
+        report.before = AnalyzeVertexCache(indices, indexCount, vertexCount);
+
+        OptimizeVertexCache(indices, indexCount, vertexCount);
+        OptimizeOverdraw(indices, indexCount, static_cast<const float *>(vertices), vertexStride, vertexCount,
+                         MBEDefaultOverdrawThreshold);
+        report.vertexCount = OptimizeVertexFetch(vertices, vertexStride, vertexCount, indices, indexCount);
+
+        report.after = AnalyzeVertexCache(indices, indexCount, report.vertexCount);
+        return report;
+    }
+}
+
+MBEVertexCacheStatistics MBEAnalyzeVertexCacheUInt16(const uint16_t *indices, size_t indexCount, size_t vertexCount)
+{
+    return AnalyzeVertexCache(indices, indexCount, vertexCount);
+}
+
+MBEVertexCacheStatistics MBEAnalyzeVertexCacheUInt32(const uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+    return AnalyzeVertexCache(indices, indexCount, vertexCount);
+}
+
+void MBEOptimizeVertexCacheUInt16(uint16_t *indices, size_t indexCount, size_t vertexCount)
+{
+    OptimizeVertexCache(indices, indexCount, vertexCount);
+}
+
+void MBEOptimizeVertexCacheUInt32(uint32_t *indices, size_t indexCount, size_t vertexCount)
+{
+    OptimizeVertexCache(indices, indexCount, vertexCount);
+}
+
+void MBEOptimizeOverdrawUInt16(uint16_t *indices, size_t indexCount,
+                               const float *positions, size_t positionStride, size_t vertexCount,
+                               float threshold)
+{
+    OptimizeOverdraw(indices, indexCount, positions, positionStride, vertexCount, threshold);
+}
+
+void MBEOptimizeOverdrawUInt32(uint32_t *indices, size_t indexCount,
+                               const float *positions, size_t positionStride, size_t vertexCount,
+                               float threshold)
+{
+    OptimizeOverdraw(indices, indexCount, positions, positionStride, vertexCount, threshold);
+}
+
+size_t MBEOptimizeVertexFetchUInt16(void *vertices, size_t vertexStride, size_t vertexCount,
+                                    uint16_t *indices, size_t indexCount)
+{
+    return OptimizeVertexFetch(vertices, vertexStride, vertexCount, indices, indexCount);
+}
+
+size_t MBEOptimizeVertexFetchUInt32(void *vertices, size_t vertexStride, size_t vertexCount,
+                                    uint32_t *indices, size_t indexCount)
+{
+    return OptimizeVertexFetch(vertices, vertexStride, vertexCount, indices, indexCount);
+}
+
+MBEMeshOptimizationReport MBEOptimizeMeshUInt16(void *vertices, size_t vertexStride, size_t vertexCount,
+                                                uint16_t *indices, size_t indexCount)
+{
+    return OptimizeMesh(vertices, vertexStride, vertexCount, indices, indexCount);
+}
+
+MBEMeshOptimizationReport MBEOptimizeMeshUInt32(void *vertices, size_t vertexStride, size_t vertexCount,
+                                                uint32_t *indices, size_t indexCount)
+{
+    return OptimizeMesh(vertices, vertexStride, vertexCount, indices, indexCount);
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that mesh classes written in plain Objective-C can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Post-transform vertex cache behavior of an indexed triangle list, measured by simulating a
+/// FIFO cache with `MBEVertexCacheSimulationSize` entries
+typedef struct
+{
+    /// Average cache miss ratio: vertex shader invocations per triangle. Ranges from 3 (no reuse)
+    /// down to about 0.5 for a large, well-ordered grid.
+    float acmr;
+    /// Average transformed vertex ratio: vertex shader invocations per referenced vertex. 1 is ideal.
+    float atvr;
+} MBEVertexCacheStatistics;
+
+typedef struct
+{
+    MBEVertexCacheStatistics before;
+    MBEVertexCacheStatistics after;
+    /// The vertex count after fetch optimization, which drops vertices that no triangle references
+    size_t vertexCount;
+} MBEMeshOptimizationReport;
+
+/// A conservative estimate of the post-transform cache size of the GPUs we run on
+static const size_t MBEVertexCacheSimulationSize = 16;
+
+/// Overdraw optimization may raise the ACMR of a cluster of triangles by at most this factor
+static const float MBEDefaultOverdrawThreshold = 1.05f;
+
+MBEVertexCacheStatistics MBEAnalyzeVertexCacheUInt16(const uint16_t *indices, size_t indexCount, size_t vertexCount);
+MBEVertexCacheStatistics MBEAnalyzeVertexCacheUInt32(const uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+/// Reorders the triangles of an indexed triangle list in place for post-transform vertex cache
+/// reuse, using Forsyth's linear-speed greedy algorithm. Triangle winding is preserved.
+void MBEOptimizeVertexCacheUInt16(uint16_t *indices, size_t indexCount, size_t vertexCount);
+void MBEOptimizeVertexCacheUInt32(uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+/// Reorders clusters of a cache-optimized triangle list so that triangles facing away from the
+/// mesh center, which are the most likely to occlude others, are drawn first. Cluster boundaries
+/// are chosen so that the ACMR grows by no more than `threshold`. `positions` points at the first
+/// vertex's x, y and z floats, with consecutive vertices `positionStride` bytes apart.
+void MBEOptimizeOverdrawUInt16(uint16_t *indices, size_t indexCount,
+                               const float *positions, size_t positionStride, size_t vertexCount,
+                               float threshold);
+void MBEOptimizeOverdrawUInt32(uint32_t *indices, size_t indexCount,
+                               const float *positions, size_t positionStride, size_t vertexCount,
+                               float threshold);
+
+/// Reorders vertices in place into the order in which the index list first references them and
+/// rewrites the indices to match, so that vertex fetches walk memory sequentially. Unreferenced
+/// vertices are dropped; returns the new vertex count.
+size_t MBEOptimizeVertexFetchUInt16(void *vertices, size_t vertexStride, size_t vertexCount,
+                                    uint16_t *indices, size_t indexCount);
+size_t MBEOptimizeVertexFetchUInt32(void *vertices, size_t vertexStride, size_t vertexCount,
+                                    uint32_t *indices, size_t indexCount);
+
+/// Runs the vertex cache, overdraw and vertex fetch passes in that order and measures the cache
+/// behavior before and after. Each vertex must begin with its x, y and z position as floats.
+MBEMeshOptimizationReport MBEOptimizeMeshUInt16(void *vertices, size_t vertexStride, size_t vertexCount,
+                                                uint16_t *indices, size_t indexCount);
+MBEMeshOptimizationReport MBEOptimizeMeshUInt32(void *vertices, size_t vertexStride, size_t vertexCount,
+                                                uint32_t *indices, size_t indexCount);
+
+#ifdef __cplusplus
+}
+#endif
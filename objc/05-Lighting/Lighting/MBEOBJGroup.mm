@@ -15,7 +15,8 @@
 - (NSString *)description
 {
     size_t vertCount = self.vertexData.length / sizeof(MBEVertex);
-    size_t indexCount = self.indexData.length / sizeof(MBEIndex);
+    size_t indexSize = (self.indexType == MTLIndexTypeUInt32) ? sizeof(uint32_t) : sizeof(uint16_t);
+    size_t indexCount = self.indexData.length / indexSize;
     return [NSString stringWithFormat:@"<MBEOBJMesh %p> (\"%@\", %d vertices, %d indices)",
             self, self.name, (int)vertCount, (int)indexCount];
 }
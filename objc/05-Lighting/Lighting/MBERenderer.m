@@ -140,8 +140,8 @@ static const uint32_t MBEBufferAlignment = 256;
     [renderPass setVertexBuffer:self.uniformBuffer offset:uniformBufferOffset atIndex:1];
 
     [renderPass drawIndexedPrimitives:MTLPrimitiveTypeTriangle
-                           indexCount:[self.mesh.indexBuffer length] / sizeof(MBEIndex)
-                            indexType:MBEIndexType
+                           indexCount:self.mesh.indexCount
+                            indexType:self.mesh.indexType
                           indexBuffer:self.mesh.indexBuffer
                     indexBufferOffset:0];
 
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// A (position, texture coordinate, normal) index triple identifying a unique mesh vertex
+struct MBEVertexKey
+{
+    uint32_t vi, ti, ni;
+};
+
+/// An open-addressing hash table from vertex keys to output vertex indices. Entries live in a
+/// single flat array with linear probing, so lookups touch one or two cache lines and inserts
+/// never allocate except when the table grows. Clearing keeps the storage for reuse.
+class MBEVertexIndexMap
+{
+public:
+    MBEVertexIndexMap() :
+        _count(0), _mask(0)
+    {
+    }
+
+    /// Returns the index stored for `key`, or inserts `candidate` and returns it if the key is absent.
+    /// `inserted` reports which of the two happened.
+    uint32_t findOrInsert(const MBEVertexKey &key, uint32_t candidate, bool &inserted)
+    {
+        if ((_count + 1) * 4 > _slots.size() * 3)
+        {
+            grow();
+        }
+
+        size_t slot = hash(key) & _mask;
+        while (1)
+        {
+            Slot &entry = _slots[slot];
+            if (entry.value == EmptyValue)
+            {
+                entry.key = key;
+                entry.value = candidate;
+                ++_count;
+                inserted = true;
+                return candidate;
+            }
+
+            if (entry.key.vi == key.vi && entry.key.ti == key.ti && entry.key.ni == key.ni)
+            {
+                inserted = false;
+                return entry.value;
+            }
+
+            slot = (slot + 1) & _mask;
+        }
+    }
+
+    void clear()
+    {
+        if (_count > 0)
+        {
+            for (Slot &slot : _slots)
+                slot.value = EmptyValue;
+            _count = 0;
+        }
+    }
+
+    size_t size() const { return _count; }
+
+private:
+    static const uint32_t EmptyValue = 0xffffffff;
+
+    struct Slot
+    {
+        MBEVertexKey key;
+        uint32_t value;
+    };
+
+    static size_t hash(const MBEVertexKey &key)
+    {
+        // Pack the triple into 64 bits and scramble it with a murmur-style finalizer. Keys in a mesh
+        // tend to be small, nearly sequential integers, which would cluster badly without mixing.
+        uint64_t h = (((uint64_t)key.vi << 32) | key.ti) ^ ((uint64_t)key.ni * 0x9e3779b97f4a7c15ull);
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return (size_t)h;
+    }
+
+    void grow()
+    {
+        std::vector<Slot> oldSlots;
+        oldSlots.swap(_slots);
+
+        const size_t capacity = oldSlots.empty() ? 1024 : oldSlots.size() * 2;
+        Slot empty;
+        empty.key.vi = empty.key.ti = empty.key.ni = 0;
+        empty.value = EmptyValue;
+        _slots.assign(capacity, empty);
+        _mask = capacity - 1;
+        _count = 0;
+
+        for (const Slot &slot : oldSlots)
+        {
+            if (slot.value != EmptyValue)
+            {
+                bool inserted;
+                findOrInsert(slot.key, slot.value, inserted);
+            }
+        }
+    }
+
+    std::vector<Slot> _slots;
+    size_t _count;
+    size_t _mask;
+};
@@ -0,0 +1,276 @@
+// Runs the mesh optimizer on the host and reports the vertex cache behavior of each mesh before and
+// after, as the average cache miss ratio (ACMR, vertex shader invocations per triangle) and average
+// transformed vertex ratio (ATVR, invocations per vertex). The meshes are a regular grid, a sphere whose
+// triangles have been shuffled, and the models bundled with the samples. Each is optimized through both
+// the 16-bit and the 32-bit entry points where its indices fit.
+//
+// It also checks what the optimizer promises: that every triangle survives with its winding, that the
+// vertices are renumbered in the order the indices first use them, that unreferenced vertices are
+// dropped, that the reported statistics match a fresh analysis, and that the ACMR doesn't get worse by
+// more than the overdraw pass allows.
+//
+// usage: MBEMeshOptimizerCheck [file.obj ...]
+
+#include "MBEMeshOptimizer.h"
+#include "MBEOBJParser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char *const MBEBundledModelPaths[] = {
+    "../Lighting/teapot.obj",
+    "../../06-Texturing/Texturing/spot/spot_triangulated.obj",
+    "../../06-Texturing/Texturing/spot/spot_quadrangulated.obj",
+};
+
+/// A vertex that remembers where it started, so that triangles can be compared across reordering
+struct MBETestVertex
+{
+    float x, y, z;
+    uint32_t id;
+};
+
+struct MBETestMesh
+{
+    std::string name;
+    std::vector<MBETestVertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+int MBEFailureCount = 0;
+
+void MBECheck(bool condition, const std::string &mesh, const char *description)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s: %s\n", mesh.c_str(), description);
+        ++MBEFailureCount;
+    }
+}
+
+MBETestVertex MBEMakeVertex(float x, float y, float z, size_t id)
+{
+    MBETestVertex vertex = { x, y, z, (uint32_t)id };
+    return vertex;
+}
+
+MBETestMesh MBEMakeGrid(size_t size)
+{
+    MBETestMesh mesh;
+    char name[32];
+    std::snprintf(name, sizeof(name), "%zux%zu grid", size, size);
+    mesh.name = name;
+    for (size_t z = 0; z < size; ++z)
+    {
+        for (size_t x = 0; x < size; ++x)
+        {
+            mesh.vertices.push_back(MBEMakeVertex((float)x, 0, (float)z, mesh.vertices.size()));
+        }
+    }
+    for (size_t z = 0; z + 1 < size; ++z)
+    {
+        for (size_t x = 0; x + 1 < size; ++x)
+        {
+            const uint32_t i = (uint32_t)(z * size + x);
+            const uint32_t quad[6] = { i, (uint32_t)(i + size), i + 1, i + 1, (uint32_t)(i + size), (uint32_t)(i + size + 1) };
+            mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+        }
+    }
+    return mesh;
+}
+
+/// A UV sphere whose triangles are in random order, as from a tool that doesn't care about the cache
+MBETestMesh MBEMakeShuffledSphere(size_t slices, size_t stacks)
+{
+    MBETestMesh mesh;
+    mesh.name = "shuffled sphere";
+    for (size_t stack = 0; stack <= stacks; ++stack)
+    {
+        const float phi = (float)M_PI * stack / stacks;
+        for (size_t slice = 0; slice <= slices; ++slice)
+        {
+            const float theta = 2 * (float)M_PI * slice / slices;
+            mesh.vertices.push_back(MBEMakeVertex(std::sin(phi) * std::cos(theta), std::cos(phi),
+                                                  std::sin(phi) * std::sin(theta), mesh.vertices.size()));
+        }
+    }
+
+    std::vector<uint32_t> triangles;
+    for (size_t stack = 0; stack < stacks; ++stack)
+    {
+        for (size_t slice = 0; slice < slices; ++slice)
+        {
+            const uint32_t i = (uint32_t)(stack * (slices + 1) + slice);
+            const uint32_t j = (uint32_t)(i + slices + 1);
+            const uint32_t quad[6] = { i, i + 1, j, j, i + 1, j + 1 };
+            triangles.insert(triangles.end(), quad, quad + 6);
+        }
+    }
+
+    std::vector<size_t> order(triangles.size() / 3);
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        order[i] = i;
+    }
+    std::mt19937 random(1);
+    std::shuffle(order.begin(), order.end(), random);
+    for (size_t triangle : order)
+    {
+        mesh.indices.insert(mesh.indices.end(), &triangles[triangle * 3], &triangles[triangle * 3 + 3]);
+    }
+    return mesh;
+}
+
+/// The positions of a model and its faces, fanned into triangles, with the vertex order of the file
+bool MBELoadModel(const char *path, MBETestMesh &mesh)
+{
+    MBEOBJData data;
+    if (!MBEOBJParseFile(path, data))
+    {
+        return false;
+    }
+
+    mesh.name = std::strrchr(path, '/') ? std::strrchr(path, '/') + 1 : path;
+    for (const MBEOBJFloat3 &position : data.positions)
+    {
+        mesh.vertices.push_back(MBEMakeVertex(position.x, position.y, position.z, mesh.vertices.size()));
+    }
+    for (size_t face = 0; face < data.faceCount(); ++face)
+    {
+        for (uint32_t corner = data.faceStarts[face] + 2; corner < data.faceStarts[face + 1]; ++corner)
+        {
+            mesh.indices.push_back(data.corners[data.faceStarts[face]].vi);
+            mesh.indices.push_back(data.corners[corner - 1].vi);
+            mesh.indices.push_back(data.corners[corner].vi);
+        }
+    }
+    return true;
+}
+
+/// The triangles of a mesh as original vertex ids, each rotated to start at its smallest id so that
+/// winding is kept, in sorted order
+std::vector<uint64_t> MBECanonicalTriangles(const std::vector<MBETestVertex> &vertices, const std::vector<uint32_t> &indices)
+{
+    std::vector<uint64_t> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        uint64_t ids[3] = { vertices[indices[i]].id, vertices[indices[i + 1]].id, vertices[indices[i + 2]].id };
+        std::rotate(ids, std::min_element(ids, ids + 3), ids + 3);
+        triangles.push_back((ids[0] << 42) | (ids[1] << 21) | ids[2]);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+/// Optimizes a copy of the mesh with indices of type Index, checks the result, and prints its statistics
+template <typename Index>
+void MBECheckOptimization(const MBETestMesh &original, const char *indexWidth,
+                          MBEMeshOptimizationReport (*optimize)(void *, size_t, size_t, Index *, size_t),
+                          MBEVertexCacheStatistics (*analyze)(const Index *, size_t, size_t))
+{
+    std::vector<MBETestVertex> vertices = original.vertices;
+    std::vector<Index> indices(original.indices.begin(), original.indices.end());
+    const std::string name = original.name + " (" + indexWidth + ")";
+
+    const MBEMeshOptimizationReport report = optimize(vertices.data(), sizeof(MBETestVertex), vertices.size(),
+                                                      indices.data(), indices.size());
+    vertices.resize(report.vertexCount);
+
+    std::vector<uint32_t> wideIndices(indices.begin(), indices.end());
+    MBECheck(MBECanonicalTriangles(vertices, wideIndices) == MBECanonicalTriangles(original.vertices, original.indices),
+             name, "every triangle survives with its winding");
+
+    std::vector<bool> isReferenced(original.vertices.size(), false);
+    for (uint32_t index : original.indices)
+    {
+        isReferenced[index] = true;
+    }
+    MBECheck(report.vertexCount == (size_t)std::count(isReferenced.begin(), isReferenced.end(), true),
+             name, "exactly the unreferenced vertices are dropped");
+
+    size_t nextNewVertex = 0;
+    bool isInFirstUseOrder = true;
+    for (Index index : indices)
+    {
+        if (index == nextNewVertex)
+        {
+            ++nextNewVertex;
+        }
+        isInFirstUseOrder = isInFirstUseOrder && index < nextNewVertex;
+    }
+    MBECheck(isInFirstUseOrder, name, "vertices are numbered in the order the indices first use them");
+
+    bool isVertexIntact = true;
+    for (const MBETestVertex &vertex : vertices)
+    {
+        const MBETestVertex &source = original.vertices[vertex.id];
+        isVertexIntact = isVertexIntact && vertex.x == source.x && vertex.y == source.y && vertex.z == source.z;
+    }
+    MBECheck(isVertexIntact, name, "vertices move whole");
+
+    const MBEVertexCacheStatistics after = analyze(indices.data(), indices.size(), vertices.size());
+    MBECheck(std::fabs(after.acmr - report.after.acmr) < 1e-5f && std::fabs(after.atvr - report.after.atvr) < 1e-5f,
+             name, "the reported statistics match a fresh analysis");
+    MBECheck(report.after.acmr <= report.before.acmr * MBEDefaultOverdrawThreshold + 1e-5f,
+             name, "the ACMR gets no worse than the overdraw pass allows");
+
+    std::printf("%-34s %9zu %7.3f -> %5.3f %7.3f -> %5.3f\n", name.c_str(), original.indices.size() / 3,
+                report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+}
+
+void MBECheckMesh(const MBETestMesh &mesh)
+{
+    if (mesh.vertices.size() <= UINT16_MAX)
+    {
+        MBECheckOptimization<uint16_t>(mesh, "16-bit", MBEOptimizeMeshUInt16, MBEAnalyzeVertexCacheUInt16);
+    }
+    MBECheckOptimization<uint32_t>(mesh, "32-bit", MBEOptimizeMeshUInt32, MBEAnalyzeVertexCacheUInt32);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<const char *> paths(argv + 1, argv + argc);
+    if (paths.empty())
+    {
+        for (const char *path : MBEBundledModelPaths)
+        {
+            paths.push_back(path);
+        }
+    }
+
+    std::printf("%zu-entry FIFO cache\n", MBEVertexCacheSimulationSize);
+    std::printf("%-34s %9s %16s %16s\n", "mesh", "triangles", "ACMR", "ATVR");
+
+    MBECheckMesh(MBEMakeGrid(65));
+    MBECheckMesh(MBEMakeShuffledSphere(64, 32));
+
+    for (const char *path : paths)
+    {
+        MBETestMesh mesh;
+        if (!MBELoadModel(path, mesh))
+        {
+            std::fprintf(stderr, "Couldn't read %s\n", path);
+            ++MBEFailureCount;
+            continue;
+        }
+        MBECheckMesh(mesh);
+    }
+
+    if (MBEFailureCount > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", MBEFailureCount);
+        return 1;
+    }
+    std::printf("All mesh optimizer checks passed\n");
+    return 0;
+}
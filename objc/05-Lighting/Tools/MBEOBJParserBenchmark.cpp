@@ -0,0 +1,88 @@
+// Measures the throughput of the OBJ parser on the host, outside of the app. Each file is mapped once
+// and then parsed repeatedly from memory, serially and in parallel, and the best time of each is
+// reported as megabytes of OBJ text per second.
+//
+// usage: MBEOBJParserBenchmark [iterations] [file.obj ...]
+//
+// With no files, it parses the models bundled with the samples, at paths relative to this directory.
+
+#include "MBEMappedFile.h"
+#include "MBEOBJParser.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+const char *const MBEBundledModelPaths[] = {
+    "../Lighting/teapot.obj",
+    "../../06-Texturing/Texturing/spot/spot_triangulated.obj",
+    "../../06-Texturing/Texturing/spot/spot_quadrangulated.obj",
+};
+
+/// The shortest of `iterations` parses of the bytes, in seconds
+double MBEBestParseTime(const char *bytes, size_t length, MBEOBJParseMode mode, int iterations, MBEOBJData &data)
+{
+    double bestTime = 1e30;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        MBEOBJParseBytes(bytes, length, data, mode);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        bestTime = std::min(bestTime, elapsed.count());
+    }
+    return bestTime;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 20;
+    if (iterations < 1)
+    {
+        std::fprintf(stderr, "usage: %s [iterations] [file.obj ...]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<const char *> paths(argv + std::min(argc, 2), argv + argc);
+    if (paths.empty())
+    {
+        paths.assign(std::begin(MBEBundledModelPaths), std::end(MBEBundledModelPaths));
+    }
+
+    std::printf("%u threads, best of %d parses\n", MBEThreadPool::sharedPool().threadCount(), iterations);
+    std::printf("%-28s %9s %9s %9s %12s %13s\n", "file", "MB", "vertices", "faces", "serial MB/s", "parallel MB/s");
+
+    int status = 0;
+    for (const char *path : paths)
+    {
+        MBEMappedFile file(path);
+        if (!file.isValid())
+        {
+            std::fprintf(stderr, "Couldn't map %s\n", path);
+            status = 1;
+            continue;
+        }
+
+        const char *bytes = (const char *)file.bytes();
+        const size_t length = file.length();
+        const double megabytes = length / 1e6;
+
+        MBEOBJData data;
+        double serialTime = MBEBestParseTime(bytes, length, MBEOBJParseModeSerial, iterations, data);
+        double parallelTime = MBEBestParseTime(bytes, length, MBEOBJParseModeParallel, iterations, data);
+
+        const char *name = std::strrchr(path, '/') ? std::strrchr(path, '/') + 1 : path;
+        std::printf("%-28s %9.2f %9zu %9zu %12.1f %13.1f\n", name, megabytes, data.positions.size(),
+                    data.faceCount(), megabytes / serialTime, megabytes / parallelTime);
+    }
+
+    return status;
+}
@@ -1,4 +1,11 @@
 #import "MBEMesh.h"
 
 @implementation MBEMesh
+
+- (NSUInteger)indexCount
+{
+    const size_t indexSize = (self.indexType == MTLIndexTypeUInt32) ? sizeof(uint32_t) : sizeof(uint16_t);
+    return [self.indexBuffer length] / indexSize;
+}
+
 @end
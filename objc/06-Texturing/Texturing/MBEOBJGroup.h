@@ -1,4 +1,5 @@
 #import <Foundation/Foundation.h>
+#import <Metal/Metal.h>
 
 @interface MBEOBJGroup : NSObject
 
@@ -7,5 +8,10 @@
 @property (copy) NSString *name;
 @property (copy) NSData *vertexData;
 @property (copy) NSData *indexData;
+/// 16-bit unless the group references more vertices than 16-bit indices can address
+@property (assign) MTLIndexType indexType;
+/// YES when `vertexData` and `indexData` each start on a page boundary and may be read up to the
+/// end of their last page, which lets them back Metal buffers without being copied
+@property (assign, getter=isPageAligned) BOOL pageAligned;
 
 @end
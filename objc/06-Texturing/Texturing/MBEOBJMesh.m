@@ -1,24 +1,52 @@
 #import "MBEOBJMesh.h"
 #import "MBEOBJGroup.h"
 
+#include <unistd.h>
+
+static id<MTLBuffer> MBENewBufferWithData(id<MTLDevice> device, NSData *data, BOOL pageAligned)
+{
+    const NSUInteger pageSize = getpagesize();
+    if (pageAligned && [data length] > 0 && ((uintptr_t)[data bytes] % pageSize) == 0)
+    {
+        // Wrap the mapped pages directly; the deallocator keeps the data (and its mapping) alive
+        NSUInteger paddedLength = ([data length] + pageSize - 1) / pageSize * pageSize;
+        id<MTLBuffer> buffer = [device newBufferWithBytesNoCopy:(void *)[data bytes]
+                                                         length:paddedLength
+                                                        options:MTLResourceOptionCPUCacheModeDefault
+                                                    deallocator:^(void *pointer, NSUInteger length) { [data self]; }];
+        if (buffer)
+        {
+            return buffer;
+        }
+    }
+
+    return [device newBufferWithBytes:[data bytes]
+                               length:[data length]
+                              options:MTLResourceOptionCPUCacheModeDefault];
+}
+
 @implementation MBEOBJMesh
 
 @synthesize indexBuffer=_indexBuffer;
 @synthesize vertexBuffer=_vertexBuffer;
+@synthesize indexType=_indexType;
+@synthesize indexCount=_indexCount;
 
 - (instancetype)initWithGroup:(MBEOBJGroup *)group device:(id<MTLDevice>)device
 {
     if ((self = [super init]))
     {
-        _vertexBuffer = [device newBufferWithBytes:[group.vertexData bytes]
-                                            length:[group.vertexData length]
-                                           options:MTLResourceOptionCPUCacheModeDefault];
+        _vertexBuffer = MBENewBufferWithData(device, group.vertexData, group.isPageAligned);
         [_vertexBuffer setLabel:[NSString stringWithFormat:@"Vertices (%@)", group.name]];
         
-        _indexBuffer = [device newBufferWithBytes:[group.indexData bytes]
-                                           length:[group.indexData length]
-                                          options:MTLResourceOptionCPUCacheModeDefault];
+        _indexBuffer = MBENewBufferWithData(device, group.indexData, group.isPageAligned);
         [_indexBuffer setLabel:[NSString stringWithFormat:@"Indices (%@)", group.name]];
+
+        _indexType = group.indexType;
+
+        // Buffers that wrap mapped pages may be longer than the indices they hold, so count them up front
+        const size_t indexSize = (_indexType == MTLIndexTypeUInt32) ? sizeof(uint32_t) : sizeof(uint16_t);
+        _indexCount = [group.indexData length] / indexSize;
     }
     return self;
 }
@@ -4,6 +4,10 @@
 
 @interface MBEOBJModel : NSObject
 
+/// Loads the model, preferring a fresh mesh cache to parsing the OBJ text. A cache baked next to the
+/// OBJ file (with the same name and an "mbemesh" extension) is tried first, then one in the user's
+/// Caches directory, which is written after the first parse. Caches are keyed to the contents of the
+/// OBJ file, so stale ones are ignored.
 - (instancetype)initWithContentsOfURL:(NSURL *)fileURL generateNormals:(BOOL)generateNormals;
 
 /// Index 0 corresponds to an unnamed group that collects all the geometry
@@ -15,4 +19,9 @@
 /// Retrieve a group from the OBJ file by name
 - (MBEOBJGroup *)groupForName:(NSString *)groupName;
 
+/// Writes the packed groups of this model to a mesh cache at `cacheURL`. Bake steps use this to
+/// produce the cache that ships next to the OBJ file. Returns NO if the model failed to load or
+/// the file couldn't be written.
+- (BOOL)writeMeshCacheToURL:(NSURL *)cacheURL;
+
 @end
@@ -1,50 +1,39 @@
 #import "MBEOBJModel.h"
 #import "MBEOBJGroup.h"
 #import "MBETypes.h"
+#import "MBEOBJParser.h"
+#import "MBEVertexIndexMap.h"
+#import "MBEMappedFile.h"
+#import "MBEContentHash.h"
+#import "MBEMeshCache.h"
+#import "MBEMeshOptimizer.h"
+#import "MBENormalGenerator.h"
 
-#include <map>
 #include <vector>
-#include <functional>
 
 // "Face vertices" are tuples of indices into file-wide lists of positions, normals, and texture coordinates.
 // We maintain a mapping from these triples to the indices they will eventually occupy in the group that
 // is currently being constructed.
-struct FaceVertex
-{
-    FaceVertex() :
-        vi(0), ti(0), ni(0)
-    {
-    }
-    
-    uint16_t vi, ti, ni;
-};
+typedef MBEVertexKey FaceVertex;
 
-static bool operator <(const FaceVertex &v0, const FaceVertex &v1)
-{
-    if (v0.vi < v1.vi)
-        return true;
-    else if (v0.vi > v1.vi)
-        return false;
-    else if (v0.ti < v1.ti)
-        return true;
-    else if (v0.ti > v1.ti)
-        return false;
-    else if (v0.ni < v1.ni)
-        return true;
-    else if (v0.ni > v1.ni)
-        return false;
-    else
-        return false;
-}
+// Groups that reference no more than this many distinct vertices are emitted with 16-bit indices
+static const size_t MBEMaxVertexCountFor16BitIndices = 65536;
+
+static NSString *const MBEMeshCachePathExtension = @"mbemesh";
+
+// Bump this whenever a change to this file alters the vertices or indices it produces, so that
+// previously written caches are rebuilt rather than reused
+static const uint32_t MBEMeshCacheBuilderVersion = 3;
+
+static const uint32_t MBEMeshCacheFlagGeneratedNormals = 1 << 0;
 
 @interface MBEOBJModel ()
 {
-    std::vector<vector_float4> vertices;
-    std::vector<vector_float4> normals;
-    std::vector<vector_float2> texCoords;
+    MBEOBJData objData;
     std::vector<MBEVertex> groupVertices;
-    std::vector<MBEIndex> groupIndices;
-    std::map<FaceVertex, MBEIndex> vertexToGroupIndexMap;
+    std::vector<uint32_t> groupIndices;
+    MBEVertexIndexMap vertexToGroupIndexMap;
+    MBEMeshCacheKey meshCacheKey;
 }
 
 @property (nonatomic, strong) NSMutableArray *mutableGroups;
@@ -61,7 +50,7 @@ static bool operator <(const FaceVertex &v0, const FaceVertex &v1)
     {
         _shouldGenerateNormals = generateNormals;
         _mutableGroups = [NSMutableArray array];
-        [self parseModelAtURL:fileURL];
+        [self loadModelAtURL:fileURL];
     }
     return self;
 }
@@ -85,114 +74,148 @@ static bool operator <(const FaceVertex &v0, const FaceVertex &v1)
     return group;
 }
 
-- (void)parseModelAtURL:(NSURL *)url
+- (void)loadModelAtURL:(NSURL *)url
 {
-    NSError *error = nil;
-    NSString *contents = [NSString stringWithContentsOfURL:url
-                                                  encoding:NSASCIIStringEncoding
-                                                     error:&error];
-    if (!contents)
+    MBEMappedFile source([[url path] fileSystemRepresentation]);
+    if (!source.isValid())
     {
         return;
     }
-    
-    NSScanner *scanner = [NSScanner scannerWithString:contents];
-    
-    NSCharacterSet *skipSet = [NSCharacterSet whitespaceAndNewlineCharacterSet];
-    NSCharacterSet *consumeSet = [skipSet invertedSet];
-    
-    scanner.charactersToBeSkipped = skipSet;
-    
-    NSCharacterSet *endlineCharacters = [NSCharacterSet newlineCharacterSet];
-    
-    [self beginGroupWithName:@"(unnamed)"];
-    
-    while (![scanner isAtEnd])
+
+    // Hashing the source is far cheaper than parsing it, and it lets us detect stale caches reliably
+    meshCacheKey.sourceHash = MBEContentHash64(source.bytes(), source.length());
+    meshCacheKey.sourceLength = source.length();
+    meshCacheKey.vertexStride = sizeof(MBEVertex);
+    meshCacheKey.builderVersion = MBEMeshCacheBuilderVersion;
+    meshCacheKey.flags = self.shouldGenerateNormals ? MBEMeshCacheFlagGeneratedNormals : 0;
+
+    NSURL *bakedCacheURL = [[url URLByDeletingPathExtension] URLByAppendingPathExtension:MBEMeshCachePathExtension];
+    NSURL *userCacheURL = [self userMeshCacheURLForModelAtURL:url];
+
+    if ([self loadMeshCacheAtURL:bakedCacheURL] || (userCacheURL && [self loadMeshCacheAtURL:userCacheURL]))
     {
-        NSString *token = nil;
-        if (![scanner scanCharactersFromSet:consumeSet intoString:&token])
-        {
-            break;
-        }
-        
-        if ([token isEqualToString:@"v"])
-        {
-            float x, y, z;
-            [scanner scanFloat:&x];
-            [scanner scanFloat:&y];
-            [scanner scanFloat:&z];
-            
-            vector_float4 v = { x, y, z, 1 };
-            vertices.push_back(v);
-        }
-        else if ([token isEqualToString:@"vt"])
+        return;
+    }
+
+    [self parseModelWithBytes:(const char *)source.bytes() length:source.length()];
+
+    if (userCacheURL)
+    {
+        [self writeMeshCacheToURL:userCacheURL];
+    }
+}
+
+- (NSURL *)userMeshCacheURLForModelAtURL:(NSURL *)url
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSURL *cachesURL = [[fileManager URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask] firstObject];
+    NSURL *directoryURL = [cachesURL URLByAppendingPathComponent:@"MBEMeshCache" isDirectory:YES];
+    if (![fileManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:nil])
+    {
+        return nil;
+    }
+
+    NSString *fileName = [[[url lastPathComponent] stringByDeletingPathExtension] stringByAppendingPathExtension:MBEMeshCachePathExtension];
+    return [directoryURL URLByAppendingPathComponent:fileName];
+}
+
+- (BOOL)loadMeshCacheAtURL:(NSURL *)cacheURL
+{
+    std::shared_ptr<MBEMeshCache> cache = MBEMeshCache::open([[cacheURL path] fileSystemRepresentation], meshCacheKey);
+    if (!cache)
+    {
+        return NO;
+    }
+
+    for (const MBEMeshCacheGroup &cachedGroup : cache->groups())
+    {
+        MBEOBJGroup *group = [[MBEOBJGroup alloc] initWithName:[NSString stringWithUTF8String:cachedGroup.name.c_str()]];
+
+        // The group data points straight into the mapping, which stays alive until the last of them is released
+        group.vertexData = [[NSData alloc] initWithBytesNoCopy:(void *)cachedGroup.vertices
+                                                        length:cachedGroup.vertexCount * sizeof(MBEVertex)
+                                                   deallocator:^(void *bytes, NSUInteger length) { (void)cache; }];
+        group.indexData = [[NSData alloc] initWithBytesNoCopy:(void *)cachedGroup.indices
+                                                       length:cachedGroup.indexCount * cachedGroup.indexSize
+                                                  deallocator:^(void *bytes, NSUInteger length) { (void)cache; }];
+        group.indexType = (cachedGroup.indexSize == sizeof(uint32_t)) ? MTLIndexTypeUInt32 : MTLIndexTypeUInt16;
+        group.pageAligned = YES;
+
+        [self.mutableGroups addObject:group];
+    }
+
+    return YES;
+}
+
+- (BOOL)writeMeshCacheToURL:(NSURL *)cacheURL
+{
+    if ([self.mutableGroups count] == 0)
+    {
+        return NO;
+    }
+
+    std::vector<MBEMeshCacheGroup> cachedGroups;
+    for (MBEOBJGroup *group in self.mutableGroups)
+    {
+        MBEMeshCacheGroup cachedGroup;
+        cachedGroup.name = [group.name UTF8String];
+        cachedGroup.vertices = [group.vertexData bytes];
+        cachedGroup.vertexCount = [group.vertexData length] / sizeof(MBEVertex);
+        cachedGroup.indexSize = (group.indexType == MTLIndexTypeUInt32) ? sizeof(uint32_t) : sizeof(uint16_t);
+        cachedGroup.indices = [group.indexData bytes];
+        cachedGroup.indexCount = [group.indexData length] / cachedGroup.indexSize;
+        cachedGroups.push_back(cachedGroup);
+    }
+
+    return MBEMeshCache::write([[cacheURL path] fileSystemRepresentation], meshCacheKey, cachedGroups);
+}
+
+- (void)parseModelWithBytes:(const char *)bytes length:(size_t)length
+{
+    MBEOBJParseBytes(bytes, length, objData, MBEOBJParseModeParallel);
+
+    std::vector<FaceVertex> faceVertices;
+    faceVertices.reserve(4);
+
+    for (size_t g = 0; g < objData.groups.size(); ++g)
+    {
+        const MBEOBJGroupRange &range = objData.groups[g];
+
+        if (g == 0)
         {
-            float u = 0, v = 0;
-            [scanner scanFloat:&u];
-            [scanner scanFloat:&v];
-            
-            vector_float2 vt = { u, v };
-            texCoords.push_back(vt);
+            [self beginGroupWithName:@"(unnamed)"];
         }
-        else if ([token isEqualToString:@"vn"])
+        else
         {
-            float nx = 0, ny = 0, nz = 0;
-            [scanner scanFloat:&nx];
-            [scanner scanFloat:&ny];
-            [scanner scanFloat:&nz];
-            
-            vector_float4 vn = { nx, ny, nz, 0 };
-            normals.push_back(vn);
+            [self beginGroupWithName:[NSString stringWithUTF8String:range.name.c_str()]];
         }
-        else if ([token isEqualToString:@"f"])
+
+        for (size_t f = range.firstFace; f < range.firstFace + range.faceCount; ++f)
         {
-            std::vector<FaceVertex> faceVertices;
-            faceVertices.reserve(4);
-            
-            while (1)
+            faceVertices.clear();
+
+            for (uint32_t c = objData.faceStarts[f]; c < objData.faceStarts[f + 1]; ++c)
             {
-                int32_t vi = 0, ti = 0, ni = 0;
-                if(![scanner scanInt:&vi])
-                {
-                    break;
-                }
-
-                if ([scanner scanString:@"/" intoString:NULL])
-                {
-                    [scanner scanInt:&ti];
-                    
-                    if ([scanner scanString:@"/" intoString:NULL])
-                    {
-                        [scanner scanInt:&ni];
-                    }
-                }
-                
+                const MBEOBJFaceCorner &corner = objData.corners[c];
+
+                // The parser has already made the indices 0-based and resolved relative references.
+                // Omitted texture coordinates and normals map to INVALID_INDEX.
                 FaceVertex faceVertex;
-                
-                // OBJ format allows relative vertex references in the form of negative indices, and
-                // dictates that indices are 1-based. Below, we simultaneously fix up negative indices
-                // and offset everything by -1 to allow 0-based indexing later on.
-                
-                faceVertex.vi = (vi < 0) ? (vertices.size() + vi - 1) : (vi - 1);
-                faceVertex.ti = (ti < 0) ? (texCoords.size() + ti - 1) : (ti - 1);
-                faceVertex.ni = (ni < 0) ? (vertices.size() + ni - 1) : (ni - 1);
+                faceVertex.vi = corner.vi;
+                faceVertex.ti = corner.ti;
+                faceVertex.ni = corner.ni;
 
                 faceVertices.push_back(faceVertex);
             }
-            
+
             [self addFaceWithFaceVertices:faceVertices];
         }
-        else if ([token isEqualToString:@"g"])
-        {
-            NSString *groupName = nil;
-            if ([scanner scanUpToCharactersFromSet:endlineCharacters intoString:&groupName])
-            {
-                [self beginGroupWithName:groupName];
-            }
-        }
     }
-    
+
     [self endCurrentGroup];
+
+    // The file-wide attribute lists are only needed while building groups
+    objData = MBEOBJData();
 }
 
 - (void)beginGroupWithName:(NSString *)name
@@ -215,7 +238,20 @@ static bool operator <(const FaceVertex &v0, const FaceVertex &v1)
     {
         [self generateNormalsForCurrentGroup];
     }
-    
+
+    // Fan triangulation emits triangles in file order, so reorder them for the post-transform vertex
+    // cache and then reorder the vertices to match, before anything is packed
+    if (!groupIndices.empty())
+    {
+        MBEMeshOptimizationReport report = MBEOptimizeMeshUInt32(groupVertices.data(), sizeof(MBEVertex), groupVertices.size(),
+                                                                 groupIndices.data(), groupIndices.size());
+        groupVertices.resize(report.vertexCount);
+#if DEBUG
+        NSLog(@"Optimized group %@: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f", self.currentGroup.name,
+              report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+#endif
+    }
+
     // Once we've read a complete group, we copy the packed vertices that have been referenced by the group
     // into the current group object. Because it's fairly uncommon to have cross-group shared vertices, this
     // essentially divides up the vertices into disjoint sets by group.
@@ -223,8 +259,25 @@ static bool operator <(const FaceVertex &v0, const FaceVertex &v1)
     NSData *vertexData = [NSData dataWithBytes:groupVertices.data() length:sizeof(MBEVertex) * groupVertices.size()];
     self.currentGroup.vertexData = vertexData;
 
-    NSData *indexData = [NSData dataWithBytes:groupIndices.data() length:sizeof(MBEIndex) * groupIndices.size()];
-    self.currentGroup.indexData = indexData;
+    // Indices are accumulated at 32 bits and narrowed when the group is small enough, which halves the
+    // index buffer size for typical meshes without truncating large ones.
+    if (groupVertices.size() <= MBEMaxVertexCountFor16BitIndices)
+    {
+        NSMutableData *indexData = [NSMutableData dataWithLength:sizeof(uint16_t) * groupIndices.size()];
+        uint16_t *indices = (uint16_t *)[indexData mutableBytes];
+        for (size_t i = 0; i < groupIndices.size(); ++i)
+        {
+            indices[i] = (uint16_t)groupIndices[i];
+        }
+        self.currentGroup.indexData = indexData;
+        self.currentGroup.indexType = MTLIndexTypeUInt16;
+    }
+    else
+    {
+        NSData *indexData = [NSData dataWithBytes:groupIndices.data() length:sizeof(uint32_t) * groupIndices.size()];
+        self.currentGroup.indexData = indexData;
+        self.currentGroup.indexType = MTLIndexTypeUInt32;
+    }
 
     groupVertices.clear();
     groupIndices.clear();
@@ -235,42 +288,16 @@ static bool operator <(const FaceVertex &v0, const FaceVertex &v1)
 
 - (void)generateNormalsForCurrentGroup
 {
-    static const vector_float4 ZERO = { 0, 0, 0, 0 };
-    
-    size_t i;
-    size_t vertexCount = groupVertices.size();
-    for (i = 0; i < vertexCount; ++i)
-    {
-        groupVertices[i].normal = ZERO;
-    }
-
-    size_t indexCount = groupIndices.size();
-    for (i = 0; i < indexCount; i += 3)
+    if (groupVertices.empty())
     {
-        uint16_t i0 = groupIndices[i];
-        uint16_t i1 = groupIndices[i + 1];
-        uint16_t i2 = groupIndices[i + 2];
-        
-        MBEVertex *v0 = &groupVertices[i0];
-        MBEVertex *v1 = &groupVertices[i1];
-        MBEVertex *v2 = &groupVertices[i2];
-        
-        vector_float3 p0 = v0->position.xyz;
-        vector_float3 p1 = v1->position.xyz;
-        vector_float3 p2 = v2->position.xyz;
-        
-        vector_float3 cross = vector_cross((p1 - p0), (p2 - p0));
-        vector_float4 cross4 = { cross.x, cross.y, cross.z, 0 };
-
-        v0->normal += cross4;
-        v1->normal += cross4;
-        v2->normal += cross4;
+        return;
     }
 
-    for (i = 0; i < vertexCount; ++i)
-    {
-        groupVertices[i].normal = vector_normalize(groupVertices[i].normal);
-    }
+    // Angle weighting keeps the long, thin triangles of polygon fans from pulling the normals of
+    // their shared vertices toward themselves
+    MBEGenerateNormalsUInt32((const float *)&groupVertices[0].position, sizeof(MBEVertex),
+                             (float *)&groupVertices[0].normal, sizeof(MBEVertex), groupVertices.size(),
+                             groupIndices.data(), groupIndices.size(), MBENormalWeightingAngle);
 }
 
 - (void)addFaceWithFaceVertices:(const std::vector<FaceVertex> &)faceVertices
@@ -289,25 +316,39 @@ static bool operator <(const FaceVertex &v0, const FaceVertex &v1)
     static const vector_float4 UP = { 0, 1, 0, 0 };
     static const vector_float2 ZERO2 = { 0, 0 };
 //    static const vector_float4 RGBA_WHITE = { 1, 1, 1, 1 };
-    static const uint16_t INVALID_INDEX = 0xffff;
+    static const uint32_t INVALID_INDEX = MBEOBJInvalidIndex;
     
-    uint16_t groupIndex;
-    auto it = vertexToGroupIndexMap.find(fv);
-    if (it != vertexToGroupIndexMap.end())
-    {
-        groupIndex = (*it).second;
-    }
-    else
+    bool inserted = false;
+    uint32_t groupIndex = vertexToGroupIndexMap.findOrInsert(fv, (uint32_t)groupVertices.size(), inserted);
+    if (inserted)
     {
         MBEVertex vertex;
-        vertex.position = vertices[fv.vi];
-        vertex.normal = (fv.ni != INVALID_INDEX) ? normals[fv.ni] : UP;
+        const MBEOBJFloat3 &p = objData.positions[fv.vi];
+        vector_float4 position = { p.x, p.y, p.z, 1 };
+        vertex.position = position;
+        if (fv.ni != INVALID_INDEX)
+        {
+            const MBEOBJFloat3 &n = objData.normals[fv.ni];
+            vector_float4 normal = { n.x, n.y, n.z, 0 };
+            vertex.normal = normal;
+        }
+        else
+        {
+            vertex.normal = UP;
+        }
 //        vertex.diffuseColor = RGBA_WHITE;
-        vertex.texCoords = (fv.ti != INVALID_INDEX) ? texCoords[fv.ti] : ZERO2;
+        if (fv.ti != INVALID_INDEX)
+        {
+            const MBEOBJFloat2 &t = objData.texCoords[fv.ti];
+            vector_float2 texCoords = { t.x, t.y };
+            vertex.texCoords = texCoords;
+        }
+        else
+        {
+            vertex.texCoords = ZERO2;
+        }
 
         groupVertices.push_back(vertex);
-        groupIndex = groupVertices.size() - 1;
-        vertexToGroupIndexMap[fv] = groupIndex;
     }
     
     groupIndices.push_back(groupIndex);
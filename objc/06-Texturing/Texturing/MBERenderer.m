@@ -159,8 +159,8 @@ static const uint32_t MBEBufferAlignment = 256;
         [renderPass setFragmentSamplerState:self.samplerState atIndex:0];
 
         [renderPass drawIndexedPrimitives:MTLPrimitiveTypeTriangle
-                               indexCount:[self.mesh.indexBuffer length] / sizeof(MBEIndex)
-                                indexType:MBEIndexType
+                               indexCount:self.mesh.indexCount
+                                indexType:self.mesh.indexType
                               indexBuffer:self.mesh.indexBuffer
                         indexBufferOffset:0];
 
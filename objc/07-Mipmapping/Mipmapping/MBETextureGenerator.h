@@ -4,9 +4,9 @@
 @interface MBETextureGenerator : NSObject
 
 /// Generates a square checkerboard texture with the specified number of tiles.
-/// If `colorfulMipmaps` is YES, mipmap levels will be generated on the CPU and tinted
-/// to be visually distinct when drawn. Otherwise, the blit command encoder is used to
-/// generate all mipmap levels on the GPU.
+/// If `colorfulMipmaps` is YES, mipmap levels will be generated on the CPU with a
+/// gamma-correct Kaiser filter and tinted to be visually distinct when drawn. Otherwise,
+/// the blit command encoder is used to generate all mipmap levels on the GPU.
 + (void)checkerboardTextureWithSize:(CGSize)size
                           tileCount:(size_t)tileCount
                     colorfulMipmaps:(BOOL)colorfulMipmaps
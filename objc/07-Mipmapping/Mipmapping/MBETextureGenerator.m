@@ -1,4 +1,5 @@
 #import "MBETextureGenerator.h"
+#import "MBEMipmapGenerator.h"
 
 static const NSUInteger bytesPerPixel = 4;
 
@@ -10,36 +11,48 @@ static const NSUInteger bytesPerPixel = 4;
                              device:(id<MTLDevice>)device
                          completion:(void (^)(id<MTLTexture>))completionBlock
 {
-    const NSUInteger bytesPerRow = bytesPerPixel * size.width;
+    const uint32_t width = size.width;
+    const uint32_t height = size.height;
     
     MTLTextureDescriptor *descriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA8Unorm
-                                                                                          width:size.width
-                                                                                         height:size.height
+                                                                                          width:width
+                                                                                         height:height
                                                                                       mipmapped:YES];
     
     id<MTLTexture> texture = [device newTextureWithDescriptor:descriptor];
     
-    CGImageRef image;
-    NSData *baseLevelData = [self createCheckerboardImageDataWithSize:size tileCount:tileCount image:&image];
+    // When the mipmaps are generated on the CPU, every level lives in one allocation along with the image
+    const uint32_t levelCount = colorfulMipmaps ? MBEMipmapLevelCount(width, height) : 1;
+    MBEMipmapLevel *levels = (MBEMipmapLevel *)calloc(levelCount, sizeof(MBEMipmapLevel));
+    const size_t chainLength = MBEMipmapChainLayout(width, height, levelCount, MBEMipmapPixelFormatRGBA8Unorm,
+                                                    bytesPerPixel, levels);
+    uint8_t *chain = (uint8_t *)calloc(chainLength, sizeof(uint8_t));
     
-    MTLRegion region = MTLRegionMake2D(0, 0, size.width, size.height);
-    [texture replaceRegion:region mipmapLevel:0 withBytes:[baseLevelData bytes] bytesPerRow:bytesPerRow];
+    [self drawCheckerboardImageWithSize:size tileCount:tileCount data:chain + levels[0].offset];
     
     if (colorfulMipmaps)
     {
         [self generateTintedMipmapsForTexture:texture
-                                        image:image
+                                        chain:chain
+                                       levels:levels
+                                   levelCount:levelCount
                               completionBlock:completionBlock];
     }
     else
     {
+        MTLRegion region = MTLRegionMake2D(0, 0, width, height);
+        [texture replaceRegion:region mipmapLevel:0 withBytes:chain + levels[0].offset bytesPerRow:levels[0].bytesPerRow];
+        
         [self generateMipmapsAcceleratedForTexture:texture
                                             device:device
                                    completionBlock:completionBlock];
     }
+    
+    free(chain);
+    free(levels);
 }
 
-+ (NSData *)createCheckerboardImageDataWithSize:(CGSize)size tileCount:(size_t)tileCount image:(CGImageRef *)outImage
++ (void)drawCheckerboardImageWithSize:(CGSize)size tileCount:(size_t)tileCount data:(uint8_t *)data
 {
     const NSUInteger width = size.width;
     const NSUInteger height = size.height;
@@ -52,8 +65,6 @@ static const NSUInteger bytesPerPixel = 4;
     }
     
     CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-    size_t dataLength = height * width * bytesPerPixel;
-    uint8_t *data = (uint8_t *)calloc(dataLength, sizeof(uint8_t));
     const NSUInteger bytesPerRow = bytesPerPixel * width;
     const NSUInteger bitsPerComponent = 8;
     CGContextRef context = CGBitmapContextCreate(data,
@@ -85,49 +96,44 @@ static const NSUInteger bytesPerPixel = 4;
         }
     }
     
-    if (outImage)
-    {
-        *outImage = CGBitmapContextCreateImage(context);
-    }
-    
     CGContextRelease(context);
-    
-    return [NSData dataWithBytesNoCopy:data length:dataLength freeWhenDone:YES];
 }
 
 + (void)generateTintedMipmapsForTexture:(id<MTLTexture>)texture
-                                  image:(CGImageRef)image
+                                  chain:(uint8_t *)chain
+                                 levels:(const MBEMipmapLevel *)levels
+                             levelCount:(uint32_t)levelCount
                         completionBlock:(void (^)(id<MTLTexture>))completionBlock
 {
-    NSUInteger level = 1;
-    NSUInteger mipWidth = [texture width] / 2;
-    NSUInteger mipHeight = [texture height] / 2;
-    CGImageRef scaledImage;
-    CGImageRetain(image);
+    // The checkerboard is drawn in device RGB, which is sRGB-encoded, so it is filtered in linear space;
+    // otherwise distant tiles would blend to a gray darker than the average of light and dark
+    MBEGenerateMipmapChain(chain, levels, levelCount, MBEMipmapPixelFormatRGBA8Unorm_sRGB,
+                           MBEMipmapFilterKaiser, MBEMipmapEdgeModeClamp);
     
-    while (mipWidth >= 1 && mipHeight >= 1)
+    for (uint32_t level = 0; level < levelCount; ++level)
     {
-        NSUInteger mipBytesPerRow = bytesPerPixel * mipWidth;
-        
-        UIColor *tintColor = [self tintColorAtIndex:level - 1];
-        NSData *mipData = [self createResizedImageDataForImage:image
-                                                          size:CGSizeMake(mipWidth, mipHeight)
-                                                     tintColor:tintColor
-                                                         image:&scaledImage];
-        
-        CGImageRelease(image);
-        image = scaledImage;
+        const MBEMipmapLevel mip = levels[level];
+        uint8_t *mipData = chain + mip.offset;
         
-        MTLRegion region = MTLRegionMake2D(0, 0, mipWidth, mipHeight);
-        [texture replaceRegion:region mipmapLevel:level withBytes:[mipData bytes] bytesPerRow:mipBytesPerRow];
+        if (level > 0)
+        {
+            UIColor *tintColor = [self tintColorAtIndex:level - 1];
+            CGFloat r, g, b, a;
+            [tintColor getRed:&r green:&g blue:&b alpha:&a];
+            
+            for (size_t i = 0; i < (size_t)mip.width * mip.height; ++i)
+            {
+                uint8_t *pixel = mipData + i * bytesPerPixel;
+                pixel[0] = pixel[0] * r;
+                pixel[1] = pixel[1] * g;
+                pixel[2] = pixel[2] * b;
+            }
+        }
         
-        mipWidth /= 2;
-        mipHeight /= 2;
-        ++level;
+        MTLRegion region = MTLRegionMake2D(0, 0, mip.width, mip.height);
+        [texture replaceRegion:region mipmapLevel:level withBytes:mipData bytesPerRow:mip.bytesPerRow];
     }
     
-    CGImageRelease(image);
-    
     completionBlock(texture);
 }
 
@@ -146,51 +152,6 @@ static const NSUInteger bytesPerPixel = 4;
     [commandBuffer commit];
 }
 
-+ (NSData *)createResizedImageDataForImage:(CGImageRef)image
-                                      size:(CGSize)size
-                                 tintColor:(UIColor *)tintColor
-                                     image:(CGImageRef *)outImage
-{
-    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-    size_t dataLength = size.height * size.width * 4;
-    uint8_t *data = (uint8_t *)calloc(dataLength, sizeof(uint8_t));
-    const NSUInteger bitsPerComponent = 8;
-    const NSUInteger bytesPerPixel = 4;
-    const NSUInteger bytesPerRow = bytesPerPixel * size.width;
-    
-    CGContextRef context = CGBitmapContextCreate(data,
-                                                 size.width,
-                                                 size.height,
-                                                 bitsPerComponent,
-                                                 bytesPerRow,
-                                                 colorSpace,
-                                                 kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
-    
-    CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
-
-    CGRect targetRect = CGRectMake(0, 0, size.width, size.height);
-    CGContextDrawImage(context, targetRect, image);
-    
-    if (outImage)
-    {
-        *outImage = CGBitmapContextCreateImage(context);
-    }
-
-    if (tintColor)
-    {
-        CGFloat r, g, b, a;
-        [tintColor getRed:&r green:&g blue:&b alpha:&a];
-        CGContextSetRGBFillColor(context, r, g, b, 1);
-        CGContextSetBlendMode (context, kCGBlendModeMultiply);
-        CGContextFillRect (context, targetRect);
-    }
-
-    CFRelease(colorSpace);
-    CFRelease(context);
-    
-    return [NSData dataWithBytesNoCopy:data length:dataLength freeWhenDone:YES];
-}
-
 + (UIColor *)tintColorAtIndex:(size_t)index
 {
     switch (index % 7) {
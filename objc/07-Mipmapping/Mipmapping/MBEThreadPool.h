@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// A fixed set of worker threads for data-parallel loops. The calling thread always takes part
+/// in the work, so a pool with no workers simply runs loops inline.
+class MBEThreadPool
+{
+public:
+    /// Creates a pool whose loops run on `threadCount` threads in total, including the caller.
+    /// Passing zero uses one thread per hardware core.
+    explicit MBEThreadPool(unsigned threadCount = 0);
+    ~MBEThreadPool();
+
+    /// A process-wide pool sized to the machine
+    static MBEThreadPool &sharedPool();
+
+    /// The number of threads that participate in a loop, including the caller
+    unsigned threadCount() const { return (unsigned)_workers.size() + 1; }
+
+    /// Invokes `body(i)` for every `i` in [0, count) and returns once all invocations have finished.
+    /// Iterations are handed out dynamically, so they may run in any order. If the pool is already
+    /// running a loop (for example, when called from inside another loop body, on any thread), the
+    /// iterations run serially on the calling thread instead.
+    void parallelFor(size_t count, const std::function<void(size_t)> &body);
+
+private:
+    MBEThreadPool(const MBEThreadPool &) = delete;
+    MBEThreadPool &operator=(const MBEThreadPool &) = delete;
+
+    void workerMain();
+    void runIterations();
+
+    std::vector<std::thread> _workers;
+    std::mutex _dispatchMutex;
+    std::atomic<std::thread::id> _dispatchingThread; // the holder of _dispatchMutex, if any
+    std::mutex _mutex;
+    std::condition_variable _wakeCondition;
+    std::condition_variable _doneCondition;
+    const std::function<void(size_t)> *_body;
+    size_t _count;
+    std::atomic<size_t> _nextIteration;
+    size_t _busyWorkers;
+    size_t _generation;
+    bool _stopping;
+};
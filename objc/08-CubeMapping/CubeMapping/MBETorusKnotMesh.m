@@ -1,5 +1,6 @@
 #import "MBETorusKnotMesh.h"
 #import "MBETypes.h"
+#import "MBEMeshOptimizer.h"
 @import simd;
 
 @interface MBETorusKnotMesh ()
@@ -131,6 +132,14 @@
         indices[i++] = vi + self.slices + 1;
     }
 
+    // The rings above are emitted in scan order, which reuses few vertices from the post-transform cache
+    MBEMeshOptimizationReport report = MBEOptimizeMeshUInt16(vertices, sizeof(MBEVertex), vertexCount, indices, indexCount);
+    vertexCount = report.vertexCount;
+#if DEBUG
+    NSLog(@"Optimized torus knot: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+          report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+#endif
+
     _vertexBuffer = [self.device newBufferWithBytes:vertices
                                              length:sizeof(MBEVertex) * vertexCount
                                             options:0];
@@ -0,0 +1,431 @@
+#include "MBEETCDecoder.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+
+namespace
+{
+    // Enough block rows per task to amortize dispatch, while leaving large levels plenty of tasks to balance
+    const size_t BlocksPerTask = 1024;
+
+    // The intensity modifiers of ETC1 and of ETC2's individual and differential modes, by table codeword
+    const int ETCModifiers[8][2] = {
+        { 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 },
+    };
+
+    // The distances between paint colors in the T and H modes
+    const int ETCDistances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+    const int EACModifiers[16][8] = {
+        { -3, -6, -9, -15, 2, 5, 8, 14 },
+        { -3, -7, -10, -13, 2, 6, 9, 12 },
+        { -2, -5, -8, -13, 1, 4, 7, 12 },
+        { -2, -4, -6, -13, 1, 3, 5, 12 },
+        { -3, -6, -8, -12, 2, 5, 7, 11 },
+        { -3, -7, -9, -11, 2, 6, 8, 10 },
+        { -4, -7, -8, -11, 3, 6, 7, 10 },
+        { -3, -5, -8, -11, 2, 4, 7, 10 },
+        { -2, -6, -8, -10, 1, 5, 7, 9 },
+        { -2, -5, -8, -10, 1, 4, 7, 9 },
+        { -2, -4, -8, -10, 1, 3, 7, 9 },
+        { -2, -5, -7, -10, 1, 4, 6, 9 },
+        { -3, -4, -7, -10, 2, 3, 6, 9 },
+        { -1, -2, -3, -10, 0, 1, 2, 9 },
+        { -4, -6, -8, -9, 3, 5, 7, 8 },
+        { -3, -5, -7, -9, 2, 4, 6, 8 },
+    };
+
+    /// A decoded 4 x 4 block. Pixel p is at column p / 4 and row p % 4, the order in which ETC stores them.
+    struct Block
+    {
+        uint8_t rgba[16][4];
+        uint16_t values[16][2];
+    };
+
+    uint64_t ReadBigEndian64(const uint8_t *bytes)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    uint32_t Bits(uint64_t block, int lowBit, int count)
+    {
+        return (uint32_t)(block >> lowBit) & ((1u << count) - 1);
+    }
+
+    uint8_t Clamp255(int value)
+    {
+        return (uint8_t)std::min(std::max(value, 0), 255);
+    }
+
+    int Extend4(uint32_t value) { return (int)((value << 4) | value); }
+    int Extend5(uint32_t value) { return (int)((value << 3) | (value >> 2)); }
+    int Extend6(uint32_t value) { return (int)((value << 2) | (value >> 4)); }
+    int Extend7(uint32_t value) { return (int)((value << 1) | (value >> 6)); }
+
+    int SignExtend3(uint32_t value)
+    {
+        return (value & 4) ? (int)value - 8 : (int)value;
+    }
+
+    void SetPixel(Block &block, int p, int r, int g, int b, int a)
+    {
+        block.rgba[p][0] = Clamp255(r);
+        block.rgba[p][1] = Clamp255(g);
+        block.rgba[p][2] = Clamp255(b);
+        block.rgba[p][3] = (uint8_t)a;
+    }
+
+    // The two-bit index of pixel p, as (most significant bit << 1) | least significant bit
+    uint32_t PixelIndex(uint64_t bits, int p)
+    {
+        return (Bits(bits, 16 + p, 1) << 1) | Bits(bits, p, 1);
+    }
+
+    /// Decodes an ETC2 color block, which is also an ETC1 block when it uses neither the T, H nor planar
+    /// modes. With `punchthrough`, the differential bit is instead the opaque bit of RGB8A1.
+    void DecodeColorBlock(const uint8_t *bytes, bool punchthrough, Block &block)
+    {
+        const uint64_t bits = ReadBigEndian64(bytes);
+        const bool differential = punchthrough || Bits(bits, 33, 1);
+        const bool opaque = !punchthrough || Bits(bits, 33, 1);
+        const bool flip = Bits(bits, 32, 1);
+
+        int base[2][3];
+        if (!differential)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                base[0][c] = Extend4(Bits(bits, 60 - c * 8, 4));
+                base[1][c] = Extend4(Bits(bits, 56 - c * 8, 4));
+            }
+        }
+        else
+        {
+            int first[3], second[3];
+            for (int c = 0; c < 3; ++c)
+            {
+                first[c] = (int)Bits(bits, 59 - c * 8, 5);
+                second[c] = first[c] + SignExtend3(Bits(bits, 56 - c * 8, 3));
+            }
+
+            // An overflowing red, green or blue selects the T, H or planar mode respectively
+            if (second[0] < 0 || second[0] > 31)
+            {
+                const int colors[2][3] = {
+                    { Extend4((Bits(bits, 59, 2) << 2) | Bits(bits, 56, 2)), Extend4(Bits(bits, 52, 4)), Extend4(Bits(bits, 48, 4)) },
+                    { Extend4(Bits(bits, 44, 4)), Extend4(Bits(bits, 40, 4)), Extend4(Bits(bits, 36, 4)) },
+                };
+                const int distance = ETCDistances[(Bits(bits, 34, 2) << 1) | Bits(bits, 32, 1)];
+                const int offsets[4] = { 0, distance, 0, -distance };
+                for (int p = 0; p < 16; ++p)
+                {
+                    const uint32_t index = PixelIndex(bits, p);
+                    const int *color = colors[index == 0 ? 0 : 1];
+                    if (!opaque && index == 2)
+                    {
+                        SetPixel(block, p, 0, 0, 0, 0);
+                        continue;
+                    }
+                    SetPixel(block, p, color[0] + offsets[index], color[1] + offsets[index], color[2] + offsets[index], 255);
+                }
+                return;
+            }
+
+            if (second[1] < 0 || second[1] > 31)
+            {
+                const uint32_t packed[2] = {
+                    (Bits(bits, 59, 4) << 8) | (((Bits(bits, 56, 3) << 1) | Bits(bits, 52, 1)) << 4) |
+                    (Bits(bits, 51, 1) << 3) | Bits(bits, 47, 3),
+                    (Bits(bits, 43, 4) << 8) | (Bits(bits, 39, 4) << 4) | Bits(bits, 35, 4),
+                };
+                int colors[2][3];
+                for (int i = 0; i < 2; ++i)
+                {
+                    colors[i][0] = Extend4(packed[i] >> 8);
+                    colors[i][1] = Extend4((packed[i] >> 4) & 0xF);
+                    colors[i][2] = Extend4(packed[i] & 0xF);
+                }
+
+                // The lowest bit of the distance is implied by the order of the two base colors
+                const uint32_t distanceIndex = (Bits(bits, 34, 1) << 2) | (Bits(bits, 32, 1) << 1) | (packed[0] >= packed[1]);
+                const int distance = ETCDistances[distanceIndex];
+                for (int p = 0; p < 16; ++p)
+                {
+                    const uint32_t index = PixelIndex(bits, p);
+                    const int *color = colors[index >> 1];
+                    const int offset = (index & 1) ? -distance : distance;
+                    if (!opaque && index == 2)
+                    {
+                        SetPixel(block, p, 0, 0, 0, 0);
+                        continue;
+                    }
+                    SetPixel(block, p, color[0] + offset, color[1] + offset, color[2] + offset, 255);
+                }
+                return;
+            }
+
+            if (second[2] < 0 || second[2] > 31)
+            {
+                const int origin[3] = {
+                    Extend6(Bits(bits, 57, 6)),
+                    Extend7((Bits(bits, 56, 1) << 6) | Bits(bits, 49, 6)),
+                    Extend6((Bits(bits, 48, 1) << 5) | (Bits(bits, 43, 2) << 3) | Bits(bits, 39, 3)),
+                };
+                const int horizontal[3] = {
+                    Extend6((Bits(bits, 34, 5) << 1) | Bits(bits, 32, 1)),
+                    Extend7(Bits(bits, 25, 7)),
+                    Extend6(Bits(bits, 19, 6)),
+                };
+                const int vertical[3] = {
+                    Extend6(Bits(bits, 13, 6)),
+                    Extend7(Bits(bits, 6, 7)),
+                    Extend6(Bits(bits, 0, 6)),
+                };
+                for (int p = 0; p < 16; ++p)
+                {
+                    const int x = p / 4, y = p % 4;
+                    int color[3];
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        color[c] = (x * (horizontal[c] - origin[c]) + y * (vertical[c] - origin[c]) + 4 * origin[c] + 2) >> 2;
+                    }
+                    SetPixel(block, p, color[0], color[1], color[2], 255);
+                }
+                return;
+            }
+
+            for (int c = 0; c < 3; ++c)
+            {
+                base[0][c] = Extend5((uint32_t)first[c]);
+                base[1][c] = Extend5((uint32_t)second[c]);
+            }
+        }
+
+        const int *tables[2] = { ETCModifiers[Bits(bits, 37, 3)], ETCModifiers[Bits(bits, 34, 3)] };
+        for (int p = 0; p < 16; ++p)
+        {
+            const int x = p / 4, y = p % 4;
+            const int subblock = flip ? (y >= 2) : (x >= 2);
+            const uint32_t index = PixelIndex(bits, p);
+
+            // Without the opaque bit, the smaller positive modifier becomes a transparent pixel and the
+            // smaller negative one becomes no modification at all
+            int modifier = tables[subblock][index & 1];
+            if (!opaque && index == 2)
+            {
+                SetPixel(block, p, 0, 0, 0, 0);
+                continue;
+            }
+            if (!opaque && index == 0)
+            {
+                modifier = 0;
+            }
+            if (index & 2)
+            {
+                modifier = -modifier;
+            }
+
+            const int *color = base[subblock];
+            SetPixel(block, p, color[0] + modifier, color[1] + modifier, color[2] + modifier, 255);
+        }
+    }
+
+    /// Decodes an EAC block into 8-bit values (for the alpha of RGBA8) or 11-bit values (for R11 and RG11)
+    void DecodeEACBlock(const uint8_t *bytes, bool elevenBit, uint8_t *alphas, size_t alphaStride,
+                        uint16_t *values, size_t valueStride)
+    {
+        const uint64_t bits = ReadBigEndian64(bytes);
+        const int base = (int)Bits(bits, 56, 8);
+        const int multiplier = (int)Bits(bits, 52, 4);
+        const int *modifiers = EACModifiers[Bits(bits, 48, 4)];
+
+        for (int p = 0; p < 16; ++p)
+        {
+            const int modifier = modifiers[Bits(bits, 45 - p * 3, 3)];
+            if (elevenBit)
+            {
+                // A multiplier of zero means one eighth, which leaves the modifier unscaled at 11 bits
+                const int scaled = multiplier ? modifier * multiplier * 8 : modifier;
+                values[p * valueStride] = (uint16_t)std::min(std::max(base * 8 + 4 + scaled, 0), 2047);
+            }
+            else
+            {
+                alphas[p * alphaStride] = Clamp255(base + modifier * multiplier);
+            }
+        }
+    }
+
+    uint32_t BytesPerBlock(MBECompressedFormat format)
+    {
+        return (format == MBECompressedFormatEAC_RGBA8 || format == MBECompressedFormatEAC_RG11) ? 16 : 8;
+    }
+
+    void DecodeBlock(MBECompressedFormat format, const uint8_t *bytes, Block &block)
+    {
+        switch (format)
+        {
+            case MBECompressedFormatETC2_RGB8:
+                DecodeColorBlock(bytes, false, block);
+                break;
+            case MBECompressedFormatETC2_RGB8A1:
+                DecodeColorBlock(bytes, true, block);
+                break;
+            case MBECompressedFormatEAC_RGBA8:
+                DecodeColorBlock(bytes + 8, false, block);
+                DecodeEACBlock(bytes, false, &block.rgba[0][3], 4, nullptr, 0);
+                break;
+            case MBECompressedFormatEAC_R11:
+                DecodeEACBlock(bytes, true, nullptr, 0, &block.values[0][0], 2);
+                break;
+            case MBECompressedFormatEAC_RG11:
+                DecodeEACBlock(bytes, true, nullptr, 0, &block.values[0][0], 2);
+                DecodeEACBlock(bytes + 8, true, nullptr, 0, &block.values[0][1], 2);
+                break;
+            default:
+                break;
+        }
+    }
+
+    void DecodeBlockRows(MBECompressedFormat format, const MBETextureContainerImage &image,
+                         uint8_t *destination, size_t destinationBytesPerRow, uint32_t firstRow, uint32_t endRow)
+    {
+        const uint32_t bytesPerBlock = BytesPerBlock(format);
+        const uint32_t bytesPerPixel = MBEETCDecodedBytesPerPixel(format);
+        const uint32_t channelCount = (format == MBECompressedFormatEAC_R11) ? 1 : 2;
+        const bool elevenBit = (format == MBECompressedFormatEAC_R11 || format == MBECompressedFormatEAC_RG11);
+        const uint32_t blocksWide = (image.width + 3) / 4;
+
+        Block block;
+        for (uint32_t blockY = firstRow; blockY < endRow; ++blockY)
+        {
+            for (uint32_t blockX = 0; blockX < blocksWide; ++blockX)
+            {
+                DecodeBlock(format, image.bytes + ((size_t)blockY * blocksWide + blockX) * bytesPerBlock, block);
+
+                // Blocks along the right and bottom edges may hang off the image
+                const uint32_t columns = std::min(4u, image.width - blockX * 4);
+                const uint32_t rows = std::min(4u, image.height - blockY * 4);
+                for (uint32_t y = 0; y < rows; ++y)
+                {
+                    uint8_t *pixel = destination + (blockY * 4 + y) * destinationBytesPerRow + blockX * 4 * bytesPerPixel;
+                    for (uint32_t x = 0; x < columns; ++x, pixel += bytesPerPixel)
+                    {
+                        const int p = x * 4 + y;
+                        if (!elevenBit)
+                        {
+                            std::copy(block.rgba[p], block.rgba[p] + 4, pixel);
+                            continue;
+                        }
+
+                        uint16_t *values = (uint16_t *)pixel;
+                        for (uint32_t c = 0; c < channelCount; ++c)
+                        {
+                            const uint16_t value = block.values[p][c];
+                            values[c] = (uint16_t)((value << 5) | (value >> 6));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+bool MBEETCCanDecode(MBECompressedFormat format)
+{
+    switch (format)
+    {
+        case MBECompressedFormatETC2_RGB8:
+        case MBECompressedFormatETC2_RGB8A1:
+        case MBECompressedFormatEAC_RGBA8:
+        case MBECompressedFormatEAC_R11:
+        case MBECompressedFormatEAC_RG11:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint32_t MBEETCDecodedBytesPerPixel(MBECompressedFormat format)
+{
+    return (format == MBECompressedFormatEAC_R11) ? 2 : 4;
+}
+
+void MBEDecodeETCImage(MBECompressedFormat format, const MBETextureContainerImage &image,
+                       uint8_t *destination, size_t destinationBytesPerRow)
+{
+    const uint32_t blocksWide = (image.width + 3) / 4;
+    const uint32_t blocksHigh = (image.height + 3) / 4;
+    const uint32_t rowsPerTask = (uint32_t)std::max<size_t>(1, BlocksPerTask / blocksWide);
+    const size_t taskCount = (blocksHigh + rowsPerTask - 1) / rowsPerTask;
+
+    MBEThreadPool::sharedPool().parallelFor(taskCount, [&](size_t task) {
+        const uint32_t firstRow = (uint32_t)task * rowsPerTask;
+        DecodeBlockRows(format, image, destination, destinationBytesPerRow,
+                        firstRow, std::min(firstRow + rowsPerTask, blocksHigh));
+    });
+}
+
+bool MBEDecodeETCLevels(const MBETextureContainer &container, uint32_t slice, uint32_t face,
+                        std::vector<uint8_t> &pixels, std::vector<MBETextureContainerImage> &levels)
+{
+    const MBECompressedFormat format = container.format();
+    if (!MBEETCCanDecode(format))
+    {
+        return false;
+    }
+
+    const uint32_t bytesPerPixel = MBEETCDecodedBytesPerPixel(format);
+
+    std::vector<size_t> offsets(container.levelCount());
+    size_t length = 0;
+    for (uint32_t level = 0; level < container.levelCount(); ++level)
+    {
+        const MBETextureContainerImage &image = container.image(level, slice, face);
+        offsets[level] = length;
+        length += (size_t)image.width * image.height * bytesPerPixel;
+    }
+    pixels.resize(length);
+
+    // Every task is a run of block rows within one level, and the tasks of all levels run together
+    struct Task
+    {
+        uint32_t level;
+        uint32_t firstRow;
+        uint32_t endRow;
+    };
+    std::vector<Task> tasks;
+
+    levels.resize(container.levelCount());
+    for (uint32_t level = 0; level < container.levelCount(); ++level)
+    {
+        const MBETextureContainerImage &image = container.image(level, slice, face);
+        MBETextureContainerImage &decoded = levels[level];
+        decoded.bytes = pixels.data() + offsets[level];
+        decoded.width = image.width;
+        decoded.height = image.height;
+        decoded.bytesPerRow = (size_t)image.width * bytesPerPixel;
+        decoded.length = decoded.bytesPerRow * image.height;
+
+        const uint32_t blocksWide = (image.width + 3) / 4;
+        const uint32_t blocksHigh = (image.height + 3) / 4;
+        const uint32_t rowsPerTask = (uint32_t)std::max<size_t>(1, BlocksPerTask / blocksWide);
+        for (uint32_t row = 0; row < blocksHigh; row += rowsPerTask)
+        {
+            tasks.push_back({ level, row, std::min(row + rowsPerTask, blocksHigh) });
+        }
+    }
+
+    MBEThreadPool::sharedPool().parallelFor(tasks.size(), [&](size_t i) {
+        const Task &task = tasks[i];
+        const MBETextureContainerImage &decoded = levels[task.level];
+        DecodeBlockRows(format, container.image(task.level, slice, face), pixels.data() + offsets[task.level],
+                        decoded.bytesPerRow, task.firstRow, task.endRow);
+    });
+
+    return true;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "MBETextureContainer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Whether the decoder handles `format`: ETC2 RGB8, RGB8A1 and RGBA8 (with EAC alpha), and unsigned EAC
+/// R11 and RG11
+bool MBEETCCanDecode(MBECompressedFormat format);
+
+/// The size of one decoded pixel. The ETC2 formats decode to RGBA8, with opaque alpha where the format
+/// has none; R11 decodes to R16 and RG11 to RG16, with each 11-bit value scaled to the full 16-bit range.
+uint32_t MBEETCDecodedBytesPerPixel(MBECompressedFormat format);
+
+/// Decodes the blocks of one image into `destination`, which must have room for `image.height` rows of
+/// `destinationBytesPerRow` bytes. Block rows are split across the threads of the shared thread pool.
+void MBEDecodeETCImage(MBECompressedFormat format, const MBETextureContainerImage &image,
+                       uint8_t *destination, size_t destinationBytesPerRow);
+
+/// Decodes every mipmap level of one face of one slice of `container` into a single allocation, with
+/// tightly packed rows, and describes each decoded level in `levels`, whose pointers refer into `pixels`.
+/// The block rows of all levels are decoded in one parallel pass, so small levels don't leave threads
+/// idle. Returns false if the container's format can't be decoded.
+bool MBEDecodeETCLevels(const MBETextureContainer &container, uint32_t slice, uint32_t face,
+                        std::vector<uint8_t> &pixels, std::vector<MBETextureContainerImage> &levels);
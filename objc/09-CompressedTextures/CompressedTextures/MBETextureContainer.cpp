@@ -0,0 +1,543 @@
+#include "MBETextureContainer.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint32_t PVRv2Magic = 0x21525650;
+    const uint32_t PVRv3Magic = 0x03525650;
+    const uint32_t ASTCMagic = 0x5CA1AB13;
+    const uint8_t KTXIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    const uint32_t KTXEndianness = 0x04030201;
+    const uint32_t KTXSwappedEndianness = 0x01020304;
+
+    const size_t PVRv2HeaderLength = 52;
+    const size_t PVRv3HeaderLength = 52;
+    const size_t ASTCHeaderLength = 16;
+    const size_t KTXHeaderLength = 64;
+
+    // Larger than any texture a device can sample, which keeps corrupt sizes from overflowing level sizes
+    const uint32_t MaxDimension = 1 << 16;
+    const uint32_t MaxSliceCount = 2048;
+
+    const uint32_t PVRv2FlagCubeMap = 0x1000;
+    const uint32_t PVRv2FlagVolume = 0x4000;
+    const uint32_t PVRv2FlagAlpha = 0x8000;
+
+    // The LDR ASTC block sizes, in the order both the PVR and the GL format numbers list them
+    const uint8_t ASTCBlockSizes[14][2] = {
+        { 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+        { 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 },
+    };
+
+    uint32_t ReadUInt32(const uint8_t *bytes, bool swapped = false)
+    {
+        uint32_t value;
+        memcpy(&value, bytes, sizeof(value));
+        return swapped ? __builtin_bswap32(value) : value;
+    }
+
+    uint32_t ReadUInt24(const uint8_t *bytes)
+    {
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16);
+    }
+
+    size_t AlignUp(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // True if [offset, offset + length) lies within a buffer of `bufferLength` bytes, without overflowing
+    bool RangeIsValid(size_t offset, size_t length, size_t bufferLength)
+    {
+        return offset <= bufferLength && length <= bufferLength - offset;
+    }
+
+    uint32_t FullLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levelCount = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size >>= 1)
+        {
+            ++levelCount;
+        }
+        return levelCount;
+    }
+
+    bool ASTCBlockSizeIsValid(uint32_t blockWidth, uint32_t blockHeight)
+    {
+        for (const uint8_t *size : ASTCBlockSizes)
+        {
+            if (size[0] == blockWidth && size[1] == blockHeight)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+MBETextureContainer::MBETextureContainer() :
+    _type(TypePVRv3), _format(MBECompressedFormatASTC), _sRGB(false), _blockWidth(0), _blockHeight(0), _bytesPerBlock(0),
+    _width(0), _height(0), _levelCount(0), _faceCount(0), _sliceCount(0)
+{
+}
+
+bool MBETextureContainer::isContainer(const void *bytes, size_t length)
+{
+    const uint8_t *header = (const uint8_t *)bytes;
+    return (length >= PVRv2HeaderLength && ReadUInt32(header + 44) == PVRv2Magic) ||
+           (length >= PVRv3HeaderLength && ReadUInt32(header) == PVRv3Magic) ||
+           (length >= ASTCHeaderLength && ReadUInt32(header) == ASTCMagic) ||
+           (length >= KTXHeaderLength && memcmp(header, KTXIdentifier, sizeof(KTXIdentifier)) == 0);
+}
+
+std::shared_ptr<MBETextureContainer> MBETextureContainer::open(const char *path)
+{
+    std::shared_ptr<MBETextureContainer> container(new MBETextureContainer());
+    container->_file.reset(new MBEMappedFile(path));
+    if (!container->_file->isValid() || !container->validate(container->_file->bytes(), container->_file->length()))
+    {
+        return nullptr;
+    }
+    return container;
+}
+
+std::shared_ptr<MBETextureContainer> MBETextureContainer::parse(const void *bytes, size_t length)
+{
+    std::shared_ptr<MBETextureContainer> container(new MBETextureContainer());
+    if (!container->validate((const uint8_t *)bytes, length))
+    {
+        return nullptr;
+    }
+    return container;
+}
+
+const MBETextureContainerKeyValue *MBETextureContainer::keyValue(const char *key) const
+{
+    for (const MBETextureContainerKeyValue &keyValue : _keyValues)
+    {
+        if (keyValue.key == key)
+        {
+            return &keyValue;
+        }
+    }
+    return nullptr;
+}
+
+bool MBETextureContainer::validate(const uint8_t *bytes, size_t length)
+{
+    if (!bytes || !isContainer(bytes, length))
+    {
+        return false;
+    }
+
+    // The PVR v2 tag sits at the end of its header, so check the formats with leading magic numbers first
+    if (ReadUInt32(bytes) == PVRv3Magic)
+    {
+        return validatePVRv3(bytes, length);
+    }
+    else if (ReadUInt32(bytes) == ASTCMagic)
+    {
+        return validateASTC(bytes, length);
+    }
+    else if (memcmp(bytes, KTXIdentifier, sizeof(KTXIdentifier)) == 0)
+    {
+        return validateKTX(bytes, length);
+    }
+    return validatePVRv2(bytes, length);
+}
+
+bool MBETextureContainer::setSize(uint32_t width, uint32_t height, uint32_t levelCount, uint32_t faceCount,
+                                  uint32_t sliceCount)
+{
+    if (width == 0 || height == 0 || width > MaxDimension || height > MaxDimension ||
+        levelCount == 0 || levelCount > FullLevelCount(width, height) ||
+        (faceCount != 1 && faceCount != 6) ||
+        sliceCount == 0 || sliceCount > MaxSliceCount)
+    {
+        return false;
+    }
+
+    _width = width;
+    _height = height;
+    _levelCount = levelCount;
+    _faceCount = faceCount;
+    _sliceCount = sliceCount;
+    _images.resize((size_t)levelCount * faceCount * sliceCount);
+    return true;
+}
+
+size_t MBETextureContainer::imageLength(uint32_t level) const
+{
+    const uint32_t width = std::max(_width >> level, 1u);
+    const uint32_t height = std::max(_height >> level, 1u);
+    size_t blocksWide = (width + _blockWidth - 1) / _blockWidth;
+    size_t blocksHigh = (height + _blockHeight - 1) / _blockHeight;
+
+    // PVRTC decodes each pixel from four neighboring blocks, so every level has at least 2 x 2 blocks
+    if (_format <= MBECompressedFormatPVRTC_RGBA_4BPP)
+    {
+        blocksWide = std::max<size_t>(blocksWide, 2);
+        blocksHigh = std::max<size_t>(blocksHigh, 2);
+    }
+    return blocksWide * blocksHigh * _bytesPerBlock;
+}
+
+MBETextureContainerImage MBETextureContainer::makeImage(const uint8_t *bytes, uint32_t level) const
+{
+    MBETextureContainerImage image;
+    image.bytes = bytes;
+    image.length = imageLength(level);
+    image.width = std::max(_width >> level, 1u);
+    image.height = std::max(_height >> level, 1u);
+    image.bytesPerRow = (_format <= MBECompressedFormatPVRTC_RGBA_4BPP) ? 0 :
+                        (image.width + _blockWidth - 1) / _blockWidth * _bytesPerBlock;
+    return image;
+}
+
+bool MBETextureContainer::validatePVRv2(const uint8_t *bytes, size_t length)
+{
+    const uint32_t headerLength = ReadUInt32(bytes);
+    const uint32_t height = ReadUInt32(bytes + 4);
+    const uint32_t width = ReadUInt32(bytes + 8);
+    const uint32_t flags = ReadUInt32(bytes + 16);
+    const uint32_t dataLength = ReadUInt32(bytes + 20);
+
+    if (headerLength < PVRv2HeaderLength || !RangeIsValid(headerLength, dataLength, length) ||
+        (flags & (PVRv2FlagCubeMap | PVRv2FlagVolume)) != 0)
+    {
+        return false;
+    }
+
+    const bool hasAlpha = (flags & PVRv2FlagAlpha) != 0;
+    switch (flags & 0xFF)
+    {
+        case 0x0C: // OGL_PVRTC2
+        case 0x18:
+            _format = hasAlpha ? MBECompressedFormatPVRTC_RGBA_2BPP : MBECompressedFormatPVRTC_RGB_2BPP;
+            _blockWidth = 8;
+            break;
+        case 0x0D: // OGL_PVRTC4
+        case 0x19:
+            _format = hasAlpha ? MBECompressedFormatPVRTC_RGBA_4BPP : MBECompressedFormatPVRTC_RGB_4BPP;
+            _blockWidth = 4;
+            break;
+        default:
+            return false;
+    }
+    _type = TypePVRv2;
+    _blockHeight = 4;
+    _bytesPerBlock = 8;
+
+    if (!setSize(width, height, FullLevelCount(width, height), 1, 1))
+    {
+        return false;
+    }
+
+    // Writers disagree on whether the mipmap count includes the base level, so the levels are counted
+    // from the data length instead, which must hold a whole number of them
+    const uint8_t *data = bytes + headerLength;
+    size_t offset = 0;
+    uint32_t levelCount = 0;
+    while (offset < dataLength && levelCount < _levelCount)
+    {
+        _images[levelCount] = makeImage(data + offset, levelCount);
+        offset += _images[levelCount].length;
+        ++levelCount;
+    }
+
+    if (levelCount == 0 || offset != dataLength)
+    {
+        return false;
+    }
+
+    _levelCount = levelCount;
+    _images.resize(levelCount);
+    return true;
+}
+
+bool MBETextureContainer::validatePVRv3(const uint8_t *bytes, size_t length)
+{
+    const uint32_t pixelFormat = ReadUInt32(bytes + 8);
+    const uint32_t pixelFormatHigh = ReadUInt32(bytes + 12);
+    const uint32_t colorSpace = ReadUInt32(bytes + 16);
+    const uint32_t height = ReadUInt32(bytes + 24);
+    const uint32_t width = ReadUInt32(bytes + 28);
+    const uint32_t depth = ReadUInt32(bytes + 32);
+    const uint32_t surfaceCount = ReadUInt32(bytes + 36);
+    const uint32_t faceCount = ReadUInt32(bytes + 40);
+    const uint32_t mipmapCount = ReadUInt32(bytes + 44);
+    const uint32_t metadataLength = ReadUInt32(bytes + 48);
+
+    // A nonzero high word means the pixels are uncompressed channels, which this reader doesn't handle
+    if (pixelFormatHigh != 0 || depth > 1 || !RangeIsValid(PVRv3HeaderLength, metadataLength, length))
+    {
+        return false;
+    }
+
+    _type = TypePVRv3;
+    _sRGB = (colorSpace == 1);
+    _blockWidth = 4;
+    _blockHeight = 4;
+    _bytesPerBlock = 8;
+
+    switch (pixelFormat)
+    {
+        case 0:
+            _format = MBECompressedFormatPVRTC_RGB_2BPP;
+            _blockWidth = 8;
+            break;
+        case 1:
+            _format = MBECompressedFormatPVRTC_RGBA_2BPP;
+            _blockWidth = 8;
+            break;
+        case 2:
+            _format = MBECompressedFormatPVRTC_RGB_4BPP;
+            break;
+        case 3:
+            _format = MBECompressedFormatPVRTC_RGBA_4BPP;
+            break;
+        case 22:
+            _format = MBECompressedFormatETC2_RGB8;
+            break;
+        case 23:
+            _format = MBECompressedFormatEAC_RGBA8;
+            _bytesPerBlock = 16;
+            break;
+        case 24:
+            _format = MBECompressedFormatETC2_RGB8A1;
+            break;
+        case 25:
+            _format = MBECompressedFormatEAC_R11;
+            break;
+        case 26:
+            _format = MBECompressedFormatEAC_RG11;
+            _bytesPerBlock = 16;
+            break;
+        default:
+            if (pixelFormat >= 27 && pixelFormat < 27 + 14)
+            {
+                _format = MBECompressedFormatASTC;
+                _blockWidth = ASTCBlockSizes[pixelFormat - 27][0];
+                _blockHeight = ASTCBlockSizes[pixelFormat - 27][1];
+                _bytesPerBlock = 16;
+                break;
+            }
+            return false;
+    }
+
+    if (!setSize(width, height, std::max(mipmapCount, 1u), faceCount, std::max(surfaceCount, 1u)))
+    {
+        return false;
+    }
+
+    // Each level holds every surface, and each surface every face
+    size_t offset = PVRv3HeaderLength + metadataLength;
+    for (uint32_t level = 0; level < _levelCount; ++level)
+    {
+        const size_t levelLength = imageLength(level);
+        for (uint32_t slice = 0; slice < _sliceCount; ++slice)
+        {
+            for (uint32_t face = 0; face < _faceCount; ++face)
+            {
+                if (!RangeIsValid(offset, levelLength, length))
+                {
+                    return false;
+                }
+                _images[(level * _sliceCount + slice) * _faceCount + face] = makeImage(bytes + offset, level);
+                offset += levelLength;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool MBETextureContainer::validateASTC(const uint8_t *bytes, size_t length)
+{
+    const uint32_t blockWidth = bytes[4];
+    const uint32_t blockHeight = bytes[5];
+    const uint32_t blockDepth = bytes[6];
+    const uint32_t width = ReadUInt24(bytes + 7);
+    const uint32_t height = ReadUInt24(bytes + 10);
+    const uint32_t depth = ReadUInt24(bytes + 13);
+
+    if (blockDepth != 1 || depth != 1 || !ASTCBlockSizeIsValid(blockWidth, blockHeight))
+    {
+        return false;
+    }
+
+    _type = TypeASTC;
+    _format = MBECompressedFormatASTC;
+    _blockWidth = blockWidth;
+    _blockHeight = blockHeight;
+    _bytesPerBlock = 16;
+
+    // ASTC files hold a single image and don't record its color space, so we assume linear
+    if (!setSize(width, height, 1, 1, 1) || !RangeIsValid(ASTCHeaderLength, imageLength(0), length))
+    {
+        return false;
+    }
+
+    _images[0] = makeImage(bytes + ASTCHeaderLength, 0);
+    return true;
+}
+
+bool MBETextureContainer::validateKTX(const uint8_t *bytes, size_t length)
+{
+    const uint32_t endianness = ReadUInt32(bytes + 12);
+    if (endianness != KTXEndianness && endianness != KTXSwappedEndianness)
+    {
+        return false;
+    }
+
+    const bool swapped = (endianness == KTXSwappedEndianness);
+    const uint32_t glType = ReadUInt32(bytes + 16, swapped);
+    const uint32_t glInternalFormat = ReadUInt32(bytes + 28, swapped);
+    const uint32_t width = ReadUInt32(bytes + 36, swapped);
+    const uint32_t height = ReadUInt32(bytes + 40, swapped);
+    const uint32_t depth = ReadUInt32(bytes + 44, swapped);
+    const uint32_t arrayElementCount = ReadUInt32(bytes + 48, swapped);
+    const uint32_t faceCount = ReadUInt32(bytes + 52, swapped);
+    const uint32_t mipmapCount = ReadUInt32(bytes + 56, swapped);
+    const uint32_t keyValueDataLength = ReadUInt32(bytes + 60, swapped);
+
+    // Compressed formats always have a GL type of zero
+    if (glType != 0 || depth > 1 || !RangeIsValid(KTXHeaderLength, keyValueDataLength, length))
+    {
+        return false;
+    }
+
+    _type = TypeKTX;
+    _blockWidth = 4;
+    _blockHeight = 4;
+    _bytesPerBlock = 8;
+
+    switch (glInternalFormat)
+    {
+        case 0x8C00: // GL_COMPRESSED_RGB_PVRTC_4BPPV1_IMG
+            _format = MBECompressedFormatPVRTC_RGB_4BPP;
+            break;
+        case 0x8C01: // GL_COMPRESSED_RGB_PVRTC_2BPPV1_IMG
+            _format = MBECompressedFormatPVRTC_RGB_2BPP;
+            _blockWidth = 8;
+            break;
+        case 0x8C02: // GL_COMPRESSED_RGBA_PVRTC_4BPPV1_IMG
+            _format = MBECompressedFormatPVRTC_RGBA_4BPP;
+            break;
+        case 0x8C03: // GL_COMPRESSED_RGBA_PVRTC_2BPPV1_IMG
+            _format = MBECompressedFormatPVRTC_RGBA_2BPP;
+            _blockWidth = 8;
+            break;
+        case 0x9270: // GL_COMPRESSED_R11_EAC
+            _format = MBECompressedFormatEAC_R11;
+            break;
+        case 0x9272: // GL_COMPRESSED_RG11_EAC
+            _format = MBECompressedFormatEAC_RG11;
+            _bytesPerBlock = 16;
+            break;
+        case 0x9274: // GL_COMPRESSED_RGB8_ETC2
+        case 0x9275: // GL_COMPRESSED_SRGB8_ETC2
+            _format = MBECompressedFormatETC2_RGB8;
+            _sRGB = (glInternalFormat == 0x9275);
+            break;
+        case 0x9276: // GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2
+        case 0x9277: // GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2
+            _format = MBECompressedFormatETC2_RGB8A1;
+            _sRGB = (glInternalFormat == 0x9277);
+            break;
+        case 0x9278: // GL_COMPRESSED_RGBA8_ETC2_EAC
+        case 0x9279: // GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC
+            _format = MBECompressedFormatEAC_RGBA8;
+            _sRGB = (glInternalFormat == 0x9279);
+            _bytesPerBlock = 16;
+            break;
+        default:
+            // GL_COMPRESSED_RGBA_ASTC_4x4_KHR and up, then GL_COMPRESSED_SRGB8_ALPHA8_ASTC_4x4_KHR and up
+            if ((glInternalFormat >= 0x93B0 && glInternalFormat < 0x93B0 + 14) ||
+                (glInternalFormat >= 0x93D0 && glInternalFormat < 0x93D0 + 14))
+            {
+                const uint32_t index = glInternalFormat & 0xF;
+                _format = MBECompressedFormatASTC;
+                _sRGB = (glInternalFormat >= 0x93D0);
+                _blockWidth = ASTCBlockSizes[index][0];
+                _blockHeight = ASTCBlockSizes[index][1];
+                _bytesPerBlock = 16;
+                break;
+            }
+            return false;
+    }
+
+    if (!setSize(width, height, std::max(mipmapCount, 1u), faceCount, std::max(arrayElementCount, 1u)))
+    {
+        return false;
+    }
+
+    // Each entry is its length, then a null-terminated key and its value, padded to four bytes
+    const size_t keyValueEnd = KTXHeaderLength + keyValueDataLength;
+    size_t offset = KTXHeaderLength;
+    while (offset < keyValueEnd)
+    {
+        if (!RangeIsValid(offset, sizeof(uint32_t), keyValueEnd))
+        {
+            return false;
+        }
+        const uint32_t entryLength = ReadUInt32(bytes + offset, swapped);
+        offset += sizeof(uint32_t);
+        if (!RangeIsValid(offset, entryLength, keyValueEnd))
+        {
+            return false;
+        }
+
+        const uint8_t *entry = bytes + offset;
+        const uint8_t *keyEnd = (const uint8_t *)memchr(entry, '\0', entryLength);
+        if (!keyEnd)
+        {
+            return false;
+        }
+
+        MBETextureContainerKeyValue keyValue;
+        keyValue.key.assign((const char *)entry, keyEnd - entry);
+        keyValue.value = keyEnd + 1;
+        keyValue.valueLength = entryLength - (keyEnd + 1 - entry);
+        _keyValues.push_back(keyValue);
+
+        offset = AlignUp(offset + entryLength, 4);
+    }
+
+    // Each level starts with its length, which covers one face of a cube map that isn't an array, and
+    // the whole level otherwise. Faces of such cube maps are padded to four bytes, as are levels.
+    const bool isCubeMap = (_faceCount == 6 && arrayElementCount == 0);
+    offset = keyValueEnd;
+    for (uint32_t level = 0; level < _levelCount; ++level)
+    {
+        const size_t levelLength = imageLength(level);
+        const size_t expectedLength = isCubeMap ? levelLength : levelLength * _faceCount * _sliceCount;
+        if (!RangeIsValid(offset, sizeof(uint32_t), length) || ReadUInt32(bytes + offset, swapped) != expectedLength)
+        {
+            return false;
+        }
+        offset += sizeof(uint32_t);
+
+        for (uint32_t slice = 0; slice < _sliceCount; ++slice)
+        {
+            for (uint32_t face = 0; face < _faceCount; ++face)
+            {
+                if (!RangeIsValid(offset, levelLength, length))
+                {
+                    return false;
+                }
+                _images[(level * _sliceCount + slice) * _faceCount + face] = makeImage(bytes + offset, level);
+                offset += levelLength;
+                if (isCubeMap)
+                {
+                    offset = AlignUp(offset, 4);
+                }
+            }
+        }
+        offset = AlignUp(offset, 4);
+    }
+
+    return true;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "MBEMappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// The block-compressed encodings a texture container can hold, independent of any graphics API
+enum MBECompressedFormat
+{
+    MBECompressedFormatPVRTC_RGB_2BPP,
+    MBECompressedFormatPVRTC_RGBA_2BPP,
+    MBECompressedFormatPVRTC_RGB_4BPP,
+    MBECompressedFormatPVRTC_RGBA_4BPP,
+    MBECompressedFormatETC2_RGB8,
+    MBECompressedFormatETC2_RGB8A1,
+    MBECompressedFormatEAC_RGBA8,
+    MBECompressedFormatEAC_R11,
+    MBECompressedFormatEAC_RG11,
+    /// LDR ASTC, whose block size is given by the container's block width and height
+    MBECompressedFormatASTC,
+};
+
+/// One mipmap level of one face of one array slice. `bytes` points directly into the container's data.
+struct MBETextureContainerImage
+{
+    const uint8_t *bytes;
+    size_t length;
+    uint32_t width;
+    uint32_t height;
+    /// The length of one row of blocks, or zero for PVRTC, whose blocks aren't stored in rows
+    size_t bytesPerRow;
+};
+
+/// One entry of the key/value metadata of a KTX file. `key` excludes its terminating null, and `value`
+/// points directly into the container's data.
+struct MBETextureContainerKeyValue
+{
+    std::string key;
+    const uint8_t *value;
+    size_t valueLength;
+};
+
+/// Reads block-compressed textures from PVR (versions 2 and 3), ASTC and KTX files without copying
+/// their pixels. Every header field that sizes or locates data is checked against the length of the
+/// file before it is used, so a truncated or malformed file is rejected instead of being read past
+/// its end. Volume textures are not supported.
+class MBETextureContainer
+{
+public:
+    enum Type
+    {
+        TypePVRv2,
+        TypePVRv3,
+        TypeASTC,
+        TypeKTX,
+    };
+
+    /// Whether `bytes` starts like one of the supported containers. Cheap; doesn't validate the file.
+    static bool isContainer(const void *bytes, size_t length);
+
+    /// Maps the file at `path` and validates it. Returns null if the file is missing, malformed, or holds
+    /// a format or layout we can't read.
+    static std::shared_ptr<MBETextureContainer> open(const char *path);
+
+    /// Validates a container already in memory, which must outlive the returned object
+    static std::shared_ptr<MBETextureContainer> parse(const void *bytes, size_t length);
+
+    Type type() const { return _type; }
+    MBECompressedFormat format() const { return _format; }
+    /// Whether the color channels are sRGB-encoded
+    bool isSRGB() const { return _sRGB; }
+
+    uint32_t blockWidth() const { return _blockWidth; }
+    uint32_t blockHeight() const { return _blockHeight; }
+    uint32_t bytesPerBlock() const { return _bytesPerBlock; }
+
+    uint32_t width() const { return _width; }
+    uint32_t height() const { return _height; }
+    uint32_t levelCount() const { return _levelCount; }
+    /// Six for cube maps, whose faces are ordered +X, -X, +Y, -Y, +Z, -Z, and one otherwise
+    uint32_t faceCount() const { return _faceCount; }
+    /// The number of array slices, which is one for textures that aren't arrays
+    uint32_t sliceCount() const { return _sliceCount; }
+
+    const MBETextureContainerImage &image(uint32_t level, uint32_t slice = 0, uint32_t face = 0) const
+    {
+        return _images[(level * _sliceCount + slice) * _faceCount + face];
+    }
+
+    const std::vector<MBETextureContainerKeyValue> &keyValues() const { return _keyValues; }
+
+    /// The value of the metadata entry named `key`, or null if there isn't one
+    const MBETextureContainerKeyValue *keyValue(const char *key) const;
+
+private:
+    MBETextureContainer();
+    MBETextureContainer(const MBETextureContainer &) = delete;
+    MBETextureContainer &operator=(const MBETextureContainer &) = delete;
+
+    bool validate(const uint8_t *bytes, size_t length);
+    bool validatePVRv2(const uint8_t *bytes, size_t length);
+    bool validatePVRv3(const uint8_t *bytes, size_t length);
+    bool validateASTC(const uint8_t *bytes, size_t length);
+    bool validateKTX(const uint8_t *bytes, size_t length);
+
+    bool setSize(uint32_t width, uint32_t height, uint32_t levelCount, uint32_t faceCount, uint32_t sliceCount);
+    size_t imageLength(uint32_t level) const;
+    MBETextureContainerImage makeImage(const uint8_t *bytes, uint32_t level) const;
+
+    std::unique_ptr<MBEMappedFile> _file;
+    Type _type;
+    MBECompressedFormat _format;
+    bool _sRGB;
+    uint32_t _blockWidth;
+    uint32_t _blockHeight;
+    uint32_t _bytesPerBlock;
+    uint32_t _width;
+    uint32_t _height;
+    uint32_t _levelCount;
+    uint32_t _faceCount;
+    uint32_t _sliceCount;
+    std::vector<MBETextureContainerImage> _images;
+    std::vector<MBETextureContainerKeyValue> _keyValues;
+};
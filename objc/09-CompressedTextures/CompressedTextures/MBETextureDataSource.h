@@ -5,16 +5,24 @@
 ///  - Any format that can be loaded by UIImage, such as PNG, JPEG, TIFF, etc.
 ///      (These textures will be converted to have a pixel format of RGBA8Unorm)
 ///  - Legacy PVR (v.2) encapsulating PVRTC data
-///  - PVR v.3 encapsulating PVRTC or ETC2/EAC data
+///  - PVR v.3 encapsulating PVRTC, ETC2/EAC or ASTC data
 ///  - ASTC encapsulating ASTC (LDR) data
+///  - KTX encapsulating PVRTC, ETC2/EAC or ASTC data
+///
+/// ETC2 and EAC data is decoded on the CPU into RGBA8, R16 or RG16 textures when the
+/// device can't sample it directly.
+///
+/// Compressed containers are validated against their length before any level is read,
+/// and files are mapped rather than copied into memory.
 ///
 /// The `levels` property is an array of NSData objects containing the mipmap
-/// levels encoded in the file, suitable for loading into an MTLTexture.
+/// levels encoded in the file, suitable for loading into an MTLTexture. For
+/// cube maps and arrays, these are the levels of the first face of the first slice.
 /// If the file contains only a single layer, this array will have one entry.
 ///
 /// The `width` and `height` properties give the dimensions of the base level.
 ///
-/// Currently, only 2D, single-slice, single-face textures are supported.
+/// Cube maps and 2D arrays are supported; volume textures and cube map arrays are not.
 @interface MBETextureDataSource : NSObject
 
 @property (nonatomic, readonly) MTLPixelFormat pixelFormat;
@@ -23,6 +31,12 @@
 @property (nonatomic, readonly) NSUInteger bytesPerRow;
 @property (nonatomic, readonly) NSUInteger mipmapCount;
 @property (nonatomic, readonly) NSArray *levels;
+/// Six for cube maps, and one otherwise
+@property (nonatomic, readonly) NSUInteger faceCount;
+/// The number of slices in an array texture, and one otherwise
+@property (nonatomic, readonly) NSUInteger arrayLength;
+/// The key/value metadata of a KTX file, mapping NSString keys to NSData values
+@property (nonatomic, readonly) NSDictionary *metadata;
 
 + (instancetype)textureDataSourceWithContentsOfURL:(NSURL *)url;
 
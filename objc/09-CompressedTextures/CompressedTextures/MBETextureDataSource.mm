@@ -0,0 +1,485 @@
+@import UIKit;
+#import "MBETextureDataSource.h"
+
+#import "MBEETCDecoder.h"
+#import "MBETextureContainer.h"
+
+@interface MBETextureDataSource ()
+{
+    // Owns the mapped file that the levels point into, when the data came from a compressed container
+    std::shared_ptr<MBETextureContainer> _container;
+}
+@end
+
+@implementation MBETextureDataSource
+
++ (instancetype)textureDataSourceWithContentsOfURL:(NSURL *)url
+{
+    // Compressed containers are mapped rather than read, so their levels are never copied
+    std::shared_ptr<MBETextureContainer> container = MBETextureContainer::open([[url path] fileSystemRepresentation]);
+    if (container)
+    {
+        return [[self alloc] initWithContainer:container backingData:nil];
+    }
+
+    NSData *data = [NSData dataWithContentsOfURL:url options:NSDataReadingMappedIfSafe error:nil];
+    return [self textureDataSourceWithData:data];
+}
+
++ (instancetype)textureDataSourceWithData:(NSData *)data
+{
+    return [[self alloc] initWithData:data];
+}
+
+- (instancetype)initWithData:(NSData *)data
+{
+    if (MBETextureContainer::isContainer([data bytes], [data length]))
+    {
+        std::shared_ptr<MBETextureContainer> container = MBETextureContainer::parse([data bytes], [data length]);
+        if (!container)
+        {
+            return nil;
+        }
+        return [self initWithContainer:container backingData:data];
+    }
+
+    if ((self = [super init]))
+    {
+        if (![[self class] dataIsProbablyNotHardwareCompressed:data] || ![self loadImageData:data])
+        {
+            return nil;
+        }
+    }
+
+    return self;
+}
+
+- (instancetype)initWithContainer:(const std::shared_ptr<MBETextureContainer> &)container backingData:(NSData *)backingData
+{
+    if ((self = [super init]))
+    {
+        _pixelFormat = [self pixelFormatForContainer:*container];
+        if (_pixelFormat == MTLPixelFormatInvalid)
+        {
+            return nil;
+        }
+
+        _container = container;
+        _width = container->width();
+        _height = container->height();
+        _bytesPerRow = container->image(0).bytesPerRow;
+        _mipmapCount = container->levelCount();
+        _faceCount = container->faceCount();
+        _arrayLength = container->sliceCount();
+
+        // Each level is a view of the container's data, which stays alive until every view is released
+        NSMutableArray *levels = [NSMutableArray arrayWithCapacity:_mipmapCount];
+        for (uint32_t level = 0; level < _mipmapCount; ++level)
+        {
+            const MBETextureContainerImage &image = container->image(level);
+            std::shared_ptr<MBETextureContainer> owner = container;
+            NSData *levelData = [[NSData alloc] initWithBytesNoCopy:(void *)image.bytes
+                                                             length:image.length
+                                                        deallocator:^(void *bytes, NSUInteger length) {
+                                                            (void)owner;
+                                                            (void)backingData;
+                                                        }];
+            [levels addObject:levelData];
+        }
+        _levels = [levels copy];
+
+        NSMutableDictionary *metadata = [NSMutableDictionary dictionary];
+        for (const MBETextureContainerKeyValue &keyValue : container->keyValues())
+        {
+            NSString *key = [[NSString alloc] initWithBytes:keyValue.key.data()
+                                                     length:keyValue.key.size()
+                                                   encoding:NSUTF8StringEncoding];
+            if (key)
+            {
+                metadata[key] = [NSData dataWithBytes:keyValue.value length:keyValue.valueLength];
+            }
+        }
+        _metadata = [metadata copy];
+    }
+
+    return self;
+}
+
++ (BOOL)dataIsProbablyNotHardwareCompressed:(NSData *)data
+{
+    if (data.length == 0)
+        return NO;
+
+    uint8_t c = 0;
+    [data getBytes:&c length:1];
+
+    switch (c) {
+        case 0xFF: // JPEG
+        case 0x89: // PNG
+        case 0x47: // GIF
+        case 0x49: // TIFF
+        case 0x4D: // TIFF
+            return YES;
+        default:
+            return NO;
+    }
+}
+
+- (BOOL)loadImageData:(NSData *)imageData
+{
+    UIImage *image = [UIImage imageWithData:imageData];
+    CGImageRef imageRef = image.CGImage;
+    if (imageRef == NULL)
+    {
+        return NO;
+    }
+
+    // Create a suitable bitmap context for extracting the bits of the image
+    const NSUInteger width = CGImageGetWidth(imageRef);
+    const NSUInteger height = CGImageGetHeight(imageRef);
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    const NSUInteger dataLength = height * width * 4;
+    uint8_t *rawData = (uint8_t *)calloc(dataLength, sizeof(uint8_t));
+    const NSUInteger bytesPerPixel = 4;
+    const NSUInteger bytesPerRow = bytesPerPixel * width;
+    const NSUInteger bitsPerComponent = 8;
+    CGContextRef context = CGBitmapContextCreate(rawData, width, height,
+                                                 bitsPerComponent, bytesPerRow, colorSpace,
+                                                 kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+    CGColorSpaceRelease(colorSpace);
+
+    CGRect imageRect = CGRectMake(0, 0, width, height);
+    CGContextDrawImage(context, imageRect, imageRef);
+
+    CGContextRelease(context);
+
+    _pixelFormat = MTLPixelFormatRGBA8Unorm;
+    _width = width;
+    _height = height;
+    _bytesPerRow = bytesPerRow;
+    _mipmapCount = 1;
+    _faceCount = 1;
+    _arrayLength = 1;
+    _levels = @[[NSData dataWithBytesNoCopy:rawData length:dataLength freeWhenDone:YES]];
+
+    return YES;
+}
+
+- (MTLPixelFormat)pixelFormatForASTCBlockWidth:(uint32_t)blockWidth
+                                   blockHeight:(uint32_t)blockHeight
+                               colorSpaceIsLDR:(BOOL)colorSpaceIsLDR
+{
+    MTLPixelFormat pixelFormat = MTLPixelFormatInvalid;
+
+    if (blockWidth == 4)
+    {
+        if (blockHeight == 4)
+        {
+            pixelFormat = MTLPixelFormatASTC_4x4_LDR;
+        }
+    }
+    else if (blockWidth == 5)
+    {
+        if( blockHeight == 4)
+        {
+            pixelFormat = MTLPixelFormatASTC_5x4_LDR;
+        }
+        else if (blockHeight == 5)
+        {
+            pixelFormat = MTLPixelFormatASTC_5x5_LDR;
+        }
+    }
+    else if (blockWidth == 6)
+    {
+        if( blockHeight == 5)
+        {
+            pixelFormat = MTLPixelFormatASTC_6x5_LDR;
+        }
+        else if (blockHeight == 6)
+        {
+            pixelFormat = MTLPixelFormatASTC_6x6_LDR;
+        }
+    }
+    else if (blockWidth == 8)
+    {
+        if( blockHeight == 5)
+        {
+            pixelFormat = MTLPixelFormatASTC_8x5_LDR;
+        }
+        else if (blockHeight == 6)
+        {
+            pixelFormat = MTLPixelFormatASTC_8x6_LDR;
+        }
+        else if (blockHeight == 8)
+        {
+            pixelFormat = MTLPixelFormatASTC_8x8_LDR;
+        }
+    }
+    else if (blockWidth == 10)
+    {
+        if( blockHeight == 5)
+        {
+            pixelFormat = MTLPixelFormatASTC_10x5_LDR;
+        }
+        else if (blockHeight == 6)
+        {
+            pixelFormat = MTLPixelFormatASTC_10x6_LDR;
+        }
+        else if (blockHeight == 8)
+        {
+            pixelFormat = MTLPixelFormatASTC_10x8_LDR;
+        }
+        else if (blockHeight == 10)
+        {
+            pixelFormat = MTLPixelFormatASTC_10x10_LDR;
+        }
+    }
+    else if (blockWidth == 12)
+    {
+        if (blockHeight == 10)
+        {
+            pixelFormat = MTLPixelFormatASTC_12x10_LDR;
+        }
+        else if (blockHeight == 12)
+        {
+            pixelFormat = MTLPixelFormatASTC_12x12_LDR;
+        }
+    }
+
+    // Adjust pixel format if we're actually sRGB instead of LDR
+    if (!colorSpaceIsLDR && pixelFormat != MTLPixelFormatInvalid)
+    {
+        pixelFormat -= (MTLPixelFormatASTC_4x4_LDR - MTLPixelFormatASTC_4x4_sRGB);
+    }
+
+    return pixelFormat;
+}
+
+- (MTLPixelFormat)pixelFormatForPVRTCBitsPerPixel:(uint32_t)bitsPerPixel
+                                   componentCount:(uint32_t)componentCount
+                               colorSpaceIsLinear:(BOOL)colorSpaceIsLinear
+{
+    MTLPixelFormat pixelFormat = MTLPixelFormatInvalid;
+
+    if (bitsPerPixel == 2)
+    {
+        if (componentCount == 3)
+        {
+            pixelFormat = colorSpaceIsLinear ? MTLPixelFormatPVRTC_RGB_2BPP : MTLPixelFormatPVRTC_RGB_2BPP_sRGB;
+        }
+        else if (componentCount == 4)
+        {
+            pixelFormat = colorSpaceIsLinear ? MTLPixelFormatPVRTC_RGBA_2BPP : MTLPixelFormatPVRTC_RGBA_2BPP_sRGB;
+        }
+    }
+    else if (bitsPerPixel == 4)
+    {
+        if (componentCount == 3)
+        {
+            pixelFormat = colorSpaceIsLinear ? MTLPixelFormatPVRTC_RGB_4BPP : MTLPixelFormatPVRTC_RGB_4BPP_sRGB;
+        }
+        else if (componentCount == 4)
+        {
+            pixelFormat = colorSpaceIsLinear ? MTLPixelFormatPVRTC_RGBA_4BPP : MTLPixelFormatPVRTC_RGBA_4BPP_sRGB;
+        }
+    }
+
+    return pixelFormat;
+}
+
+- (MTLPixelFormat)pixelFormatForContainer:(const MBETextureContainer &)container
+{
+    const BOOL colorSpaceIsLinear = !container.isSRGB();
+
+    switch (container.format())
+    {
+        case MBECompressedFormatPVRTC_RGB_2BPP:
+            return [self pixelFormatForPVRTCBitsPerPixel:2 componentCount:3 colorSpaceIsLinear:colorSpaceIsLinear];
+        case MBECompressedFormatPVRTC_RGBA_2BPP:
+            return [self pixelFormatForPVRTCBitsPerPixel:2 componentCount:4 colorSpaceIsLinear:colorSpaceIsLinear];
+        case MBECompressedFormatPVRTC_RGB_4BPP:
+            return [self pixelFormatForPVRTCBitsPerPixel:4 componentCount:3 colorSpaceIsLinear:colorSpaceIsLinear];
+        case MBECompressedFormatPVRTC_RGBA_4BPP:
+            return [self pixelFormatForPVRTCBitsPerPixel:4 componentCount:4 colorSpaceIsLinear:colorSpaceIsLinear];
+        case MBECompressedFormatETC2_RGB8:
+            return colorSpaceIsLinear ? MTLPixelFormatETC2_RGB8 : MTLPixelFormatETC2_RGB8_sRGB;
+        case MBECompressedFormatETC2_RGB8A1:
+            return colorSpaceIsLinear ? MTLPixelFormatETC2_RGB8A1 : MTLPixelFormatETC2_RGB8A1_sRGB;
+        case MBECompressedFormatEAC_RGBA8:
+            return colorSpaceIsLinear ? MTLPixelFormatEAC_RGBA8 : MTLPixelFormatEAC_RGBA8_sRGB;
+        case MBECompressedFormatEAC_R11:
+            return MTLPixelFormatEAC_R11Unorm;
+        case MBECompressedFormatEAC_RG11:
+            return MTLPixelFormatEAC_RG11Unorm;
+        case MBECompressedFormatASTC:
+            return [self pixelFormatForASTCBlockWidth:container.blockWidth()
+                                          blockHeight:container.blockHeight()
+                                      colorSpaceIsLDR:colorSpaceIsLinear];
+    }
+
+    return MTLPixelFormatInvalid;
+}
+
+// This heuristic might be a little bit off. I haven't tested it with anything other than RGBA8Unorm.
+- (BOOL)pixelFormatIsColorRenderable:(MTLPixelFormat)pixelFormat
+{
+    BOOL isCompressedFormat = (pixelFormat >= MTLPixelFormatASTC_4x4_sRGB && pixelFormat <= MTLPixelFormatASTC_12x12_LDR) ||
+                              (pixelFormat >= MTLPixelFormatPVRTC_RGB_2BPP && pixelFormat <= MTLPixelFormatPVRTC_RGBA_4BPP_sRGB) ||
+                              (pixelFormat >= MTLPixelFormatEAC_R11Unorm && pixelFormat <= MTLPixelFormatETC2_RGB8A1_sRGB);
+    BOOL is422Format = (pixelFormat == MTLPixelFormatGBGR422 || pixelFormat == MTLPixelFormatBGRG422);
+
+    return !isCompressedFormat && !is422Format && !(pixelFormat == MTLPixelFormatInvalid);
+}
+
+- (id<MTLTexture>)newTextureWithCommandQueue:(id<MTLCommandQueue>)commandQueue generateMipmaps:(BOOL)generateMipmaps
+{
+    if ([self.levels count] == 0)
+    {
+        return nil;
+    }
+
+    BOOL mipsLoaded = ([self.levels count] > 1);
+    BOOL canGenerateMips = [self pixelFormatIsColorRenderable:self.pixelFormat];
+
+    if (mipsLoaded || !canGenerateMips)
+    {
+        generateMipmaps = NO;
+    }
+
+    BOOL needMipStorage = (generateMipmaps || mipsLoaded);
+
+    MTLTextureDescriptor *texDescriptor = nil;
+    if (self.faceCount == 6 && self.arrayLength == 1 && self.width == self.height)
+    {
+        texDescriptor = [MTLTextureDescriptor textureCubeDescriptorWithPixelFormat:self.pixelFormat
+                                                                              size:self.width
+                                                                         mipmapped:needMipStorage];
+    }
+    else if (self.faceCount == 1)
+    {
+        texDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:self.pixelFormat
+                                                                           width:self.width
+                                                                          height:self.height
+                                                                       mipmapped:needMipStorage];
+        if (self.arrayLength > 1)
+        {
+            texDescriptor.textureType = MTLTextureType2DArray;
+            texDescriptor.arrayLength = self.arrayLength;
+        }
+    }
+    else
+    {
+        // Cube map arrays aren't available on every device we support, and cube faces must be square
+        return nil;
+    }
+
+    if (mipsLoaded)
+    {
+        // Containers may stop short of 1 x 1, so only allocate the levels they hold
+        texDescriptor.mipmapLevelCount = [self.levels count];
+    }
+    texDescriptor.usage = MTLTextureUsageShaderRead;
+    id<MTLTexture> texture = [[commandQueue device] newTextureWithDescriptor:texDescriptor];
+
+    if (texture == nil && _container && MBEETCCanDecode(_container->format()))
+    {
+        // The GPU can't sample this format, so decode it into an uncompressed one that it can
+        return [self newDecodedTextureWithDevice:[commandQueue device] descriptor:texDescriptor];
+    }
+
+    if (_container)
+    {
+        // Every face and slice is copied straight out of the mapped container
+        for (uint32_t level = 0; level < _container->levelCount(); ++level)
+        {
+            for (uint32_t slice = 0; slice < _container->sliceCount(); ++slice)
+            {
+                for (uint32_t face = 0; face < _container->faceCount(); ++face)
+                {
+                    const MBETextureContainerImage &image = _container->image(level, slice, face);
+                    MTLRegion region = MTLRegionMake2D(0, 0, image.width, image.height);
+                    [texture replaceRegion:region
+                               mipmapLevel:level
+                                     slice:slice * _container->faceCount() + face
+                                 withBytes:image.bytes
+                               bytesPerRow:image.bytesPerRow
+                             bytesPerImage:0];
+                }
+            }
+        }
+    }
+    else
+    {
+        MTLRegion region = MTLRegionMake2D(0, 0, self.width, self.height);
+        [texture replaceRegion:region mipmapLevel:0 withBytes:[self.levels[0] bytes] bytesPerRow:self.bytesPerRow];
+    }
+
+    if (generateMipmaps)
+    {
+        [self generateMipmapsForTexture:texture commandQueue:commandQueue];
+    }
+
+    return texture;
+}
+
+- (MTLPixelFormat)decodedPixelFormatForContainer:(const MBETextureContainer &)container
+{
+    switch (container.format())
+    {
+        case MBECompressedFormatEAC_R11:
+            return MTLPixelFormatR16Unorm;
+        case MBECompressedFormatEAC_RG11:
+            return MTLPixelFormatRG16Unorm;
+        default:
+            return container.isSRGB() ? MTLPixelFormatRGBA8Unorm_sRGB : MTLPixelFormatRGBA8Unorm;
+    }
+}
+
+- (id<MTLTexture>)newDecodedTextureWithDevice:(id<MTLDevice>)device descriptor:(MTLTextureDescriptor *)descriptor
+{
+    MTLTextureDescriptor *decodedDescriptor = [descriptor copy];
+    decodedDescriptor.pixelFormat = [self decodedPixelFormatForContainer:*_container];
+    id<MTLTexture> texture = [device newTextureWithDescriptor:decodedDescriptor];
+    if (texture == nil)
+    {
+        return nil;
+    }
+
+    // Every level of a face is decoded at once, so the pool stays busy through the small levels
+    std::vector<uint8_t> pixels;
+    std::vector<MBETextureContainerImage> levels;
+    for (uint32_t slice = 0; slice < _container->sliceCount(); ++slice)
+    {
+        for (uint32_t face = 0; face < _container->faceCount(); ++face)
+        {
+            MBEDecodeETCLevels(*_container, slice, face, pixels, levels);
+            for (uint32_t level = 0; level < levels.size(); ++level)
+            {
+                const MBETextureContainerImage &image = levels[level];
+                MTLRegion region = MTLRegionMake2D(0, 0, image.width, image.height);
+                [texture replaceRegion:region
+                           mipmapLevel:level
+                                 slice:slice * _container->faceCount() + face
+                             withBytes:image.bytes
+                           bytesPerRow:image.bytesPerRow
+                         bytesPerImage:0];
+            }
+        }
+    }
+
+    return texture;
+}
+
+- (void)generateMipmapsForTexture:(id<MTLTexture>)texture commandQueue:(id<MTLCommandQueue>)commandQueue
+{
+    id<MTLCommandBuffer> commandBuffer = [commandQueue commandBuffer];
+    id<MTLBlitCommandEncoder> blitEncoder = [commandBuffer blitCommandEncoder];
+    [blitEncoder generateMipmapsForTexture:texture];
+    [blitEncoder endEncoding];
+    [commandBuffer commit];
+
+    // blocking call
+    [commandBuffer waitUntilCompleted];
+}
+
+@end
@@ -0,0 +1,113 @@
+// Measures the throughput of the ETC2/EAC decoder on the host, outside of the app. Each container is
+// mapped once and every face of every slice is decoded repeatedly, and the best time is reported as
+// megapixels per second, counting the pixels of every mipmap level. Only the decode is timed, not the
+// upload of the decoded pixels to a texture.
+//
+// usage: MBEETCDecodeBenchmark [iterations] [file.pvr|file.ktx ...]
+//
+// With no files, it decodes the textures bundled with the sample, at paths relative to this directory,
+// skipping those in formats the decoder doesn't handle.
+
+#include "MBEETCDecoder.h"
+#include "MBETextureContainer.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+const char *const MBEBundledTexturePaths[] = {
+    "../CompressedTextures/Textures/hotair.2bpp.pvr",
+    "../CompressedTextures/Textures/hotair.4bpp.pvr",
+    "../CompressedTextures/Textures/hotair.astc4x4.ktx",
+    "../CompressedTextures/Textures/hotair.astc8x8.ktx",
+    "../CompressedTextures/Textures/hotair.etc2.pvr",
+};
+
+/// The shortest of `iterations` decodes of every face of every slice, in seconds
+double MBEBestDecodeTime(const MBETextureContainer &container, int iterations, double &pixelCount)
+{
+    std::vector<uint8_t> pixels;
+    std::vector<MBETextureContainerImage> levels;
+    double bestTime = 1e30;
+    for (int i = 0; i < iterations; ++i)
+    {
+        pixelCount = 0;
+        double time = 0;
+        for (uint32_t slice = 0; slice < container.sliceCount(); ++slice)
+        {
+            for (uint32_t face = 0; face < container.faceCount(); ++face)
+            {
+                auto start = std::chrono::steady_clock::now();
+                MBEDecodeETCLevels(container, slice, face, pixels, levels);
+                std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                time += elapsed.count();
+
+                for (const MBETextureContainerImage &image : levels)
+                {
+                    pixelCount += (double)image.width * image.height;
+                }
+            }
+        }
+        bestTime = std::min(bestTime, time);
+    }
+    return bestTime;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int iterations = (argc > 1) ? std::atoi(argv[1]) : 20;
+    if (iterations < 1)
+    {
+        std::fprintf(stderr, "usage: %s [iterations] [file.pvr|file.ktx ...]\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<const char *> paths(argv + std::min(argc, 2), argv + argc);
+    const bool isBundled = paths.empty();
+    if (isBundled)
+    {
+        paths.assign(std::begin(MBEBundledTexturePaths), std::end(MBEBundledTexturePaths));
+    }
+
+    std::printf("%u threads, best of %d decodes\n", MBEThreadPool::sharedPool().threadCount(), iterations);
+    std::printf("%-24s %11s %7s %12s %9s\n", "file", "size", "levels", "megapixels", "MP/s");
+
+    int status = 0;
+    for (const char *path : paths)
+    {
+        const char *name = std::strrchr(path, '/') ? std::strrchr(path, '/') + 1 : path;
+        std::shared_ptr<MBETextureContainer> container = MBETextureContainer::open(path);
+        if (!container)
+        {
+            std::fprintf(stderr, "Couldn't read %s\n", path);
+            status = 1;
+            continue;
+        }
+        if (!MBEETCCanDecode(container->format()))
+        {
+            std::printf("%-24s skipped, not ETC2/EAC\n", name);
+            // A format we can't decode is only an error when the file was asked for by name
+            status = isBundled ? status : 1;
+            continue;
+        }
+
+        double pixelCount = 0;
+        double time = MBEBestDecodeTime(*container, iterations, pixelCount);
+
+        char size[32];
+        std::snprintf(size, sizeof(size), "%ux%u", container->width(), container->height());
+        std::printf("%-24s %11s %7u %12.2f %9.1f\n", name, size, container->levelCount(),
+                    pixelCount / 1e6, pixelCount / 1e6 / time);
+    }
+
+    return status;
+}
@@ -0,0 +1,14 @@
+#!/bin/sh
+# Builds the host-side tools for this sample into ./build, with any C++11 compiler and POSIX threads.
+# The tools share their sources with the app, so they measure exactly what ships.
+set -e
+cd "$(dirname "$0")"
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--O2}
+SOURCES=../CompressedTextures
+
+mkdir -p build
+$CXX -std=c++11 $CXXFLAGS -I$SOURCES -o build/MBEETCDecodeBenchmark MBEETCDecodeBenchmark.cpp \
+    $SOURCES/MBEETCDecoder.cpp $SOURCES/MBETextureContainer.cpp $SOURCES/MBEMappedFile.cpp \
+    $SOURCES/MBEThreadPool.cpp -lpthread
@@ -0,0 +1,35 @@
+@import Foundation;
+
+typedef uint32_t MBEAssetID;
+
+/// Streams assets in on background threads, so that a renderer can draw its first frames while its
+/// meshes and textures are still loading. Each asset has a `load` block, which runs on a worker thread
+/// and should do all of the slow work, including creating its Metal resources, and a `completion`
+/// block, which runs on the thread that calls `processCompletions` and should publish the asset to the
+/// renderer. Loading is ordered by dependencies and bounded by an estimate of the memory each asset
+/// holds while it loads (see MBEAssetPipeline).
+@interface MBEAssetLoader : NSObject
+
+/// Creates a loader with `workerCount` threads, or one per core when it is zero, that starts no more
+/// loads while the assets in flight are estimated to hold `maxBytesInFlight` bytes.
+- (instancetype)initWithWorkerCount:(NSUInteger)workerCount maxBytesInFlight:(size_t)maxBytesInFlight;
+
+/// Queues an asset that is loaded once the assets in `dependencies`, an array of NSNumber-wrapped
+/// MBEAssetIDs, have completed. `load` returns whether it succeeded; when it fails, or a dependency
+/// fails, `completion` is passed NO.
+- (MBEAssetID)addAssetWithEstimatedBytes:(size_t)estimatedBytes
+                            dependencies:(NSArray *)dependencies
+                                    load:(BOOL (^)(void))load
+                              completion:(void (^)(BOOL loaded))completion;
+
+/// Runs the completion blocks of the assets that have finished loading since the last call, and
+/// returns how many ran. Never waits for a load; call it once per frame.
+- (NSUInteger)processCompletions;
+
+/// Blocks until every queued asset has loaded and completed, running completions on this thread
+- (void)waitUntilIdle;
+
+/// Whether every queued asset has completed
+@property (nonatomic, readonly, getter=isIdle) BOOL idle;
+
+@end
@@ -0,0 +1,71 @@
+#import "MBEAssetLoader.h"
+#import "MBEAssetPipeline.h"
+
+#include <memory>
+#include <vector>
+
+@interface MBEAssetLoader ()
+{
+    std::unique_ptr<MBEAssetPipeline> _pipeline;
+}
+@end
+
+@implementation MBEAssetLoader
+
+- (instancetype)initWithWorkerCount:(NSUInteger)workerCount maxBytesInFlight:(size_t)maxBytesInFlight
+{
+    if ((self = [super init]))
+    {
+        _pipeline.reset(new MBEAssetPipeline((unsigned)workerCount, maxBytesInFlight));
+    }
+    return self;
+}
+
+- (MBEAssetID)addAssetWithEstimatedBytes:(size_t)estimatedBytes
+                            dependencies:(NSArray *)dependencies
+                                    load:(BOOL (^)(void))load
+                              completion:(void (^)(BOOL loaded))completion
+{
+    std::vector<MBEAssetPipeline::AssetID> dependencyIDs;
+    for (NSNumber *dependency in dependencies)
+    {
+        dependencyIDs.push_back([dependency unsignedIntValue]);
+    }
+
+    BOOL (^loadBlock)(void) = [load copy];
+    void (^completionBlock)(BOOL) = [completion copy];
+
+    // Workers have no run loop to drain autoreleased objects, so each load gets a pool of its own
+    return _pipeline->add(estimatedBytes, dependencyIDs,
+                          [loadBlock]() -> bool
+                          {
+                              @autoreleasepool
+                              {
+                                  return loadBlock ? loadBlock() : YES;
+                              }
+                          },
+                          [completionBlock](bool loaded)
+                          {
+                              if (completionBlock)
+                              {
+                                  completionBlock(loaded);
+                              }
+                          });
+}
+
+- (NSUInteger)processCompletions
+{
+    return _pipeline->runCompletions();
+}
+
+- (void)waitUntilIdle
+{
+    _pipeline->waitUntilIdle();
+}
+
+- (BOOL)isIdle
+{
+    return _pipeline->isIdle();
+}
+
+@end
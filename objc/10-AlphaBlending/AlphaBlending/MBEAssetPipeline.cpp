@@ -0,0 +1,266 @@
+#include "MBEAssetPipeline.h"
+
+#include <algorithm>
+
+struct MBEAssetPipeline::Asset
+{
+    enum State
+    {
+        Waiting,   // for its dependencies to complete
+        Ready,     // to load, once there is a worker and room in the budget
+        Loading,
+        Finished,  // loading, or failing; waiting for its completion to run
+        Complete,
+    };
+
+    State state;
+    size_t bytes;
+    size_t pendingDependencyCount;
+    bool dependencyFailed;
+    bool loaded;
+    bool holdsBytes;
+    std::function<bool()> load;
+    std::function<void(bool)> complete;
+    std::vector<AssetID> dependents;
+};
+
+MBEAssetPipeline::MBEAssetPipeline(unsigned workerCount, size_t maxBytesInFlight) :
+    _maxBytesInFlight(maxBytesInFlight), _bytesInFlight(0), _peakBytesInFlight(0), _incompleteCount(0), _stopping(false)
+{
+    if (workerCount == 0)
+    {
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 0; i < workerCount; ++i)
+    {
+        _workers.push_back(std::thread(&MBEAssetPipeline::workerMain, this));
+    }
+}
+
+MBEAssetPipeline::~MBEAssetPipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _workCondition.notify_all();
+
+    for (std::thread &worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+MBEAssetPipeline::AssetID MBEAssetPipeline::add(size_t estimatedBytes,
+                                                const std::vector<AssetID> &dependencies,
+                                                std::function<bool()> load,
+                                                std::function<void(bool)> complete)
+{
+    std::unique_ptr<Asset> asset(new Asset());
+    asset->state = Asset::Waiting;
+    asset->bytes = estimatedBytes;
+    asset->pendingDependencyCount = 0;
+    asset->dependencyFailed = false;
+    asset->loaded = false;
+    asset->holdsBytes = false;
+    asset->load = std::move(load);
+    asset->complete = std::move(complete);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    const AssetID assetID = (AssetID)_assets.size();
+
+    for (AssetID dependencyID : dependencies)
+    {
+        if (dependencyID >= assetID)
+        {
+            asset->dependencyFailed = true;
+            continue;
+        }
+
+        Asset &dependency = *_assets[dependencyID];
+        if (dependency.state == Asset::Complete)
+        {
+            asset->dependencyFailed = asset->dependencyFailed || !dependency.loaded;
+        }
+        else
+        {
+            dependency.dependents.push_back(assetID);
+            ++asset->pendingDependencyCount;
+        }
+    }
+
+    _assets.push_back(std::move(asset));
+    ++_incompleteCount;
+
+    if (_assets[assetID]->pendingDependencyCount == 0)
+    {
+        if (_assets[assetID]->dependencyFailed)
+        {
+            _assets[assetID]->state = Asset::Finished;
+            _finishedAssets.push_back(assetID);
+            lock.unlock();
+            _completionCondition.notify_all();
+        }
+        else
+        {
+            _assets[assetID]->state = Asset::Ready;
+            _readyAssets.push_back(assetID);
+            lock.unlock();
+            _workCondition.notify_one();
+        }
+    }
+
+    return assetID;
+}
+
+bool MBEAssetPipeline::canStartLoading() const
+{
+    if (_readyAssets.empty())
+    {
+        return false;
+    }
+
+    // The budget is checked against the next asset only, so that a large asset isn't starved by small ones
+    const size_t bytes = _assets[_readyAssets.front()]->bytes;
+    return _bytesInFlight == 0 || bytes <= _maxBytesInFlight - std::min(_bytesInFlight, _maxBytesInFlight);
+}
+
+void MBEAssetPipeline::workerMain()
+{
+    while (1)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _workCondition.wait(lock, [this] { return _stopping || canStartLoading(); });
+        if (_stopping)
+        {
+            return;
+        }
+
+        const AssetID assetID = _readyAssets.front();
+        _readyAssets.pop_front();
+
+        Asset &asset = *_assets[assetID];
+        asset.state = Asset::Loading;
+        asset.holdsBytes = true;
+        _bytesInFlight += asset.bytes;
+        _peakBytesInFlight = std::max(_peakBytesInFlight, _bytesInFlight);
+
+        // Another worker may be able to start too, if the budget allows
+        lock.unlock();
+        _workCondition.notify_one();
+
+        const bool loaded = asset.load ? asset.load() : true;
+
+        lock.lock();
+        asset.loaded = loaded;
+        asset.state = Asset::Finished;
+        _finishedAssets.push_back(assetID);
+        lock.unlock();
+        _completionCondition.notify_all();
+    }
+}
+
+size_t MBEAssetPipeline::runCompletions(size_t maxCount)
+{
+    size_t completedCount = 0;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (completedCount < maxCount && !_finishedAssets.empty())
+    {
+        const AssetID assetID = _finishedAssets.front();
+        _finishedAssets.pop_front();
+
+        Asset &asset = *_assets[assetID];
+        std::function<void(bool)> complete = std::move(asset.complete);
+        const bool loaded = asset.loaded;
+
+        lock.unlock();
+        if (complete)
+        {
+            complete(loaded);
+        }
+        lock.lock();
+
+        finish(assetID, loaded);
+        ++completedCount;
+    }
+    return completedCount;
+}
+
+void MBEAssetPipeline::finish(AssetID assetID, bool loaded)
+{
+    Asset &asset = *_assets[assetID];
+    asset.state = Asset::Complete;
+    asset.load = nullptr;
+    --_incompleteCount;
+
+    // Freed bytes or newly ready assets may let a worker start
+    bool wakeWorkers = false;
+    if (asset.holdsBytes)
+    {
+        _bytesInFlight -= asset.bytes;
+        asset.holdsBytes = false;
+        wakeWorkers = asset.bytes > 0;
+    }
+
+    for (AssetID dependentID : asset.dependents)
+    {
+        Asset &dependent = *_assets[dependentID];
+        dependent.dependencyFailed = dependent.dependencyFailed || !loaded;
+        if (--dependent.pendingDependencyCount > 0)
+        {
+            continue;
+        }
+
+        if (dependent.dependencyFailed)
+        {
+            dependent.state = Asset::Finished;
+            _finishedAssets.push_back(dependentID);
+        }
+        else
+        {
+            dependent.state = Asset::Ready;
+            _readyAssets.push_back(dependentID);
+            wakeWorkers = true;
+        }
+    }
+    asset.dependents.clear();
+
+    if (wakeWorkers)
+    {
+        _workCondition.notify_all();
+    }
+}
+
+void MBEAssetPipeline::waitUntilIdle()
+{
+    while (1)
+    {
+        runCompletions();
+
+        std::unique_lock<std::mutex> lock(_mutex);
+        if (_incompleteCount == 0)
+        {
+            return;
+        }
+        _completionCondition.wait(lock, [this] { return !_finishedAssets.empty(); });
+    }
+}
+
+bool MBEAssetPipeline::isIdle() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _incompleteCount == 0;
+}
+
+size_t MBEAssetPipeline::bytesInFlight() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bytesInFlight;
+}
+
+size_t MBEAssetPipeline::peakBytesInFlight() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _peakBytesInFlight;
+}
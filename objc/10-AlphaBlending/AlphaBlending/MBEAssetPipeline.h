@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// Loads assets on a set of worker threads while the thread that owns the pipeline (typically the one
+/// that renders) keeps running, and hands each loaded asset back to that thread.
+///
+/// An asset is loaded in two steps. Its `load` function runs on a worker and does the slow part: I/O,
+/// decoding, mesh processing and, on a real device, creating GPU resources. Its `complete` function
+/// then runs on the owning thread from `runCompletions`, where it can publish the asset to objects
+/// that aren't thread-safe. An asset is not loaded until every asset it depends on has completed, so
+/// its `load` may read what their completions published. When a dependency fails to load, so do its
+/// dependents, without their `load` being called.
+///
+/// Every asset declares how many bytes it will hold while it is in flight, from the start of its
+/// `load` until its `complete` returns. Loads don't start while that would raise the total above
+/// the pipeline's budget, which bounds peak memory during loading; an asset larger than the budget
+/// still loads, alone. Assets start in the order they become ready.
+class MBEAssetPipeline
+{
+public:
+    typedef uint32_t AssetID;
+
+    /// Creates a pipeline with `workerCount` threads, or one per hardware core when it is zero
+    MBEAssetPipeline(unsigned workerCount, size_t maxBytesInFlight);
+
+    /// Abandons assets that have not started loading and waits for those that have. Completions that
+    /// have not run by now never run.
+    ~MBEAssetPipeline();
+
+    /// Queues an asset and returns its id. `dependencies` must be ids returned earlier by this pipeline.
+    /// May be called from any thread, including from `load` and `complete` functions.
+    AssetID add(size_t estimatedBytes,
+                const std::vector<AssetID> &dependencies,
+                std::function<bool()> load,
+                std::function<void(bool loaded)> complete);
+
+    /// Runs up to `maxCount` pending completions on the calling thread, which should always be the same
+    /// thread, and returns how many ran. Never blocks on loads.
+    size_t runCompletions(size_t maxCount = SIZE_MAX);
+
+    /// Runs completions on the calling thread until every asset added so far, and every asset those
+    /// add, has completed
+    void waitUntilIdle();
+
+    /// Whether every asset added so far has completed
+    bool isIdle() const;
+
+    /// The estimated bytes of the assets that are loading or waiting for their completion to run
+    size_t bytesInFlight() const;
+    /// The largest `bytesInFlight` has been
+    size_t peakBytesInFlight() const;
+
+private:
+    MBEAssetPipeline(const MBEAssetPipeline &) = delete;
+    MBEAssetPipeline &operator=(const MBEAssetPipeline &) = delete;
+
+    struct Asset;
+
+    void workerMain();
+    bool canStartLoading() const;
+    void finish(AssetID assetID, bool loaded);
+
+    std::vector<std::thread> _workers;
+    mutable std::mutex _mutex;
+    std::condition_variable _workCondition;
+    std::condition_variable _completionCondition;
+    std::vector<std::unique_ptr<Asset>> _assets;
+    std::deque<AssetID> _readyAssets;
+    std::deque<AssetID> _finishedAssets;
+    size_t _maxBytesInFlight;
+    size_t _bytesInFlight;
+    size_t _peakBytesInFlight;
+    size_t _incompleteCount;
+    bool _stopping;
+};
@@ -0,0 +1,23 @@
+@import UIKit;
+@import Metal;
+
+/// Creates textures from images in the main bundle through a persistent cache of their decoded pixels.
+/// The first time an image is loaded, it is decoded with Core Graphics, its mipmaps are built on the
+/// CPU, and every level is written to the user's Caches directory under a name derived from a hash of
+/// the image file and the requested format. Later loads map the cached levels and upload them one at a
+/// time, without decoding the image, allocating memory for its pixels, or waiting on the GPU.
+@interface MBECachedTextureLoader : NSObject
+
++ (instancetype)sharedTextureLoader;
+
+/// Returns a texture for the image named `imageName`, or nil if there is none. `pixelFormat` must be
+/// MTLPixelFormatRGBA8Unorm or MTLPixelFormatRGBA8Unorm_sRGB. When `flipped` is YES, the image is
+/// flipped vertically as it is decoded. A cache baked into the bundle next to the image, with the
+/// extension "mbetexture", is used in preference to the user's cache when it matches.
+- (id<MTLTexture>)texture2DWithImageNamed:(NSString *)imageName
+                              pixelFormat:(MTLPixelFormat)pixelFormat
+                                mipmapped:(BOOL)mipmapped
+                                  flipped:(BOOL)flipped
+                                   device:(id<MTLDevice>)device;
+
+@end
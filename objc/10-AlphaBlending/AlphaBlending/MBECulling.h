@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that the renderers, written in plain Objective-C, can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct
+{
+    float center[3];
+    float radius;
+} MBEBoundingSphere;
+
+/// The six planes that bound a view volume, each stored as (a, b, c, d) such that a point is on the
+/// inside of the plane when a * x + b * y + c * z + d >= 0. The normals (a, b, c) are unit length.
+typedef struct
+{
+    float planes[6][4];
+} MBEFrustum;
+
+/// Running totals of culling work, which can be accumulated across several calls and reset each frame
+typedef struct
+{
+    size_t instancesTested;
+    size_t instancesVisible;
+} MBECullingStats;
+
+/// Computes a sphere that encloses `count` points. Each point is three consecutive floats, and points
+/// start every `stride` bytes. The sphere is close to, but not necessarily, the smallest possible.
+MBEBoundingSphere MBEBoundingSphereMake(const float *positions, size_t count, size_t stride);
+
+/// Extracts the planes of the view volume of a column-major view-projection matrix. The near plane is
+/// taken where clip-space z = -w, so the frustum contains the view volume whether the projection maps
+/// depth to [-1, 1] or to [0, 1].
+MBEFrustum MBEFrustumMake(const float viewProjectionMatrix[16]);
+
+/// Writes the world-space bounds of `count` instances of a mesh with bounds `sphere` to `spheres`. Each
+/// instance is `stride` bytes long and starts with its column-major model matrix, which may rotate, scale
+/// and translate the mesh, but not shear it.
+void MBETransformBoundingSpheres(MBEBoundingSphere sphere,
+                                 const void *instances,
+                                 size_t instanceCount,
+                                 size_t stride,
+                                 MBEBoundingSphere *spheres);
+
+/// Copies the instances whose bounding spheres intersect the frustum, in order, to the front of
+/// `visibleInstances`, and returns how many there are. Each instance is `stride` bytes long and starts
+/// with its column-major model matrix, which places `sphere` in world space and may rotate, scale and
+/// translate it, but not shear it. `visibleInstances` may be the same as `instances` to compact them
+/// in place. If `stats` is not null, the counts of this call are added to it.
+size_t MBECullInstances(const MBEFrustum *frustum,
+                        MBEBoundingSphere sphere,
+                        const void *instances,
+                        size_t instanceCount,
+                        size_t stride,
+                        void *visibleInstances,
+                        MBECullingStats *stats);
+
+/// Sorts instances by the level of detail they should be drawn with, so that each level can be drawn
+/// as one contiguous run. An instance gets the coarsest level whose error, scaled by the instance and
+/// projected from the nearest point of its bounding sphere, covers at most `pixelTolerance` pixels.
+/// `projectionScale` converts a size at unit distance to pixels, and is typically the viewport height
+/// divided by 2 * tan(fieldOfView / 2). `levelErrors` are in model units and must not decrease.
+///
+/// Instances are laid out as for MBECullInstances and are sorted in place, keeping their relative order
+/// within each level. `scratch` needs room for `instanceCount` instances, and the number of instances
+/// at each level is written to `levelInstanceCounts`.
+void MBESortInstancesByLevelOfDetail(const float cameraPosition[3],
+                                     float projectionScale,
+                                     float pixelTolerance,
+                                     MBEBoundingSphere sphere,
+                                     const float *levelErrors,
+                                     size_t levelCount,
+                                     void *instances,
+                                     size_t instanceCount,
+                                     size_t stride,
+                                     void *scratch,
+                                     size_t *levelInstanceCounts);
+
+#ifdef __cplusplus
+}
+#endif
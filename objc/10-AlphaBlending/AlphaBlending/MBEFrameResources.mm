@@ -0,0 +1,76 @@
+#import "MBEFrameResources.h"
+#import "MBEFrameRing.h"
+
+#include <memory>
+
+const NSUInteger MBEDefaultFramesInFlight = 3;
+const NSUInteger MBEFrameResourceAlignment = 256;
+
+@interface MBEFrameResources ()
+{
+    // The fence is shared with completion handlers, which may run after the renderer is gone
+    std::shared_ptr<MBECPUFrameFence> _fence;
+    std::unique_ptr<MBEFrameRing> _ring;
+}
+@end
+
+@implementation MBEFrameResources
+
+- (instancetype)initWithDevice:(id<MTLDevice>)device
+                framesInFlight:(NSUInteger)framesInFlight
+                 bytesPerFrame:(NSUInteger)bytesPerFrame
+{
+    if ((self = [super init]))
+    {
+        _fence = std::make_shared<MBECPUFrameFence>();
+        _ring.reset(new MBEFrameRing(*_fence, (unsigned)framesInFlight, bytesPerFrame, MBEFrameResourceAlignment));
+
+        _framesInFlight = _ring->frameCount();
+        _bytesPerFrame = _ring->bytesPerFrame();
+
+        _buffer = [device newBufferWithLength:_ring->length() options:MTLResourceOptionCPUCacheModeDefault];
+        [_buffer setLabel:@"Frame Resources"];
+    }
+    return self;
+}
+
+- (void)beginFrame
+{
+    _ring->beginFrame();
+}
+
+- (void)waitForPreviousFrames
+{
+    const uint64_t frame = _ring->currentFrame();
+    if (frame > 1)
+    {
+        _fence->wait(frame - 1);
+    }
+}
+
+- (void *)allocateLength:(NSUInteger)length offset:(NSUInteger *)offset
+{
+    size_t allocationOffset = 0;
+    if (!_ring->allocate(length, &allocationOffset))
+    {
+#if DEBUG
+        NSLog(@"Frame resources exhausted: %d bytes requested with %d of %d in use",
+              (int)length, (int)_ring->bytesAllocated(), (int)_bytesPerFrame);
+#endif
+        return NULL;
+    }
+
+    *offset = allocationOffset;
+    return (uint8_t *)[_buffer contents] + allocationOffset;
+}
+
+- (void)endFrameWithCommandBuffer:(id<MTLCommandBuffer>)commandBuffer
+{
+    const uint64_t frame = _ring->currentFrame();
+    std::shared_ptr<MBECPUFrameFence> fence = _fence;
+    [commandBuffer addCompletedHandler:^(id<MTLCommandBuffer> commandBuffer) {
+        fence->signal(frame);
+    }];
+}
+
+@end
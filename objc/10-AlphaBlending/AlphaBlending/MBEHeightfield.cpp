@@ -0,0 +1,106 @@
+#include "MBEHeightfield.h"
+#include "MBEThreadPool.h"
+
+#include <cmath>
+
+MBEHeightfield::MBEHeightfield(unsigned iterations, float smoothness, uint64_t seed) :
+    _stride(((size_t)1 << iterations) + 1),
+    _seed(seed),
+    _heights(_stride * _stride, 0.0f)
+{
+    float variance = 1.0f; // absolute maximum displacement at the current level
+    const float smoothingFactor = powf(2, -smoothness); // factor by which to decrease variance each level
+
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        const size_t squareSize = (size_t)1 << (iterations - i);
+
+        // Within a level, every sample depends only on samples from earlier levels, so each step can
+        // fill its rows in parallel
+        performSquareStep(squareSize, variance);
+        performEdgeStep(squareSize, variance);
+
+        variance *= smoothingFactor;
+    }
+}
+
+float MBEHeightfield::displacement(size_t row, size_t column) const
+{
+    // SplitMix64's finalizer over the seed and coordinates gives well-distributed, independent values
+    uint64_t z = _seed + 0x9e3779b97f4a7c15ULL * (((uint64_t)row << 32) | (uint64_t)column);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z ^= z >> 31;
+
+    // The top 24 bits make an exact float in [0, 1), which we map to [-1, 1)
+    const float unit = (float)(z >> 40) * (1.0f / 16777216.0f);
+    return unit * 2 - 1;
+}
+
+void MBEHeightfield::performSquareStep(size_t squareSize, float variance)
+{
+    // Each square's center becomes the mean of its corners, plus a random displacement
+    const size_t squaresPerEdge = (_stride - 1) / squareSize;
+    const size_t half = squareSize / 2;
+
+    MBEThreadPool::sharedPool().parallelFor(squaresPerEdge, [&](size_t y)
+    {
+        const size_t r0 = y * squareSize;
+        const size_t r1 = r0 + squareSize;
+        for (size_t x = 0; x < squaresPerEdge; ++x)
+        {
+            const size_t c0 = x * squareSize;
+            const size_t c1 = c0 + squareSize;
+            const float mean = (height(r0, c0) + height(r0, c1) + height(r1, c0) + height(r1, c1)) * 0.25f;
+            _heights[(r0 + half) * _stride + (c0 + half)] = mean + displacement(r0 + half, c0 + half) * variance;
+        }
+    });
+}
+
+void MBEHeightfield::performEdgeStep(size_t squareSize, float variance)
+{
+    // Each edge's midpoint becomes the mean of the edge's endpoints, plus a random displacement. Edges
+    // shared by two squares are visited once, so neighboring squares agree on them.
+    const size_t half = squareSize / 2;
+    const size_t rowCount = (_stride - 1) / half + 1;
+
+    MBEThreadPool::sharedPool().parallelFor(rowCount, [&](size_t i)
+    {
+        const size_t r = i * half;
+        if (r % squareSize == 0)
+        {
+            // A row of corners: fill the midpoints of the horizontal edges between them
+            for (size_t c = half; c < _stride; c += squareSize)
+            {
+                const float mean = (height(r, c - half) + height(r, c + half)) * 0.5f;
+                _heights[r * _stride + c] = mean + displacement(r, c) * variance;
+            }
+        }
+        else
+        {
+            // A row of square centers: fill the midpoints of the vertical edges between the centers
+            for (size_t c = 0; c < _stride; c += squareSize)
+            {
+                const float mean = (height(r - half, c) + height(r + half, c)) * 0.5f;
+                _heights[r * _stride + c] = mean + displacement(r, c) * variance;
+            }
+        }
+    });
+}
+
+void MBEHeightfield::normal(size_t row, size_t column, float spacing, float verticalScale, float normal[3]) const
+{
+    const size_t c0 = (column > 0) ? column - 1 : column;
+    const size_t c1 = (column + 1 < _stride) ? column + 1 : column;
+    const size_t r0 = (row > 0) ? row - 1 : row;
+    const size_t r1 = (row + 1 < _stride) ? row + 1 : row;
+
+    // Slopes along x (columns) and z (rows)
+    const float dx = (height(row, c1) - height(row, c0)) * verticalScale / ((c1 - c0) * spacing);
+    const float dz = (height(r1, column) - height(r0, column)) * verticalScale / ((r1 - r0) * spacing);
+
+    const float length = sqrtf(dx * dx + 1 + dz * dz);
+    normal[0] = -dx / length;
+    normal[1] = 1 / length;
+    normal[2] = -dz / length;
+}
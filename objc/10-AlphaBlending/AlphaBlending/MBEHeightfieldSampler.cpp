@@ -0,0 +1,334 @@
+#include "MBEHeightfieldSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+    // Queries are processed in groups of this many, with each step of the interpolation written as a
+    // loop over the group so that the compiler can turn it into vector instructions
+    const size_t MBESampleLaneCount = 4;
+
+    inline void cross(const float a[3], const float b[3], float result[3])
+    {
+        result[0] = a[1] * b[2] - a[2] * b[1];
+        result[1] = a[2] * b[0] - a[0] * b[2];
+        result[2] = a[0] * b[1] - a[1] * b[0];
+    }
+
+    inline float dot(const float a[3], const float b[3])
+    {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+}
+
+MBEHeightfieldSampler::MBEHeightfieldSampler(const MBEHeightfield &heightfield, float spacing, float verticalScale) :
+    _heights(heightfield.heights()),
+    _stride(heightfield.stride()),
+    _spacing(spacing),
+    _inverseSpacing(1 / spacing),
+    _verticalScale(verticalScale),
+    _origin(-0.5f * (heightfield.stride() - 1) * spacing)
+{
+    buildHierarchy();
+}
+
+void MBEHeightfieldSampler::buildHierarchy()
+{
+    const size_t cellsPerEdge = _stride - 1;
+
+    // Level 1 covers 2 x 2 cells, which is 3 x 3 samples
+    size_t blocksPerEdge = cellsPerEdge / 2;
+    if (blocksPerEdge == 0)
+    {
+        return;
+    }
+
+    _levels.resize(2);
+    _levels[1].resize(blocksPerEdge * blocksPerEdge);
+    for (size_t i = 0; i < blocksPerEdge; ++i)
+    {
+        for (size_t j = 0; j < blocksPerEdge; ++j)
+        {
+            float minHeight = INFINITY;
+            float maxHeight = -INFINITY;
+            for (size_t r = 2 * i; r <= 2 * i + 2; ++r)
+            {
+                for (size_t c = 2 * j; c <= 2 * j + 2; ++c)
+                {
+                    const float h = _heights[r * _stride + c] * _verticalScale;
+                    minHeight = std::min(minHeight, h);
+                    maxHeight = std::max(maxHeight, h);
+                }
+            }
+            _levels[1][i * blocksPerEdge + j] = { minHeight, maxHeight };
+        }
+    }
+
+    // Each further level merges 2 x 2 blocks of the level below, up to a single block covering everything
+    while (blocksPerEdge > 1)
+    {
+        const std::vector<Range> &below = _levels.back();
+        const size_t belowPerEdge = blocksPerEdge;
+        blocksPerEdge /= 2;
+
+        std::vector<Range> level(blocksPerEdge * blocksPerEdge);
+        for (size_t i = 0; i < blocksPerEdge; ++i)
+        {
+            for (size_t j = 0; j < blocksPerEdge; ++j)
+            {
+                const Range &a = below[(2 * i) * belowPerEdge + 2 * j];
+                const Range &b = below[(2 * i) * belowPerEdge + 2 * j + 1];
+                const Range &c = below[(2 * i + 1) * belowPerEdge + 2 * j];
+                const Range &d = below[(2 * i + 1) * belowPerEdge + 2 * j + 1];
+                level[i * blocksPerEdge + j].minHeight = std::min(std::min(a.minHeight, b.minHeight), std::min(c.minHeight, d.minHeight));
+                level[i * blocksPerEdge + j].maxHeight = std::max(std::max(a.maxHeight, b.maxHeight), std::max(c.maxHeight, d.maxHeight));
+            }
+        }
+        _levels.push_back(std::move(level));
+    }
+}
+
+float MBEHeightfieldSampler::height(float x, float z) const
+{
+    const float position[2] = { x, z };
+    float result;
+    sampleHeights(position, 1, &result, nullptr, 0);
+    return result;
+}
+
+void MBEHeightfieldSampler::sampleHeights(const float *positions, size_t count, float *heights,
+                                          float *normals, size_t normalStride) const
+{
+    const size_t cellsPerEdge = _stride - 1;
+    const float maxCoordinate = (float)cellsPerEdge;
+    const float slopeScale = _verticalScale * _inverseSpacing;
+
+    for (size_t first = 0; first < count; first += MBESampleLaneCount)
+    {
+        const size_t laneCount = std::min(MBESampleLaneCount, count - first);
+
+        float h00[MBESampleLaneCount] = {}, h01[MBESampleLaneCount] = {};
+        float h10[MBESampleLaneCount] = {}, h11[MBESampleLaneCount] = {};
+        float fx[MBESampleLaneCount] = {}, fz[MBESampleLaneCount] = {};
+
+        // Gather the corners of the cell under each position. Clamping the cell, rather than the sample,
+        // keeps the far edge from reading past the last row or column.
+        for (size_t lane = 0; lane < laneCount; ++lane)
+        {
+            const float gx = std::min(std::max((positions[(first + lane) * 2 + 0] - _origin) * _inverseSpacing, 0.0f), maxCoordinate);
+            const float gz = std::min(std::max((positions[(first + lane) * 2 + 1] - _origin) * _inverseSpacing, 0.0f), maxCoordinate);
+            const size_t column = std::min((size_t)gx, cellsPerEdge - 1);
+            const size_t row = std::min((size_t)gz, cellsPerEdge - 1);
+            fx[lane] = gx - column;
+            fz[lane] = gz - row;
+
+            const float *corner = _heights + row * _stride + column;
+            h00[lane] = corner[0];
+            h01[lane] = corner[1];
+            h10[lane] = corner[_stride];
+            h11[lane] = corner[_stride + 1];
+        }
+
+        float laneHeights[MBESampleLaneCount];
+        for (size_t lane = 0; lane < MBESampleLaneCount; ++lane)
+        {
+            const float top = h00[lane] + fx[lane] * (h01[lane] - h00[lane]);
+            const float bottom = h10[lane] + fx[lane] * (h11[lane] - h10[lane]);
+            laneHeights[lane] = (top + fz[lane] * (bottom - top)) * _verticalScale;
+        }
+        std::copy(laneHeights, laneHeights + laneCount, heights + first);
+
+        if (normals)
+        {
+            // The gradient of the bilinear patch gives the normal (-dh/dx, 1, -dh/dz), up to length
+            float nx[MBESampleLaneCount], ny[MBESampleLaneCount], nz[MBESampleLaneCount];
+            for (size_t lane = 0; lane < MBESampleLaneCount; ++lane)
+            {
+                const float dx = ((1 - fz[lane]) * (h01[lane] - h00[lane]) + fz[lane] * (h11[lane] - h10[lane])) * slopeScale;
+                const float dz = ((1 - fx[lane]) * (h10[lane] - h00[lane]) + fx[lane] * (h11[lane] - h01[lane])) * slopeScale;
+                const float inverseLength = 1 / sqrtf(dx * dx + 1 + dz * dz);
+                nx[lane] = -dx * inverseLength;
+                ny[lane] = inverseLength;
+                nz[lane] = -dz * inverseLength;
+            }
+
+            for (size_t lane = 0; lane < laneCount; ++lane)
+            {
+                float *normal = (float *)((char *)normals + (first + lane) * normalStride);
+                normal[0] = nx[lane];
+                normal[1] = ny[lane];
+                normal[2] = nz[lane];
+            }
+        }
+    }
+}
+
+const MBEHeightfieldSampler::Range &MBEHeightfieldSampler::range(size_t level, size_t row, size_t column) const
+{
+    const size_t blocksPerEdge = (_stride - 1) >> level;
+    return _levels[level][row * blocksPerEdge + column];
+}
+
+bool MBEHeightfieldSampler::intersectBox(const Ray &ray, size_t level, size_t row, size_t column,
+                                         float *enter, float *exit) const
+{
+    const float size = (float)((size_t)1 << level) * _spacing;
+    const Range &heights = range(level, row, column);
+    const float lower[3] = { _origin + column * size, heights.minHeight, _origin + row * size };
+    const float upper[3] = { lower[0] + size, heights.maxHeight, lower[2] + size };
+
+    // Slab test. A zero direction component gives infinite slab distances, which the comparisons handle.
+    float tEnter = *enter;
+    float tExit = *exit;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t0 = (lower[axis] - ray.origin[axis]) * ray.inverseDirection[axis];
+        float t1 = (upper[axis] - ray.origin[axis]) * ray.inverseDirection[axis];
+        if (t0 > t1)
+        {
+            std::swap(t0, t1);
+        }
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+    }
+
+    *enter = tEnter;
+    *exit = tExit;
+    return tEnter <= tExit;
+}
+
+void MBEHeightfieldSampler::intersectNode(const Ray &ray, size_t level, size_t row, size_t column, float *nearest) const
+{
+    if (level == 1)
+    {
+        for (size_t r = 2 * row; r < 2 * row + 2; ++r)
+        {
+            for (size_t c = 2 * column; c < 2 * column + 2; ++c)
+            {
+                intersectCell(ray, r, c, nearest);
+            }
+        }
+        return;
+    }
+
+    // Visit the children nearest first, so that farther ones can be skipped once something is hit
+    struct Child { float enter; size_t row; size_t column; };
+    Child children[4];
+    size_t childCount = 0;
+    for (size_t dr = 0; dr < 2; ++dr)
+    {
+        for (size_t dc = 0; dc < 2; ++dc)
+        {
+            float enter = 0;
+            float exit = *nearest;
+            if (intersectBox(ray, level - 1, 2 * row + dr, 2 * column + dc, &enter, &exit))
+            {
+                children[childCount++] = { enter, 2 * row + dr, 2 * column + dc };
+            }
+        }
+    }
+    std::sort(children, children + childCount, [](const Child &a, const Child &b) { return a.enter < b.enter; });
+
+    for (size_t i = 0; i < childCount; ++i)
+    {
+        if (children[i].enter <= *nearest)
+        {
+            intersectNode(ray, level - 1, children[i].row, children[i].column, nearest);
+        }
+    }
+}
+
+void MBEHeightfieldSampler::intersectCell(const Ray &ray, size_t row, size_t column, float *nearest) const
+{
+    auto vertex = [&](size_t r, size_t c, float result[3])
+    {
+        result[0] = _origin + c * _spacing;
+        result[1] = _heights[r * _stride + c] * _verticalScale;
+        result[2] = _origin + r * _spacing;
+    };
+
+    float v00[3], v01[3], v10[3], v11[3];
+    vertex(row, column, v00);
+    vertex(row, column + 1, v01);
+    vertex(row + 1, column, v10);
+    vertex(row + 1, column + 1, v11);
+
+    // The cell is split along the same diagonal as the terrain mesh, so hits lie on the drawn surface
+    const float *triangles[2][3] = { { v00, v10, v11 }, { v11, v01, v00 } };
+    for (int i = 0; i < 2; ++i)
+    {
+        const float *a = triangles[i][0];
+        const float *b = triangles[i][1];
+        const float *c = triangles[i][2];
+
+        // Möller-Trumbore
+        const float edge1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const float edge2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        float p[3];
+        cross(ray.direction, edge2, p);
+        const float determinant = dot(edge1, p);
+        if (determinant == 0)
+        {
+            continue;
+        }
+
+        const float inverseDeterminant = 1 / determinant;
+        const float s[3] = { ray.origin[0] - a[0], ray.origin[1] - a[1], ray.origin[2] - a[2] };
+        const float u = dot(s, p) * inverseDeterminant;
+        if (u < 0 || u > 1)
+        {
+            continue;
+        }
+
+        float q[3];
+        cross(s, edge1, q);
+        const float v = dot(ray.direction, q) * inverseDeterminant;
+        if (v < 0 || u + v > 1)
+        {
+            continue;
+        }
+
+        const float t = dot(edge2, q) * inverseDeterminant;
+        if (t >= 0 && t < *nearest)
+        {
+            *nearest = t;
+        }
+    }
+}
+
+bool MBEHeightfieldSampler::intersectRay(const float origin[3], const float direction[3], float maxDistance,
+                                         float *distance) const
+{
+    Ray ray;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        ray.origin[axis] = origin[axis];
+        ray.direction[axis] = direction[axis];
+        ray.inverseDirection[axis] = 1 / direction[axis];
+    }
+
+    float nearest = maxDistance;
+    if (_levels.empty())
+    {
+        intersectCell(ray, 0, 0, &nearest);
+    }
+    else
+    {
+        const size_t topLevel = _levels.size() - 1;
+        float enter = 0;
+        float exit = maxDistance;
+        if (intersectBox(ray, topLevel, 0, 0, &enter, &exit))
+        {
+            intersectNode(ray, topLevel, 0, 0, &nearest);
+        }
+    }
+
+    if (nearest < maxDistance)
+    {
+        *distance = nearest;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "MBEHeightfield.h"
+
+#include <cstddef>
+#include <vector>
+
+/// Answers height, normal and ray queries against a heightfield laid out as MBETerrainMesh lays it out:
+/// centered on the origin, with `spacing` between samples and heights multiplied by `verticalScale`.
+/// Positions outside the heightfield are clamped to its nearest edge. All queries are const and may be
+/// made from any number of threads at once.
+class MBEHeightfieldSampler
+{
+public:
+    MBEHeightfieldSampler(const MBEHeightfield &heightfield, float spacing, float verticalScale);
+
+    /// The bilinearly interpolated height at (x, z)
+    float height(float x, float z) const;
+
+    /// Samples `count` positions, given as consecutive (x, z) pairs. Writes one height per position, and,
+    /// if `normals` is not null, the unit normal of the interpolated surface as three floats every
+    /// `normalStride` bytes.
+    void sampleHeights(const float *positions, size_t count, float *heights, float *normals, size_t normalStride) const;
+
+    /// Finds the first point where a ray meets the triangulated surface, within `maxDistance` units along
+    /// `direction` (which need not be unit length). Returns false if there is none.
+    bool intersectRay(const float origin[3], const float direction[3], float maxDistance, float *distance) const;
+
+private:
+    struct Range
+    {
+        float minHeight;
+        float maxHeight;
+    };
+
+    struct Ray
+    {
+        float origin[3];
+        float direction[3];
+        float inverseDirection[3];
+    };
+
+    void buildHierarchy();
+    const Range &range(size_t level, size_t row, size_t column) const;
+    bool intersectBox(const Ray &ray, size_t level, size_t row, size_t column, float *enter, float *exit) const;
+    void intersectNode(const Ray &ray, size_t level, size_t row, size_t column, float *nearest) const;
+    void intersectCell(const Ray &ray, size_t row, size_t column, float *nearest) const;
+
+    const float *_heights;
+    size_t _stride;
+    float _spacing;
+    float _inverseSpacing;
+    float _verticalScale;
+    float _origin; // world x and z of the first sample
+
+    // Level k (k >= 1) holds the height range of each block of 2^k x 2^k cells, in row-major order
+    std::vector<std::vector<Range>> _levels;
+};
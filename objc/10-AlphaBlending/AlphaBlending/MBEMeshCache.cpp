@@ -0,0 +1,253 @@
+#include "MBEMeshCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace
+{
+    const char Magic[8] = { 'M', 'B', 'E', 'M', 'E', 'S', 'H', '\0' };
+
+    // Bump whenever the layout of the header or the group table changes
+    const uint32_t FormatVersion = 1;
+
+    struct MBEMeshCacheHeader
+    {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t builderVersion;
+        uint64_t sourceHash;
+        uint64_t sourceLength;
+        uint32_t vertexStride;
+        uint32_t flags;
+        uint32_t groupCount;
+        uint32_t reserved;
+        uint64_t fileLength;
+    };
+
+    struct MBEMeshCacheGroupEntry
+    {
+        uint64_t nameOffset;
+        uint32_t nameLength;
+        uint32_t indexSize;
+        uint64_t vertexOffset;
+        uint64_t vertexCount;
+        uint64_t indexOffset;
+        uint64_t indexCount;
+    };
+
+    static_assert(sizeof(MBEMeshCacheHeader) == 56, "Mesh cache header must not contain padding");
+    static_assert(sizeof(MBEMeshCacheGroupEntry) == 48, "Mesh cache group entry must not contain padding");
+
+    size_t AlignUp(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // True if [offset, offset + length) lies within a file of `fileLength` bytes, without overflowing
+    bool RangeIsValid(uint64_t offset, uint64_t length, uint64_t fileLength)
+    {
+        return offset <= fileLength && length <= fileLength - offset;
+    }
+
+    bool WriteBytes(FILE *file, const void *bytes, size_t length)
+    {
+        return length == 0 || fwrite(bytes, 1, length, file) == length;
+    }
+
+    bool WritePadding(FILE *file, size_t from, size_t to)
+    {
+        static const uint8_t zeros[256] = { 0 };
+        while (from < to)
+        {
+            size_t chunk = std::min(to - from, sizeof(zeros));
+            if (!WriteBytes(file, zeros, chunk))
+            {
+                return false;
+            }
+            from += chunk;
+        }
+        return true;
+    }
+}
+
+MBEMeshCache::MBEMeshCache(const char *path) :
+    _file(path)
+{
+}
+
+std::shared_ptr<MBEMeshCache> MBEMeshCache::open(const char *path, const MBEMeshCacheKey &key)
+{
+    std::shared_ptr<MBEMeshCache> cache(new MBEMeshCache(path));
+    if (!cache->validate(key))
+    {
+        return nullptr;
+    }
+    return cache;
+}
+
+bool MBEMeshCache::validate(const MBEMeshCacheKey &key)
+{
+    if (!_file.isValid() || _file.length() < sizeof(MBEMeshCacheHeader))
+    {
+        return false;
+    }
+
+    const uint8_t *base = _file.bytes();
+    const uint64_t fileLength = _file.length();
+
+    MBEMeshCacheHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.formatVersion != FormatVersion ||
+        header.fileLength != fileLength)
+    {
+        return false;
+    }
+
+    if (header.builderVersion != key.builderVersion ||
+        header.sourceHash != key.sourceHash ||
+        header.sourceLength != key.sourceLength ||
+        header.vertexStride != key.vertexStride ||
+        header.flags != key.flags)
+    {
+        return false;
+    }
+
+    const uint64_t tableOffset = sizeof(MBEMeshCacheHeader);
+    if (!RangeIsValid(tableOffset, (uint64_t)header.groupCount * sizeof(MBEMeshCacheGroupEntry), fileLength))
+    {
+        return false;
+    }
+
+    _groups.resize(header.groupCount);
+    for (uint32_t i = 0; i < header.groupCount; ++i)
+    {
+        MBEMeshCacheGroupEntry entry;
+        memcpy(&entry, base + tableOffset + i * sizeof(MBEMeshCacheGroupEntry), sizeof(entry));
+
+        // Counts are bounded by the file length before multiplying, so the byte sizes can't overflow
+        if ((entry.indexSize != 2 && entry.indexSize != 4) ||
+            entry.vertexCount > fileLength || entry.indexCount > fileLength ||
+            !RangeIsValid(entry.nameOffset, entry.nameLength, fileLength) ||
+            !RangeIsValid(entry.vertexOffset, entry.vertexCount * header.vertexStride, fileLength) ||
+            !RangeIsValid(entry.indexOffset, entry.indexCount * entry.indexSize, fileLength) ||
+            entry.vertexOffset % MBEMeshCacheBlockAlignment != 0 ||
+            entry.indexOffset % MBEMeshCacheBlockAlignment != 0)
+        {
+            _groups.clear();
+            return false;
+        }
+
+        MBEMeshCacheGroup &group = _groups[i];
+        group.name.assign(reinterpret_cast<const char *>(base + entry.nameOffset), entry.nameLength);
+        group.vertices = base + entry.vertexOffset;
+        group.vertexCount = (size_t)entry.vertexCount;
+        group.indices = base + entry.indexOffset;
+        group.indexCount = (size_t)entry.indexCount;
+        group.indexSize = entry.indexSize;
+    }
+
+    return true;
+}
+
+bool MBEMeshCache::write(const char *path, const MBEMeshCacheKey &key, const std::vector<MBEMeshCacheGroup> &groups)
+{
+    // Lay out the file up front: header, group table, names, then the page-aligned blocks
+    std::vector<MBEMeshCacheGroupEntry> entries(groups.size());
+
+    size_t offset = sizeof(MBEMeshCacheHeader) + groups.size() * sizeof(MBEMeshCacheGroupEntry);
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        entries[i].nameOffset = offset;
+        entries[i].nameLength = (uint32_t)groups[i].name.size();
+        offset += groups[i].name.size();
+    }
+
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        const MBEMeshCacheGroup &group = groups[i];
+        MBEMeshCacheGroupEntry &entry = entries[i];
+
+        entry.indexSize = group.indexSize;
+
+        offset = AlignUp(offset, MBEMeshCacheBlockAlignment);
+        entry.vertexOffset = offset;
+        entry.vertexCount = group.vertexCount;
+        offset += group.vertexCount * key.vertexStride;
+
+        offset = AlignUp(offset, MBEMeshCacheBlockAlignment);
+        entry.indexOffset = offset;
+        entry.indexCount = group.indexCount;
+        offset += group.indexCount * group.indexSize;
+    }
+
+    const size_t fileLength = AlignUp(offset, MBEMeshCacheBlockAlignment);
+
+    MBEMeshCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.formatVersion = FormatVersion;
+    header.builderVersion = key.builderVersion;
+    header.sourceHash = key.sourceHash;
+    header.sourceLength = key.sourceLength;
+    header.vertexStride = key.vertexStride;
+    header.flags = key.flags;
+    header.groupCount = (uint32_t)groups.size();
+    header.fileLength = fileLength;
+
+    // Every writer gets a temporary file of its own, even for the same key in the same process, so the
+    // file that's renamed into place can only ever hold one writer's data
+    std::string temporaryPath = std::string(path) + ".tmp.XXXXXX";
+    int descriptor = mkstemp(&temporaryPath[0]);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    FILE *file = fdopen(descriptor, "wb");
+    if (!file)
+    {
+        close(descriptor);
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+
+    bool ok = WriteBytes(file, &header, sizeof(header)) &&
+              WriteBytes(file, entries.data(), entries.size() * sizeof(MBEMeshCacheGroupEntry));
+
+    size_t written = sizeof(header) + entries.size() * sizeof(MBEMeshCacheGroupEntry);
+    for (size_t i = 0; ok && i < groups.size(); ++i)
+    {
+        ok = WriteBytes(file, groups[i].name.data(), groups[i].name.size());
+        written += groups[i].name.size();
+    }
+
+    for (size_t i = 0; ok && i < groups.size(); ++i)
+    {
+        const MBEMeshCacheGroup &group = groups[i];
+        const MBEMeshCacheGroupEntry &entry = entries[i];
+
+        ok = WritePadding(file, written, entry.vertexOffset) &&
+             WriteBytes(file, group.vertices, group.vertexCount * key.vertexStride);
+        written = entry.vertexOffset + group.vertexCount * key.vertexStride;
+
+        ok = ok && WritePadding(file, written, entry.indexOffset) &&
+             WriteBytes(file, group.indices, group.indexCount * group.indexSize);
+        written = entry.indexOffset + group.indexCount * group.indexSize;
+    }
+
+    ok = ok && WritePadding(file, written, fileLength);
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(temporaryPath.c_str(), path) != 0)
+    {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
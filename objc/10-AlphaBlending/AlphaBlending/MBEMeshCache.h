@@ -0,0 +1,68 @@
+#pragma once
+
+#include "MBEMappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Larger than or equal to the virtual memory page size of every device we run on
+static const size_t MBEMeshCacheBlockAlignment = 16384;
+
+/// Identifies the source and the processing that produced a mesh cache. A cache is only used when
+/// every field matches what the loader would produce from the current source file.
+struct MBEMeshCacheKey
+{
+    /// `MBEContentHash64` of the source file
+    uint64_t sourceHash;
+    uint64_t sourceLength;
+    /// Size of one packed vertex, which catches caches baked against a different vertex layout
+    uint32_t vertexStride;
+    /// Bumped by the loader whenever the way it builds vertices or indices changes
+    uint32_t builderVersion;
+    /// Loader options that affect the baked data, such as normal generation
+    uint32_t flags;
+};
+
+/// One group of a mesh cache. When the group comes from `MBEMeshCache::open`, the pointers refer
+/// directly into the mapped file.
+struct MBEMeshCacheGroup
+{
+    std::string name;
+    const void *vertices;
+    size_t vertexCount;
+    const void *indices;
+    size_t indexCount;
+    /// 2 or 4 bytes
+    uint32_t indexSize;
+};
+
+/// A versioned binary container for packed vertex and index buffers, written once by a bake step
+/// and mapped read-only at load time. Every vertex and index block starts on a
+/// `MBEMeshCacheBlockAlignment` boundary and is padded to a multiple of it, so a block can be
+/// handed to an API that requires whole, page-aligned pages without copying it.
+class MBEMeshCache
+{
+public:
+    /// Maps the cache at `path` and validates its header and block table. Returns null if the
+    /// file is missing, malformed, from another format version, or doesn't match `key`.
+    static std::shared_ptr<MBEMeshCache> open(const char *path, const MBEMeshCacheKey &key);
+
+    /// Writes `groups` to a temporary file next to `path` and renames it into place, so that
+    /// readers never observe a partially written cache. Returns false on I/O failure.
+    static bool write(const char *path, const MBEMeshCacheKey &key, const std::vector<MBEMeshCacheGroup> &groups);
+
+    const std::vector<MBEMeshCacheGroup> &groups() const { return _groups; }
+
+private:
+    explicit MBEMeshCache(const char *path);
+    MBEMeshCache(const MBEMeshCache &) = delete;
+    MBEMeshCache &operator=(const MBEMeshCache &) = delete;
+
+    bool validate(const MBEMeshCacheKey &key);
+
+    MBEMappedFile _file;
+    std::vector<MBEMeshCacheGroup> _groups;
+};
@@ -0,0 +1,398 @@
+#include "MBEMipmapGenerator.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Four channels in one register, which the compiler maps to NEON or SSE, so that every channel of a
+    // pixel is filtered by the same instruction
+    typedef float Float4 __attribute__((vector_size(16)));
+
+    Float4 Splat(float value)
+    {
+        Float4 result = { value, value, value, value };
+        return result;
+    }
+
+    // Enough rows per task to amortize dispatch, while leaving large levels plenty of tasks to balance
+    const size_t PixelsPerTask = 16 * 1024;
+
+    const double KaiserRadius = 3;
+    const double KaiserAlpha = 4;
+
+    /// One source pixel that contributes to a destination pixel
+    struct Tap
+    {
+        uint32_t index;
+        float weight;
+    };
+
+    /// The taps of every destination pixel along one axis. The taps of pixel i are
+    /// taps[firstTaps[i]] up to taps[firstTaps[i + 1]].
+    struct AxisKernel
+    {
+        std::vector<uint32_t> firstTaps;
+        std::vector<Tap> taps;
+    };
+
+    double Sinc(double x)
+    {
+        if (std::fabs(x) < 1e-6)
+        {
+            return 1;
+        }
+        return std::sin(M_PI * x) / (M_PI * x);
+    }
+
+    // The zeroth-order modified Bessel function of the first kind, by its power series
+    double BesselI0(double x)
+    {
+        double sum = 1, term = 1;
+        for (int k = 1; k < 32 && term > sum * 1e-12; ++k)
+        {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+        }
+        return sum;
+    }
+
+    double Kaiser(double x)
+    {
+        if (std::fabs(x) >= 1)
+        {
+            return 0;
+        }
+        return BesselI0(KaiserAlpha * std::sqrt(1 - x * x)) / BesselI0(KaiserAlpha);
+    }
+
+    // Distances and radii are in destination pixels, so the kernels widen with the reduction
+    double KernelRadius(MBEMipmapFilter filter)
+    {
+        switch (filter)
+        {
+            case MBEMipmapFilterBox:
+                return 0.5;
+            case MBEMipmapFilterTriangle:
+                return 1;
+            case MBEMipmapFilterKaiser:
+            default:
+                return KaiserRadius;
+        }
+    }
+
+    // The weight of the source pixel spanning [start, end), relative to the center of a destination pixel
+    double KernelWeight(MBEMipmapFilter filter, double start, double end)
+    {
+        switch (filter)
+        {
+            case MBEMipmapFilterBox:
+                // Box weights are the exact coverage of the pixel, so that odd sizes blend their last row
+                // and column in instead of dropping them
+                return std::max(0.0, std::min(end, 0.5) - std::max(start, -0.5));
+            case MBEMipmapFilterTriangle:
+                return std::max(0.0, 1 - std::fabs((start + end) / 2));
+            case MBEMipmapFilterKaiser:
+            default:
+            {
+                const double x = (start + end) / 2;
+                return Sinc(x) * Kaiser(x / KaiserRadius);
+            }
+        }
+    }
+
+    uint32_t ResolveIndex(int64_t index, uint32_t size, MBEMipmapEdgeMode edgeMode)
+    {
+        if (edgeMode == MBEMipmapEdgeModeWrap)
+        {
+            return (uint32_t)(((index % size) + size) % size);
+        }
+        return (uint32_t)std::min<int64_t>(std::max<int64_t>(index, 0), size - 1);
+    }
+
+    AxisKernel KernelForAxis(uint32_t sourceSize, uint32_t destinationSize, MBEMipmapFilter filter,
+                             MBEMipmapEdgeMode edgeMode)
+    {
+        AxisKernel kernel;
+        kernel.firstTaps.reserve(destinationSize + 1);
+
+        const double scale = (double)sourceSize / destinationSize;
+        const double radius = KernelRadius(filter) * scale;
+
+        for (uint32_t i = 0; i < destinationSize; ++i)
+        {
+            kernel.firstTaps.push_back((uint32_t)kernel.taps.size());
+
+            const double center = (i + 0.5) * scale;
+            const int64_t first = (int64_t)std::floor(center - radius);
+            const int64_t last = (int64_t)std::ceil(center + radius);
+
+            double sum = 0;
+            for (int64_t s = first; s < last; ++s)
+            {
+                const double weight = KernelWeight(filter, (s - center) / scale, (s + 1 - center) / scale);
+                if (weight == 0)
+                {
+                    continue;
+                }
+
+                // Clamping can map several taps to the same edge pixel, which is folded into one tap
+                const uint32_t index = ResolveIndex(s, sourceSize, edgeMode);
+                const size_t firstTap = kernel.firstTaps.back();
+                std::vector<Tap>::iterator tap = std::find_if(kernel.taps.begin() + firstTap, kernel.taps.end(),
+                                                              [index](const Tap &t) { return t.index == index; });
+                if (tap != kernel.taps.end())
+                {
+                    tap->weight += (float)weight;
+                }
+                else
+                {
+                    kernel.taps.push_back({ index, (float)weight });
+                }
+                sum += weight;
+            }
+
+            for (size_t t = kernel.firstTaps.back(); t < kernel.taps.size(); ++t)
+            {
+                kernel.taps[t].weight = (float)(kernel.taps[t].weight / sum);
+            }
+        }
+
+        kernel.firstTaps.push_back((uint32_t)kernel.taps.size());
+        return kernel;
+    }
+
+    float SRGBToLinear(float value)
+    {
+        return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    /// Lookup tables for converting 8-bit channels to and from linear floats
+    struct ChannelTables
+    {
+        float unormToFloat[256];
+        float sRGBToLinear[256];
+        // The linear value at which rounding an encoded value moves from k to k + 1, for converting
+        // linear values back to the nearest 8-bit sRGB value with a binary search
+        float sRGBThresholds[255];
+
+        ChannelTables()
+        {
+            for (int i = 0; i < 256; ++i)
+            {
+                unormToFloat[i] = i / 255.0f;
+                sRGBToLinear[i] = SRGBToLinear(i / 255.0f);
+            }
+            for (int i = 0; i < 255; ++i)
+            {
+                sRGBThresholds[i] = SRGBToLinear((i + 0.5f) / 255.0f);
+            }
+        }
+    };
+
+    const ChannelTables &Tables()
+    {
+        static const ChannelTables tables;
+        return tables;
+    }
+
+    uint8_t LinearToUnorm8(float value)
+    {
+        return (uint8_t)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    uint8_t LinearToSRGB8(float value, const ChannelTables &tables)
+    {
+        return (uint8_t)(std::upper_bound(tables.sRGBThresholds, tables.sRGBThresholds + 255, value) -
+                         tables.sRGBThresholds);
+    }
+
+    void LoadRow(const uint8_t *row, uint32_t width, MBEMipmapPixelFormat format, Float4 *pixels)
+    {
+        const ChannelTables &tables = Tables();
+        switch (format)
+        {
+            case MBEMipmapPixelFormatRGBA8Unorm:
+                for (uint32_t x = 0; x < width; ++x, row += 4)
+                {
+                    Float4 pixel = { tables.unormToFloat[row[0]], tables.unormToFloat[row[1]],
+                                     tables.unormToFloat[row[2]], tables.unormToFloat[row[3]] };
+                    pixels[x] = pixel;
+                }
+                break;
+            case MBEMipmapPixelFormatRGBA8Unorm_sRGB:
+                for (uint32_t x = 0; x < width; ++x, row += 4)
+                {
+                    Float4 pixel = { tables.sRGBToLinear[row[0]], tables.sRGBToLinear[row[1]],
+                                     tables.sRGBToLinear[row[2]], tables.unormToFloat[row[3]] };
+                    pixels[x] = pixel;
+                }
+                break;
+            case MBEMipmapPixelFormatRGBA32Float:
+                memcpy(pixels, row, width * sizeof(Float4));
+                break;
+        }
+    }
+
+    void StoreRow(const Float4 *pixels, uint32_t width, MBEMipmapPixelFormat format, uint8_t *row)
+    {
+        const ChannelTables &tables = Tables();
+        switch (format)
+        {
+            case MBEMipmapPixelFormatRGBA8Unorm:
+                for (uint32_t x = 0; x < width; ++x, row += 4)
+                {
+                    for (int c = 0; c < 4; ++c)
+                    {
+                        row[c] = LinearToUnorm8(pixels[x][c]);
+                    }
+                }
+                break;
+            case MBEMipmapPixelFormatRGBA8Unorm_sRGB:
+                for (uint32_t x = 0; x < width; ++x, row += 4)
+                {
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        row[c] = LinearToSRGB8(pixels[x][c], tables);
+                    }
+                    row[3] = LinearToUnorm8(pixels[x][3]);
+                }
+                break;
+            case MBEMipmapPixelFormatRGBA32Float:
+                memcpy(row, pixels, width * sizeof(Float4));
+                break;
+        }
+    }
+
+    // Runs `body(begin, end)` over blocks of rows, spread across the shared thread pool
+    template <typename Body>
+    void ParallelForRows(uint32_t rowCount, uint32_t width, const Body &body)
+    {
+        const uint32_t rowsPerTask = (uint32_t)std::max<size_t>(1, PixelsPerTask / std::max(width, 1u));
+        const size_t taskCount = (rowCount + rowsPerTask - 1) / rowsPerTask;
+        MBEThreadPool::sharedPool().parallelFor(taskCount, [&](size_t task) {
+            const uint32_t begin = (uint32_t)task * rowsPerTask;
+            body(begin, std::min(begin + rowsPerTask, rowCount));
+        });
+    }
+}
+
+uint32_t MBEMipmapLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levelCount = 1;
+    uint32_t size = std::max(width, height);
+    while (size > 1)
+    {
+        size >>= 1;
+        ++levelCount;
+    }
+    return levelCount;
+}
+
+size_t MBEMipmapBytesPerPixel(MBEMipmapPixelFormat format)
+{
+    return (format == MBEMipmapPixelFormatRGBA32Float) ? 4 * sizeof(float) : 4;
+}
+
+size_t MBEMipmapChainLayout(uint32_t width, uint32_t height, uint32_t levelCount, MBEMipmapPixelFormat format,
+                            size_t alignment, MBEMipmapLevel *levels)
+{
+    alignment = std::max<size_t>(alignment, 1);
+
+    size_t offset = 0;
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        MBEMipmapLevel &level = levels[i];
+        offset = (offset + alignment - 1) & ~(alignment - 1);
+        level.offset = offset;
+        level.width = std::max(width >> i, 1u);
+        level.height = std::max(height >> i, 1u);
+        level.bytesPerRow = level.width * MBEMipmapBytesPerPixel(format);
+        offset += level.bytesPerRow * level.height;
+    }
+    return offset;
+}
+
+void MBEGenerateMipmapChain(void *chain, const MBEMipmapLevel *levels, uint32_t levelCount,
+                            MBEMipmapPixelFormat format, MBEMipmapFilter filter, MBEMipmapEdgeMode edgeMode)
+{
+    uint8_t *bytes = (uint8_t *)chain;
+
+    // 8-bit levels are filtered from a float copy of the previous level, which is kept from one level to
+    // the next; level 0 and float levels are read straight from the chain
+    const bool keepsFloatLevels = (format != MBEMipmapPixelFormatRGBA32Float);
+    std::vector<Float4> previousLevel, nextLevel;
+
+    // The horizontal pass writes here, and the vertical pass reads from here
+    std::vector<Float4> filteredRows;
+
+    for (uint32_t i = 1; i < levelCount; ++i)
+    {
+        const MBEMipmapLevel &source = levels[i - 1];
+        const MBEMipmapLevel &destination = levels[i];
+        const bool sourceIsFloatLevel = keepsFloatLevels && i > 1;
+
+        const AxisKernel columns = KernelForAxis(source.width, destination.width, filter, edgeMode);
+        const AxisKernel rows = KernelForAxis(source.height, destination.height, filter, edgeMode);
+
+        filteredRows.resize((size_t)destination.width * source.height);
+        ParallelForRows(source.height, source.width, [&](uint32_t begin, uint32_t end) {
+            std::vector<Float4> loadedRow(sourceIsFloatLevel ? 0 : source.width);
+            for (uint32_t y = begin; y < end; ++y)
+            {
+                const Float4 *sourceRow;
+                if (sourceIsFloatLevel)
+                {
+                    sourceRow = &previousLevel[(size_t)y * source.width];
+                }
+                else
+                {
+                    LoadRow(bytes + source.offset + y * source.bytesPerRow, source.width, format, loadedRow.data());
+                    sourceRow = loadedRow.data();
+                }
+
+                Float4 *filteredRow = &filteredRows[(size_t)y * destination.width];
+                for (uint32_t x = 0; x < destination.width; ++x)
+                {
+                    Float4 sum = Splat(0);
+                    for (uint32_t t = columns.firstTaps[x]; t < columns.firstTaps[x + 1]; ++t)
+                    {
+                        sum += sourceRow[columns.taps[t].index] * Splat(columns.taps[t].weight);
+                    }
+                    filteredRow[x] = sum;
+                }
+            }
+        });
+
+        const bool keepsNextLevel = keepsFloatLevels && i + 1 < levelCount;
+        nextLevel.resize(keepsNextLevel ? (size_t)destination.width * destination.height : 0);
+        ParallelForRows(destination.height, destination.width, [&](uint32_t begin, uint32_t end) {
+            std::vector<Float4> row(destination.width);
+            for (uint32_t y = begin; y < end; ++y)
+            {
+                // Accumulating whole rows keeps the reads of the filtered rows sequential
+                std::fill(row.begin(), row.end(), Splat(0));
+                for (uint32_t t = rows.firstTaps[y]; t < rows.firstTaps[y + 1]; ++t)
+                {
+                    const Float4 *filteredRow = &filteredRows[(size_t)rows.taps[t].index * destination.width];
+                    const Float4 weight = Splat(rows.taps[t].weight);
+                    for (uint32_t x = 0; x < destination.width; ++x)
+                    {
+                        row[x] += filteredRow[x] * weight;
+                    }
+                }
+
+                if (keepsNextLevel)
+                {
+                    std::copy(row.begin(), row.end(), nextLevel.begin() + (size_t)y * destination.width);
+                }
+                StoreRow(row.data(), destination.width, format, bytes + destination.offset + y * destination.bytesPerRow);
+            }
+        });
+
+        previousLevel.swap(nextLevel);
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that texture generators written in plain Objective-C can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// The pixel layouts a mipmap chain can hold. Every format has four channels.
+typedef enum
+{
+    /// 8-bit channels, filtered as stored
+    MBEMipmapPixelFormatRGBA8Unorm,
+    /// 8-bit channels whose color is sRGB-encoded; color is filtered in linear space and alpha as stored
+    MBEMipmapPixelFormatRGBA8Unorm_sRGB,
+    /// 32-bit float channels, filtered as stored and never clamped
+    MBEMipmapPixelFormatRGBA32Float,
+} MBEMipmapPixelFormat;
+
+/// The kernels used to reduce each level to the next. All are separable and normalized.
+typedef enum
+{
+    /// The average of the source pixels each destination pixel covers. Cheapest, but lets the most
+    /// aliasing through.
+    MBEMipmapFilterBox,
+    /// A tent two destination pixels wide, which is [1 3 3 1] / 8 when halving an even size
+    MBEMipmapFilterTriangle,
+    /// A sinc windowed by a Kaiser window six destination pixels wide. Sharpest, with little aliasing,
+    /// at the cost of mild ringing around hard edges.
+    MBEMipmapFilterKaiser,
+} MBEMipmapFilter;
+
+/// How kernels that reach past the edge of a level find their pixels
+typedef enum
+{
+    /// Repeat the edge pixels, for textures that are sampled with clamp-to-edge addressing
+    MBEMipmapEdgeModeClamp,
+    /// Wrap around to the other side, for textures that tile
+    MBEMipmapEdgeModeWrap,
+} MBEMipmapEdgeMode;
+
+/// Where one level of a mipmap chain lives in the chain's allocation
+typedef struct
+{
+    size_t offset;
+    uint32_t width;
+    uint32_t height;
+    size_t bytesPerRow;
+} MBEMipmapLevel;
+
+/// The number of levels in a full mipmap chain for an image of `width` x `height` pixels, from the
+/// image itself down to 1 x 1. Level i is max(1, width >> i) by max(1, height >> i) pixels.
+uint32_t MBEMipmapLevelCount(uint32_t width, uint32_t height);
+
+/// The number of bytes in one pixel of `format`
+size_t MBEMipmapBytesPerPixel(MBEMipmapPixelFormat format);
+
+/// Lays out the first `levelCount` levels of a mipmap chain for a `width` x `height` image one after
+/// another in a single allocation, with tightly packed rows and each level starting on a multiple of
+/// `alignment` bytes (which must be a power of two). Fills in `levels` and returns the length of the
+/// allocation.
+size_t MBEMipmapChainLayout(uint32_t width, uint32_t height, uint32_t levelCount, MBEMipmapPixelFormat format,
+                            size_t alignment, MBEMipmapLevel *levels);
+
+/// Fills levels 1 through `levelCount` - 1 of a chain laid out by `levels`, which must already hold the
+/// image in level 0. Each level is filtered from a full-precision copy of the one before it, rather
+/// than from its rounded pixels, so 8-bit chains don't accumulate rounding error. Rows are split across
+/// the threads of the shared thread pool.
+void MBEGenerateMipmapChain(void *chain, const MBEMipmapLevel *levels, uint32_t levelCount,
+                            MBEMipmapPixelFormat format, MBEMipmapFilter filter, MBEMipmapEdgeMode edgeMode);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,6 +1,7 @@
 @import Foundation;
 @import Metal;
 #import "MBEMesh.h"
+#import "MBECulling.h"
 
 @class MBEOBJGroup;
 
@@ -8,4 +9,7 @@
 
 - (instancetype)initWithGroup:(MBEOBJGroup *)group device:(id<MTLDevice>)device;
 
+/// A sphere that encloses every vertex of the mesh, in model space
+@property (nonatomic, readonly) MBEBoundingSphere boundingSphere;
+
 @end
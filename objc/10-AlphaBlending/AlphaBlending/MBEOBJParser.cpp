@@ -0,0 +1,609 @@
+#include "MBEOBJParser.h"
+#include "MBEMappedFile.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+
+// Every power of ten up to 10^22 is exactly representable as a double, which lets us convert
+// decimal literals with at most 15 significant digits exactly, with a single multiply or divide.
+const double MBEExactPowersOfTen[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+const uint64_t MBEMaxExactMantissa = 1ull << 53;
+
+inline bool MBEIsBlank(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+inline bool MBEIsDigit(char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+// A forward-only cursor over a range of the file that never copies or allocates
+struct MBEOBJLexer
+{
+    const char *p;
+    const char *end;
+
+    void skipBlanks()
+    {
+        while (p < end && MBEIsBlank(*p))
+            ++p;
+    }
+
+    void skipLine()
+    {
+        const char *newline = static_cast<const char *>(memchr(p, '\n', end - p));
+        p = newline ? newline + 1 : end;
+    }
+
+    bool consume(char c)
+    {
+        if (p < end && *p == c)
+        {
+            ++p;
+            return true;
+        }
+        return false;
+    }
+
+    bool scanInt(int64_t &value)
+    {
+        const char *q = p;
+        bool negative = false;
+        if (q < end && (*q == '-' || *q == '+'))
+        {
+            negative = (*q == '-');
+            ++q;
+        }
+
+        if (q >= end || !MBEIsDigit(*q))
+            return false;
+
+        int64_t magnitude = 0;
+        while (q < end && MBEIsDigit(*q))
+        {
+            if (magnitude < (INT64_MAX / 10))
+                magnitude = magnitude * 10 + (*q - '0');
+            ++q;
+        }
+
+        value = negative ? -magnitude : magnitude;
+        p = q;
+        return true;
+    }
+
+    bool scanFloat(float &value)
+    {
+        skipBlanks();
+
+        const char *start = p;
+        const char *q = p;
+
+        bool negative = false;
+        if (q < end && (*q == '-' || *q == '+'))
+        {
+            negative = (*q == '-');
+            ++q;
+        }
+
+        // Accumulate up to 19 significant digits, which always fit in 64 bits
+        uint64_t mantissa = 0;
+        int significantDigits = 0;
+        int exponent = 0;
+        bool sawDigit = false;
+        bool truncated = false;
+
+        while (q < end && MBEIsDigit(*q))
+        {
+            sawDigit = true;
+            if (significantDigits < 19)
+            {
+                mantissa = mantissa * 10 + (*q - '0');
+                if (mantissa != 0)
+                    ++significantDigits;
+            }
+            else
+            {
+                ++exponent;
+                truncated = true;
+            }
+            ++q;
+        }
+
+        if (q < end && *q == '.')
+        {
+            ++q;
+            while (q < end && MBEIsDigit(*q))
+            {
+                sawDigit = true;
+                if (significantDigits < 19)
+                {
+                    mantissa = mantissa * 10 + (*q - '0');
+                    if (mantissa != 0)
+                        ++significantDigits;
+                    --exponent;
+                }
+                else
+                {
+                    truncated = true;
+                }
+                ++q;
+            }
+        }
+
+        if (!sawDigit)
+            return false;
+
+        if (q < end && (*q == 'e' || *q == 'E'))
+        {
+            const char *r = q + 1;
+            bool negativeExponent = false;
+            if (r < end && (*r == '-' || *r == '+'))
+            {
+                negativeExponent = (*r == '-');
+                ++r;
+            }
+
+            if (r < end && MBEIsDigit(*r))
+            {
+                int explicitExponent = 0;
+                while (r < end && MBEIsDigit(*r))
+                {
+                    if (explicitExponent < 10000)
+                        explicitExponent = explicitExponent * 10 + (*r - '0');
+                    ++r;
+                }
+                exponent += negativeExponent ? -explicitExponent : explicitExponent;
+                q = r;
+            }
+        }
+
+        double result;
+        if (!truncated && mantissa <= MBEMaxExactMantissa && exponent >= -22 && exponent <= 22)
+        {
+            // Fast path: both operands are exact, so IEEE arithmetic gives the correctly rounded result
+            result = (double)mantissa;
+            result = (exponent < 0) ? (result / MBEExactPowersOfTen[-exponent])
+                                    : (result * MBEExactPowersOfTen[exponent]);
+            if (negative)
+                result = -result;
+        }
+        else
+        {
+            // Slow path for long or extreme literals. The token isn't NUL-terminated in the mapping,
+            // so hand a bounded copy to strtod.
+            char buffer[128];
+            size_t length = q - start;
+            if (length < sizeof(buffer))
+            {
+                memcpy(buffer, start, length);
+                buffer[length] = '\0';
+                result = strtod(buffer, NULL);
+            }
+            else
+            {
+                std::string token(start, length);
+                result = strtod(token.c_str(), NULL);
+            }
+        }
+
+        value = (float)result;
+        p = q;
+        return true;
+    }
+};
+
+// Relative (negative) references depend on how many elements precede the face in the whole file,
+// which a chunk parsed in isolation doesn't know. They are rare, so rather than widening every
+// corner, we record them on the side and patch them up once the chunk's base offsets are known.
+enum MBEOBJAttribute
+{
+    MBEOBJAttributePosition,
+    MBEOBJAttributeTexCoord,
+    MBEOBJAttributeNormal,
+};
+
+struct MBEOBJRelativeReference
+{
+    uint32_t corner;
+    MBEOBJAttribute attribute;
+    int64_t localIndex; // relative to the first element declared in the chunk; may be negative
+};
+
+// The output of parsing one line-aligned range of the file. `data.groups[0]` is a continuation
+// of whatever group was open when the chunk began.
+struct MBEOBJChunk
+{
+    MBEOBJData data;
+    std::vector<MBEOBJRelativeReference> relativeReferences;
+};
+
+// Chunks smaller than this aren't worth handing to another thread
+const size_t MBEOBJMinimumChunkLength = 256 * 1024;
+
+inline uint32_t MBEOBJResolveIndex(MBEOBJChunk &chunk, int64_t index, MBEOBJAttribute attribute, size_t localCount)
+{
+    // OBJ indices are 1-based, and negative indices count backwards from the most recently declared element
+    if (index > 0)
+        return (uint32_t)(index - 1);
+
+    if (index < 0)
+    {
+        MBEOBJRelativeReference reference;
+        reference.corner = (uint32_t)chunk.data.corners.size();
+        reference.attribute = attribute;
+        reference.localIndex = (int64_t)localCount + index;
+        chunk.relativeReferences.push_back(reference);
+    }
+
+    return MBEOBJInvalidIndex;
+}
+
+void MBEOBJParseFace(MBEOBJLexer &lexer, MBEOBJChunk &chunk)
+{
+    MBEOBJData &data = chunk.data;
+    const size_t firstCorner = data.corners.size();
+    const size_t firstRelativeReference = chunk.relativeReferences.size();
+
+    while (1)
+    {
+        lexer.skipBlanks();
+
+        int64_t vi = 0, ti = 0, ni = 0;
+        if (!lexer.scanInt(vi))
+            break;
+
+        if (lexer.consume('/'))
+        {
+            lexer.scanInt(ti);
+
+            if (lexer.consume('/'))
+                lexer.scanInt(ni);
+        }
+
+        MBEOBJFaceCorner corner;
+        corner.vi = MBEOBJResolveIndex(chunk, vi, MBEOBJAttributePosition, data.positions.size());
+        corner.ti = MBEOBJResolveIndex(chunk, ti, MBEOBJAttributeTexCoord, data.texCoords.size());
+        corner.ni = MBEOBJResolveIndex(chunk, ni, MBEOBJAttributeNormal, data.normals.size());
+        data.corners.push_back(corner);
+    }
+
+    if (data.corners.size() - firstCorner < 3)
+    {
+        // Points and lines don't contribute any triangles
+        data.corners.resize(firstCorner);
+        chunk.relativeReferences.resize(firstRelativeReference);
+        return;
+    }
+
+    data.faceStarts.push_back((uint32_t)data.corners.size());
+}
+
+void MBEOBJBeginGroup(MBEOBJLexer &lexer, MBEOBJData &data)
+{
+    lexer.skipBlanks();
+
+    const char *nameStart = lexer.p;
+    const char *nameEnd = nameStart;
+    while (nameEnd < lexer.end && *nameEnd != '\n' && *nameEnd != '\r')
+        ++nameEnd;
+
+    if (nameEnd == nameStart)
+        return;
+
+    MBEOBJGroupRange group;
+    group.name.assign(nameStart, nameEnd - nameStart);
+    group.firstFace = data.faceCount();
+    group.faceCount = 0;
+    data.groups.push_back(group);
+
+    lexer.p = nameEnd;
+}
+
+void MBEOBJParseChunk(const char *begin, const char *end, MBEOBJChunk &chunk)
+{
+    MBEOBJData &data = chunk.data;
+    data.faceStarts.push_back(0);
+
+    MBEOBJGroupRange continuedGroup;
+    continuedGroup.firstFace = 0;
+    continuedGroup.faceCount = 0;
+    data.groups.push_back(continuedGroup);
+
+    MBEOBJLexer lexer = { begin, end };
+
+    while (lexer.p < lexer.end)
+    {
+        lexer.skipBlanks();
+
+        const char *keyword = lexer.p;
+        while (lexer.p < lexer.end && !MBEIsBlank(*lexer.p) && *lexer.p != '\n')
+            ++lexer.p;
+        const size_t keywordLength = lexer.p - keyword;
+
+        if (keywordLength == 1 && keyword[0] == 'v')
+        {
+            MBEOBJFloat3 position = { 0, 0, 0 };
+            lexer.scanFloat(position.x);
+            lexer.scanFloat(position.y);
+            lexer.scanFloat(position.z);
+            data.positions.push_back(position);
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 't')
+        {
+            MBEOBJFloat2 texCoord = { 0, 0 };
+            lexer.scanFloat(texCoord.x);
+            lexer.scanFloat(texCoord.y);
+            data.texCoords.push_back(texCoord);
+        }
+        else if (keywordLength == 2 && keyword[0] == 'v' && keyword[1] == 'n')
+        {
+            MBEOBJFloat3 normal = { 0, 0, 0 };
+            lexer.scanFloat(normal.x);
+            lexer.scanFloat(normal.y);
+            lexer.scanFloat(normal.z);
+            data.normals.push_back(normal);
+        }
+        else if (keywordLength == 1 && keyword[0] == 'f')
+        {
+            MBEOBJParseFace(lexer, chunk);
+        }
+        else if (keywordLength == 1 && keyword[0] == 'g')
+        {
+            MBEOBJBeginGroup(lexer, data);
+        }
+
+        lexer.skipLine();
+    }
+}
+
+// Rewrites a chunk's relative references now that the number of elements declared before the
+// chunk is known.
+void MBEOBJResolveRelativeReferences(const MBEOBJChunk &chunk, MBEOBJFaceCorner *corners,
+                                     size_t positionBase, size_t texCoordBase, size_t normalBase)
+{
+    for (const MBEOBJRelativeReference &reference : chunk.relativeReferences)
+    {
+        MBEOBJFaceCorner &corner = corners[reference.corner];
+        switch (reference.attribute)
+        {
+            case MBEOBJAttributePosition:
+            {
+                int64_t index = (int64_t)positionBase + reference.localIndex;
+                corner.vi = (index >= 0) ? (uint32_t)index : MBEOBJInvalidIndex;
+                break;
+            }
+            case MBEOBJAttributeTexCoord:
+            {
+                int64_t index = (int64_t)texCoordBase + reference.localIndex;
+                corner.ti = (index >= 0) ? (uint32_t)index : MBEOBJInvalidIndex;
+                break;
+            }
+            case MBEOBJAttributeNormal:
+            {
+                int64_t index = (int64_t)normalBase + reference.localIndex;
+                corner.ni = (index >= 0) ? (uint32_t)index : MBEOBJInvalidIndex;
+                break;
+            }
+        }
+    }
+}
+
+// Splits [bytes, bytes + length) into roughly equal ranges that each end just after a newline
+std::vector<const char *> MBEOBJFindChunkBoundaries(const char *bytes, size_t length, size_t chunkCount)
+{
+    std::vector<const char *> boundaries(1, bytes);
+    const char *end = bytes + length;
+
+    for (size_t i = 1; i < chunkCount; ++i)
+    {
+        const char *target = bytes + (length * i) / chunkCount;
+        if (target <= boundaries.back())
+            continue;
+
+        const char *newline = static_cast<const char *>(memchr(target, '\n', end - target));
+        if (!newline)
+            break;
+
+        boundaries.push_back(newline + 1);
+    }
+
+    boundaries.push_back(end);
+    return boundaries;
+}
+
+// Concatenates chunks in file order. Attribute and corner copies run in parallel, since the prefix
+// sums of the chunk sizes tell each chunk exactly where its elements land.
+void MBEOBJMergeChunks(std::vector<MBEOBJChunk> &chunks, MBEOBJData &data, MBEThreadPool &pool)
+{
+    const size_t chunkCount = chunks.size();
+
+    std::vector<size_t> positionBases(chunkCount + 1, 0);
+    std::vector<size_t> texCoordBases(chunkCount + 1, 0);
+    std::vector<size_t> normalBases(chunkCount + 1, 0);
+    std::vector<size_t> cornerBases(chunkCount + 1, 0);
+    std::vector<size_t> faceBases(chunkCount + 1, 0);
+
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        const MBEOBJData &chunkData = chunks[i].data;
+        positionBases[i + 1] = positionBases[i] + chunkData.positions.size();
+        texCoordBases[i + 1] = texCoordBases[i] + chunkData.texCoords.size();
+        normalBases[i + 1] = normalBases[i] + chunkData.normals.size();
+        cornerBases[i + 1] = cornerBases[i] + chunkData.corners.size();
+        faceBases[i + 1] = faceBases[i] + chunkData.faceCount();
+    }
+
+    data.positions.resize(positionBases[chunkCount]);
+    data.texCoords.resize(texCoordBases[chunkCount]);
+    data.normals.resize(normalBases[chunkCount]);
+    data.corners.resize(cornerBases[chunkCount]);
+    data.faceStarts.resize(faceBases[chunkCount] + 1);
+    data.faceStarts[0] = 0;
+
+    pool.parallelFor(chunkCount, [&](size_t i)
+    {
+        MBEOBJData &chunkData = chunks[i].data;
+
+        std::copy(chunkData.positions.begin(), chunkData.positions.end(), data.positions.begin() + positionBases[i]);
+        std::copy(chunkData.texCoords.begin(), chunkData.texCoords.end(), data.texCoords.begin() + texCoordBases[i]);
+        std::copy(chunkData.normals.begin(), chunkData.normals.end(), data.normals.begin() + normalBases[i]);
+
+        MBEOBJFaceCorner *corners = data.corners.data() + cornerBases[i];
+        std::copy(chunkData.corners.begin(), chunkData.corners.end(), corners);
+        MBEOBJResolveRelativeReferences(chunks[i], corners, positionBases[i], texCoordBases[i], normalBases[i]);
+
+        // Skip the leading zero; each chunk's faces end where the next chunk's begin
+        uint32_t *faceStarts = data.faceStarts.data() + faceBases[i] + 1;
+        for (size_t f = 1; f < chunkData.faceStarts.size(); ++f)
+            faceStarts[f - 1] = (uint32_t)(cornerBases[i] + chunkData.faceStarts[f]);
+
+        // Release the chunk's copies as we go to keep peak memory down. Its groups are still needed below.
+        std::vector<MBEOBJFloat3>().swap(chunkData.positions);
+        std::vector<MBEOBJFloat2>().swap(chunkData.texCoords);
+        std::vector<MBEOBJFloat3>().swap(chunkData.normals);
+        std::vector<MBEOBJFaceCorner>().swap(chunkData.corners);
+    });
+
+    // Group statements are few, so they are merged serially. Every chunk's first group merely continues
+    // the previous chunk's last group, except in the first chunk, where it is the implicit unnamed group.
+    data.groups.clear();
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        std::vector<MBEOBJGroupRange> &chunkGroups = chunks[i].data.groups;
+        for (size_t g = (i == 0) ? 0 : 1; g < chunkGroups.size(); ++g)
+        {
+            MBEOBJGroupRange group;
+            group.name.swap(chunkGroups[g].name);
+            group.firstFace = faceBases[i] + chunkGroups[g].firstFace;
+            group.faceCount = 0;
+            data.groups.push_back(group);
+        }
+    }
+
+    for (size_t g = 0; g < data.groups.size(); ++g)
+    {
+        size_t endFace = (g + 1 < data.groups.size()) ? data.groups[g + 1].firstFace : data.faceCount();
+        data.groups[g].faceCount = endFace - data.groups[g].firstFace;
+    }
+}
+
+// Drops faces that reference positions that were never declared and clears dangling texture
+// coordinate and normal references. Well-formed files pass through without being modified.
+void MBEOBJValidateFaces(MBEOBJData &data)
+{
+    const uint32_t positionCount = (uint32_t)data.positions.size();
+    const uint32_t texCoordCount = (uint32_t)data.texCoords.size();
+    const uint32_t normalCount = (uint32_t)data.normals.size();
+
+    bool anyInvalidFaces = false;
+    for (MBEOBJFaceCorner &corner : data.corners)
+    {
+        if (corner.vi >= positionCount)
+            anyInvalidFaces = true;
+        if (corner.ti >= texCoordCount)
+            corner.ti = MBEOBJInvalidIndex;
+        if (corner.ni >= normalCount)
+            corner.ni = MBEOBJInvalidIndex;
+    }
+
+    if (!anyInvalidFaces)
+        return;
+
+    std::vector<MBEOBJFaceCorner> corners;
+    std::vector<uint32_t> faceStarts(1, 0);
+    corners.reserve(data.corners.size());
+    faceStarts.reserve(data.faceStarts.size());
+
+    for (MBEOBJGroupRange &group : data.groups)
+    {
+        const size_t firstFace = faceStarts.size() - 1;
+        for (size_t f = group.firstFace; f < group.firstFace + group.faceCount; ++f)
+        {
+            bool valid = true;
+            for (uint32_t c = data.faceStarts[f]; c < data.faceStarts[f + 1]; ++c)
+                valid = valid && (data.corners[c].vi < positionCount);
+
+            if (valid)
+            {
+                corners.insert(corners.end(), data.corners.begin() + data.faceStarts[f], data.corners.begin() + data.faceStarts[f + 1]);
+                faceStarts.push_back((uint32_t)corners.size());
+            }
+        }
+        group.firstFace = firstFace;
+        group.faceCount = (faceStarts.size() - 1) - firstFace;
+    }
+
+    data.corners.swap(corners);
+    data.faceStarts.swap(faceStarts);
+}
+
+} // namespace
+
+void MBEOBJParseBytes(const char *bytes, size_t length, MBEOBJData &data, MBEOBJParseMode mode)
+{
+    MBEThreadPool &pool = MBEThreadPool::sharedPool();
+
+    size_t chunkCount = 1;
+    if (mode == MBEOBJParseModeParallel)
+    {
+        // Oversubscribe a little so that chunks with unusually dense lines don't leave other threads idle
+        chunkCount = std::min<size_t>(pool.threadCount() * 4, length / MBEOBJMinimumChunkLength);
+        chunkCount = std::max<size_t>(chunkCount, 1);
+    }
+
+    std::vector<const char *> boundaries = MBEOBJFindChunkBoundaries(bytes, length, chunkCount);
+    chunkCount = boundaries.size() - 1;
+
+    std::vector<MBEOBJChunk> chunks(chunkCount);
+
+    pool.parallelFor(chunkCount, [&](size_t i)
+    {
+        MBEOBJParseChunk(boundaries[i], boundaries[i + 1], chunks[i]);
+    });
+
+    data = MBEOBJData();
+
+    if (chunkCount == 1)
+    {
+        // A single chunk is already laid out the way the merged result would be
+        MBEOBJChunk &chunk = chunks[0];
+        MBEOBJResolveRelativeReferences(chunk, chunk.data.corners.data(), 0, 0, 0);
+        std::swap(data, chunk.data);
+
+        for (size_t g = 0; g < data.groups.size(); ++g)
+        {
+            size_t endFace = (g + 1 < data.groups.size()) ? data.groups[g + 1].firstFace : data.faceCount();
+            data.groups[g].faceCount = endFace - data.groups[g].firstFace;
+        }
+    }
+    else
+    {
+        MBEOBJMergeChunks(chunks, data, pool);
+    }
+
+    MBEOBJValidateFaces(data);
+}
+
+bool MBEOBJParseFile(const char *path, MBEOBJData &data, MBEOBJParseMode mode)
+{
+    MBEMappedFile file(path);
+    if (!file.isValid())
+    {
+        return false;
+    }
+
+    MBEOBJParseBytes(reinterpret_cast<const char *>(file.bytes()), file.length(), data, mode);
+    return true;
+}
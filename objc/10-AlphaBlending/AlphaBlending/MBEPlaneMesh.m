@@ -1,6 +1,7 @@
 #import "MBEPlaneMesh.h"
 #import "MBETypes.h"
 #import "MBEMathUtilities.h"
+#import "MBEMeshOptimizer.h"
 
 @implementation MBEPlaneMesh
 
@@ -81,6 +82,13 @@
         }
     }
 
+    MBEMeshOptimizationReport report = MBEOptimizeMeshUInt16(vertices, sizeof(MBEVertex), vertexCount, indices, indexCount);
+    vertexCount = report.vertexCount;
+#if DEBUG
+    NSLog(@"Optimized plane: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f",
+          report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+#endif
+
     _vertexBuffer = [device newBufferWithBytes:vertices
                                         length:sizeof(MBEVertex) * vertexCount
                                        options:MTLResourceOptionCPUCacheModeDefault];
@@ -1,11 +1,14 @@
 @import Foundation;
 @import QuartzCore.CAMetalLayer;
+#import "MBECulling.h"
 
 @interface MBERenderer : NSObject
 
 @property (nonatomic, assign) float angularVelocity;
 @property (nonatomic, assign) float velocity;
 @property (nonatomic, assign) float frameDuration;
+/// The instances that frustum culling tested and kept in the most recent frame
+@property (nonatomic, readonly) MBECullingStats cullingStats;
 
 - (instancetype)initWithLayer:(CAMetalLayer *)layer;
 - (void)draw;
@@ -7,6 +7,9 @@
 #import "MBEOBJMesh.h"
 #import "MBEPlaneMesh.h"
 #import "MBEMaterial.h"
+#import "MBEFrameResources.h"
+#import "MBESpatialIndex.h"
+#import "MBEAssetLoader.h"
 
 #define AlignUp(N, M) ((((N) + (M) - 1) / (M)) * (M))
 
@@ -15,14 +18,25 @@ static const uint32_t MBEBufferAlignment = 256;
 static const float MBETerrainSize = 64;
 static const float MBETerrainHeight = 2.5;
 static const float MBETerrainSmoothness = 0.95;
+// Terrain chunks are drawn at the coarsest level of detail whose error covers no more than this many pixels
+static const float MBETerrainPixelTolerance = 2;
 
 static const float MBEWaterLevel = -0.5;
 
 static const size_t MBETreeCount = 200;
+// The tree index divides the terrain into cells this many times, down to 16 x 16 cells of 4 x 4 units
+static const unsigned MBETreeIndexDepth = 5;
 static const float MBECameraHeight = 0.3;
 
-static const size_t MBESharedUniformOffset = 0;
-static const size_t MBETerrainUniformOffset = AlignUp(MBESharedUniformOffset + sizeof(Uniforms), MBEBufferAlignment);
+// Assets load in the background, no more than this many estimated bytes at a time
+static const size_t MBEMaxAssetBytesInFlight = 16 * 1024 * 1024;
+// A 1024 x 1024 RGBA8 texture and its mipmaps, which is what each of the scene's textures is
+static const size_t MBETextureAssetBytes = 1024 * 1024 * 4 * 4 / 3;
+static const size_t MBEModelAssetBytes = 4 * 1024 * 1024;
+
+// Offsets into the uniform buffer, which holds the uniforms that never change. The shared uniforms are
+// rewritten every frame, so they live in the frame resources instead.
+static const size_t MBETerrainUniformOffset = 0;
 static const size_t MBEWaterUniformOffset = AlignUp(MBETerrainUniformOffset + sizeof(InstanceUniforms), MBEBufferAlignment);
 static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeof(InstanceUniforms), MBEBufferAlignment);
 
@@ -36,11 +50,20 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
 // Resources
 @property (nonatomic, strong) MBETerrainMesh *terrainMesh;
 @property (nonatomic, strong) MBEMesh *waterMesh;
-@property (nonatomic, strong) MBEMesh *treeMesh;
+@property (nonatomic, strong) MBEOBJMesh *treeMesh;
 @property (nonatomic, strong) MBEMaterial *terrainMaterial;
 @property (nonatomic, strong) MBEMaterial *waterMaterial;
 @property (nonatomic, strong) MBEMaterial *treeMaterial;
 @property (nonatomic, strong) id<MTLBuffer> uniformBuffer;
+@property (nonatomic, strong) MBEFrameResources *frameResources;
+@property (nonatomic, assign) NSUInteger sharedUniformOffset;
+@property (nonatomic, assign) NSUInteger treeUniformOffset;
+@property (nonatomic, assign) NSUInteger visibleTreeCount;
+// The ids of the trees that survive culling, kept from frame to frame so that culling stays off the stack
+@property (nonatomic, strong) NSMutableData *visibleTreeIDs;
+@property (nonatomic, assign) MBEFrustum frustum;
+@property (nonatomic, assign) MBESpatialIndex *treeIndex;
+@property (nonatomic, strong) MBEAssetLoader *assetLoader;
 // Parameters
 @property (nonatomic, assign) vector_float3 cameraPosition;
 @property (nonatomic, assign) float cameraHeading;
@@ -59,6 +82,11 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
     return self;
 }
 
+- (void)dealloc
+{
+    MBESpatialIndexDestroy(_treeIndex);
+}
+
 - (void)buildMetal
 {
     _device = MTLCreateSystemDefaultDevice();
@@ -78,19 +106,25 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
 
 - (void)buildResources
 {
-    [self loadMeshes];
-    [self loadTextures];
+    // The terrain is needed to place the camera, so it is built up front. Everything else streams in
+    // while the first frames are drawn, and each part of the scene appears once its assets are ready.
+    _assetLoader = [[MBEAssetLoader alloc] initWithWorkerCount:0 maxBytesInFlight:MBEMaxAssetBytesInFlight];
+
+    [self buildMeshes];
+    [self buildMaterials];
     [self buildUniformBuffer];
+    [self buildFrameResources];
     [self populateTerrainUniforms];
     [self populateWaterUniforms];
-    [self populateTreeUniforms];
+    [self loadTextures];
+    [self loadTrees];
 }
 
-- (void)loadMeshes
+- (void)buildMeshes
 {
     _terrainMesh = [[MBETerrainMesh alloc] initWithWidth:MBETerrainSize
                                                   height:MBETerrainHeight
-                                              iterations:6
+                                              iterations:8
                                               smoothness:MBETerrainSmoothness
                                                   device:self.device];
 
@@ -101,45 +135,98 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
                                         textureScale:10
                                              opacity:0.2
                                               device:_device];
-
-    NSURL *modelURL = [[NSBundle mainBundle] URLForResource:@"palm" withExtension:@"obj"];
-    MBEOBJModel *treeModel = [[MBEOBJModel alloc] initWithContentsOfURL:modelURL generateNormals:YES];
-    if (treeModel)
-    {
-        MBEOBJGroup *group = [treeModel groupForName:@"palm"];
-        if (group)
-        {
-            _treeMesh = [[MBEOBJMesh alloc] initWithGroup:group device:_device];
-        }
-    }
 }
 
-- (void)loadTextures
+- (void)buildMaterials
 {
-    MBETextureLoader *textureLoader = [MBETextureLoader sharedTextureLoader];
-
-    id<MTLTexture> terrainTexture = [textureLoader texture2DWithImageNamed:@"sand" mipmapped:YES device:_device];
-    _terrainMaterial = [[MBEMaterial alloc] initWithDiffuseTexture:terrainTexture
+    // Materials start without textures, and aren't drawn until their textures have loaded
+    _terrainMaterial = [[MBEMaterial alloc] initWithDiffuseTexture:nil
                                                   alphaTestEnabled:NO
                                                    blendingEnabled:NO
                                                  depthWriteEnabled:YES
                                                             device:_device];
 
-    id<MTLTexture> treeTexture = [textureLoader texture2DWithImageNamed:@"palm_diffuse" mipmapped:YES device:_device];
-    _treeMaterial = [[MBEMaterial alloc] initWithDiffuseTexture:treeTexture
+    _treeMaterial = [[MBEMaterial alloc] initWithDiffuseTexture:nil
                                                alphaTestEnabled:YES
                                                 blendingEnabled:NO
                                               depthWriteEnabled:YES
                                                          device:_device];
 
-    id<MTLTexture> waterTexture = [textureLoader texture2DWithImageNamed:@"water" mipmapped:YES device:_device];
-    _waterMaterial = [[MBEMaterial alloc] initWithDiffuseTexture:waterTexture
+    _waterMaterial = [[MBEMaterial alloc] initWithDiffuseTexture:nil
                                                 alphaTestEnabled:NO
                                                  blendingEnabled:YES
                                                depthWriteEnabled:NO
                                                           device:_device];
 }
 
+- (void)loadTextureNamed:(NSString *)imageName forMaterial:(MBEMaterial *)material
+{
+    id<MTLDevice> device = self.device;
+    __block id<MTLTexture> texture = nil;
+    [self.assetLoader addAssetWithEstimatedBytes:MBETextureAssetBytes
+                                    dependencies:nil
+                                            load:^{
+        texture = [[MBETextureLoader sharedTextureLoader] texture2DWithImageNamed:imageName mipmapped:YES device:device];
+        return (BOOL)(texture != nil);
+    }
+                                      completion:^(BOOL loaded) {
+        material.diffuseTexture = texture;
+    }];
+}
+
+- (void)loadTextures
+{
+    [self loadTextureNamed:@"sand" forMaterial:self.terrainMaterial];
+    [self loadTextureNamed:@"palm_diffuse" forMaterial:self.treeMaterial];
+    [self loadTextureNamed:@"water" forMaterial:self.waterMaterial];
+}
+
+- (void)loadTrees
+{
+    __weak MBERenderer *weakSelf = self;
+    id<MTLDevice> device = self.device;
+
+    __block MBEOBJMesh *treeMesh = nil;
+    MBEAssetID treeMeshID = [self.assetLoader addAssetWithEstimatedBytes:MBEModelAssetBytes
+                                                            dependencies:nil
+                                                                    load:^{
+        NSURL *modelURL = [[NSBundle mainBundle] URLForResource:@"palm" withExtension:@"obj"];
+        MBEOBJModel *treeModel = [[MBEOBJModel alloc] initWithContentsOfURL:modelURL generateNormals:YES];
+        MBEOBJGroup *group = [treeModel groupForName:@"palm"];
+        if (group)
+        {
+            treeMesh = [[MBEOBJMesh alloc] initWithGroup:group device:device];
+        }
+        return (BOOL)(treeMesh != nil);
+    }
+                                                              completion:^(BOOL loaded) {
+        weakSelf.treeMesh = treeMesh;
+    }];
+
+    // The trees are placed once their mesh is known, since the index needs its bounds. Nothing reads
+    // the tree uniforms until the index is published, so the worker may write them in place.
+    __block MBESpatialIndex *treeIndex = NULL;
+    [self.assetLoader addAssetWithEstimatedBytes:0
+                                    dependencies:@[ @(treeMeshID) ]
+                                            load:^{
+        MBERenderer *renderer = weakSelf;
+        [renderer populateTreeUniforms];
+        treeIndex = [renderer newTreeIndex];
+        return (BOOL)(treeIndex != NULL);
+    }
+                                      completion:^(BOOL loaded) {
+        MBERenderer *renderer = weakSelf;
+        if (renderer)
+        {
+            renderer.treeIndex = treeIndex;
+        }
+        else
+        {
+            MBESpatialIndexDestroy(treeIndex);
+        }
+    }];
+}
+
 - (void)buildUniformBuffer
 {
     size_t uniformBufferLength = MBETreeUniformOffset + sizeof(InstanceUniforms) * MBETreeCount;
@@ -147,6 +234,18 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
     [_uniformBuffer setLabel:@"Uniforms"];
 }
 
+- (void)buildFrameResources
+{
+    // The shared uniforms change every frame, and so does the set of trees that survive culling
+    const NSUInteger bytesPerFrame = AlignUp(sizeof(Uniforms), MBEFrameResourceAlignment) +
+                                     AlignUp(sizeof(InstanceUniforms) * MBETreeCount, MBEFrameResourceAlignment);
+    _frameResources = [[MBEFrameResources alloc] initWithDevice:_device
+                                                 framesInFlight:MBEDefaultFramesInFlight
+                                                  bytesPerFrame:bytesPerFrame];
+
+    _visibleTreeIDs = [NSMutableData dataWithLength:sizeof(uint32_t) * MBETreeCount];
+}
+
 - (void)populateTerrainUniforms
 {
     matrix_float4x4 terrainModelMatrix = matrix_identity();
@@ -170,26 +269,39 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
 
 - (void)populateTreeUniforms
 {
-    for (int i = 0; i < MBETreeCount; ++i)
-    {
-        const float halfTerrainWidth = self.terrainMesh.width / 2;
-        const float halfTerrainDepth = self.terrainMesh.depth / 2;
+    const float halfTerrainWidth = self.terrainMesh.width / 2;
+    const float halfTerrainDepth = self.terrainMesh.depth / 2;
 
-        vector_float3 position = { 0, 0, 0 };
-        BOOL onLand = NO;
+    vector_float3 positions[MBETreeCount];
+    vector_float2 candidates[MBETreeCount];
+    float candidateHeights[MBETreeCount];
+    size_t placedCount = 0;
 
-        // Attempt to place the palm tree on dry land
-        // This will spin forever if the water level is too high
-        while (!onLand)
+    // Attempt to place the palm trees on dry land, testing a batch of random spots at a time
+    // This will spin forever if the water level is too high
+    while (placedCount < MBETreeCount)
+    {
+        const size_t candidateCount = MBETreeCount - placedCount;
+        for (size_t i = 0; i < candidateCount; ++i)
         {
-            position.x = random_float(-halfTerrainWidth, halfTerrainWidth);
-            position.z = random_float(-halfTerrainDepth, halfTerrainDepth);
-            position.y = [self.terrainMesh heightAtPositionX:position.x z:position.z];
+            candidates[i].x = random_float(-halfTerrainWidth, halfTerrainWidth);
+            candidates[i].y = random_float(-halfTerrainDepth, halfTerrainDepth);
+        }
+
+        [self.terrainMesh getHeights:candidateHeights normals:NULL atPositions:candidates count:candidateCount];
 
-            onLand = (position.y > MBEWaterLevel);
+        for (size_t i = 0; i < candidateCount; ++i)
+        {
+            if (candidateHeights[i] > MBEWaterLevel)
+            {
+                positions[placedCount++] = (vector_float3){ candidates[i].x, candidateHeights[i], candidates[i].y };
+            }
         }
+    }
 
-        matrix_float4x4 modelMatrix = matrix_translation(position);
+    for (int i = 0; i < MBETreeCount; ++i)
+    {
+        matrix_float4x4 modelMatrix = matrix_translation(positions[i]);
 
         InstanceUniforms uniforms;
         uniforms.modelMatrix = modelMatrix;
@@ -200,6 +312,22 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
     }
 }
 
+- (MBESpatialIndex *)newTreeIndex
+{
+    // The trees never move, so their index is built once, in bulk
+    MBEBoundingSphere *treeSpheres = malloc(sizeof(MBEBoundingSphere) * MBETreeCount);
+    MBETransformBoundingSpheres(self.treeMesh.boundingSphere, [self.uniformBuffer contents] + MBETreeUniformOffset,
+                                MBETreeCount, sizeof(InstanceUniforms), treeSpheres);
+
+    const float halfTerrainWidth = self.terrainMesh.width / 2;
+    const float halfTerrainDepth = self.terrainMesh.depth / 2;
+    MBESpatialIndex *treeIndex = MBESpatialIndexCreate(-halfTerrainWidth, halfTerrainWidth, -halfTerrainDepth, halfTerrainDepth,
+                                                       MBETreeIndexDepth);
+    MBESpatialIndexBuild(treeIndex, treeSpheres, MBETreeCount);
+    free(treeSpheres);
+    return treeIndex;
+}
+
 - (void)buildDepthTexture
 {
     CGSize drawableSize = self.layer.drawableSize;
@@ -265,7 +393,57 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
 
     Uniforms uniforms;
     uniforms.viewProjectionMatrix = matrix_multiply(projectionMatrix, viewMatrix);
-    memcpy([self.uniformBuffer contents] + MBESharedUniformOffset, &uniforms, sizeof(Uniforms));
+
+    // Without room for the shared uniforms, nothing is drawn this frame
+    NSUInteger offset = 0;
+    void *contents = [self.frameResources allocateLength:sizeof(Uniforms) offset:&offset];
+    if (contents)
+    {
+        memcpy(contents, &uniforms, sizeof(Uniforms));
+    }
+    self.sharedUniformOffset = contents ? offset : NSNotFound;
+
+    self.frustum = MBEFrustumMake((const float *)&uniforms.viewProjectionMatrix);
+
+    const float projectionScale = self.layer.drawableSize.height / (2 * tan(fov * 0.5));
+    [self.terrainMesh selectLevelsOfDetailForCameraPosition:self.cameraPosition
+                                            projectionScale:projectionScale
+                                             pixelTolerance:MBETerrainPixelTolerance];
+}
+
+- (void)cullTrees
+{
+    if (!self.treeIndex)
+    {
+        self.visibleTreeCount = 0;
+        return;
+    }
+
+    // Only the trees that may be on screen are copied into this frame's uniforms, packed together so
+    // that a single instanced draw covers exactly them
+    uint32_t *visibleTreeIDs = self.visibleTreeIDs.mutableBytes;
+    MBECullingStats stats = { 0, 0 };
+    const MBEFrustum frustum = self.frustum;
+    const size_t visibleTreeCount = MBESpatialIndexQueryFrustum(self.treeIndex, &frustum, visibleTreeIDs, MBETreeCount, &stats);
+
+    NSUInteger offset = 0;
+    InstanceUniforms *visibleTreeUniforms = [self.frameResources allocateLength:sizeof(InstanceUniforms) * MBETreeCount
+                                                                         offset:&offset];
+    if (!visibleTreeUniforms)
+    {
+        self.visibleTreeCount = 0;
+        return;
+    }
+
+    const InstanceUniforms *treeUniforms = (const InstanceUniforms *)([self.uniformBuffer contents] + MBETreeUniformOffset);
+    for (size_t i = 0; i < visibleTreeCount; ++i)
+    {
+        visibleTreeUniforms[i] = treeUniforms[visibleTreeIDs[i]];
+    }
+
+    self.visibleTreeCount = visibleTreeCount;
+    self.treeUniformOffset = offset;
+    _cullingStats = stats;
 }
 
 - (MTLRenderPassDescriptor *)newRenderPassWithColorAttachmentTexture:(id<MTLTexture>)texture
@@ -285,10 +463,7 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
     return renderPass;
 }
 
-- (void)drawInstancedMesh:(MBEMesh *)mesh
-       withCommandEncoder:(id<MTLRenderCommandEncoder>)commandEncoder
-                 material:(MBEMaterial *)material
-            instanceCount:(uint32_t)instanceCount
+- (void)setMaterial:(MBEMaterial *)material withCommandEncoder:(id<MTLRenderCommandEncoder>)commandEncoder
 {
     [commandEncoder setRenderPipelineState:material.pipelineState];
 
@@ -296,13 +471,21 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
 
     [commandEncoder setFragmentSamplerState:self.sampler atIndex:0];
 
-    [commandEncoder setVertexBuffer:mesh.vertexBuffer offset:0 atIndex:0];
-
     [commandEncoder setFragmentTexture:material.diffuseTexture atIndex:0];
+}
+
+- (void)drawInstancedMesh:(MBEMesh *)mesh
+       withCommandEncoder:(id<MTLRenderCommandEncoder>)commandEncoder
+                 material:(MBEMaterial *)material
+            instanceCount:(uint32_t)instanceCount
+{
+    [self setMaterial:material withCommandEncoder:commandEncoder];
+
+    [commandEncoder setVertexBuffer:mesh.vertexBuffer offset:0 atIndex:0];
 
     [commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
-                               indexCount:[mesh.indexBuffer length] / sizeof(MBEIndex)
-                                indexType:MTLIndexTypeUInt16
+                               indexCount:mesh.indexCount
+                                indexType:mesh.indexType
                               indexBuffer:mesh.indexBuffer
                         indexBufferOffset:0
                             instanceCount:instanceCount];
@@ -310,7 +493,16 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
 
 - (void)draw
 {
+    // Waits only if the GPU is still executing the frame that last used this frame's uniforms
+    [self.frameResources beginFrame];
+
+    // Publish whatever finished loading since the last frame
+    [self.assetLoader processCompletions];
+
     [self updateCamera];
+    [self cullTrees];
+
+    id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
 
     id<CAMetalDrawable> drawable = [self.layer nextDrawable];
 
@@ -324,43 +516,55 @@ static const size_t MBETreeUniformOffset = AlignUp(MBEWaterUniformOffset + sizeo
 
         MTLRenderPassDescriptor *renderPass = [self newRenderPassWithColorAttachmentTexture:[drawable texture]];
 
-        id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
-
         id<MTLRenderCommandEncoder> commandEncoder = [commandBuffer renderCommandEncoderWithDescriptor:renderPass];
         [commandEncoder setFrontFacingWinding:MTLWindingCounterClockwise];
         [commandEncoder setCullMode:MTLCullModeNone];
 
         // Set the shared uniforms as vertex buffer at index 1
-        [commandEncoder setVertexBuffer:self.uniformBuffer offset:MBESharedUniformOffset atIndex:1];
+        const BOOL hasSharedUniforms = (self.sharedUniformOffset != NSNotFound);
+        if (hasSharedUniforms)
+        {
+            [commandEncoder setVertexBuffer:self.frameResources.buffer offset:self.sharedUniformOffset atIndex:1];
+        }
 
         // Set terrain uniforms as vertex buffer at index 2 and draw terrain
-        [commandEncoder setVertexBuffer:self.uniformBuffer offset:MBETerrainUniformOffset atIndex:2];
-        [self drawInstancedMesh:self.terrainMesh
-             withCommandEncoder:commandEncoder
-                       material:self.terrainMaterial
-                  instanceCount:1];
-
-        // Set palm tree uniforms as vertex buffer at index 2 and draw trees
-        [commandEncoder setVertexBuffer:self.uniformBuffer offset:MBETreeUniformOffset atIndex:2];
-        [self drawInstancedMesh:self.treeMesh
-             withCommandEncoder:commandEncoder
-                       material:self.treeMaterial
-                  instanceCount:MBETreeCount];
+        if (hasSharedUniforms && self.terrainMaterial.diffuseTexture)
+        {
+            [commandEncoder setVertexBuffer:self.uniformBuffer offset:MBETerrainUniformOffset atIndex:2];
+            [self setMaterial:self.terrainMaterial withCommandEncoder:commandEncoder];
+            [self.terrainMesh drawChunksWithCommandEncoder:commandEncoder];
+        }
+
+        // Set the uniforms of the visible palm trees as vertex buffer at index 2 and draw them
+        if (hasSharedUniforms && self.visibleTreeCount > 0 && self.treeMaterial.diffuseTexture)
+        {
+            [commandEncoder setVertexBuffer:self.frameResources.buffer offset:self.treeUniformOffset atIndex:2];
+            [self drawInstancedMesh:self.treeMesh
+                 withCommandEncoder:commandEncoder
+                           material:self.treeMaterial
+                      instanceCount:(uint32_t)self.visibleTreeCount];
+        }
 
         // Set water surface uniforms as vertex buffer at index 2 and draw water surface
         // Order is important here, since the water material uses alpha blending,
         // and all translucent surfaces must be drawn last to blend properly.
-        [commandEncoder setVertexBuffer:self.uniformBuffer offset:MBEWaterUniformOffset atIndex:2];
-        [self drawInstancedMesh:self.waterMesh
-             withCommandEncoder:commandEncoder
-                       material:self.waterMaterial
-                  instanceCount:1];
+        if (hasSharedUniforms && self.waterMaterial.diffuseTexture)
+        {
+            [commandEncoder setVertexBuffer:self.uniformBuffer offset:MBEWaterUniformOffset atIndex:2];
+            [self drawInstancedMesh:self.waterMesh
+                 withCommandEncoder:commandEncoder
+                           material:self.waterMaterial
+                      instanceCount:1];
+        }
         
         [commandEncoder endEncoding];
         
         [commandBuffer presentDrawable:drawable];
-        [commandBuffer commit];
     }
+
+    // Committed even without a drawable, so that its completion releases this frame's uniforms
+    [self.frameResources endFrameWithCommandBuffer:commandBuffer];
+    [commandBuffer commit];
 }
 
 @end
@@ -0,0 +1,515 @@
+#include "MBESpatialIndex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    const unsigned MBESpatialIndexMaxDepth = 10;
+    const uint32_t MBENoNode = std::numeric_limits<uint32_t>::max();
+
+    struct Box
+    {
+        float min[3];
+        float max[3];
+    };
+
+    struct Node
+    {
+        std::vector<uint32_t> objects;
+        uint32_t subtreeCount; // objects in this node and all of its descendants
+    };
+
+    struct Object
+    {
+        MBEBoundingSphere sphere;
+        uint32_t node;
+        uint32_t slot; // position within the node's object list
+    };
+
+    // Nodes are stored level by level; level L has 4^L nodes in row-major order, starting here
+    uint32_t LevelOffset(unsigned level)
+    {
+        return (((uint32_t)1 << (2 * level)) - 1) / 3;
+    }
+
+    float SquaredDistanceToBox(const float point[3], const Box &box)
+    {
+        float distance = 0;
+        for (int i = 0; i < 3; ++i)
+        {
+            const float d = std::max(std::max(box.min[i] - point[i], point[i] - box.max[i]), 0.0f);
+            distance += d * d;
+        }
+        return distance;
+    }
+
+    bool SpheresIntersect(const MBEBoundingSphere &sphere, const float center[3], float radius)
+    {
+        const float dx = sphere.center[0] - center[0];
+        const float dy = sphere.center[1] - center[1];
+        const float dz = sphere.center[2] - center[2];
+        const float reach = sphere.radius + radius;
+        return dx * dx + dy * dy + dz * dz <= reach * reach;
+    }
+
+    bool SphereInFrustum(const MBEFrustum &frustum, const MBEBoundingSphere &sphere)
+    {
+        for (int p = 0; p < 6; ++p)
+        {
+            const float *plane = frustum.planes[p];
+            const float distance = plane[0] * sphere.center[0] + plane[1] * sphere.center[1] +
+                                   plane[2] * sphere.center[2] + plane[3];
+            if (distance < -sphere.radius)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    enum Containment
+    {
+        Outside,
+        Intersecting,
+        Inside,
+    };
+
+    Containment BoxInFrustum(const MBEFrustum &frustum, const Box &box)
+    {
+        Containment containment = Inside;
+        for (int p = 0; p < 6; ++p)
+        {
+            const float *plane = frustum.planes[p];
+
+            // The corners farthest along and against the plane's normal
+            float nearest = plane[3], farthest = plane[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                const float low = plane[i] * box.min[i], high = plane[i] * box.max[i];
+                nearest += std::min(low, high);
+                farthest += std::max(low, high);
+            }
+
+            if (farthest < 0)
+            {
+                return Outside;
+            }
+            if (nearest < 0)
+            {
+                containment = Intersecting;
+            }
+        }
+        return containment;
+    }
+
+    // Returns the distance at which a ray enters a sphere, or a negative value if it misses
+    float RaySphere(const float origin[3], const float direction[3], const MBEBoundingSphere &sphere)
+    {
+        const float offset[3] = { origin[0] - sphere.center[0], origin[1] - sphere.center[1], origin[2] - sphere.center[2] };
+        const float b = offset[0] * direction[0] + offset[1] * direction[1] + offset[2] * direction[2];
+        const float c = offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] - sphere.radius * sphere.radius;
+        if (c <= 0)
+        {
+            return 0; // the origin is inside the sphere
+        }
+
+        const float discriminant = b * b - c;
+        if (b > 0 || discriminant < 0)
+        {
+            return -1;
+        }
+        return -b - std::sqrt(discriminant);
+    }
+
+    bool RayBox(const float origin[3], const float inverseDirection[3], const Box &box, float maxDistance)
+    {
+        float enter = 0, exit = maxDistance;
+        for (int i = 0; i < 3; ++i)
+        {
+            float t0 = (box.min[i] - origin[i]) * inverseDirection[i];
+            float t1 = (box.max[i] - origin[i]) * inverseDirection[i];
+            if (t0 > t1)
+            {
+                std::swap(t0, t1);
+            }
+            enter = std::max(enter, t0);
+            exit = std::min(exit, t1);
+        }
+        return enter <= exit;
+    }
+}
+
+struct MBESpatialIndex
+{
+    float minX, minZ;
+    float cellWidth, cellDepth; // size of a cell at the deepest level
+    unsigned depth;
+
+    // The vertical extent of every node, widened as objects are added so that it encloses them all
+    float minY, maxY;
+
+    std::vector<Node> nodes;
+    std::vector<Object> objects;
+    size_t count;
+
+    MBESpatialIndex(float indexMinX, float indexMaxX, float indexMinZ, float indexMaxZ, unsigned requestedDepth)
+    : minX(indexMinX), minZ(indexMinZ), depth(std::min(std::max(requestedDepth, 1u), MBESpatialIndexMaxDepth)),
+      minY(INFINITY), maxY(-INFINITY), count(0)
+    {
+        const float cellsPerEdge = (float)(1u << (depth - 1));
+        cellWidth = (indexMaxX - indexMinX) / cellsPerEdge;
+        cellDepth = (indexMaxZ - indexMinZ) / cellsPerEdge;
+        nodes.resize(LevelOffset(depth));
+        for (Node &node : nodes)
+        {
+            node.subtreeCount = 0;
+        }
+    }
+
+    // The root is level 0; a node's children are at the next level, in cells 2x ..< 2x + 2 and 2z ..< 2z + 2
+    uint32_t nodeFor(const MBEBoundingSphere &sphere) const
+    {
+        const float cellsPerEdge = (float)(1u << (depth - 1));
+        const float x = (sphere.center[0] - minX) / cellWidth;
+        const float z = (sphere.center[2] - minZ) / cellDepth;
+        if (!(x >= 0 && x < cellsPerEdge && z >= 0 && z < cellsPerEdge))
+        {
+            return 0; // the root is never culled, so it may hold objects outside the indexed area
+        }
+
+        // A sphere fits the loose bounds of a cell if its radius is at most half the cell's size
+        unsigned level = depth - 1;
+        float halfCell = std::min(cellWidth, cellDepth) * 0.5f;
+        while (level > 0 && sphere.radius > halfCell)
+        {
+            --level;
+            halfCell *= 2;
+        }
+
+        const unsigned shift = depth - 1 - level;
+        const uint32_t column = (uint32_t)x >> shift;
+        const uint32_t row = (uint32_t)z >> shift;
+        return LevelOffset(level) + (row << level) + column;
+    }
+
+    Box looseBox(unsigned level, uint32_t row, uint32_t column) const
+    {
+        const float scale = (float)(1u << (depth - 1 - level));
+        const float width = cellWidth * scale, cellDepthAtLevel = cellDepth * scale;
+        Box box;
+        box.min[0] = minX + (column - 0.5f) * width;
+        box.max[0] = minX + (column + 1.5f) * width;
+        box.min[1] = minY;
+        box.max[1] = maxY;
+        box.min[2] = minZ + (row - 0.5f) * cellDepthAtLevel;
+        box.max[2] = minZ + (row + 1.5f) * cellDepthAtLevel;
+        return box;
+    }
+
+    void adjustSubtreeCounts(uint32_t node, int delta)
+    {
+        // Walk up to the root, recovering each ancestor from the node's level, row and column
+        unsigned level = 0;
+        while (level + 1 < depth && LevelOffset(level + 1) <= node)
+        {
+            ++level;
+        }
+        uint32_t cell = node - LevelOffset(level);
+        uint32_t row = cell >> level, column = cell & ((1u << level) - 1);
+        for (;;)
+        {
+            nodes[LevelOffset(level) + (row << level) + column].subtreeCount += delta;
+            if (level == 0)
+            {
+                break;
+            }
+            --level;
+            row >>= 1;
+            column >>= 1;
+        }
+    }
+
+    void link(uint32_t objectID, uint32_t node)
+    {
+        Object &object = objects[objectID];
+        object.node = node;
+        object.slot = (uint32_t)nodes[node].objects.size();
+        nodes[node].objects.push_back(objectID);
+        adjustSubtreeCounts(node, 1);
+    }
+
+    void unlink(uint32_t objectID)
+    {
+        Object &object = objects[objectID];
+        std::vector<uint32_t> &list = nodes[object.node].objects;
+        const uint32_t last = list.back();
+        list[object.slot] = last;
+        objects[last].slot = object.slot;
+        list.pop_back();
+        adjustSubtreeCounts(object.node, -1);
+        object.node = MBENoNode;
+    }
+
+    void insert(uint32_t objectID, const MBEBoundingSphere &sphere)
+    {
+        if (objectID >= objects.size())
+        {
+            objects.resize(objectID + 1, Object{ { { 0, 0, 0 }, 0 }, MBENoNode, 0 });
+        }
+
+        minY = std::min(minY, sphere.center[1] - sphere.radius);
+        maxY = std::max(maxY, sphere.center[1] + sphere.radius);
+
+        Object &object = objects[objectID];
+        object.sphere = sphere;
+
+        const uint32_t node = nodeFor(sphere);
+        if (object.node == node)
+        {
+            return;
+        }
+
+        if (object.node == MBENoNode)
+        {
+            ++count;
+        }
+        else
+        {
+            unlink(objectID);
+        }
+        link(objectID, node);
+    }
+
+    // Visits the objects of every node whose loose box passes `nodeTest`, telling `visit` whether the node
+    // lies wholly inside the query. Nodes inside a node that lies wholly inside need no test of their own.
+    template <typename NodeTest, typename Visit>
+    void traverse(unsigned level, uint32_t row, uint32_t column, bool inside, NodeTest &nodeTest, Visit &visit) const
+    {
+        const Node &node = nodes[LevelOffset(level) + (row << level) + column];
+        if (node.subtreeCount == 0)
+        {
+            return;
+        }
+
+        // The root may hold objects outside the indexed area, so it has no bounds to test
+        if (!inside && level > 0)
+        {
+            const Containment containment = nodeTest(looseBox(level, row, column));
+            if (containment == Outside)
+            {
+                return;
+            }
+            inside = (containment == Inside);
+        }
+
+        for (uint32_t objectID : node.objects)
+        {
+            visit(objectID, inside);
+        }
+
+        if (level + 1 < depth)
+        {
+            for (uint32_t r = row * 2; r < row * 2 + 2; ++r)
+            {
+                for (uint32_t c = column * 2; c < column * 2 + 2; ++c)
+                {
+                    traverse(level + 1, r, c, inside, nodeTest, visit);
+                }
+            }
+        }
+    }
+};
+
+MBESpatialIndex *MBESpatialIndexCreate(float minX, float maxX, float minZ, float maxZ, unsigned depth)
+{
+    return new MBESpatialIndex(minX, maxX, minZ, maxZ, depth);
+}
+
+void MBESpatialIndexDestroy(MBESpatialIndex *index)
+{
+    delete index;
+}
+
+size_t MBESpatialIndexGetCount(const MBESpatialIndex *index)
+{
+    return index->count;
+}
+
+void MBESpatialIndexBuild(MBESpatialIndex *index, const MBEBoundingSphere *spheres, size_t count)
+{
+    for (Node &node : index->nodes)
+    {
+        node.objects.clear();
+        node.subtreeCount = 0;
+    }
+
+    index->objects.assign(count, Object{ { { 0, 0, 0 }, 0 }, MBENoNode, 0 });
+    index->count = count;
+    index->minY = INFINITY;
+    index->maxY = -INFINITY;
+
+    // Every object's node is known up front, so each node's list can be filled without reallocating
+    std::vector<uint32_t> objectNodes(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        objectNodes[i] = index->nodeFor(spheres[i]);
+        index->nodes[objectNodes[i]].subtreeCount += 1;
+        index->minY = std::min(index->minY, spheres[i].center[1] - spheres[i].radius);
+        index->maxY = std::max(index->maxY, spheres[i].center[1] + spheres[i].radius);
+    }
+
+    for (Node &node : index->nodes)
+    {
+        node.objects.reserve(node.subtreeCount);
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        Object &object = index->objects[i];
+        object.sphere = spheres[i];
+        object.node = objectNodes[i];
+        object.slot = (uint32_t)index->nodes[object.node].objects.size();
+        index->nodes[object.node].objects.push_back((uint32_t)i);
+    }
+
+    // So far each node counts only its own objects; add every level's totals into the level above
+    for (unsigned level = index->depth - 1; level > 0; --level)
+    {
+        const uint32_t cellsPerEdge = 1u << level;
+        for (uint32_t row = 0; row < cellsPerEdge; ++row)
+        {
+            for (uint32_t column = 0; column < cellsPerEdge; ++column)
+            {
+                const uint32_t child = LevelOffset(level) + row * cellsPerEdge + column;
+                const uint32_t parent = LevelOffset(level - 1) + (row / 2) * (cellsPerEdge / 2) + column / 2;
+                index->nodes[parent].subtreeCount += index->nodes[child].subtreeCount;
+            }
+        }
+    }
+}
+
+void MBESpatialIndexInsert(MBESpatialIndex *index, uint32_t objectID, MBEBoundingSphere sphere)
+{
+    index->insert(objectID, sphere);
+}
+
+void MBESpatialIndexUpdate(MBESpatialIndex *index, const MBEBoundingSphere *spheres, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        index->insert((uint32_t)i, spheres[i]);
+    }
+}
+
+void MBESpatialIndexRemove(MBESpatialIndex *index, uint32_t objectID)
+{
+    if (objectID < index->objects.size() && index->objects[objectID].node != MBENoNode)
+    {
+        index->unlink(objectID);
+        --index->count;
+    }
+}
+
+size_t MBESpatialIndexQueryFrustum(const MBESpatialIndex *index,
+                                   const MBEFrustum *frustum,
+                                   uint32_t *objectIDs,
+                                   size_t capacity,
+                                   MBECullingStats *stats)
+{
+    size_t found = 0, tested = 0;
+    auto nodeTest = [&](const Box &box) { return BoxInFrustum(*frustum, box); };
+    auto visit = [&](uint32_t objectID, bool nodeInside)
+    {
+        if (!nodeInside)
+        {
+            ++tested;
+            if (!SphereInFrustum(*frustum, index->objects[objectID].sphere))
+            {
+                return;
+            }
+        }
+        if (found < capacity)
+        {
+            objectIDs[found++] = objectID;
+        }
+    };
+    index->traverse(0, 0, 0, false, nodeTest, visit);
+
+    std::sort(objectIDs, objectIDs + found);
+
+    if (stats)
+    {
+        stats->instancesTested += tested;
+        stats->instancesVisible += found;
+    }
+    return found;
+}
+
+size_t MBESpatialIndexQuerySphere(const MBESpatialIndex *index,
+                                  const float center[3],
+                                  float radius,
+                                  uint32_t *objectIDs,
+                                  size_t capacity)
+{
+    size_t found = 0;
+    auto nodeTest = [&](const Box &box)
+    {
+        return (SquaredDistanceToBox(center, box) <= radius * radius) ? Intersecting : Outside;
+    };
+    auto visit = [&](uint32_t objectID, bool)
+    {
+        if (found < capacity && SpheresIntersect(index->objects[objectID].sphere, center, radius))
+        {
+            objectIDs[found++] = objectID;
+        }
+    };
+    index->traverse(0, 0, 0, false, nodeTest, visit);
+
+    std::sort(objectIDs, objectIDs + found);
+    return found;
+}
+
+bool MBESpatialIndexIntersectRay(const MBESpatialIndex *index,
+                                 const float origin[3],
+                                 const float direction[3],
+                                 float maxDistance,
+                                 uint32_t *objectID,
+                                 float *distance)
+{
+    const float length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    if (length == 0)
+    {
+        return false;
+    }
+
+    const float unitDirection[3] = { direction[0] / length, direction[1] / length, direction[2] / length };
+    const float inverseDirection[3] = { 1 / unitDirection[0], 1 / unitDirection[1], 1 / unitDirection[2] };
+
+    // Boxes beyond the nearest hit so far are skipped, so the search narrows as it goes
+    float nearest = maxDistance;
+    bool hit = false;
+    auto nodeTest = [&](const Box &box)
+    {
+        return RayBox(origin, inverseDirection, box, nearest) ? Intersecting : Outside;
+    };
+    auto visit = [&](uint32_t candidate, bool)
+    {
+        const float t = RaySphere(origin, unitDirection, index->objects[candidate].sphere);
+        if (t >= 0 && t <= nearest && (!hit || t < nearest || candidate < *objectID))
+        {
+            nearest = t;
+            *objectID = candidate;
+            hit = true;
+        }
+    };
+    index->traverse(0, 0, 0, false, nodeTest, visit);
+
+    if (hit)
+    {
+        *distance = nearest;
+    }
+    return hit;
+}
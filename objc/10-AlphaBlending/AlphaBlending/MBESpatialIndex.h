@@ -0,0 +1,75 @@
+#pragma once
+
+#include "MBECulling.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that the renderers, written in plain Objective-C, can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// A loose quadtree over the XZ plane that indexes objects by their bounding spheres, so that the
+/// objects near a point, inside a view frustum or along a ray can be found without visiting them all.
+/// Each object lives in the deepest node whose loose bounds (its cell, grown by half a cell on every
+/// side) are guaranteed to contain its sphere, which makes moving an object cheap: most moves stay
+/// within the same node, and the rest are a removal and an insertion.
+///
+/// Objects are identified by caller-chosen ids, typically their index in the caller's instance array.
+/// An index may be used from one thread at a time.
+typedef struct MBESpatialIndex MBESpatialIndex;
+
+/// Creates an empty index over the rectangle [minX, maxX] x [minZ, maxZ], subdivided `depth` times.
+/// Objects whose centers lie outside the rectangle are still indexed, but are visited by every query.
+MBESpatialIndex *MBESpatialIndexCreate(float minX, float maxX, float minZ, float maxZ, unsigned depth);
+void MBESpatialIndexDestroy(MBESpatialIndex *index);
+
+/// The number of objects in the index
+size_t MBESpatialIndexGetCount(const MBESpatialIndex *index);
+
+/// Replaces the contents of the index with `count` objects whose ids are 0 ..< count. This is faster than
+/// inserting the objects one at a time, and suits props that never move.
+void MBESpatialIndexBuild(MBESpatialIndex *index, const MBEBoundingSphere *spheres, size_t count);
+
+/// Adds the object `objectID`, or moves it if it is already in the index
+void MBESpatialIndexInsert(MBESpatialIndex *index, uint32_t objectID, MBEBoundingSphere sphere);
+
+/// Moves the objects 0 ..< count to new bounds, adding any that are not yet indexed. Suits agents that
+/// move every frame.
+void MBESpatialIndexUpdate(MBESpatialIndex *index, const MBEBoundingSphere *spheres, size_t count);
+
+/// Removes the object `objectID`, if it is in the index
+void MBESpatialIndexRemove(MBESpatialIndex *index, uint32_t objectID);
+
+/// Finds the objects whose spheres intersect the frustum and writes up to `capacity` of their ids to
+/// `objectIDs`, in ascending order. Returns the number written. If `stats` is not null, the number of
+/// spheres tested individually and the number found are added to it.
+size_t MBESpatialIndexQueryFrustum(const MBESpatialIndex *index,
+                                   const MBEFrustum *frustum,
+                                   uint32_t *objectIDs,
+                                   size_t capacity,
+                                   MBECullingStats *stats);
+
+/// Finds the objects whose spheres intersect the sphere at `center` with `radius`, and writes up to
+/// `capacity` of their ids to `objectIDs`, in ascending order. Returns the number written.
+size_t MBESpatialIndexQuerySphere(const MBESpatialIndex *index,
+                                  const float center[3],
+                                  float radius,
+                                  uint32_t *objectIDs,
+                                  size_t capacity);
+
+/// Finds the nearest object whose sphere the ray from `origin` along `direction` (which need not be unit
+/// length) enters within `maxDistance` units. Returns false if there is none.
+bool MBESpatialIndexIntersectRay(const MBESpatialIndex *index,
+                                 const float origin[3],
+                                 const float direction[3],
+                                 float maxDistance,
+                                 uint32_t *objectID,
+                                 float *distance);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,21 @@
+#import "MBEMesh.h"
+@import simd;
+
+/// One square piece of an MBETerrainMesh. Each chunk has its own vertex buffer, laid out as a grid
+/// in row-major order, so it can be indexed with 16-bit indices however large the terrain is. All
+/// chunks of a terrain share one index buffer, which holds every level of detail; the first
+/// `indexCount` indices draw the chunk at full detail.
+@interface MBETerrainChunk : MBEMesh
+
+- (instancetype)initWithVertexBuffer:(id<MTLBuffer>)vertexBuffer
+                         indexBuffer:(id<MTLBuffer>)indexBuffer
+                           indexType:(MTLIndexType)indexType
+                          indexCount:(NSUInteger)indexCount
+                           boundsMin:(vector_float3)boundsMin
+                           boundsMax:(vector_float3)boundsMax;
+
+/// The corners of the axis-aligned box that encloses the chunk's vertices
+@property (nonatomic, readonly) vector_float3 boundsMin;
+@property (nonatomic, readonly) vector_float3 boundsMax;
+
+@end
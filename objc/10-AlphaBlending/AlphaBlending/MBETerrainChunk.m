@@ -0,0 +1,29 @@
+#import "MBETerrainChunk.h"
+
+@implementation MBETerrainChunk
+
+@synthesize vertexBuffer=_vertexBuffer;
+@synthesize indexBuffer=_indexBuffer;
+@synthesize indexType=_indexType;
+@synthesize indexCount=_indexCount;
+
+- (instancetype)initWithVertexBuffer:(id<MTLBuffer>)vertexBuffer
+                         indexBuffer:(id<MTLBuffer>)indexBuffer
+                           indexType:(MTLIndexType)indexType
+                          indexCount:(NSUInteger)indexCount
+                           boundsMin:(vector_float3)boundsMin
+                           boundsMax:(vector_float3)boundsMax
+{
+    if ((self = [super init]))
+    {
+        _vertexBuffer = vertexBuffer;
+        _indexBuffer = indexBuffer;
+        _indexType = indexType;
+        _indexCount = indexCount;
+        _boundsMin = boundsMin;
+        _boundsMax = boundsMax;
+    }
+    return self;
+}
+
+@end
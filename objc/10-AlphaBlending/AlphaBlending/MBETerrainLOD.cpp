@@ -0,0 +1,249 @@
+#include "MBETerrainLOD.h"
+#include "MBEMeshOptimizer.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+
+MBETerrainLOD::MBETerrainLOD(const MBEHeightfield &heightfield, size_t chunkSize, float spacing, float verticalScale) :
+    _chunkSize(chunkSize),
+    _chunksPerEdge((heightfield.stride() - 1) / chunkSize),
+    _levelCount(1),
+    _spacing(spacing),
+    _origin(-0.5f * (heightfield.stride() - 1) * spacing)
+{
+    while (((size_t)1 << _levelCount) <= chunkSize)
+    {
+        ++_levelCount;
+    }
+
+    buildIndices();
+    computeErrors(heightfield, verticalScale);
+}
+
+MBETerrainIndexRange MBETerrainLOD::levelRange(size_t level) const
+{
+    MBETerrainIndexRange range = _interiorRanges[level];
+    range.count += borderRange(level, 0).count;
+    return range;
+}
+
+void MBETerrainLOD::buildIndices()
+{
+    const size_t chunkStride = _chunkSize + 1;
+    const size_t vertexCount = chunkStride * chunkStride;
+
+    _interiorRanges.resize(_levelCount);
+    _borderRanges.resize(_levelCount * 16);
+
+    for (size_t level = 0; level < _levelCount; ++level)
+    {
+        const size_t quadsPerEdge = _chunkSize >> level;
+
+        for (int part = -1; part < 16; ++part)
+        {
+            // A chunk that is a single quad is already as coarse as it gets, so it never has a coarser
+            // neighbor to stitch to
+            if (part > 0 && quadsPerEdge == 1)
+            {
+                _borderRanges[level * 16 + part] = _borderRanges[level * 16];
+                continue;
+            }
+
+            MBETerrainIndexRange range = { _indices.size(), 0 };
+            appendLevelTriangles(level, part < 0, (part < 0) ? 0 : (uint8_t)part);
+            range.count = _indices.size() - range.offset;
+
+            if (range.count > 0)
+            {
+                MBEOptimizeVertexCacheUInt32(&_indices[range.offset], range.count, vertexCount);
+            }
+
+            if (part < 0)
+            {
+                _interiorRanges[level] = range;
+            }
+            else
+            {
+                _borderRanges[level * 16 + part] = range;
+            }
+        }
+    }
+}
+
+void MBETerrainLOD::appendLevelTriangles(size_t level, bool interior, uint8_t stitchMask)
+{
+    const size_t chunkStride = _chunkSize + 1;
+    const size_t step = (size_t)1 << level;
+    const size_t n = _chunkSize >> level;
+
+    // Maps a vertex of this level's grid to a chunk vertex. On a stitched side, odd vertices are moved onto
+    // their even neighbor, which leaves only the vertices the coarser level has along that side. With the
+    // diagonal this grid uses, the triangles that collapse are exactly those that become degenerate.
+    auto vertex = [&](size_t i, size_t j) -> uint32_t
+    {
+        if ((i == 0 && (stitchMask & MBETerrainSideNorth)) || (i == n && (stitchMask & MBETerrainSideSouth)))
+        {
+            j &= ~(size_t)1;
+        }
+        if ((j == 0 && (stitchMask & MBETerrainSideWest)) || (j == n && (stitchMask & MBETerrainSideEast)))
+        {
+            i &= ~(size_t)1;
+        }
+        return (uint32_t)(i * step * chunkStride + j * step);
+    };
+
+    auto appendTriangle = [&](uint32_t a, uint32_t b, uint32_t c)
+    {
+        if (a != b && b != c && c != a)
+        {
+            _indices.push_back(a);
+            _indices.push_back(b);
+            _indices.push_back(c);
+        }
+    };
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        for (size_t j = 0; j < n; ++j)
+        {
+            const bool isBorder = (i == 0 || j == 0 || i == n - 1 || j == n - 1);
+            if (isBorder == interior)
+            {
+                continue;
+            }
+
+            appendTriangle(vertex(i, j), vertex(i + 1, j), vertex(i + 1, j + 1));
+            appendTriangle(vertex(i + 1, j + 1), vertex(i, j + 1), vertex(i, j));
+        }
+    }
+}
+
+void MBETerrainLOD::computeErrors(const MBEHeightfield &heightfield, float verticalScale)
+{
+    const size_t chunkCount = this->chunkCount();
+    _errors.assign(chunkCount * _levelCount, 0.0f);
+    _minHeights.resize(chunkCount);
+    _maxHeights.resize(chunkCount);
+
+    MBEThreadPool::sharedPool().parallelFor(chunkCount, [&](size_t chunk)
+    {
+        const size_t firstRow = (chunk / _chunksPerEdge) * _chunkSize;
+        const size_t firstColumn = (chunk % _chunksPerEdge) * _chunkSize;
+        auto height = [&](size_t r, size_t c) { return heightfield.height(firstRow + r, firstColumn + c); };
+
+        float minHeight = INFINITY;
+        float maxHeight = -INFINITY;
+        for (size_t r = 0; r <= _chunkSize; ++r)
+        {
+            for (size_t c = 0; c <= _chunkSize; ++c)
+            {
+                minHeight = std::min(minHeight, height(r, c));
+                maxHeight = std::max(maxHeight, height(r, c));
+            }
+        }
+        _minHeights[chunk] = std::min(minHeight * verticalScale, maxHeight * verticalScale);
+        _maxHeights[chunk] = std::max(minHeight * verticalScale, maxHeight * verticalScale);
+
+        float *errors = &_errors[chunk * _levelCount];
+        for (size_t level = 1; level < _levelCount; ++level)
+        {
+            const size_t step = (size_t)1 << level;
+            const size_t n = _chunkSize >> level;
+
+            // Compare every full-detail sample with the triangle of this level that covers it
+            float maxError = 0;
+            for (size_t r = 0; r <= _chunkSize; ++r)
+            {
+                const size_t i = std::min(r / step, n - 1);
+                const float dr = (float)(r - i * step) / step;
+                for (size_t c = 0; c <= _chunkSize; ++c)
+                {
+                    const size_t j = std::min(c / step, n - 1);
+                    const float dc = (float)(c - j * step) / step;
+
+                    const float h00 = height(i * step, j * step);
+                    const float h01 = height(i * step, (j + 1) * step);
+                    const float h10 = height((i + 1) * step, j * step);
+                    const float h11 = height((i + 1) * step, (j + 1) * step);
+                    const float approximation = (dr >= dc) ? h00 + dr * (h10 - h00) + dc * (h11 - h10)
+                                                           : h00 + dc * (h01 - h00) + dr * (h11 - h01);
+
+                    maxError = std::max(maxError, fabsf(height(r, c) - approximation));
+                }
+            }
+
+            errors[level] = std::max(maxError * fabsf(verticalScale), errors[level - 1]);
+        }
+    });
+}
+
+size_t MBETerrainLOD::selectLevels(const float cameraPosition[3], float projectionScale, float pixelTolerance,
+                                   std::vector<MBETerrainChunkLOD> &selection) const
+{
+    const size_t chunkCount = this->chunkCount();
+    const float chunkExtent = _chunkSize * _spacing;
+    selection.resize(chunkCount);
+
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        const float minX = _origin + (chunk % _chunksPerEdge) * chunkExtent;
+        const float minZ = _origin + (chunk / _chunksPerEdge) * chunkExtent;
+
+        // Distance from the camera to the nearest point of the chunk's bounding box
+        const float dx = std::max(std::max(minX - cameraPosition[0], cameraPosition[0] - (minX + chunkExtent)), 0.0f);
+        const float dy = std::max(std::max(_minHeights[chunk] - cameraPosition[1], cameraPosition[1] - _maxHeights[chunk]), 0.0f);
+        const float dz = std::max(std::max(minZ - cameraPosition[2], cameraPosition[2] - (minZ + chunkExtent)), 0.0f);
+        const float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+        size_t level = _levelCount - 1;
+        while (level > 0 && geometricError(chunk, level) * projectionScale > pixelTolerance * distance)
+        {
+            --level;
+        }
+        selection[chunk].level = (uint8_t)level;
+        selection[chunk].stitchMask = 0;
+    }
+
+    // Refine any chunk more than one level coarser than a neighbor. Refining only ever lowers levels,
+    // so this settles after at most levelCount sweeps.
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            const size_t row = chunk / _chunksPerEdge;
+            const size_t column = chunk % _chunksPerEdge;
+            uint8_t level = selection[chunk].level;
+            if (row > 0) level = std::min<uint8_t>(level, selection[chunk - _chunksPerEdge].level + 1);
+            if (row + 1 < _chunksPerEdge) level = std::min<uint8_t>(level, selection[chunk + _chunksPerEdge].level + 1);
+            if (column > 0) level = std::min<uint8_t>(level, selection[chunk - 1].level + 1);
+            if (column + 1 < _chunksPerEdge) level = std::min<uint8_t>(level, selection[chunk + 1].level + 1);
+            if (level != selection[chunk].level)
+            {
+                selection[chunk].level = level;
+                changed = true;
+            }
+        }
+    }
+
+    size_t triangleCount = 0;
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+    {
+        const size_t row = chunk / _chunksPerEdge;
+        const size_t column = chunk % _chunksPerEdge;
+        const uint8_t level = selection[chunk].level;
+
+        uint8_t stitchMask = 0;
+        if (row > 0 && selection[chunk - _chunksPerEdge].level > level) stitchMask |= MBETerrainSideNorth;
+        if (row + 1 < _chunksPerEdge && selection[chunk + _chunksPerEdge].level > level) stitchMask |= MBETerrainSideSouth;
+        if (column > 0 && selection[chunk - 1].level > level) stitchMask |= MBETerrainSideWest;
+        if (column + 1 < _chunksPerEdge && selection[chunk + 1].level > level) stitchMask |= MBETerrainSideEast;
+        selection[chunk].stitchMask = stitchMask;
+
+        triangleCount += (interiorRange(level).count + borderRange(level, stitchMask).count) / 3;
+    }
+
+    return triangleCount;
+}
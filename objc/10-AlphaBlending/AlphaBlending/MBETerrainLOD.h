@@ -0,0 +1,89 @@
+#pragma once
+
+#include "MBEHeightfield.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// The sides of a terrain chunk, used as bits of a stitch mask. North is the chunk's first row and
+/// west is its first column.
+enum MBETerrainSide : uint8_t
+{
+    MBETerrainSideNorth = 1 << 0,
+    MBETerrainSideEast = 1 << 1,
+    MBETerrainSideSouth = 1 << 2,
+    MBETerrainSideWest = 1 << 3,
+};
+
+/// A run of triangles in MBETerrainLOD::indices(), in indices
+struct MBETerrainIndexRange
+{
+    size_t offset;
+    size_t count;
+};
+
+/// The level of detail chosen for a chunk. Sides in `stitchMask` border a chunk one level coarser,
+/// and drop every other vertex along that side so that the two chunks share the same edge.
+struct MBETerrainChunkLOD
+{
+    uint8_t level;
+    uint8_t stitchMask;
+};
+
+/// Levels of detail for a heightfield that is drawn as square chunks, laid out as MBETerrainMesh lays
+/// them out: centered on the origin, with `spacing` between samples and heights multiplied by
+/// `verticalScale`.
+///
+/// Level L of a chunk uses every 2^L-th sample of the full-detail grid, so all levels index the same
+/// chunk vertices. Each level is split into an interior, which never changes, and a border ring, which
+/// has a variant for each of the 16 stitch masks. A level's interior is immediately followed by its
+/// unstitched border, so the pair can be drawn as one range.
+///
+/// Nothing here touches the GPU: selection is a pure function of the camera and the precomputed errors.
+class MBETerrainLOD
+{
+public:
+    MBETerrainLOD(const MBEHeightfield &heightfield, size_t chunkSize, float spacing, float verticalScale);
+
+    size_t levelCount() const { return _levelCount; }
+    size_t chunksPerEdge() const { return _chunksPerEdge; }
+    size_t chunkCount() const { return _chunksPerEdge * _chunksPerEdge; }
+
+    /// The triangles of every level, as indices into a chunk's (chunkSize + 1)^2 vertices in row-major order
+    const std::vector<uint32_t> &indices() const { return _indices; }
+
+    /// The whole of a level, without stitching
+    MBETerrainIndexRange levelRange(size_t level) const;
+    MBETerrainIndexRange interiorRange(size_t level) const { return _interiorRanges[level]; }
+    MBETerrainIndexRange borderRange(size_t level, uint8_t stitchMask) const { return _borderRanges[level * 16 + stitchMask]; }
+
+    /// The largest vertical distance, in world units, between a chunk drawn at `level` and at full detail.
+    /// Errors never decrease from one level to the next.
+    float geometricError(size_t chunk, size_t level) const { return _errors[chunk * _levelCount + level]; }
+
+    /// Chooses the coarsest level for each chunk whose geometric error projects to no more than
+    /// `pixelTolerance` pixels, then refines chunks until no two neighbors differ by more than one level.
+    /// `projectionScale` is the viewport height in pixels divided by 2 tan(fovy / 2). Returns the number
+    /// of triangles the selection draws.
+    size_t selectLevels(const float cameraPosition[3], float projectionScale, float pixelTolerance,
+                        std::vector<MBETerrainChunkLOD> &selection) const;
+
+private:
+    void buildIndices();
+    void appendLevelTriangles(size_t level, bool interior, uint8_t stitchMask);
+    void computeErrors(const MBEHeightfield &heightfield, float verticalScale);
+
+    size_t _chunkSize;
+    size_t _chunksPerEdge;
+    size_t _levelCount;
+    float _spacing;
+    float _origin; // world x and z of the heightfield's first sample
+
+    std::vector<uint32_t> _indices;
+    std::vector<MBETerrainIndexRange> _interiorRanges;
+    std::vector<MBETerrainIndexRange> _borderRanges;
+    std::vector<float> _errors;
+    std::vector<float> _minHeights;
+    std::vector<float> _maxHeights;
+};
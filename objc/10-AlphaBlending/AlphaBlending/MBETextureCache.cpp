@@ -0,0 +1,255 @@
+#include "MBETextureCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+    const char Magic[8] = { 'M', 'B', 'E', 'T', 'E', 'X', 'R', '\0' };
+
+    // Bump whenever the layout of the header or the level table changes
+    const uint32_t FormatVersion = 1;
+
+    // Enough for a 2^31 x 2^31 image, which keeps a corrupt level count from reserving huge tables
+    const uint32_t MaxLevelCount = 32;
+
+    struct MBETextureCacheHeader
+    {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t builderVersion;
+        uint64_t sourceHash;
+        uint64_t sourceLength;
+        uint32_t pixelFormat;
+        uint32_t flags;
+        uint32_t bytesPerPixel;
+        uint32_t levelCount;
+        uint64_t fileLength;
+    };
+
+    struct MBETextureCacheLevelEntry
+    {
+        uint64_t offset;
+        uint32_t width;
+        uint32_t height;
+        uint64_t bytesPerRow;
+    };
+
+    static_assert(sizeof(MBETextureCacheHeader) == 56, "Texture cache header must not contain padding");
+    static_assert(sizeof(MBETextureCacheLevelEntry) == 24, "Texture cache level entry must not contain padding");
+
+    size_t AlignUp(size_t offset, size_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // True if [offset, offset + length) lies within a file of `fileLength` bytes, without overflowing
+    bool RangeIsValid(uint64_t offset, uint64_t length, uint64_t fileLength)
+    {
+        return offset <= fileLength && length <= fileLength - offset;
+    }
+
+    // True if a level has the size that level `index` of a chain starting at `width` x `height` must have
+    bool IsMipmapOfSize(uint32_t levelWidth, uint32_t levelHeight, uint32_t index, uint32_t width, uint32_t height)
+    {
+        return levelWidth == std::max(width >> index, 1u) && levelHeight == std::max(height >> index, 1u);
+    }
+
+    bool WriteBytes(FILE *file, const void *bytes, size_t length)
+    {
+        return length == 0 || fwrite(bytes, 1, length, file) == length;
+    }
+
+    bool WritePadding(FILE *file, size_t from, size_t to)
+    {
+        static const uint8_t zeros[256] = { 0 };
+        while (from < to)
+        {
+            size_t chunk = std::min(to - from, sizeof(zeros));
+            if (!WriteBytes(file, zeros, chunk))
+            {
+                return false;
+            }
+            from += chunk;
+        }
+        return true;
+    }
+}
+
+MBETextureCache::MBETextureCache(const char *path) :
+    _file(path),
+    _bytesPerPixel(0)
+{
+}
+
+std::shared_ptr<MBETextureCache> MBETextureCache::open(const char *path, const MBETextureCacheKey &key)
+{
+    std::shared_ptr<MBETextureCache> cache(new MBETextureCache(path));
+    if (!cache->validate(key))
+    {
+        return nullptr;
+    }
+    return cache;
+}
+
+bool MBETextureCache::validate(const MBETextureCacheKey &key)
+{
+    if (!_file.isValid() || _file.length() < sizeof(MBETextureCacheHeader))
+    {
+        return false;
+    }
+
+    const uint8_t *base = _file.bytes();
+    const uint64_t fileLength = _file.length();
+
+    MBETextureCacheHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    if (memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+        header.formatVersion != FormatVersion ||
+        header.fileLength != fileLength)
+    {
+        return false;
+    }
+
+    if (header.builderVersion != key.builderVersion ||
+        header.sourceHash != key.sourceHash ||
+        header.sourceLength != key.sourceLength ||
+        header.pixelFormat != key.pixelFormat ||
+        header.flags != key.flags)
+    {
+        return false;
+    }
+
+    const uint64_t tableOffset = sizeof(MBETextureCacheHeader);
+    if (header.bytesPerPixel == 0 || header.bytesPerPixel > 16 ||
+        header.levelCount == 0 || header.levelCount > MaxLevelCount ||
+        !RangeIsValid(tableOffset, (uint64_t)header.levelCount * sizeof(MBETextureCacheLevelEntry), fileLength))
+    {
+        return false;
+    }
+
+    _levels.resize(header.levelCount);
+    for (uint32_t i = 0; i < header.levelCount; ++i)
+    {
+        MBETextureCacheLevelEntry entry;
+        memcpy(&entry, base + tableOffset + i * sizeof(MBETextureCacheLevelEntry), sizeof(entry));
+
+        const uint32_t width = (i == 0) ? entry.width : _levels[0].width;
+        const uint32_t height = (i == 0) ? entry.height : _levels[0].height;
+
+        // Dimensions are 32-bit and rows are bounded by the file length, so the level size can't overflow
+        if (entry.width == 0 || entry.height == 0 ||
+            !IsMipmapOfSize(entry.width, entry.height, i, width, height) ||
+            entry.bytesPerRow < (uint64_t)entry.width * header.bytesPerPixel || entry.bytesPerRow > fileLength ||
+            !RangeIsValid(entry.offset, entry.bytesPerRow * entry.height, fileLength) ||
+            entry.offset % MBETextureCacheLevelAlignment != 0)
+        {
+            _levels.clear();
+            return false;
+        }
+
+        MBETextureCacheLevel &level = _levels[i];
+        level.bytes = base + entry.offset;
+        level.width = entry.width;
+        level.height = entry.height;
+        level.bytesPerRow = (size_t)entry.bytesPerRow;
+    }
+
+    _bytesPerPixel = header.bytesPerPixel;
+    return true;
+}
+
+bool MBETextureCache::write(const char *path, const MBETextureCacheKey &key, uint32_t bytesPerPixel,
+                            const std::vector<MBETextureCacheLevel> &levels)
+{
+    if (levels.empty() || levels.size() > MaxLevelCount)
+    {
+        return false;
+    }
+
+    // Lay out the file up front: header, level table, then the aligned levels, with tightly packed rows
+    std::vector<MBETextureCacheLevelEntry> entries(levels.size());
+
+    size_t offset = sizeof(MBETextureCacheHeader) + levels.size() * sizeof(MBETextureCacheLevelEntry);
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        const MBETextureCacheLevel &level = levels[i];
+        if (!IsMipmapOfSize(level.width, level.height, (uint32_t)i, levels[0].width, levels[0].height) ||
+            level.width == 0 || level.height == 0)
+        {
+            return false;
+        }
+
+        MBETextureCacheLevelEntry &entry = entries[i];
+        offset = AlignUp(offset, MBETextureCacheLevelAlignment);
+        entry.offset = offset;
+        entry.width = level.width;
+        entry.height = level.height;
+        entry.bytesPerRow = (uint64_t)level.width * bytesPerPixel;
+        offset += entry.bytesPerRow * level.height;
+    }
+
+    const size_t fileLength = offset;
+
+    MBETextureCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.formatVersion = FormatVersion;
+    header.builderVersion = key.builderVersion;
+    header.sourceHash = key.sourceHash;
+    header.sourceLength = key.sourceLength;
+    header.pixelFormat = key.pixelFormat;
+    header.flags = key.flags;
+    header.bytesPerPixel = bytesPerPixel;
+    header.levelCount = (uint32_t)levels.size();
+    header.fileLength = fileLength;
+
+    // Every writer gets a temporary file of its own, even for the same key in the same process, so the
+    // file that's renamed into place can only ever hold one writer's data
+    std::string temporaryPath = std::string(path) + ".tmp.XXXXXX";
+    int descriptor = mkstemp(&temporaryPath[0]);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+
+    FILE *file = fdopen(descriptor, "wb");
+    if (!file)
+    {
+        close(descriptor);
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+
+    bool ok = WriteBytes(file, &header, sizeof(header)) &&
+              WriteBytes(file, entries.data(), entries.size() * sizeof(MBETextureCacheLevelEntry));
+
+    size_t written = sizeof(header) + entries.size() * sizeof(MBETextureCacheLevelEntry);
+    for (size_t i = 0; ok && i < levels.size(); ++i)
+    {
+        const MBETextureCacheLevel &level = levels[i];
+        const MBETextureCacheLevelEntry &entry = entries[i];
+
+        ok = WritePadding(file, written, entry.offset);
+        for (uint32_t row = 0; ok && row < level.height; ++row)
+        {
+            ok = WriteBytes(file, (const uint8_t *)level.bytes + row * level.bytesPerRow, entry.bytesPerRow);
+        }
+        written = entry.offset + entry.bytesPerRow * level.height;
+    }
+
+    ok = (fclose(file) == 0) && ok;
+
+    if (!ok || rename(temporaryPath.c_str(), path) != 0)
+    {
+        unlink(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,360 @@
+// Checks the asset pipeline on the host, with the GPU replaced by a stub whose uploads take time in
+// proportion to their size and fail for chosen assets. The assets form a graph like a scene's: textures
+// and meshes with no dependencies, materials that use textures, models that use a mesh and a material,
+// and scenes that use several models. A few uploads fail.
+//
+// The check fails unless every asset loads only after each of its dependencies has completed, every
+// asset downstream of a failure completes as failed without loading, every other asset loads, each
+// completion runs exactly once and on the owning thread, and the bytes in flight stay within budget.
+//
+// usage: MBEAssetPipelineCheck [workers]
+
+#include "MBEAssetPipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const size_t MBEMegabyte = 1024 * 1024;
+
+int MBEFailureCount = 0;
+
+void MBECheck(bool condition, const char *description)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", description);
+        ++MBEFailureCount;
+    }
+}
+
+/// Stands in for the device: an upload takes a microsecond per 4 KB, and fails for the assets it is
+/// told to fail
+class MBEStubDevice
+{
+public:
+    explicit MBEStubDevice(const std::set<std::string> &failingAssets) : _failingAssets(failingAssets) {}
+
+    bool upload(const std::string &name, size_t bytes)
+    {
+        std::this_thread::sleep_for(std::chrono::microseconds(bytes / 4096));
+        return _failingAssets.count(name) == 0;
+    }
+
+private:
+    std::set<std::string> _failingAssets;
+};
+
+/// What happened to an asset, recorded by its load and completion. Times are taken from one counter
+/// shared by every event, so they order events across threads.
+struct MBEAssetRecord
+{
+    std::string name;
+    size_t bytes;
+    std::vector<size_t> dependencies; // indices into the records
+    std::atomic<int> loadCount;
+    std::atomic<int> loadTime;
+    int completeCount;
+    int completeTime;
+    bool loaded;
+    bool completedOnOwningThread;
+};
+
+/// Runs a graph of assets through a pipeline and checks the order and outcome of every load and completion
+class MBEAssetGraph
+{
+public:
+    MBEAssetGraph(unsigned workerCount, size_t maxBytesInFlight, const std::set<std::string> &failingAssets)
+    : _device(failingAssets), _pipeline(workerCount, maxBytesInFlight), _maxBytesInFlight(maxBytesInFlight),
+      _clock(0), _bytesInFlight(0), _overBudget(false),
+      _owningThread(std::this_thread::get_id()), _failingAssets(failingAssets)
+    {
+    }
+
+    /// Adds an asset whose load uploads `bytes`, and returns its index in the records
+    size_t add(const std::string &name, size_t bytes, const std::vector<size_t> &dependencies)
+    {
+        _records.emplace_back();
+        const size_t index = _records.size() - 1;
+        MBEAssetRecord &record = _records.back();
+        record.name = name;
+        record.bytes = bytes;
+        record.dependencies = dependencies;
+        record.loadCount = 0;
+        record.loadTime = -1;
+        record.completeCount = 0;
+        record.completeTime = -1;
+        record.loaded = false;
+        record.completedOnOwningThread = true;
+
+        std::vector<MBEAssetPipeline::AssetID> dependencyIDs;
+        for (size_t dependency : dependencies)
+        {
+            dependencyIDs.push_back(_assetIDs[dependency]);
+        }
+
+        // Workers get the record itself, since the deque may be growing on this thread as they run
+        MBEAssetRecord *recordPointer = &record;
+        _assetIDs.push_back(_pipeline.add(bytes, dependencyIDs,
+                                          [this, recordPointer]() { return load(*recordPointer); },
+                                          [this, recordPointer](bool loaded) { complete(*recordPointer, loaded); }));
+        return index;
+    }
+
+    MBEAssetPipeline &pipeline() { return _pipeline; }
+
+    /// Checks every asset's record against what its dependencies and the failing uploads imply
+    void checkOutcomes(const char *context)
+    {
+        size_t loadedCount = 0, failedCount = 0, skippedCount = 0, largestBytes = 0;
+        bool isOrdered = true, isSkipped = true, isLoaded = true, isCompletedOnce = true, isOnOwningThread = true;
+        for (MBEAssetRecord &record : _records)
+        {
+            bool dependenciesLoaded = true;
+            for (size_t dependency : record.dependencies)
+            {
+                const MBEAssetRecord &dependencyRecord = _records[dependency];
+                dependenciesLoaded = dependenciesLoaded && dependencyRecord.loaded;
+                isOrdered = isOrdered && (record.loadCount == 0 || dependencyRecord.completeTime < record.loadTime);
+            }
+
+            const bool shouldLoad = dependenciesLoaded && _failingAssets.count(record.name) == 0;
+            isSkipped = isSkipped && (record.loadCount == (dependenciesLoaded ? 1 : 0));
+            isLoaded = isLoaded && (record.loaded == shouldLoad);
+            isCompletedOnce = isCompletedOnce && record.completeCount == 1;
+            isOnOwningThread = isOnOwningThread && record.completedOnOwningThread;
+
+            largestBytes = std::max(largestBytes, record.bytes);
+            loadedCount += record.loaded;
+            failedCount += (dependenciesLoaded && !record.loaded);
+            skippedCount += !dependenciesLoaded;
+        }
+
+        std::string description = std::string(context) + ": no asset loads before its dependencies have completed";
+        MBECheck(isOrdered, description.c_str());
+        description = std::string(context) + ": assets with a failed dependency are never loaded, and the rest load once";
+        MBECheck(isSkipped, description.c_str());
+        description = std::string(context) + ": an asset is loaded exactly when it and all of its dependencies are";
+        MBECheck(isLoaded, description.c_str());
+        description = std::string(context) + ": every completion runs exactly once";
+        MBECheck(isCompletedOnce, description.c_str());
+        description = std::string(context) + ": completions run on the thread that owns the pipeline";
+        MBECheck(isOnOwningThread, description.c_str());
+        description = std::string(context) + ": bytes in flight stay within the budget";
+        MBECheck(!_overBudget && _pipeline.peakBytesInFlight() <= std::max(_maxBytesInFlight, largestBytes),
+                 description.c_str());
+        description = std::string(context) + ": no bytes are in flight once the pipeline is idle";
+        MBECheck(_pipeline.isIdle() && _pipeline.bytesInFlight() == 0 && _bytesInFlight == 0, description.c_str());
+
+        std::printf("%s: %zu assets, %zu loaded, %zu failed, %zu skipped for a failed dependency, peak %.1f MB in flight\n",
+                    context, _records.size(), loadedCount, failedCount, skippedCount,
+                    (double)_pipeline.peakBytesInFlight() / MBEMegabyte);
+    }
+
+private:
+    bool load(MBEAssetRecord &record)
+    {
+        record.loadTime = _clock++;
+        ++record.loadCount;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bytesInFlight += record.bytes;
+            // An asset larger than the budget may load, but only alone
+            _overBudget = _overBudget || (_bytesInFlight > _maxBytesInFlight && _bytesInFlight != record.bytes);
+        }
+        return _device.upload(record.name, record.bytes);
+    }
+
+    void complete(MBEAssetRecord &record, bool loaded)
+    {
+        record.completeTime = _clock++;
+        ++record.completeCount;
+        record.loaded = loaded;
+        record.completedOnOwningThread = (std::this_thread::get_id() == _owningThread);
+        if (record.loadCount > 0)
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bytesInFlight -= record.bytes;
+        }
+    }
+
+    MBEStubDevice _device;
+    MBEAssetPipeline _pipeline;
+    size_t _maxBytesInFlight;
+    std::deque<MBEAssetRecord> _records;
+    std::vector<MBEAssetPipeline::AssetID> _assetIDs;
+    std::atomic<int> _clock;
+    std::mutex _mutex;
+    size_t _bytesInFlight;
+    bool _overBudget;
+    std::thread::id _owningThread;
+    std::set<std::string> _failingAssets;
+};
+
+/// Picks `count` distinct indices from [first, first + range)
+std::vector<size_t> MBEPick(std::mt19937 &random, size_t first, size_t range, size_t count)
+{
+    std::vector<size_t> all(range);
+    for (size_t i = 0; i < range; ++i)
+    {
+        all[i] = first + i;
+    }
+    std::shuffle(all.begin(), all.end(), random);
+    all.resize(std::min(count, range));
+    return all;
+}
+
+/// A scene's worth of assets, some of whose uploads fail, loaded on `workerCount` threads
+void MBECheckScene(unsigned workerCount)
+{
+    const std::set<std::string> failingAssets = { "texture 3", "texture 17", "mesh 5", "material 8", "model 40" };
+    const size_t maxBytesInFlight = 24 * MBEMegabyte;
+    MBEAssetGraph graph(workerCount, maxBytesInFlight, failingAssets);
+    std::mt19937 random(1);
+
+    const size_t textureCount = 48, meshCount = 24, materialCount = 32, modelCount = 64, sceneCount = 6;
+    char name[32];
+    for (size_t i = 0; i < textureCount; ++i)
+    {
+        std::snprintf(name, sizeof(name), "texture %zu", i);
+        graph.add(name, (1 + i % 4) * MBEMegabyte, {});
+    }
+    for (size_t i = 0; i < meshCount; ++i)
+    {
+        std::snprintf(name, sizeof(name), "mesh %zu", i);
+        graph.add(name, (2 + i % 3) * MBEMegabyte, {});
+    }
+    const size_t firstMaterial = textureCount + meshCount;
+    for (size_t i = 0; i < materialCount; ++i)
+    {
+        std::snprintf(name, sizeof(name), "material %zu", i);
+        graph.add(name, 64 * 1024, MBEPick(random, 0, textureCount, 1 + i % 3));
+    }
+    const size_t firstModel = firstMaterial + materialCount;
+    for (size_t i = 0; i < modelCount; ++i)
+    {
+        std::snprintf(name, sizeof(name), "model %zu", i);
+        graph.add(name, 256 * 1024, { textureCount + random() % meshCount, firstMaterial + random() % materialCount });
+    }
+
+    const size_t firstScene = firstModel + modelCount;
+    for (size_t i = 0; i < sceneCount; ++i)
+    {
+        std::snprintf(name, sizeof(name), "scene %zu", i);
+        graph.add(name, 0, MBEPick(random, firstModel, modelCount, 4 + 4 * i));
+    }
+
+    // Completions run on this thread while loads are still going, then everything is drained
+    while (!graph.pipeline().isIdle())
+    {
+        graph.pipeline().runCompletions(8);
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    // Follow-ups to scenes that have already completed, as the renderer queues what a scene uncovers
+    for (size_t i = 0; i < sceneCount; ++i)
+    {
+        std::snprintf(name, sizeof(name), "follow-up %zu", i);
+        graph.add(name, MBEMegabyte, { firstScene + i });
+    }
+    graph.pipeline().waitUntilIdle();
+
+    char context[64];
+    std::snprintf(context, sizeof(context), "scene on %u workers", workerCount);
+    graph.checkOutcomes(context);
+}
+
+/// The edge cases: a dependency that failed before its dependent was added, a dependency id the
+/// pipeline never returned, an asset larger than the whole budget, and assets added from a completion
+void MBECheckEdgeCases()
+{
+    MBEAssetGraph graph(3, 4 * MBEMegabyte, { "broken" });
+
+    const size_t broken = graph.add("broken", MBEMegabyte, {});
+    graph.pipeline().waitUntilIdle();
+    graph.add("after broken", MBEMegabyte, { broken });
+    graph.add("huge", 16 * MBEMegabyte, {});
+    for (int i = 0; i < 8; ++i)
+    {
+        graph.add("small", MBEMegabyte, {});
+    }
+    graph.pipeline().waitUntilIdle();
+    graph.checkOutcomes("edge cases");
+
+    MBEAssetPipeline pipeline(1, MBEMegabyte);
+    bool isInvalidLoadCalled = false, isInvalidLoaded = true;
+    pipeline.add(0, { 7 }, [&] { isInvalidLoadCalled = true; return true; }, [&](bool loaded) { isInvalidLoaded = loaded; });
+    pipeline.waitUntilIdle();
+    MBECheck(!isInvalidLoadCalled && !isInvalidLoaded, "an asset that depends on an unknown id fails without loading");
+
+    // Assets that a completion adds are waited for too
+    int chainLength = 0;
+    std::function<void(bool)> extendChain = [&](bool)
+    {
+        if (++chainLength < 10)
+        {
+            pipeline.add(0, {}, nullptr, extendChain);
+        }
+    };
+    pipeline.add(0, {}, nullptr, extendChain);
+    pipeline.waitUntilIdle();
+    MBECheck(chainLength == 10, "waitUntilIdle waits for assets that completions add");
+}
+
+/// Destroying the pipeline waits for loads in progress and abandons the rest, without running completions.
+/// With no completions run, the first asset holds the whole budget, so no other can start.
+void MBECheckTeardown()
+{
+    std::atomic<int> loadCount(0);
+    int completeCount = 0;
+    {
+        MBEAssetPipeline pipeline(1, MBEMegabyte);
+        for (int i = 0; i < 20; ++i)
+        {
+            pipeline.add(MBEMegabyte, {},
+                         [&] { ++loadCount; std::this_thread::sleep_for(std::chrono::milliseconds(5)); return true; },
+                         [&](bool) { ++completeCount; });
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    MBECheck(loadCount == 1, "destroying the pipeline abandons assets that haven't started");
+    MBECheck(completeCount == 0, "destroying the pipeline runs no completions");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const unsigned workerCount = (argc > 1) ? (unsigned)std::atoi(argv[1]) : 4;
+    if (workerCount == 0)
+    {
+        std::fprintf(stderr, "usage: %s [workers, at least 1]\n", argv[0]);
+        return 1;
+    }
+
+    MBECheckScene(1);
+    MBECheckScene(workerCount);
+    MBECheckEdgeCases();
+    MBECheckTeardown();
+
+    if (MBEFailureCount > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", MBEFailureCount);
+        return 1;
+    }
+    std::printf("All asset pipeline checks passed\n");
+    return 0;
+}
@@ -0,0 +1,12 @@
+#!/bin/sh
+# Builds the host-side tools for this sample into ./build, with any C++11 compiler and POSIX threads.
+# The tools share their sources with the app, so they check exactly what ships.
+set -e
+cd "$(dirname "$0")"
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--O2}
+SOURCES=../AlphaBlending
+
+mkdir -p build
+$CXX -std=c++11 $CXXFLAGS -I$SOURCES -o build/MBEAssetPipelineCheck MBEAssetPipelineCheck.cpp $SOURCES/MBEAssetPipeline.cpp -lpthread
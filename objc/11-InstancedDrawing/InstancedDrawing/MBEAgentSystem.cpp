@@ -0,0 +1,187 @@
+#include "MBEAgentSystem.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// PerInstanceUniforms is written as raw floats: a 4x4 model matrix followed by a 3x3 normal matrix
+// whose columns are padded to four floats
+static_assert(sizeof(PerInstanceUniforms) == 28 * sizeof(float), "unexpected PerInstanceUniforms layout");
+
+namespace
+{
+    // Agents are updated in blocks of this many; each block is one task for the thread pool, and its
+    // temporaries stay in the L1 cache
+    const size_t MBEAgentBlockSize = 256;
+
+    const float MBEPi = 3.14159265358979f;
+
+    uint64_t mix(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    /// A uniformly distributed float in [0, 1) that depends only on its arguments
+    float unitRandom(uint64_t seed, uint64_t stream, uint64_t index)
+    {
+        const uint64_t z = mix(seed + 0x9e3779b97f4a7c15ULL * (mix(stream) ^ index));
+        return (float)(z >> 40) * (1.0f / 16777216.0f);
+    }
+
+    /// Computes sine and cosine of every angle in a block without branches or library calls, so that
+    /// the loop vectorizes. Angles are reduced to [-pi, pi], folded into [-pi/2, pi/2], and evaluated
+    /// with Taylor polynomials that are accurate to about 1e-7 there.
+    void sinCos(const float *angles, size_t count, float *sines, float *cosines)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            float x = angles[i];
+            x -= 2 * MBEPi * floorf(x * (0.5f / MBEPi) + 0.5f);
+
+            const float folded = (x > 0.5f * MBEPi) ? MBEPi - x : ((x < -0.5f * MBEPi) ? -MBEPi - x : x);
+            const float cosineSign = (folded == x) ? 1.0f : -1.0f;
+
+            const float x2 = folded * folded;
+            const float s = folded * (1 + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880 + x2 * (-1.0f / 39916800))))));
+            const float c = 1 + x2 * (-0.5f + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320 + x2 * (-1.0f / 3628800 + x2 * (1.0f / 479001600))))));
+
+            sines[i] = s;
+            cosines[i] = cosineSign * c;
+        }
+    }
+}
+
+struct MBEAgentSystem
+{
+    MBEAgentParameters parameters;
+    uint64_t seed;
+    uint64_t retargetCount;
+
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> heading;
+    std::vector<float> targetHeading;
+
+    void updateBlock(size_t first, size_t count, float timeStep, MBEAgentGroundFunction ground, void *groundContext,
+                     PerInstanceUniforms *uniforms);
+};
+
+MBEAgentSystem *MBEAgentSystemCreate(size_t agentCount, MBEAgentParameters parameters, uint64_t seed)
+{
+    MBEAgentSystem *system = new MBEAgentSystem;
+    system->parameters = parameters;
+    system->seed = seed;
+    system->retargetCount = 0;
+    system->x.resize(agentCount);
+    system->y.resize(agentCount);
+    system->z.resize(agentCount);
+    system->heading.resize(agentCount);
+    system->targetHeading.resize(agentCount);
+
+    const float centerX = 0.5f * (parameters.minX + parameters.maxX);
+    const float centerZ = 0.5f * (parameters.minZ + parameters.maxZ);
+    const float extentX = 0.8f * (parameters.maxX - parameters.minX);
+    const float extentZ = 0.8f * (parameters.maxZ - parameters.minZ);
+
+    for (size_t i = 0; i < agentCount; ++i)
+    {
+        system->x[i] = centerX + (unitRandom(seed, 0, i) - 0.5f) * extentX;
+        system->z[i] = centerZ + (unitRandom(seed, 1, i) - 0.5f) * extentZ;
+        system->heading[i] = 2 * MBEPi * unitRandom(seed, 2, i);
+        system->targetHeading[i] = system->heading[i];
+    }
+
+    return system;
+}
+
+void MBEAgentSystemDestroy(MBEAgentSystem *system)
+{
+    delete system;
+}
+
+size_t MBEAgentSystemGetCount(const MBEAgentSystem *system)
+{
+    return system->x.size();
+}
+
+void MBEAgentSystemRetarget(MBEAgentSystem *system)
+{
+    // Each retarget draws from its own stream, so results don't depend on how the work is divided
+    const uint64_t stream = 3 + system->retargetCount++;
+    const size_t agentCount = system->x.size();
+    for (size_t i = 0; i < agentCount; ++i)
+    {
+        system->targetHeading[i] = 2 * MBEPi * unitRandom(system->seed, stream, i);
+    }
+}
+
+void MBEAgentSystem::updateBlock(size_t first, size_t count, float timeStep, MBEAgentGroundFunction ground,
+                                 void *groundContext, PerInstanceUniforms *uniforms)
+{
+    float *xs = &x[first];
+    float *ys = &y[first];
+    float *zs = &z[first];
+    float *headings = &heading[first];
+    const float *targets = &targetHeading[first];
+
+    const float damping = parameters.turnDamping;
+    const float distance = parameters.speed * timeStep;
+
+    // Smooth between the current and intended direction
+    for (size_t i = 0; i < count; ++i)
+    {
+        headings[i] = damping * headings[i] + (1 - damping) * targets[i];
+    }
+
+    float sines[MBEAgentBlockSize];
+    float cosines[MBEAgentBlockSize];
+    sinCos(headings, count, sines, cosines);
+
+    // Walk forward, staying on the patch
+    float groundPositions[MBEAgentBlockSize * 2];
+    for (size_t i = 0; i < count; ++i)
+    {
+        xs[i] = std::min(std::max(xs[i] + sines[i] * distance, parameters.minX), parameters.maxX);
+        zs[i] = std::min(std::max(zs[i] + cosines[i] * distance, parameters.minZ), parameters.maxZ);
+        groundPositions[i * 2 + 0] = xs[i];
+        groundPositions[i * 2 + 1] = zs[i];
+    }
+
+    ground(groundPositions, count, ys, groundContext);
+
+    // The model matrix is a translation times a rotation of -heading about the y axis, and the normal
+    // matrix is its upper-left 3x3. Both are written column by column, straight into the destination.
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float s = sines[i];
+        const float c = cosines[i];
+        float *u = (float *)&uniforms[first + i];
+
+        u[0] = c;     u[1] = 0;     u[2] = -s;    u[3] = 0;
+        u[4] = 0;     u[5] = 1;     u[6] = 0;     u[7] = 0;
+        u[8] = s;     u[9] = 0;     u[10] = c;    u[11] = 0;
+        u[12] = xs[i]; u[13] = ys[i]; u[14] = zs[i]; u[15] = 1;
+
+        u[16] = c;    u[17] = 0;    u[18] = -s;   u[19] = 0;
+        u[20] = 0;    u[21] = 1;    u[22] = 0;    u[23] = 0;
+        u[24] = s;    u[25] = 0;    u[26] = c;    u[27] = 0;
+    }
+}
+
+void MBEAgentSystemUpdate(MBEAgentSystem *system, float timeStep, MBEAgentGroundFunction ground, void *groundContext,
+                          PerInstanceUniforms *uniforms)
+{
+    const size_t agentCount = system->x.size();
+    const size_t blockCount = (agentCount + MBEAgentBlockSize - 1) / MBEAgentBlockSize;
+
+    MBEThreadPool::sharedPool().parallelFor(blockCount, [&](size_t block)
+    {
+        const size_t first = block * MBEAgentBlockSize;
+        const size_t count = std::min(MBEAgentBlockSize, agentCount - first);
+        system->updateBlock(first, count, timeStep, ground, groundContext, uniforms);
+    });
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#import "MBETypes.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that the renderer, written in plain Objective-C, can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// A herd of agents that wander a rectangular patch of ground. Each agent turns smoothly toward a
+/// target heading, walks forward at a constant speed, and stays within the patch and on the ground.
+/// State is kept as parallel arrays of floats, and updates run in blocks across all cores.
+typedef struct MBEAgentSystem MBEAgentSystem;
+
+typedef struct
+{
+    float speed;        // distance covered per second
+    float turnDamping;  // fraction of the current heading kept at each update
+    float minX;         // the patch that agents are confined to
+    float maxX;
+    float minZ;
+    float maxZ;
+} MBEAgentParameters;
+
+/// Writes the ground height under `count` positions, given as consecutive (x, z) pairs. It is called
+/// from several threads at once, each with its own block of agents.
+typedef void (*MBEAgentGroundFunction)(const float *positions, size_t count, float *heights, void *context);
+
+/// Creates `agentCount` agents at random positions in the central 80% of the patch, facing random
+/// directions. The same seed always produces the same agents.
+MBEAgentSystem *MBEAgentSystemCreate(size_t agentCount, MBEAgentParameters parameters, uint64_t seed);
+void MBEAgentSystemDestroy(MBEAgentSystem *system);
+
+size_t MBEAgentSystemGetCount(const MBEAgentSystem *system);
+
+/// Gives every agent a new random target heading
+void MBEAgentSystemRetarget(MBEAgentSystem *system);
+
+/// Advances every agent by `timeStep` seconds, places it on the ground, and writes its model and normal
+/// matrices into `uniforms`, which must have room for one PerInstanceUniforms per agent.
+void MBEAgentSystemUpdate(MBEAgentSystem *system, float timeStep, MBEAgentGroundFunction ground, void *groundContext,
+                          PerInstanceUniforms *uniforms);
+
+#ifdef __cplusplus
+}
+#endif
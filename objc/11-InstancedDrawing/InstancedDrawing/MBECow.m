@@ -1,4 +0,0 @@
-#import "MBECow.h"
-
-@implementation MBECow
-@end
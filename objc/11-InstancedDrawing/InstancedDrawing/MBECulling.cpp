@@ -0,0 +1,277 @@
+#include "MBECulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    // Instances are tested in blocks of this many, as structures of arrays, so that the plane tests
+    // compile to SIMD instructions
+    const size_t MBECullLaneCount = 4;
+
+    const float *PointAt(const float *positions, size_t stride, size_t index)
+    {
+        return (const float *)((const uint8_t *)positions + index * stride);
+    }
+
+    float DistanceSquared(const float *a, const float *b)
+    {
+        const float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+        return dx * dx + dy * dy + dz * dz;
+    }
+
+    size_t FarthestPoint(const float *positions, size_t count, size_t stride, const float *from)
+    {
+        size_t farthest = 0;
+        float farthestDistance = -1;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const float distance = DistanceSquared(PointAt(positions, stride, i), from);
+            if (distance > farthestDistance)
+            {
+                farthest = i;
+                farthestDistance = distance;
+            }
+        }
+        return farthest;
+    }
+
+    MBEBoundingSphere TransformSphere(const MBEBoundingSphere &sphere, const uint8_t *instance)
+    {
+        float m[16];
+        memcpy(m, instance, sizeof(m));
+
+        MBEBoundingSphere transformed;
+        for (int i = 0; i < 3; ++i)
+        {
+            transformed.center[i] = m[i] * sphere.center[0] + m[4 + i] * sphere.center[1] + m[8 + i] * sphere.center[2] + m[12 + i];
+        }
+
+        // A non-uniform scale stretches the sphere into an ellipsoid, which the largest scale encloses
+        const float scaleX = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+        const float scaleY = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+        const float scaleZ = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+        transformed.radius = sphere.radius * std::sqrt(std::max(scaleX, std::max(scaleY, scaleZ)));
+        return transformed;
+    }
+
+    void SetPlane(float plane[4], const float row[4], float sign, const float otherRow[4])
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            plane[i] = row[i] + sign * otherRow[i];
+        }
+
+        const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                plane[i] /= length;
+            }
+        }
+    }
+}
+
+MBEBoundingSphere MBEBoundingSphereMake(const float *positions, size_t count, size_t stride)
+{
+    MBEBoundingSphere sphere = { { 0, 0, 0 }, 0 };
+    if (count == 0)
+    {
+        return sphere;
+    }
+
+    // Ritter's method: start from the two points farthest apart along a rough diameter, then grow the
+    // sphere just enough to take in any point that is still outside it
+    const float *a = PointAt(positions, stride, FarthestPoint(positions, count, stride, positions));
+    const float *b = PointAt(positions, stride, FarthestPoint(positions, count, stride, a));
+
+    for (int i = 0; i < 3; ++i)
+    {
+        sphere.center[i] = (a[i] + b[i]) * 0.5f;
+    }
+    sphere.radius = std::sqrt(DistanceSquared(a, b)) * 0.5f;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float *point = PointAt(positions, stride, i);
+        const float distance = std::sqrt(DistanceSquared(point, sphere.center));
+        if (distance > sphere.radius)
+        {
+            const float radius = (sphere.radius + distance) * 0.5f;
+            const float shift = (radius - sphere.radius) / distance;
+            for (int j = 0; j < 3; ++j)
+            {
+                sphere.center[j] += (point[j] - sphere.center[j]) * shift;
+            }
+            sphere.radius = radius;
+        }
+    }
+
+    // Absorb the rounding error of the updates, so that every point is strictly inside
+    sphere.radius *= 1.0001f;
+    return sphere;
+}
+
+MBEFrustum MBEFrustumMake(const float viewProjectionMatrix[16])
+{
+    float rows[4][4];
+    for (int row = 0; row < 4; ++row)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            rows[row][column] = viewProjectionMatrix[column * 4 + row];
+        }
+    }
+
+    // A clip-space point is inside when -w <= x <= w, -w <= y <= w and -w <= z <= w (Gribb and Hartmann)
+    MBEFrustum frustum;
+    SetPlane(frustum.planes[0], rows[3], 1, rows[0]);  // left
+    SetPlane(frustum.planes[1], rows[3], -1, rows[0]); // right
+    SetPlane(frustum.planes[2], rows[3], 1, rows[1]);  // bottom
+    SetPlane(frustum.planes[3], rows[3], -1, rows[1]); // top
+    SetPlane(frustum.planes[4], rows[3], 1, rows[2]);  // near
+    SetPlane(frustum.planes[5], rows[3], -1, rows[2]); // far
+    return frustum;
+}
+
+void MBETransformBoundingSpheres(MBEBoundingSphere sphere,
+                                 const void *instances,
+                                 size_t instanceCount,
+                                 size_t stride,
+                                 MBEBoundingSphere *spheres)
+{
+    const uint8_t *source = (const uint8_t *)instances;
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        spheres[i] = TransformSphere(sphere, source + i * stride);
+    }
+}
+
+size_t MBECullInstances(const MBEFrustum *frustum,
+                        MBEBoundingSphere sphere,
+                        const void *instances,
+                        size_t instanceCount,
+                        size_t stride,
+                        void *visibleInstances,
+                        MBECullingStats *stats)
+{
+    const uint8_t *source = (const uint8_t *)instances;
+    uint8_t *destination = (uint8_t *)visibleInstances;
+    size_t visibleCount = 0;
+
+    for (size_t first = 0; first < instanceCount; first += MBECullLaneCount)
+    {
+        const size_t laneCount = std::min(MBECullLaneCount, instanceCount - first);
+
+        // Lanes past the end of the instances are left as zero-radius spheres at the origin and ignored
+        float x[MBECullLaneCount] = {}, y[MBECullLaneCount] = {}, z[MBECullLaneCount] = {};
+        float radius[MBECullLaneCount] = {};
+
+        for (size_t lane = 0; lane < laneCount; ++lane)
+        {
+            const MBEBoundingSphere transformed = TransformSphere(sphere, source + (first + lane) * stride);
+            x[lane] = transformed.center[0];
+            y[lane] = transformed.center[1];
+            z[lane] = transformed.center[2];
+            radius[lane] = transformed.radius;
+        }
+
+        int visible[MBECullLaneCount];
+        for (size_t lane = 0; lane < MBECullLaneCount; ++lane)
+        {
+            visible[lane] = 1;
+        }
+
+        for (int p = 0; p < 6; ++p)
+        {
+            const float *plane = frustum->planes[p];
+            for (size_t lane = 0; lane < MBECullLaneCount; ++lane)
+            {
+                const float distance = plane[0] * x[lane] + plane[1] * y[lane] + plane[2] * z[lane] + plane[3];
+                visible[lane] &= (distance >= -radius[lane]);
+            }
+        }
+
+        // Visible instances only ever move toward the front, so compacting in place is safe
+        for (size_t lane = 0; lane < laneCount; ++lane)
+        {
+            if (visible[lane])
+            {
+                const size_t index = first + lane;
+                if (destination + visibleCount * stride != source + index * stride)
+                {
+                    memmove(destination + visibleCount * stride, source + index * stride, stride);
+                }
+                ++visibleCount;
+            }
+        }
+    }
+
+    if (stats)
+    {
+        stats->instancesTested += instanceCount;
+        stats->instancesVisible += visibleCount;
+    }
+
+    return visibleCount;
+}
+
+void MBESortInstancesByLevelOfDetail(const float cameraPosition[3],
+                                     float projectionScale,
+                                     float pixelTolerance,
+                                     MBEBoundingSphere sphere,
+                                     const float *levelErrors,
+                                     size_t levelCount,
+                                     void *instances,
+                                     size_t instanceCount,
+                                     size_t stride,
+                                     void *scratch,
+                                     size_t *levelInstanceCounts)
+{
+    uint8_t *source = (uint8_t *)instances;
+    uint8_t *sorted = (uint8_t *)scratch;
+    std::fill(levelInstanceCounts, levelInstanceCounts + levelCount, 0);
+    if (levelCount == 0)
+    {
+        return;
+    }
+
+    // Distances closer than this are treated as the camera being inside the sphere
+    const float minimumDistance = 1e-4f;
+
+    std::vector<uint8_t> levels(instanceCount);
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        const MBEBoundingSphere transformed = TransformSphere(sphere, source + i * stride);
+        const float distance = std::max(std::sqrt(DistanceSquared(transformed.center, cameraPosition)) - transformed.radius,
+                                        minimumDistance);
+
+        // The transformed radius over the model radius is the instance's largest scale
+        const float scale = (sphere.radius > 0) ? transformed.radius / sphere.radius : 1;
+        const float modelTolerance = pixelTolerance * distance / (projectionScale * scale);
+
+        size_t level = 0;
+        while (level + 1 < levelCount && levelErrors[level + 1] <= modelTolerance)
+        {
+            ++level;
+        }
+        levels[i] = (uint8_t)level;
+        ++levelInstanceCounts[level];
+    }
+
+    // A counting sort, which is stable and touches each instance twice
+    std::vector<size_t> next(levelCount, 0);
+    for (size_t level = 1; level < levelCount; ++level)
+    {
+        next[level] = next[level - 1] + levelInstanceCounts[level - 1];
+    }
+
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        memcpy(sorted + next[levels[i]]++ * stride, source + i * stride, stride);
+    }
+    memcpy(source, sorted, instanceCount * stride);
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+/// Tells the CPU when the GPU has finished with a frame. Frames are numbered from 1 in the order
+/// they are submitted, and complete in that order, so signalling frame n means that every frame up
+/// to and including n has completed.
+class MBEFrameFence
+{
+public:
+    virtual ~MBEFrameFence() {}
+
+    /// Marks `frame` and every earlier frame as completed. May be called from any thread.
+    virtual void signal(uint64_t frame) = 0;
+
+    /// Blocks the calling thread until `frame` has completed
+    virtual void wait(uint64_t frame) = 0;
+
+    /// The most recently completed frame, or zero if no frame has completed yet
+    virtual uint64_t completedFrame() const = 0;
+};
+
+/// A fence that is signalled by code running on the CPU: a command buffer's completion handler
+/// when there is a GPU, or a thread standing in for the GPU when there isn't.
+class MBECPUFrameFence : public MBEFrameFence
+{
+public:
+    MBECPUFrameFence() : _completedFrame(0) {}
+
+    void signal(uint64_t frame) override;
+    void wait(uint64_t frame) override;
+    uint64_t completedFrame() const override;
+
+private:
+    MBECPUFrameFence(const MBECPUFrameFence &) = delete;
+    MBECPUFrameFence &operator=(const MBECPUFrameFence &) = delete;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _completed;
+    uint64_t _completedFrame;
+};
+
+/// Hands out per-frame memory from a buffer divided into `frameCount` equal slots, so that the CPU
+/// can fill the slot of the next frame while the GPU is still reading the slots of the frames in
+/// flight. Starting a frame waits on the fence until the frame that last used its slot completes,
+/// which also keeps the CPU from running more than `frameCount` frames ahead of the GPU.
+///
+/// The ring only does the bookkeeping; the caller owns the memory, which is `length()` bytes long.
+/// Frames must be started from one thread at a time.
+class MBEFrameRing
+{
+public:
+    /// `alignment` must be a power of two. Each slot holds `bytesPerFrame` bytes, rounded up to it.
+    MBEFrameRing(MBEFrameFence &fence, unsigned frameCount, size_t bytesPerFrame, size_t alignment);
+
+    unsigned frameCount() const { return _frameCount; }
+    size_t bytesPerFrame() const { return _bytesPerFrame; }
+    size_t alignment() const { return _alignment; }
+
+    /// The size of the memory that backs every slot
+    size_t length() const { return _bytesPerFrame * _frameCount; }
+
+    /// Waits until the slot of the next frame is free, starts that frame, and returns its number
+    uint64_t beginFrame();
+
+    /// The frame most recently started, or zero if none has been
+    uint64_t currentFrame() const { return _currentFrame; }
+
+    /// The slot that the current frame allocates from. Frame 1 uses slot 0.
+    unsigned currentSlot() const { return _currentFrame ? (unsigned)((_currentFrame - 1) % _frameCount) : 0; }
+
+    /// Reserves `length` bytes in the current frame's slot and stores their offset from the start
+    /// of the memory in `offset`. The offset is a multiple of the ring's alignment. Returns false,
+    /// leaving `offset` untouched, if no frame has been started or the slot has too little room left.
+    bool allocate(size_t length, size_t *offset);
+
+    /// The number of bytes allocated in the current frame, including alignment padding
+    size_t bytesAllocated() const { return _cursor; }
+
+private:
+    MBEFrameRing(const MBEFrameRing &) = delete;
+    MBEFrameRing &operator=(const MBEFrameRing &) = delete;
+
+    MBEFrameFence &_fence;
+    unsigned _frameCount;
+    size_t _alignment;
+    size_t _bytesPerFrame;
+    uint64_t _currentFrame;
+    size_t _cursor;
+};
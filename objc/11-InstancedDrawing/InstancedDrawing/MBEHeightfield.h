@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// A square grid of (2^iterations + 1)^2 heights generated by midpoint displacement (the
+/// "diamond-square" algorithm). Heights start at zero in the corners and are displaced by at most
+/// 1 at the first level; each further level scales the displacement by 2^-smoothness.
+///
+/// Every sample's displacement is a hash of the seed and the sample's coordinates, so the result
+/// depends only on the parameters and not on how many threads generated it.
+class MBEHeightfield
+{
+public:
+    MBEHeightfield(unsigned iterations, float smoothness, uint64_t seed);
+
+    /// The number of samples along each edge
+    size_t stride() const { return _stride; }
+
+    float height(size_t row, size_t column) const { return _heights[row * _stride + column]; }
+    const float *heights() const { return _heights.data(); }
+
+    /// Computes the unit normal at a sample from central differences (one-sided on the edges), for a
+    /// grid whose samples are `spacing` apart horizontally and whose heights are multiplied by
+    /// `verticalScale`. Because it only looks at the heightfield, normals agree along chunk seams.
+    void normal(size_t row, size_t column, float spacing, float verticalScale, float normal[3]) const;
+
+private:
+    void performSquareStep(size_t squareSize, float variance);
+    void performEdgeStep(size_t squareSize, float variance);
+    float displacement(size_t row, size_t column) const;
+
+    size_t _stride;
+    uint64_t _seed;
+    std::vector<float> _heights;
+};
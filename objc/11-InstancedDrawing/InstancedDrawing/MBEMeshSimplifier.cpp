@@ -0,0 +1,611 @@
+#include "MBEMeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+    const uint32_t NoVertex = 0xffffffff;
+    const uint32_t ManyVertices = 0xfffffffe;
+
+    // Planes through open borders are weighted this much more heavily than the faces they bound, which
+    // keeps borders from being pulled inward
+    const double BorderWeight = 10.0;
+
+    enum VertexKind : uint8_t
+    {
+        Manifold,   // surrounded by triangles, with one set of attributes: may collapse onto any neighbor
+        Border,     // on an open border: may collapse onto a neighbor along the border
+        Seam,       // one of two vertices on either side of a seam: may collapse along the seam
+        Locked,     // anything more complex, such as a corner or the meeting point of several seams
+    };
+
+    struct Vector3
+    {
+        double x, y, z;
+    };
+
+    Vector3 Subtract(const Vector3 &a, const Vector3 &b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    Vector3 Cross(const Vector3 &a, const Vector3 &b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+    double Dot(const Vector3 &a, const Vector3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+    double Length(const Vector3 &a) { return std::sqrt(Dot(a, a)); }
+
+    /// The sum of squared distances to a set of weighted planes, as the symmetric matrix A, vector b and
+    /// scalar c of p'Ap + 2b'p + c, together with the total weight of the planes that were summed
+    struct Quadric
+    {
+        double a00, a01, a02, a11, a12, a22;
+        double b0, b1, b2;
+        double c;
+        double weight;
+
+        Quadric() : a00(0), a01(0), a02(0), a11(0), a12(0), a22(0), b0(0), b1(0), b2(0), c(0), weight(0) {}
+
+        // `normal` must be unit length; the plane is normal . p + d = 0
+        void addPlane(const Vector3 &normal, double d, double planeWeight, double areaWeight)
+        {
+            a00 += planeWeight * normal.x * normal.x;
+            a01 += planeWeight * normal.x * normal.y;
+            a02 += planeWeight * normal.x * normal.z;
+            a11 += planeWeight * normal.y * normal.y;
+            a12 += planeWeight * normal.y * normal.z;
+            a22 += planeWeight * normal.z * normal.z;
+            b0 += planeWeight * normal.x * d;
+            b1 += planeWeight * normal.y * d;
+            b2 += planeWeight * normal.z * d;
+            c += planeWeight * d * d;
+            weight += areaWeight;
+        }
+
+        void add(const Quadric &other)
+        {
+            a00 += other.a00; a01 += other.a01; a02 += other.a02;
+            a11 += other.a11; a12 += other.a12; a22 += other.a22;
+            b0 += other.b0; b1 += other.b1; b2 += other.b2;
+            c += other.c;
+            weight += other.weight;
+        }
+
+        // The weighted mean squared distance from `p` to the planes
+        double evaluate(const Vector3 &p) const
+        {
+            const double rx = a00 * p.x + a01 * p.y + a02 * p.z;
+            const double ry = a01 * p.x + a11 * p.y + a12 * p.z;
+            const double rz = a02 * p.x + a12 * p.y + a22 * p.z;
+            const double error = p.x * rx + p.y * ry + p.z * rz + 2 * (p.x * b0 + p.y * b1 + p.z * b2) + c;
+            return (weight > 0) ? std::max(error, 0.0) / weight : 0;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+    };
+
+    uint64_t EdgeKey(uint32_t a, uint32_t b)
+    {
+        return ((uint64_t)a << 32) | b;
+    }
+
+    struct PositionHash
+    {
+        size_t operator()(const Vector3 &p) const
+        {
+            const float coordinates[3] = { (float)p.x, (float)p.y, (float)p.z };
+            uint32_t bits[3];
+            memcpy(bits, coordinates, sizeof(bits));
+            return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        }
+    };
+
+    struct PositionEqual
+    {
+        bool operator()(const Vector3 &a, const Vector3 &b) const
+        {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    };
+
+    class Simplifier
+    {
+    public:
+        Simplifier(const float *positions, size_t positionStride, size_t vertexCount, std::vector<uint32_t> &indices)
+        : _vertexCount(vertexCount), _indices(indices)
+        {
+            _positions.resize(vertexCount);
+            for (size_t v = 0; v < vertexCount; ++v)
+            {
+                const float *p = (const float *)((const uint8_t *)positions + v * positionStride);
+                _positions[v] = { p[0], p[1], p[2] };
+            }
+
+            buildPositionRemap();
+            classifyVertices(true);
+            buildQuadrics();
+        }
+
+        double simplify(size_t targetIndexCount)
+        {
+            double maxCost = 0;
+            size_t pass = 0;
+            while (_indices.size() > targetIndexCount)
+            {
+                const size_t trianglesToRemove = (_indices.size() - targetIndexCount) / 3;
+                if (trianglesToRemove == 0)
+                {
+                    break;
+                }
+
+                // Collapses move borders and seams, so the vertices are classified again before every pass
+                if (pass++ > 0)
+                {
+                    classifyVertices(false);
+                }
+
+                std::vector<Collapse> collapses = pickCollapses();
+                if (collapses.empty())
+                {
+                    break;
+                }
+
+                const size_t removed = applyCollapses(collapses, trianglesToRemove, &maxCost);
+                if (removed == 0)
+                {
+                    break;
+                }
+            }
+            return maxCost;
+        }
+
+    private:
+        void buildPositionRemap()
+        {
+            _remap.resize(_vertexCount);
+            _sibling.assign(_vertexCount, NoVertex);
+            _wedgeCount.assign(_vertexCount, 0);
+
+            std::unordered_map<Vector3, uint32_t, PositionHash, PositionEqual> firstVertexAtPosition;
+            firstVertexAtPosition.reserve(_vertexCount);
+            for (uint32_t v = 0; v < _vertexCount; ++v)
+            {
+                auto inserted = firstVertexAtPosition.insert(std::make_pair(_positions[v], v));
+                const uint32_t first = inserted.first->second;
+                _remap[v] = first;
+                if (!inserted.second)
+                {
+                    // Remember one other vertex at the same position, which is all a two-sided seam needs
+                    _sibling[v] = first;
+                    if (_sibling[first] == NoVertex)
+                    {
+                        _sibling[first] = v;
+                    }
+                }
+                ++_wedgeCount[first];
+            }
+        }
+
+        void classifyVertices(bool collectBorderEdges)
+        {
+            std::unordered_set<uint64_t> edges, positionEdges;
+            edges.reserve(_indices.size());
+            positionEdges.reserve(_indices.size());
+            for (size_t i = 0; i < _indices.size(); i += 3)
+            {
+                for (int e = 0; e < 3; ++e)
+                {
+                    const uint32_t a = _indices[i + e], b = _indices[i + (e + 1) % 3];
+                    edges.insert(EdgeKey(a, b));
+                    positionEdges.insert(EdgeKey(_remap[a], _remap[b]));
+                }
+            }
+
+            // The single open edge leaving and entering each vertex, if there is exactly one
+            _openOut.assign(_vertexCount, NoVertex);
+            _openIn.assign(_vertexCount, NoVertex);
+            std::vector<bool> openAtPosition(_vertexCount, false);
+            for (size_t i = 0; i < _indices.size(); i += 3)
+            {
+                for (int e = 0; e < 3; ++e)
+                {
+                    const uint32_t a = _indices[i + e], b = _indices[i + (e + 1) % 3];
+                    if (edges.count(EdgeKey(b, a)))
+                    {
+                        continue;
+                    }
+                    _openOut[a] = (_openOut[a] == NoVertex) ? b : ManyVertices;
+                    _openIn[b] = (_openIn[b] == NoVertex) ? a : ManyVertices;
+
+                    if (!positionEdges.count(EdgeKey(_remap[b], _remap[a])))
+                    {
+                        openAtPosition[a] = true;
+                        openAtPosition[b] = true;
+                        if (collectBorderEdges)
+                        {
+                            _borderEdges.push_back(EdgeKey(a, b));
+                        }
+                    }
+                }
+            }
+
+            _kind.assign(_vertexCount, Locked);
+            for (uint32_t v = 0; v < _vertexCount; ++v)
+            {
+                const bool hasOpenEdges = (_openOut[v] != NoVertex || _openIn[v] != NoVertex);
+                const bool singleOpenEdges = (_openOut[v] < ManyVertices && _openIn[v] < ManyVertices);
+                const uint32_t wedges = _wedgeCount[_remap[v]];
+
+                if (wedges == 1)
+                {
+                    if (!hasOpenEdges)
+                    {
+                        _kind[v] = Manifold;
+                    }
+                    else if (singleOpenEdges && openAtPosition[v])
+                    {
+                        _kind[v] = Border;
+                    }
+                }
+                else if (wedges == 2 && singleOpenEdges && !openAtPosition[v])
+                {
+                    // The open edges of both sides must run between the same positions, in opposite directions
+                    const uint32_t s = _sibling[v];
+                    if (_openOut[s] < ManyVertices && _openIn[s] < ManyVertices &&
+                        _remap[_openOut[v]] == _remap[_openIn[s]] && _remap[_openIn[v]] == _remap[_openOut[s]])
+                    {
+                        _kind[v] = Seam;
+                    }
+                }
+            }
+        }
+
+        void buildQuadrics()
+        {
+            _quadrics.assign(_vertexCount, Quadric());
+            for (size_t i = 0; i < _indices.size(); i += 3)
+            {
+                const Vector3 &p0 = _positions[_indices[i]], &p1 = _positions[_indices[i + 1]], &p2 = _positions[_indices[i + 2]];
+                const Vector3 normal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+                const double doubleArea = Length(normal);
+                if (doubleArea == 0)
+                {
+                    continue;
+                }
+
+                const Vector3 unitNormal = { normal.x / doubleArea, normal.y / doubleArea, normal.z / doubleArea };
+                const double d = -Dot(unitNormal, p0);
+                const double area = doubleArea * 0.5;
+                for (int k = 0; k < 3; ++k)
+                {
+                    _quadrics[_remap[_indices[i + k]]].addPlane(unitNormal, d, area, area);
+                }
+            }
+
+            // Each open border edge gets a plane through it, perpendicular to its triangle
+            std::unordered_map<uint64_t, size_t> edgeTriangles;
+            for (size_t i = 0; i < _indices.size(); i += 3)
+            {
+                for (int e = 0; e < 3; ++e)
+                {
+                    edgeTriangles[EdgeKey(_indices[i + e], _indices[i + (e + 1) % 3])] = i;
+                }
+            }
+
+            for (uint64_t edge : _borderEdges)
+            {
+                const uint32_t a = (uint32_t)(edge >> 32), b = (uint32_t)edge;
+                const size_t i = edgeTriangles[edge];
+                const Vector3 &p0 = _positions[_indices[i]], &p1 = _positions[_indices[i + 1]], &p2 = _positions[_indices[i + 2]];
+                const Vector3 faceNormal = Cross(Subtract(p1, p0), Subtract(p2, p0));
+                const Vector3 direction = Subtract(_positions[b], _positions[a]);
+                const Vector3 normal = Cross(direction, faceNormal);
+                const double length = Length(normal);
+                if (length == 0)
+                {
+                    continue;
+                }
+
+                const Vector3 unitNormal = { normal.x / length, normal.y / length, normal.z / length };
+                const double d = -Dot(unitNormal, _positions[a]);
+                const double weight = Dot(direction, direction) * BorderWeight;
+                _quadrics[_remap[a]].addPlane(unitNormal, d, weight, 0);
+                _quadrics[_remap[b]].addPlane(unitNormal, d, weight, 0);
+            }
+        }
+
+        // The vertex on the other side of a seam that moves along with `from` when it collapses onto `to`
+        uint32_t seamCounterpart(uint32_t from, uint32_t to) const
+        {
+            const uint32_t s = _sibling[from];
+            return (to == _openOut[from]) ? _openIn[s] : _openOut[s];
+        }
+
+        bool canCollapse(uint32_t from, uint32_t to) const
+        {
+            switch (_kind[from])
+            {
+                case Manifold:
+                    return true;
+                case Border:
+                    return to == _openOut[from] || to == _openIn[from];
+                case Seam:
+                {
+                    if (to != _openOut[from] && to != _openIn[from])
+                    {
+                        return false;
+                    }
+                    const uint32_t counterpart = seamCounterpart(from, to);
+                    return counterpart < ManyVertices && _remap[counterpart] == _remap[to];
+                }
+                default:
+                    return false;
+            }
+        }
+
+        double collapseCost(uint32_t from, uint32_t to) const
+        {
+            Quadric quadric = _quadrics[_remap[from]];
+            quadric.add(_quadrics[_remap[to]]);
+            return quadric.evaluate(_positions[to]);
+        }
+
+        std::vector<Collapse> pickCollapses() const
+        {
+            std::vector<Collapse> collapses;
+            collapses.reserve(_indices.size());
+            for (size_t i = 0; i < _indices.size(); i += 3)
+            {
+                for (int e = 0; e < 3; ++e)
+                {
+                    const uint32_t a = _indices[i + e], b = _indices[i + (e + 1) % 3];
+
+                    // Every interior edge is seen from both of its triangles; consider it once
+                    if (_kind[a] == Manifold && _kind[b] == Manifold && a > b)
+                    {
+                        continue;
+                    }
+
+                    const bool forward = canCollapse(a, b), backward = canCollapse(b, a);
+                    if (!forward && !backward)
+                    {
+                        continue;
+                    }
+
+                    const double forwardCost = forward ? collapseCost(a, b) : INFINITY;
+                    const double backwardCost = backward ? collapseCost(b, a) : INFINITY;
+                    if (forwardCost <= backwardCost)
+                    {
+                        collapses.push_back({ a, b, forwardCost });
+                    }
+                    else
+                    {
+                        collapses.push_back({ b, a, backwardCost });
+                    }
+                }
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse &x, const Collapse &y) { return x.cost < y.cost; });
+            return collapses;
+        }
+
+        // Whether moving `position` onto `target` turns any triangle around it over
+        bool flipsTriangle(uint32_t position, uint32_t target) const
+        {
+            const Vector3 &newPosition = _positions[target];
+            for (uint32_t t = _adjacencyOffsets[position]; t < _adjacencyOffsets[position + 1]; ++t)
+            {
+                const size_t i = _adjacency[t];
+                uint32_t corners[3] = { _remap[_indices[i]], _remap[_indices[i + 1]], _remap[_indices[i + 2]] };
+                if (corners[0] == _remap[target] || corners[1] == _remap[target] || corners[2] == _remap[target])
+                {
+                    continue; // this triangle disappears
+                }
+
+                Vector3 points[3] = { _positions[corners[0]], _positions[corners[1]], _positions[corners[2]] };
+                const Vector3 before = Cross(Subtract(points[1], points[0]), Subtract(points[2], points[0]));
+                for (int k = 0; k < 3; ++k)
+                {
+                    if (corners[k] == position)
+                    {
+                        points[k] = newPosition;
+                    }
+                }
+                const Vector3 after = Cross(Subtract(points[1], points[0]), Subtract(points[2], points[0]));
+                if (Dot(before, after) <= 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void buildAdjacency()
+        {
+            // Triangles around each position, in compressed rows
+            _adjacencyOffsets.assign(_vertexCount + 1, 0);
+            for (uint32_t index : _indices)
+            {
+                ++_adjacencyOffsets[_remap[index] + 1];
+            }
+            for (size_t v = 0; v < _vertexCount; ++v)
+            {
+                _adjacencyOffsets[v + 1] += _adjacencyOffsets[v];
+            }
+
+            _adjacency.resize(_indices.size());
+            std::vector<uint32_t> fill(_adjacencyOffsets.begin(), _adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < _indices.size(); ++i)
+            {
+                _adjacency[fill[_remap[_indices[i]]]++] = (uint32_t)(i - i % 3);
+            }
+        }
+
+        size_t applyCollapses(const std::vector<Collapse> &collapses, size_t trianglesToRemove, double *maxCost)
+        {
+            buildAdjacency();
+
+            std::vector<uint32_t> target(_vertexCount);
+            for (uint32_t v = 0; v < _vertexCount; ++v)
+            {
+                target[v] = v;
+            }
+
+            // Triangles around a collapsed position change, so nothing else may move onto or off them this pass
+            std::vector<bool> locked(_vertexCount, false);
+            size_t removed = 0;
+
+            for (const Collapse &collapse : collapses)
+            {
+                if (removed >= trianglesToRemove)
+                {
+                    break;
+                }
+
+                const uint32_t position = _remap[collapse.from];
+                if (locked[position] || locked[_remap[collapse.to]] || flipsTriangle(position, collapse.to))
+                {
+                    continue;
+                }
+
+                target[collapse.from] = collapse.to;
+                if (_kind[collapse.from] == Seam)
+                {
+                    target[_sibling[collapse.from]] = seamCounterpart(collapse.from, collapse.to);
+                }
+
+                for (uint32_t t = _adjacencyOffsets[position]; t < _adjacencyOffsets[position + 1]; ++t)
+                {
+                    const size_t i = _adjacency[t];
+                    bool disappears = false;
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        const uint32_t corner = _remap[_indices[i + k]];
+                        locked[corner] = true;
+                        disappears = disappears || (corner == _remap[collapse.to]);
+                    }
+                    removed += disappears ? 1 : 0;
+                }
+
+                _quadrics[_remap[collapse.to]].add(_quadrics[position]);
+                *maxCost = std::max(*maxCost, collapse.cost);
+            }
+
+            // Rewrite the triangles and drop those that collapsed to a line
+            size_t write = 0;
+            for (size_t i = 0; i < _indices.size(); i += 3)
+            {
+                const uint32_t a = target[_indices[i]], b = target[_indices[i + 1]], c = target[_indices[i + 2]];
+                if (_remap[a] == _remap[b] || _remap[b] == _remap[c] || _remap[a] == _remap[c])
+                {
+                    continue;
+                }
+                _indices[write++] = a;
+                _indices[write++] = b;
+                _indices[write++] = c;
+            }
+
+            const size_t removedTriangles = (_indices.size() - write) / 3;
+            _indices.resize(write);
+            return removedTriangles;
+        }
+
+        size_t _vertexCount;
+        std::vector<uint32_t> &_indices;
+        std::vector<Vector3> _positions;
+        std::vector<uint32_t> _remap;     // the first vertex at each vertex's position
+        std::vector<uint32_t> _sibling;   // another vertex at the same position, if any
+        std::vector<uint32_t> _wedgeCount; // vertices at each position, indexed by `_remap`
+        std::vector<uint32_t> _openOut;
+        std::vector<uint32_t> _openIn;
+        std::vector<uint64_t> _borderEdges;
+        std::vector<VertexKind> _kind;
+        std::vector<Quadric> _quadrics;   // indexed by `_remap`
+        std::vector<uint32_t> _adjacencyOffsets;
+        std::vector<uint32_t> _adjacency;
+    };
+
+    template <typename Index>
+    size_t SimplifyMesh(Index *destination, const Index *indices, size_t indexCount,
+                        const float *positions, size_t positionStride, size_t vertexCount,
+                        size_t targetIndexCount, float *error)
+    {
+        std::vector<uint32_t> simplified(indices, indices + indexCount);
+        double cost = 0;
+        if (targetIndexCount < indexCount)
+        {
+            Simplifier simplifier(positions, positionStride, vertexCount, simplified);
+            cost = simplifier.simplify(targetIndexCount);
+        }
+
+        std::copy(simplified.begin(), simplified.end(), destination);
+        if (error)
+        {
+            *error = (float)std::sqrt(cost);
+        }
+        return simplified.size();
+    }
+
+    template <typename Index>
+    size_t BuildLevelsOfDetail(const Index *indices, size_t indexCount,
+                               const float *positions, size_t positionStride, size_t vertexCount,
+                               const float *triangleRatios, size_t levelCount,
+                               Index *levelIndices, MBEMeshLevelOfDetail *levels)
+    {
+        size_t offset = 0;
+        float previousError = 0;
+        for (size_t level = 0; level < levelCount; ++level)
+        {
+            const size_t triangleCount = indexCount / 3;
+            const size_t targetIndexCount = (size_t)(triangleCount * std::min(std::max(triangleRatios[level], 0.0f), 1.0f)) * 3;
+
+            // Simplifying every level from the original keeps each level's error relative to the original
+            float error = 0;
+            const size_t levelIndexCount = SimplifyMesh(levelIndices + offset, indices, indexCount, positions, positionStride,
+                                                        vertexCount, targetIndexCount, &error);
+
+            levels[level].indexOffset = offset;
+            levels[level].indexCount = levelIndexCount;
+            levels[level].error = std::max(error, previousError);
+            previousError = levels[level].error;
+            offset += levelIndexCount;
+        }
+        return offset;
+    }
+}
+
+size_t MBESimplifyMeshUInt16(uint16_t *destination, const uint16_t *indices, size_t indexCount,
+                             const float *positions, size_t positionStride, size_t vertexCount,
+                             size_t targetIndexCount, float *error)
+{
+    return SimplifyMesh(destination, indices, indexCount, positions, positionStride, vertexCount, targetIndexCount, error);
+}
+
+size_t MBESimplifyMeshUInt32(uint32_t *destination, const uint32_t *indices, size_t indexCount,
+                             const float *positions, size_t positionStride, size_t vertexCount,
+                             size_t targetIndexCount, float *error)
+{
+    return SimplifyMesh(destination, indices, indexCount, positions, positionStride, vertexCount, targetIndexCount, error);
+}
+
+size_t MBEBuildLevelsOfDetailUInt16(const uint16_t *indices, size_t indexCount,
+                                    const float *positions, size_t positionStride, size_t vertexCount,
+                                    const float *triangleRatios, size_t levelCount,
+                                    uint16_t *levelIndices, MBEMeshLevelOfDetail *levels)
+{
+    return BuildLevelsOfDetail(indices, indexCount, positions, positionStride, vertexCount, triangleRatios, levelCount,
+                               levelIndices, levels);
+}
+
+size_t MBEBuildLevelsOfDetailUInt32(const uint32_t *indices, size_t indexCount,
+                                    const float *positions, size_t positionStride, size_t vertexCount,
+                                    const float *triangleRatios, size_t levelCount,
+                                    uint32_t *levelIndices, MBEMeshLevelOfDetail *levels)
+{
+    return BuildLevelsOfDetail(indices, indexCount, positions, positionStride, vertexCount, triangleRatios, levelCount,
+                               levelIndices, levels);
+}
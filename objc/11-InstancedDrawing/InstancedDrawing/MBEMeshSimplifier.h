@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that mesh classes written in plain Objective-C can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// One level of a chain built by MBEBuildLevelsOfDetail
+typedef struct
+{
+    /// The first index of the level within the chain's indices
+    size_t indexOffset;
+    size_t indexCount;
+    /// An estimate of how far the level's surface strays from the original, in model units
+    float error;
+} MBEMeshLevelOfDetail;
+
+/// Simplifies an indexed triangle list toward `targetIndexCount` indices by collapsing edges in order of
+/// quadric error (Garland and Heckbert). Each collapse moves one vertex onto a neighbor, so the result
+/// indexes the original vertices and needs no vertex buffer of its own.
+///
+/// Vertices that share a position but differ in other attributes form a seam, such as a UV seam or a
+/// crease. Seam vertices only collapse along the seam, together with their counterparts on the other
+/// side, and vertices on open borders only collapse along the border, so neither seams nor borders
+/// tear. The result may have more indices than the target when no collapse is left that keeps these
+/// guarantees without flipping a triangle.
+///
+/// Writes the simplified indices to `destination`, which needs room for `indexCount` indices and may
+/// be the same as `indices`, and returns their number. If `error` is not null, it receives an
+/// estimate of the distance between the simplified and original surfaces, in model units.
+size_t MBESimplifyMeshUInt16(uint16_t *destination, const uint16_t *indices, size_t indexCount,
+                             const float *positions, size_t positionStride, size_t vertexCount,
+                             size_t targetIndexCount, float *error);
+size_t MBESimplifyMeshUInt32(uint32_t *destination, const uint32_t *indices, size_t indexCount,
+                             const float *positions, size_t positionStride, size_t vertexCount,
+                             size_t targetIndexCount, float *error);
+
+/// Builds `levelCount` levels of detail, each simplified from the original to the fraction
+/// `triangleRatios[i]` of its triangles. Ratios should decrease, starting from 1 for the original
+/// mesh. Writes the indices of every level one after another to `levelIndices`, which needs room
+/// for `indexCount * levelCount` indices, describes each level in `levels`, and returns the total
+/// number of indices written. Errors never decrease from one level to the next.
+size_t MBEBuildLevelsOfDetailUInt16(const uint16_t *indices, size_t indexCount,
+                                    const float *positions, size_t positionStride, size_t vertexCount,
+                                    const float *triangleRatios, size_t levelCount,
+                                    uint16_t *levelIndices, MBEMeshLevelOfDetail *levels);
+size_t MBEBuildLevelsOfDetailUInt32(const uint32_t *indices, size_t indexCount,
+                                    const float *positions, size_t positionStride, size_t vertexCount,
+                                    const float *triangleRatios, size_t levelCount,
+                                    uint32_t *levelIndices, MBEMeshLevelOfDetail *levels);
+
+#ifdef __cplusplus
+}
+#endif
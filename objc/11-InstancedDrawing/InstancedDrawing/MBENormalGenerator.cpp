@@ -0,0 +1,195 @@
+#include "MBENormalGenerator.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    // Work is split into blocks this large so that small meshes don't pay for waking the pool
+    const size_t BlockSize = 4096;
+
+    inline const float *StridedFloats(const float *base, size_t stride, size_t index)
+    {
+        return reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(base) + index * stride);
+    }
+
+    inline float *StridedFloats(float *base, size_t stride, size_t index)
+    {
+        return reinterpret_cast<float *>(reinterpret_cast<uint8_t *>(base) + index * stride);
+    }
+
+    // The angle between two vectors, given their dot product and the product of their lengths.
+    // Clamping guards acos against rounding just outside [-1, 1].
+    inline float AngleBetween(float dot, float lengthProduct)
+    {
+        if (lengthProduct <= 0)
+        {
+            return 0;
+        }
+        return acosf(std::max(-1.0f, std::min(1.0f, dot / lengthProduct)));
+    }
+
+    void ParallelForBlocks(size_t count, const std::function<void(size_t, size_t)> &body)
+    {
+        const size_t blockCount = (count + BlockSize - 1) / BlockSize;
+        if (blockCount <= 1)
+        {
+            body(0, count);
+            return;
+        }
+
+        MBEThreadPool::sharedPool().parallelFor(blockCount, [&](size_t block)
+        {
+            body(block * BlockSize, std::min(count, (block + 1) * BlockSize));
+        });
+    }
+
+    template <typename Index>
+    void GenerateNormals(const float *positions, size_t positionStride,
+                         float *normals, size_t normalStride, size_t vertexCount,
+                         const Index *indices, size_t indexCount,
+                         MBENormalWeighting weighting)
+    {
+        if (vertexCount == 0)
+        {
+            return;
+        }
+
+        const size_t triangleCount = indexCount / 3;
+
+        // Gather the positions into separate x, y and z arrays so the face loop below reads dense floats
+        std::vector<float> px(vertexCount), py(vertexCount), pz(vertexCount);
+        ParallelForBlocks(vertexCount, [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; ++v)
+            {
+                const float *p = StridedFloats(positions, positionStride, v);
+                px[v] = p[0];
+                py[v] = p[1];
+                pz[v] = p[2];
+            }
+        });
+
+        // Weighted face normals, one per triangle corner, also stored as separate component arrays.
+        // Each corner is written by exactly one thread, so no synchronization is needed.
+        std::vector<float> cx(triangleCount * 3), cy(triangleCount * 3), cz(triangleCount * 3);
+        ParallelForBlocks(triangleCount, [&](size_t begin, size_t end)
+        {
+            for (size_t t = begin; t < end; ++t)
+            {
+                const Index i0 = indices[t * 3], i1 = indices[t * 3 + 1], i2 = indices[t * 3 + 2];
+
+                const float e1x = px[i1] - px[i0], e1y = py[i1] - py[i0], e1z = pz[i1] - pz[i0];
+                const float e2x = px[i2] - px[i0], e2y = py[i2] - py[i0], e2z = pz[i2] - pz[i0];
+
+                // The cross product's length is twice the triangle's area, which is exactly the area weight
+                float nx = e1y * e2z - e1z * e2y;
+                float ny = e1z * e2x - e1x * e2z;
+                float nz = e1x * e2y - e1y * e2x;
+
+                float w0 = 1, w1 = 1, w2 = 1;
+                if (weighting == MBENormalWeightingAngle)
+                {
+                    const float e3x = px[i2] - px[i1], e3y = py[i2] - py[i1], e3z = pz[i2] - pz[i1];
+                    const float l1 = sqrtf(e1x * e1x + e1y * e1y + e1z * e1z);
+                    const float l2 = sqrtf(e2x * e2x + e2y * e2y + e2z * e2z);
+                    const float l3 = sqrtf(e3x * e3x + e3y * e3y + e3z * e3z);
+
+                    w0 = AngleBetween(e1x * e2x + e1y * e2y + e1z * e2z, l1 * l2);
+                    w1 = AngleBetween(-(e1x * e3x + e1y * e3y + e1z * e3z), l1 * l3);
+                    w2 = (float)M_PI - w0 - w1;
+
+                    const float length = sqrtf(nx * nx + ny * ny + nz * nz);
+                    const float scale = (length > 0) ? 1 / length : 0;
+                    nx *= scale;
+                    ny *= scale;
+                    nz *= scale;
+
+                    if (scale == 0)
+                    {
+                        w0 = w1 = w2 = 0;
+                    }
+                }
+
+                cx[t * 3] = nx * w0;
+                cy[t * 3] = ny * w0;
+                cz[t * 3] = nz * w0;
+                cx[t * 3 + 1] = nx * w1;
+                cy[t * 3 + 1] = ny * w1;
+                cz[t * 3 + 1] = nz * w1;
+                cx[t * 3 + 2] = nx * w2;
+                cy[t * 3 + 2] = ny * w2;
+                cz[t * 3 + 2] = nz * w2;
+            }
+        });
+
+        // Vertex-to-corner adjacency in compressed rows, built with a counting sort. Corners are listed in
+        // index order, which makes the per-vertex sums independent of how the work is scheduled.
+        std::vector<uint32_t> cornerOffsets(vertexCount + 1, 0);
+        for (size_t c = 0; c < triangleCount * 3; ++c)
+        {
+            ++cornerOffsets[indices[c] + 1];
+        }
+        for (size_t v = 0; v < vertexCount; ++v)
+        {
+            cornerOffsets[v + 1] += cornerOffsets[v];
+        }
+
+        std::vector<uint32_t> corners(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(cornerOffsets.begin(), cornerOffsets.end() - 1);
+            for (size_t c = 0; c < triangleCount * 3; ++c)
+            {
+                corners[fill[indices[c]]++] = (uint32_t)c;
+            }
+        }
+
+        ParallelForBlocks(vertexCount, [&](size_t begin, size_t end)
+        {
+            for (size_t v = begin; v < end; ++v)
+            {
+                float nx = 0, ny = 0, nz = 0;
+                for (uint32_t j = cornerOffsets[v]; j < cornerOffsets[v + 1]; ++j)
+                {
+                    const uint32_t c = corners[j];
+                    nx += cx[c];
+                    ny += cy[c];
+                    nz += cz[c];
+                }
+
+                float *n = StridedFloats(normals, normalStride, v);
+                const float length = sqrtf(nx * nx + ny * ny + nz * nz);
+                if (length > 0)
+                {
+                    n[0] = nx / length;
+                    n[1] = ny / length;
+                    n[2] = nz / length;
+                }
+                else
+                {
+                    n[0] = 0;
+                    n[1] = 1;
+                    n[2] = 0;
+                }
+            }
+        });
+    }
+}
+
+void MBEGenerateNormalsUInt16(const float *positions, size_t positionStride,
+                              float *normals, size_t normalStride, size_t vertexCount,
+                              const uint16_t *indices, size_t indexCount,
+                              MBENormalWeighting weighting)
+{
+    GenerateNormals(positions, positionStride, normals, normalStride, vertexCount, indices, indexCount, weighting);
+}
+
+void MBEGenerateNormalsUInt32(const float *positions, size_t positionStride,
+                              float *normals, size_t normalStride, size_t vertexCount,
+                              const uint32_t *indices, size_t indexCount,
+                              MBENormalWeighting weighting)
+{
+    GenerateNormals(positions, positionStride, normals, normalStride, vertexCount, indices, indexCount, weighting);
+}
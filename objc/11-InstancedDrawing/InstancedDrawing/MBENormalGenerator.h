@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that mesh classes written in plain Objective-C can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    /// Each face contributes in proportion to its area. Cheap, and good for evenly tessellated meshes.
+    MBENormalWeightingArea,
+    /// Each face contributes in proportion to the angle it subtends at the vertex, so the result doesn't
+    /// depend on how a surface was triangulated. This is what keeps triangle fans from skewing normals.
+    MBENormalWeightingAngle,
+} MBENormalWeighting;
+
+/// Computes smooth per-vertex normals for an indexed triangle list. `positions` points at the first
+/// vertex's x, y and z floats and `normals` at the first vertex's normal x, y and z floats, with
+/// consecutive vertices `positionStride` and `normalStride` bytes apart, so both may point into the
+/// same interleaved vertex array. Only the x, y and z components of each normal are written.
+/// Vertices that belong to no non-degenerate triangle get (0, 1, 0).
+///
+/// Face normals are computed in structure-of-arrays batches and summed per vertex through a
+/// vertex-to-corner adjacency table, so the work parallelizes without atomics and the result is the
+/// same however many threads run it.
+void MBEGenerateNormalsUInt16(const float *positions, size_t positionStride,
+                              float *normals, size_t normalStride, size_t vertexCount,
+                              const uint16_t *indices, size_t indexCount,
+                              MBENormalWeighting weighting);
+void MBEGenerateNormalsUInt32(const float *positions, size_t positionStride,
+                              float *normals, size_t normalStride, size_t vertexCount,
+                              const uint32_t *indices, size_t indexCount,
+                              MBENormalWeighting weighting);
+
+#ifdef __cplusplus
+}
+#endif
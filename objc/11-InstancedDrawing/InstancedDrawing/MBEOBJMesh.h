@@ -1,6 +1,9 @@
 @import Foundation;
 @import Metal;
 #import "MBEMesh.h"
+#import "MBETypes.h"
+#import "MBECulling.h"
+#import "MBEMeshSimplifier.h"
 
 @class MBEOBJGroup;
 
@@ -8,4 +11,30 @@
 
 - (instancetype)initWithGroup:(MBEOBJGroup *)group device:(id<MTLDevice>)device;
 
+/// When `compactVertices` is YES, the vertex buffer holds MBECompactVertex rather than MBEVertex,
+/// which takes 16 bytes per vertex instead of 40. Such meshes must be drawn with a vertex function
+/// that decodes compact vertices, and `bounds` must be bound alongside them.
+- (instancetype)initWithGroup:(MBEOBJGroup *)group device:(id<MTLDevice>)device compactVertices:(BOOL)compactVertices;
+
+/// When `levelCount` is greater than 1, the index buffer also holds coarser levels of detail, each with
+/// half the triangles of the one before, simplified from the group's indices when the mesh is created.
+/// All levels share the vertex buffer. `indexCount` is the count of level 0, the original mesh.
+- (instancetype)initWithGroup:(MBEOBJGroup *)group
+                       device:(id<MTLDevice>)device
+              compactVertices:(BOOL)compactVertices
+                   levelCount:(NSUInteger)levelCount;
+
+/// Whether `vertexBuffer` holds MBECompactVertex
+@property (nonatomic, readonly) BOOL hasCompactVertices;
+/// The bounds that compact vertex positions were quantized against; zero for full-precision meshes
+@property (nonatomic, readonly) MBEMeshBounds bounds;
+/// A sphere that encloses every vertex of the mesh, in model space
+@property (nonatomic, readonly) MBEBoundingSphere boundingSphere;
+/// The number of levels of detail in `indexBuffer`, at least 1
+@property (nonatomic, readonly) NSUInteger levelCount;
+
+/// The indices and error of a level of detail. Index offsets are in indices, not bytes, and errors
+/// are in model units and never decrease from one level to the next.
+- (MBEMeshLevelOfDetail)levelOfDetailAtIndex:(NSUInteger)index;
+
 @end
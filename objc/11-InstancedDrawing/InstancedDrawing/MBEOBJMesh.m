@@ -1,26 +1,145 @@
 #import "MBEOBJMesh.h"
 #import "MBEOBJGroup.h"
+#import "MBEVertexCompression.h"
+
+#include <unistd.h>
+
+static id<MTLBuffer> MBENewBufferWithData(id<MTLDevice> device, NSData *data, BOOL pageAligned)
+{
+    const NSUInteger pageSize = getpagesize();
+    if (pageAligned && [data length] > 0 && ((uintptr_t)[data bytes] % pageSize) == 0)
+    {
+        // Wrap the mapped pages directly; the deallocator keeps the data (and its mapping) alive
+        NSUInteger paddedLength = ([data length] + pageSize - 1) / pageSize * pageSize;
+        id<MTLBuffer> buffer = [device newBufferWithBytesNoCopy:(void *)[data bytes]
+                                                         length:paddedLength
+                                                        options:MTLResourceOptionCPUCacheModeDefault
+                                                    deallocator:^(void *pointer, NSUInteger length) { [data self]; }];
+        if (buffer)
+        {
+            return buffer;
+        }
+    }
+
+    return [device newBufferWithBytes:[data bytes]
+                               length:[data length]
+                              options:MTLResourceOptionCPUCacheModeDefault];
+}
+
+@interface MBEOBJMesh ()
+@property (nonatomic, strong) NSData *levels;
+@end
 
 @implementation MBEOBJMesh
 
 @synthesize indexBuffer=_indexBuffer;
 @synthesize vertexBuffer=_vertexBuffer;
+@synthesize indexType=_indexType;
+@synthesize indexCount=_indexCount;
 
 - (instancetype)initWithGroup:(MBEOBJGroup *)group device:(id<MTLDevice>)device
+{
+    return [self initWithGroup:group device:device compactVertices:NO];
+}
+
+- (instancetype)initWithGroup:(MBEOBJGroup *)group device:(id<MTLDevice>)device compactVertices:(BOOL)compactVertices
+{
+    return [self initWithGroup:group device:device compactVertices:compactVertices levelCount:1];
+}
+
+- (instancetype)initWithGroup:(MBEOBJGroup *)group
+                       device:(id<MTLDevice>)device
+              compactVertices:(BOOL)compactVertices
+                   levelCount:(NSUInteger)levelCount
 {
     if ((self = [super init]))
     {
-        _vertexBuffer = [device newBufferWithBytes:[group.vertexData bytes]
-                                            length:[group.vertexData length]
-                                           options:MTLResourceOptionCPUCacheModeDefault];
+        if (compactVertices)
+        {
+            const size_t vertexCount = [group.vertexData length] / sizeof(MBEVertex);
+            NSMutableData *compactData = [NSMutableData dataWithLength:sizeof(MBECompactVertex) * vertexCount];
+            _bounds = MBECompressVertices([group.vertexData bytes], vertexCount, [compactData mutableBytes]);
+            _vertexBuffer = MBENewBufferWithData(device, compactData, NO);
+            _hasCompactVertices = YES;
+        }
+        else
+        {
+            _vertexBuffer = MBENewBufferWithData(device, group.vertexData, group.isPageAligned);
+        }
         [_vertexBuffer setLabel:[NSString stringWithFormat:@"Vertices (%@)", group.name]];
+
+        _boundingSphere = MBEBoundingSphereMake([group.vertexData bytes],
+                                                [group.vertexData length] / sizeof(MBEVertex),
+                                                sizeof(MBEVertex));
         
-        _indexBuffer = [device newBufferWithBytes:[group.indexData bytes]
-                                           length:[group.indexData length]
-                                          options:MTLResourceOptionCPUCacheModeDefault];
+        _indexType = group.indexType;
+
+        // Buffers that wrap mapped pages may be longer than the indices they hold, so count them up front
+        const size_t indexSize = (_indexType == MTLIndexTypeUInt32) ? sizeof(uint32_t) : sizeof(uint16_t);
+        _indexCount = [group.indexData length] / indexSize;
+
+        if (levelCount > 1)
+        {
+            NSData *levelIndexData = [self buildLevelsOfDetail:levelCount fromGroup:group];
+            _indexBuffer = MBENewBufferWithData(device, levelIndexData, NO);
+        }
+        else
+        {
+            MBEMeshLevelOfDetail level = { 0, _indexCount, 0 };
+            _levels = [NSData dataWithBytes:&level length:sizeof(level)];
+            _indexBuffer = MBENewBufferWithData(device, group.indexData, group.isPageAligned);
+        }
         [_indexBuffer setLabel:[NSString stringWithFormat:@"Indices (%@)", group.name]];
     }
     return self;
 }
 
+- (NSData *)buildLevelsOfDetail:(NSUInteger)levelCount fromGroup:(MBEOBJGroup *)group
+{
+    float triangleRatios[levelCount];
+    for (NSUInteger i = 0; i < levelCount; ++i)
+    {
+        triangleRatios[i] = 1.0f / (1 << i);
+    }
+
+    // Vertex positions are read from the full-precision vertices, even when the buffer holds compact ones
+    const float *positions = (const float *)[group.vertexData bytes];
+    const size_t vertexCount = [group.vertexData length] / sizeof(MBEVertex);
+
+    NSMutableData *levels = [NSMutableData dataWithLength:sizeof(MBEMeshLevelOfDetail) * levelCount];
+    NSMutableData *levelIndices = nil;
+    size_t levelIndexCount = 0;
+    if (self.indexType == MTLIndexTypeUInt32)
+    {
+        levelIndices = [NSMutableData dataWithLength:sizeof(uint32_t) * self.indexCount * levelCount];
+        levelIndexCount = MBEBuildLevelsOfDetailUInt32([group.indexData bytes], self.indexCount,
+                                                       positions, sizeof(MBEVertex), vertexCount,
+                                                       triangleRatios, levelCount,
+                                                       [levelIndices mutableBytes], [levels mutableBytes]);
+        [levelIndices setLength:sizeof(uint32_t) * levelIndexCount];
+    }
+    else
+    {
+        levelIndices = [NSMutableData dataWithLength:sizeof(uint16_t) * self.indexCount * levelCount];
+        levelIndexCount = MBEBuildLevelsOfDetailUInt16([group.indexData bytes], self.indexCount,
+                                                       positions, sizeof(MBEVertex), vertexCount,
+                                                       triangleRatios, levelCount,
+                                                       [levelIndices mutableBytes], [levels mutableBytes]);
+        [levelIndices setLength:sizeof(uint16_t) * levelIndexCount];
+    }
+
+    _levels = levels;
+    return levelIndices;
+}
+
+- (NSUInteger)levelCount
+{
+    return [self.levels length] / sizeof(MBEMeshLevelOfDetail);
+}
+
+- (MBEMeshLevelOfDetail)levelOfDetailAtIndex:(NSUInteger)index
+{
+    return ((const MBEMeshLevelOfDetail *)[self.levels bytes])[index];
+}
+
 @end
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Marks a texture coordinate or normal reference that was omitted from a face corner
+static const uint32_t MBEOBJInvalidIndex = 0xffffffff;
+
+struct MBEOBJFloat3
+{
+    float x, y, z;
+};
+
+struct MBEOBJFloat2
+{
+    float x, y;
+};
+
+/// A face corner, expressed as zero-based indices into the file-wide attribute lists.
+/// Relative (negative) references have already been resolved.
+struct MBEOBJFaceCorner
+{
+    uint32_t vi, ti, ni;
+};
+
+/// A run of consecutive faces that belong to the same "g" statement
+struct MBEOBJGroupRange
+{
+    std::string name;
+    size_t firstFace;
+    size_t faceCount;
+};
+
+/// The raw contents of an OBJ file. Faces are stored as a flat list of corners; the corners of
+/// face `i` are `corners[faceStarts[i]]` up to (but not including) `corners[faceStarts[i + 1]]`.
+/// `groups[0]` always exists and collects the faces declared before the first "g" statement;
+/// its name is empty.
+struct MBEOBJData
+{
+    std::vector<MBEOBJFloat3> positions;
+    std::vector<MBEOBJFloat3> normals;
+    std::vector<MBEOBJFloat2> texCoords;
+    std::vector<MBEOBJFaceCorner> corners;
+    std::vector<uint32_t> faceStarts;
+    std::vector<MBEOBJGroupRange> groups;
+
+    size_t faceCount() const { return faceStarts.empty() ? 0 : faceStarts.size() - 1; }
+};
+
+enum MBEOBJParseMode
+{
+    /// Parse the whole file on the calling thread
+    MBEOBJParseModeSerial,
+    /// Split the file into line-aligned chunks and parse them on the shared thread pool. The result
+    /// is identical to a serial parse; small files are parsed serially regardless.
+    MBEOBJParseModeParallel,
+};
+
+/// Parses the "v", "vt", "vn", "f" and "g" records of an in-memory OBJ file. Everything else
+/// (comments, materials, smoothing groups) is skipped. Faces with fewer than three corners or
+/// with position references that are out of range are dropped; out-of-range texture coordinate
+/// and normal references are treated as if they had been omitted.
+void MBEOBJParseBytes(const char *bytes, size_t length, MBEOBJData &data,
+                      MBEOBJParseMode mode = MBEOBJParseModeSerial);
+
+/// Memory-maps the file at `path` and parses it in place. Returns false if the file can't be read.
+bool MBEOBJParseFile(const char *path, MBEOBJData &data, MBEOBJParseMode mode = MBEOBJParseModeSerial);
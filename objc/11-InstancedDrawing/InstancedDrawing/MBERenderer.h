@@ -1,13 +1,23 @@
 @import Foundation;
 @import QuartzCore.CAMetalLayer;
+#import "MBECulling.h"
+
+/// The number of cows the renderer starts with, unless told otherwise
+extern const NSUInteger MBEDefaultCowCount;
 
 @interface MBERenderer : NSObject
 
 @property (nonatomic, assign) float angularVelocity;
 @property (nonatomic, assign) float velocity;
 @property (nonatomic, assign) float frameDuration;
+/// The number of cows in the herd. Changing it replaces the herd with a new one of that size, starting
+/// with the next frame.
+@property (nonatomic, assign) NSUInteger cowCount;
+/// The instances that frustum culling tested and kept in the most recent frame
+@property (nonatomic, readonly) MBECullingStats cullingStats;
 
 - (instancetype)initWithLayer:(CAMetalLayer *)layer;
+- (instancetype)initWithLayer:(CAMetalLayer *)layer cowCount:(NSUInteger)cowCount;
 - (void)draw;
 
 @end
@@ -6,23 +6,43 @@
 #import "MBEMatrixUtilities.h"
 #import "MBETypes.h"
 #import "MBETextureLoader.h"
-#import "MBECow.h"
+#import "MBEAgentSystem.h"
+#import "MBEFrameResources.h"
+#import "MBESpatialIndex.h"
 
-static const size_t MBECowCount = 80;
+#define AlignUp(N, M) ((((N) + (M) - 1) / (M)) * (M))
+
+const NSUInteger MBEDefaultCowCount = 80;
 static const float MBECowSpeed = 0.75;
 static const float MBECowTurnDamping = 0.95;
+// The cow index divides the terrain into cells at least this many times, down to 8 x 8 cells of 5 x 5 units,
+// and more often for larger herds, until there are no more than this many cows to a cell on average
+static const unsigned MBECowIndexMinDepth = 4;
+static const unsigned MBECowIndexMaxDepth = 10;
+static const size_t MBECowsPerIndexCell = 32;
+// Cows are drawn at one of this many levels of detail, each with half the triangles of the one before,
+// choosing the coarsest whose error covers no more than a pixel
+enum { MBECowLevelCount = 4 };
+static const float MBECowPixelTolerance = 1;
+
+// Compact vertices take 16 bytes instead of 40, which cuts the vertex fetch bandwidth of the
+// instanced cows by 60% at the cost of a few instructions of decoding in the vertex function
+static const BOOL MBEUseCompactCowVertices = YES;
 
 static const float MBETerrainSize = 40;
 static const float MBETerrainHeight = 1.5;
 static const float MBETerrainSmoothness = 0.95;
+// Terrain chunks are drawn at the coarsest level of detail whose error covers no more than this many pixels
+static const float MBETerrainPixelTolerance = 2;
 
 static const float MBECameraHeight = 1;
 
 static const vector_float3 Y = { 0, 1, 0 };
 
-static inline float random_unit_float()
+static void MBEGetTerrainHeights(const float *positions, size_t count, float *heights, void *context)
 {
-    return arc4random() / (double)UINT32_MAX;
+    MBETerrainMesh *terrainMesh = (__bridge MBETerrainMesh *)context;
+    [terrainMesh getHeights:heights normals:NULL atPositions:(const vector_float2 *)positions count:count];
 }
 
 @interface MBERenderer ()
@@ -31,32 +51,57 @@ static inline float random_unit_float()
 @property (nonatomic, strong) id<MTLDevice> device;
 @property (nonatomic, strong) id<MTLCommandQueue> commandQueue;
 @property (nonatomic, strong) id<MTLRenderPipelineState> renderPipeline;
+@property (nonatomic, strong) id<MTLRenderPipelineState> compactRenderPipeline;
 @property (nonatomic, strong) id<MTLDepthStencilState> depthState;
 @property (nonatomic, strong) id<MTLTexture> depthTexture;
 @property (nonatomic, strong) id<MTLSamplerState> sampler;
 // Resources
 @property (nonatomic, strong) MBETerrainMesh *terrainMesh;
 @property (nonatomic, strong) id<MTLTexture> terrainTexture;
-@property (nonatomic, strong) MBEMesh *cowMesh;
+@property (nonatomic, strong) MBEOBJMesh *cowMesh;
 @property (nonatomic, strong) id<MTLTexture> cowTexture;
-@property (nonatomic, strong) id<MTLBuffer> sharedUniformBuffer;
-@property (nonatomic, strong) id<MTLBuffer> terrainUniformBuffer;
-@property (nonatomic, strong) id<MTLBuffer> cowUniformBuffer;
+@property (nonatomic, strong) id<MTLBuffer> cowBoundsBuffer;
+@property (nonatomic, strong) MBEFrameResources *frameResources;
+// Offsets of the current frame's uniforms within the frame resource buffer
+@property (nonatomic, assign) NSUInteger sharedUniformOffset;
+@property (nonatomic, assign) NSUInteger terrainUniformOffset;
+@property (nonatomic, assign) NSUInteger cowUniformOffset;
+@property (nonatomic, assign) NSUInteger visibleCowCount;
+@property (nonatomic, assign) MBEFrustum frustum;
+@property (nonatomic, assign) float projectionScale;
 // Parameters
 @property (nonatomic, assign) vector_float3 cameraPosition;
 @property (nonatomic, assign) float cameraHeading;
 @property (nonatomic, assign) float cameraPitch;
-@property (nonatomic, copy) NSArray *cows;
+@property (nonatomic, assign) MBEAgentSystem *cows;
+@property (nonatomic, assign) MBESpatialIndex *cowIndex;
 @property (nonatomic, assign) size_t frameCount;
 @end
 
 @implementation MBERenderer
+{
+    // The number of visible cows drawn at each level of detail, whose uniforms follow one another
+    size_t _cowLevelInstanceCounts[MBECowLevelCount];
+    // Room for the uniforms of every cow while they are sorted by level of detail, kept from frame to frame
+    // so that large herds stay off the stack
+    NSMutableData *_cowSortScratch;
+    // The ids of the cows that survive culling, with room for the whole herd
+    NSMutableData *_visibleCowIDs;
+    // The bounding sphere of every cow, which updates the cow index each frame
+    NSMutableData *_cowSpheres;
+}
 
 - (instancetype)initWithLayer:(CAMetalLayer *)layer
+{
+    return [self initWithLayer:layer cowCount:MBEDefaultCowCount];
+}
+
+- (instancetype)initWithLayer:(CAMetalLayer *)layer cowCount:(NSUInteger)cowCount
 {
     if ((self = [super init]))
     {
         _frameDuration = 1 / 60.0;
+        _cowCount = cowCount;
         _layer = layer;
         [self buildMetal];
         [self buildPipelines];
@@ -66,6 +111,12 @@ static inline float random_unit_float()
     return self;
 }
 
+- (void)dealloc
+{
+    MBEAgentSystemDestroy(_cows);
+    MBESpatialIndexDestroy(_cowIndex);
+}
+
 - (void)buildMetal
 {
     _device = MTLCreateSystemDefaultDevice();
@@ -73,6 +124,26 @@ static inline float random_unit_float()
     _layer.pixelFormat = MTLPixelFormatBGRA8Unorm;
 }
 
+- (id<MTLRenderPipelineState>)newRenderPipelineWithLibrary:(id<MTLLibrary>)library
+                                        vertexFunctionName:(NSString *)vertexFunctionName
+                                          vertexDescriptor:(MTLVertexDescriptor *)vertexDescriptor
+{
+    MTLRenderPipelineDescriptor *pipelineDescriptor = [MTLRenderPipelineDescriptor new];
+    pipelineDescriptor.vertexFunction = [library newFunctionWithName:vertexFunctionName];
+    pipelineDescriptor.fragmentFunction = [library newFunctionWithName:@"fragment_texture"];
+    pipelineDescriptor.vertexDescriptor = vertexDescriptor;
+    pipelineDescriptor.colorAttachments[0].pixelFormat = MTLPixelFormatBGRA8Unorm;
+    pipelineDescriptor.depthAttachmentPixelFormat = MTLPixelFormatDepth32Float;
+
+    NSError *error = nil;
+    id<MTLRenderPipelineState> pipeline = [self.device newRenderPipelineStateWithDescriptor:pipelineDescriptor error:&error];
+    if (!pipeline)
+    {
+        NSLog(@"Failed to create render pipeline state: %@", error);
+    }
+    return pipeline;
+}
+
 - (void)buildPipelines
 {
     _commandQueue = [_device newCommandQueue];
@@ -91,20 +162,28 @@ static inline float random_unit_float()
     vertexDescriptor.attributes[2].bufferIndex = 0;
     vertexDescriptor.layouts[0].stepFunction = MTLVertexStepFunctionPerVertex;
     vertexDescriptor.layouts[0].stride = sizeof(MBEVertex);
-    
-    MTLRenderPipelineDescriptor *pipelineDescriptor = [MTLRenderPipelineDescriptor new];
-    pipelineDescriptor.vertexFunction = [library newFunctionWithName:@"vertex_project"];
-    pipelineDescriptor.fragmentFunction = [library newFunctionWithName:@"fragment_texture"];
-    pipelineDescriptor.vertexDescriptor = vertexDescriptor;
-    pipelineDescriptor.colorAttachments[0].pixelFormat = MTLPixelFormatBGRA8Unorm;
-    pipelineDescriptor.depthAttachmentPixelFormat = MTLPixelFormatDepth32Float;
 
-    NSError *error = nil;
-    _renderPipeline = [self.device newRenderPipelineStateWithDescriptor:pipelineDescriptor error:&error];
-    if (!_renderPipeline)
-    {
-        NSLog(@"Failed to create render pipeline state: %@", error);
-    }
+    _renderPipeline = [self newRenderPipelineWithLibrary:library
+                                      vertexFunctionName:@"vertex_project"
+                                        vertexDescriptor:vertexDescriptor];
+
+    // The normalized formats let the vertex fetch hardware do most of the work of decoding compact vertices
+    MTLVertexDescriptor *compactVertexDescriptor = [MTLVertexDescriptor new];
+    compactVertexDescriptor.attributes[0].format = MTLVertexFormatUShort4Normalized;
+    compactVertexDescriptor.attributes[0].offset = offsetof(MBECompactVertex, position);
+    compactVertexDescriptor.attributes[0].bufferIndex = 0;
+    compactVertexDescriptor.attributes[1].format = MTLVertexFormatShort2Normalized;
+    compactVertexDescriptor.attributes[1].offset = offsetof(MBECompactVertex, normal);
+    compactVertexDescriptor.attributes[1].bufferIndex = 0;
+    compactVertexDescriptor.attributes[2].format = MTLVertexFormatHalf2;
+    compactVertexDescriptor.attributes[2].offset = offsetof(MBECompactVertex, texCoords);
+    compactVertexDescriptor.attributes[2].bufferIndex = 0;
+    compactVertexDescriptor.layouts[0].stepFunction = MTLVertexStepFunctionPerVertex;
+    compactVertexDescriptor.layouts[0].stride = sizeof(MBECompactVertex);
+
+    _compactRenderPipeline = [self newRenderPipelineWithLibrary:library
+                                             vertexFunctionName:@"vertex_project_compact"
+                                               vertexDescriptor:compactVertexDescriptor];
     
     MTLDepthStencilDescriptor *depthDescriptor = [MTLDepthStencilDescriptor new];
     depthDescriptor.depthWriteEnabled = YES;
@@ -123,25 +202,32 @@ static inline float random_unit_float()
 
 - (void)buildCows
 {
-    NSMutableArray *cows = [NSMutableArray arrayWithCapacity:MBECowCount];
-    
-    for (size_t i = 0; i < MBECowCount; ++i)
+    MBEAgentSystemDestroy(_cows);
+    MBESpatialIndexDestroy(_cowIndex);
+
+    MBEAgentParameters parameters;
+    parameters.speed = MBECowSpeed;
+    parameters.turnDamping = MBECowTurnDamping;
+    parameters.minX = -MBETerrainSize * 0.5;
+    parameters.maxX = MBETerrainSize * 0.5;
+    parameters.minZ = -MBETerrainSize * 0.5;
+    parameters.maxZ = MBETerrainSize * 0.5;
+
+    const uint64_t seed = ((uint64_t)arc4random() << 32) | arc4random();
+    const size_t cowCount = self.cowCount;
+    _cows = MBEAgentSystemCreate(cowCount, parameters, seed);
+
+    // A level with depth d has 4^(d - 1) cells
+    unsigned indexDepth = MBECowIndexMinDepth;
+    while (indexDepth < MBECowIndexMaxDepth && ((size_t)1 << (2 * (indexDepth - 1))) * MBECowsPerIndexCell < cowCount)
     {
-        MBECow *cow = [MBECow new];
-        
-        // Situate the cow somewhere in the internal 80% part of the terrain patch
-        float x = (random_unit_float() - 0.5) * MBETerrainSize * 0.8;
-        float z = (random_unit_float() - 0.5) * MBETerrainSize * 0.8;
-        float y = [self.terrainMesh heightAtPositionX:x z:z];
-        
-        cow.position = (vector_float3){ x, y, z };
-        cow.heading = 2 * M_PI * random_unit_float();
-        cow.targetHeading = cow.heading;
-        
-        [cows addObject:cow];
+        ++indexDepth;
     }
-    
-    _cows = [cows copy];
+    _cowIndex = MBESpatialIndexCreate(parameters.minX, parameters.maxX, parameters.minZ, parameters.maxZ, indexDepth);
+
+    _cowSortScratch = [NSMutableData dataWithLength:sizeof(PerInstanceUniforms) * cowCount];
+    _visibleCowIDs = [NSMutableData dataWithLength:sizeof(uint32_t) * cowCount];
+    _cowSpheres = [NSMutableData dataWithLength:sizeof(MBEBoundingSphere) * cowCount];
 }
 
 - (void)loadMeshes
@@ -155,7 +241,17 @@ static inline float random_unit_float()
     NSURL *modelURL = [[NSBundle mainBundle] URLForResource:@"spot" withExtension:@"obj"];
     MBEOBJModel *cowModel = [[MBEOBJModel alloc] initWithContentsOfURL:modelURL generateNormals:YES];
     MBEOBJGroup *spotGroup = [cowModel groupForName:@"spot"];
-    _cowMesh = [[MBEOBJMesh alloc] initWithGroup:spotGroup device:_device];
+    _cowMesh = [[MBEOBJMesh alloc] initWithGroup:spotGroup device:_device compactVertices:MBEUseCompactCowVertices
+                                       levelCount:MBECowLevelCount];
+
+    if (_cowMesh.hasCompactVertices)
+    {
+        MBEMeshBounds bounds = _cowMesh.bounds;
+        _cowBoundsBuffer = [_device newBufferWithBytes:&bounds
+                                                length:sizeof(MBEMeshBounds)
+                                               options:MTLResourceOptionCPUCacheModeDefault];
+        [_cowBoundsBuffer setLabel:@"Cow Bounds"];
+    }
 }
 
 - (void)loadTextures
@@ -167,26 +263,24 @@ static inline float random_unit_float()
     [_cowTexture setLabel:@"Cow Texture"];
 }
 
-- (void)buildUniformBuffers
+- (void)buildFrameResources
 {
-    _sharedUniformBuffer = [_device newBufferWithLength:sizeof(Uniforms)
-                                                        options:MTLResourceOptionCPUCacheModeDefault];
-    [_sharedUniformBuffer setLabel:@"Shared Uniforms"];
-    
-    _terrainUniformBuffer = [_device newBufferWithLength:sizeof(PerInstanceUniforms)
-                                                         options:MTLResourceOptionCPUCacheModeDefault];
-    [_terrainUniformBuffer setLabel:@"Terrain Uniforms"];
-    
-    _cowUniformBuffer = [_device newBufferWithLength:sizeof(PerInstanceUniforms) * MBECowCount
-                                                     options:MTLResourceOptionCPUCacheModeDefault];
-    [_cowUniformBuffer setLabel:@"Cow Uniforms"];
+    // Every uniform that changes from frame to frame is written into the slot of the frame being encoded,
+    // so the CPU never overwrites uniforms that the GPU is still reading
+    const NSUInteger bytesPerFrame = AlignUp(sizeof(Uniforms), MBEFrameResourceAlignment) +
+                                     AlignUp(sizeof(PerInstanceUniforms), MBEFrameResourceAlignment) +
+                                     AlignUp(sizeof(PerInstanceUniforms) * MBEAgentSystemGetCount(self.cows),
+                                             MBEFrameResourceAlignment);
+    _frameResources = [[MBEFrameResources alloc] initWithDevice:_device
+                                                 framesInFlight:MBEDefaultFramesInFlight
+                                                  bytesPerFrame:bytesPerFrame];
 }
 
 - (void)buildResources
 {
     [self loadMeshes];
     [self loadTextures];
-    [self buildUniformBuffers];
+    [self buildFrameResources];
 }
 
 - (void)buildDepthTexture
@@ -230,7 +324,14 @@ static inline float random_unit_float()
     PerInstanceUniforms terrainUniforms;
     terrainUniforms.modelMatrix = matrix_identity();
     terrainUniforms.normalMatrix = matrix_upper_left3x3(terrainUniforms.modelMatrix);
-    memcpy([self.terrainUniformBuffer contents], &terrainUniforms, sizeof(PerInstanceUniforms));
+
+    NSUInteger offset = 0;
+    void *contents = [self.frameResources allocateLength:sizeof(PerInstanceUniforms) offset:&offset];
+    if (contents)
+    {
+        memcpy(contents, &terrainUniforms, sizeof(PerInstanceUniforms));
+    }
+    self.terrainUniformOffset = contents ? offset : NSNotFound;
 }
 
 - (void)updateCamera
@@ -250,34 +351,28 @@ static inline float random_unit_float()
 
 - (void)updateCows
 {
-    for (size_t i = 0; i < MBECowCount; ++i)
+    // all cows select a new heading every ~4 seconds
+    if (self.frameCount % 240 == 0)
+        MBEAgentSystemRetarget(self.cows);
+
+    // move the cows, constrain them to the terrain, and write their matrices straight into this frame's uniforms
+    const size_t cowCount = MBEAgentSystemGetCount(self.cows);
+    NSUInteger offset = 0;
+    void *contents = [self.frameResources allocateLength:sizeof(PerInstanceUniforms) * cowCount offset:&offset];
+    if (!contents)
     {
-        MBECow *cow = self.cows[i];
-
-        // all cows select a new heading every ~4 seconds
-        if (self.frameCount % 240 == 0)
-            cow.targetHeading = 2 * M_PI * random_unit_float();
-
-        // smooth between the current and intended direction
-        cow.heading = (MBECowTurnDamping * cow.heading) + ((1 - MBECowTurnDamping) * cow.targetHeading);
-        
-        // update cow position based on its orientation, constraining to terrain
-        vector_float3 position = cow.position;
-        position.x += sin(cow.heading) * MBECowSpeed * self.frameDuration;
-        position.z += cos(cow.heading) * MBECowSpeed * self.frameDuration;
-        position = [self positionConstrainedToTerrainForPosition:position];
-        cow.position = position;
-
-        // build model matrix for cow
-        matrix_float4x4 rotation = matrix_rotation(Y, -cow.heading);
-        matrix_float4x4 translation = matrix_translation(cow.position);
-
-        // copy matrices into uniform buffers
-        PerInstanceUniforms uniforms;
-        uniforms.modelMatrix = matrix_multiply(translation, rotation);
-        uniforms.normalMatrix = matrix_upper_left3x3(uniforms.modelMatrix);
-        memcpy([self.cowUniformBuffer contents] + sizeof(PerInstanceUniforms) * i, &uniforms, sizeof(PerInstanceUniforms));
+        // The cows stand still, and aren't drawn, for a frame without room for their uniforms
+        self.cowUniformOffset = NSNotFound;
+        return;
     }
+    MBEAgentSystemUpdate(self.cows, self.frameDuration, MBEGetTerrainHeights, (__bridge void *)self.terrainMesh,
+                         (PerInstanceUniforms *)contents);
+    self.cowUniformOffset = offset;
+
+    // Cows rarely leave their cell in a single frame, so most of them stay put in the index
+    MBEBoundingSphere *cowSpheres = _cowSpheres.mutableBytes;
+    MBETransformBoundingSpheres(self.cowMesh.boundingSphere, contents, cowCount, sizeof(PerInstanceUniforms), cowSpheres);
+    MBESpatialIndexUpdate(self.cowIndex, cowSpheres, cowCount);
 }
 
 - (void)updateSharedUniforms
@@ -291,7 +386,68 @@ static inline float random_unit_float()
     
     Uniforms uniforms;
     uniforms.viewProjectionMatrix = matrix_multiply(projectionMatrix, viewMatrix);
-    memcpy([self.sharedUniformBuffer contents], &uniforms, sizeof(Uniforms));
+
+    // Without room for the shared uniforms, nothing is drawn this frame
+    NSUInteger offset = 0;
+    void *contents = [self.frameResources allocateLength:sizeof(Uniforms) offset:&offset];
+    if (contents)
+    {
+        memcpy(contents, &uniforms, sizeof(Uniforms));
+    }
+    self.sharedUniformOffset = contents ? offset : NSNotFound;
+
+    self.frustum = MBEFrustumMake((const float *)&uniforms.viewProjectionMatrix);
+
+    self.projectionScale = self.layer.drawableSize.height / (2 * tan(fov * 0.5));
+    [self.terrainMesh selectLevelsOfDetailForCameraPosition:self.cameraPosition
+                                            projectionScale:self.projectionScale
+                                             pixelTolerance:MBETerrainPixelTolerance];
+}
+
+- (void)cullCows
+{
+    if (self.cowUniformOffset == NSNotFound)
+    {
+        self.visibleCowCount = 0;
+        return;
+    }
+
+    // The uniforms of the cows that may be on screen are packed to the front of this frame's cow uniforms,
+    // so that a single instanced draw covers exactly them
+    PerInstanceUniforms *cowUniforms = (PerInstanceUniforms *)((uint8_t *)[self.frameResources.buffer contents] +
+                                                               self.cowUniformOffset);
+
+    uint32_t *visibleCowIDs = _visibleCowIDs.mutableBytes;
+    MBECullingStats stats = { 0, 0 };
+    const MBEFrustum frustum = self.frustum;
+    const size_t visibleCowCount = MBESpatialIndexQueryFrustum(self.cowIndex, &frustum, visibleCowIDs,
+                                                               MBEAgentSystemGetCount(self.cows), &stats);
+
+    // The ids come back in ascending order, so every cow moves toward the front, past cows already moved
+    for (size_t i = 0; i < visibleCowCount; ++i)
+    {
+        if (visibleCowIDs[i] != i)
+        {
+            cowUniforms[i] = cowUniforms[visibleCowIDs[i]];
+        }
+    }
+
+    self.visibleCowCount = visibleCowCount;
+    _cullingStats = stats;
+
+    // Then they are grouped by level of detail, so that each level is one instanced draw
+    float levelErrors[MBECowLevelCount];
+    const size_t levelCount = MIN(self.cowMesh.levelCount, MBECowLevelCount);
+    for (size_t i = 0; i < levelCount; ++i)
+    {
+        levelErrors[i] = [self.cowMesh levelOfDetailAtIndex:i].error;
+    }
+
+    const vector_float3 cameraPosition = self.cameraPosition;
+    MBESortInstancesByLevelOfDetail((const float *)&cameraPosition, self.projectionScale, MBECowPixelTolerance,
+                                    self.cowMesh.boundingSphere, levelErrors, levelCount,
+                                    cowUniforms, visibleCowCount, sizeof(PerInstanceUniforms),
+                                    _cowSortScratch.mutableBytes, _cowLevelInstanceCounts);
 }
 
 - (void)updateUniforms
@@ -300,6 +456,7 @@ static inline float random_unit_float()
     [self updateCows];
     [self updateCamera];
     [self updateSharedUniforms];
+    [self cullCows];
 }
 
 - (MTLRenderPassDescriptor *)createRenderPassWithColorAttachmentTexture:(id<MTLTexture>)texture
@@ -320,39 +477,84 @@ static inline float random_unit_float()
 
 - (void)drawTerrainWithCommandEncoder:(id<MTLRenderCommandEncoder>)commandEncoder
 {
-    [commandEncoder setVertexBuffer:self.terrainMesh.vertexBuffer offset:0 atIndex:0];
-    [commandEncoder setVertexBuffer:self.sharedUniformBuffer offset:0 atIndex:1];
-    [commandEncoder setVertexBuffer:self.terrainUniformBuffer offset:0 atIndex:2];
+    if (self.sharedUniformOffset == NSNotFound || self.terrainUniformOffset == NSNotFound)
+    {
+        return;
+    }
+
+    [commandEncoder setVertexBuffer:self.frameResources.buffer offset:self.sharedUniformOffset atIndex:1];
+    [commandEncoder setVertexBuffer:self.frameResources.buffer offset:self.terrainUniformOffset atIndex:2];
     [commandEncoder setFragmentTexture:self.terrainTexture atIndex:0];
     [commandEncoder setFragmentSamplerState:self.sampler atIndex:0];
-    
-    [commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
-                               indexCount:[self.terrainMesh.indexBuffer length] / sizeof(MBEIndex)
-                                indexType:MTLIndexTypeUInt16
-                              indexBuffer:self.terrainMesh.indexBuffer
-                        indexBufferOffset:0];
+
+    [self.terrainMesh drawChunksWithCommandEncoder:commandEncoder];
 }
 
 - (void)drawCowsWithCommandEncoder:(id<MTLRenderCommandEncoder>)commandEncoder
 {
+    if (self.visibleCowCount == 0 || self.sharedUniformOffset == NSNotFound)
+    {
+        return;
+    }
+
+    if (self.cowMesh.hasCompactVertices)
+    {
+        [commandEncoder setRenderPipelineState:self.compactRenderPipeline];
+        [commandEncoder setVertexBuffer:self.cowBoundsBuffer offset:0 atIndex:3];
+    }
+    else
+    {
+        [commandEncoder setRenderPipelineState:self.renderPipeline];
+    }
+
     [commandEncoder setVertexBuffer:self.cowMesh.vertexBuffer offset:0 atIndex:0];
-    [commandEncoder setVertexBuffer:self.sharedUniformBuffer offset:0 atIndex:1];
-    [commandEncoder setVertexBuffer:self.cowUniformBuffer offset:0 atIndex:2];
+    [commandEncoder setVertexBuffer:self.frameResources.buffer offset:self.sharedUniformOffset atIndex:1];
     [commandEncoder setFragmentTexture:self.cowTexture atIndex:0];
     [commandEncoder setFragmentSamplerState:self.sampler atIndex:0];
-    
-    [commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
-                               indexCount:[self.cowMesh.indexBuffer length] / sizeof(MBEIndex)
-                                indexType:MTLIndexTypeUInt16
-                              indexBuffer:self.cowMesh.indexBuffer
-                        indexBufferOffset:0
-                            instanceCount:MBECowCount];
+
+    const size_t indexSize = (self.cowMesh.indexType == MTLIndexTypeUInt32) ? sizeof(uint32_t) : sizeof(uint16_t);
+    NSUInteger firstInstance = 0;
+    for (NSUInteger i = 0; i < MIN(self.cowMesh.levelCount, MBECowLevelCount); ++i)
+    {
+        const NSUInteger instanceCount = _cowLevelInstanceCounts[i];
+        if (instanceCount == 0)
+        {
+            continue;
+        }
+
+        // Without base instances, each level's draw starts its instance uniforms at the level's first cow
+        const MBEMeshLevelOfDetail level = [self.cowMesh levelOfDetailAtIndex:i];
+        [commandEncoder setVertexBuffer:self.frameResources.buffer
+                                 offset:self.cowUniformOffset + firstInstance * sizeof(PerInstanceUniforms)
+                                atIndex:2];
+        [commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                                   indexCount:level.indexCount
+                                    indexType:self.cowMesh.indexType
+                                  indexBuffer:self.cowMesh.indexBuffer
+                            indexBufferOffset:level.indexOffset * indexSize
+                                instanceCount:instanceCount];
+        firstInstance += instanceCount;
+    }
 }
 
 - (void)draw
 {
+    // A new herd needs uniforms of a new size. Frames in flight keep the old buffer alive until they
+    // complete, so the new frame resources can be used right away.
+    if (self.cowCount != MBEAgentSystemGetCount(self.cows))
+    {
+        [self buildCows];
+        [self buildFrameResources];
+    }
+
+    // Waits only if the GPU is still executing the frame that last used this frame's uniforms; otherwise
+    // the CPU goes on to prepare this frame while the GPU works through the previous ones
+    [self.frameResources beginFrame];
+
     [self updateUniforms];
 
+    id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
+
     id<CAMetalDrawable> drawable = [self.layer nextDrawable];
 
     if (drawable)
@@ -365,8 +567,6 @@ static inline float random_unit_float()
         
         MTLRenderPassDescriptor *renderPass = [self createRenderPassWithColorAttachmentTexture:[drawable texture]];
 
-        id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
-
         id<MTLRenderCommandEncoder> commandEncoder = [commandBuffer renderCommandEncoderWithDescriptor:renderPass];
         [commandEncoder setRenderPipelineState:self.renderPipeline];
         [commandEncoder setDepthStencilState:self.depthState];
@@ -379,10 +579,14 @@ static inline float random_unit_float()
         [commandEncoder endEncoding];
         
         [commandBuffer presentDrawable:drawable];
-        [commandBuffer commit];
         
         ++self.frameCount;
     }
+
+    // The command buffer is committed even when there was no drawable, so that its completion releases
+    // this frame's uniforms
+    [self.frameResources endFrameWithCommandBuffer:commandBuffer];
+    [commandBuffer commit];
 }
 
 @end
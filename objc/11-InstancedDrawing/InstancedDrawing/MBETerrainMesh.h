@@ -1,22 +1,82 @@
-#import "MBEMesh.h"
+@import Foundation;
+@import Metal;
+#import "MBETerrainChunk.h"
 
-@interface MBETerrainMesh : MBEMesh
+/// The default number of quads along each edge of a terrain chunk. Chunks this size have
+/// 129 x 129 vertices, which is as many as 16-bit indices can address.
+extern const NSUInteger MBETerrainDefaultChunkSize;
+
+/// The largest supported number of subdivisions, which makes a terrain 8193 vertices on a side
+extern const NSUInteger MBETerrainMaxIterations;
+
+@interface MBETerrainMesh : NSObject
 
 @property (nonatomic, readonly) float width;
 @property (nonatomic, readonly) float depth;
 @property (nonatomic, readonly) float height;
 
+/// The pieces of the terrain, in row-major order, each of which is drawn as a separate mesh
+@property (nonatomic, readonly) NSArray *chunks;
+/// The number of quads along each edge of a chunk
+@property (nonatomic, readonly) NSUInteger chunkSize;
+/// The number of chunks along each edge of the terrain
+@property (nonatomic, readonly) NSUInteger chunksPerEdge;
+/// The number of levels of detail each chunk can be drawn at. Level 0 is full detail, and each
+/// further level halves the number of vertices along each edge of a chunk.
+@property (nonatomic, readonly) NSUInteger levelCount;
+/// The number of triangles drawn by `drawChunksWithCommandEncoder:` with the current levels of detail
+@property (nonatomic, readonly) NSUInteger triangleCount;
+
 /// Generates a square patch of terrain, using the diamond-square midpoint displacement algorithm.
 /// Smoothness varies from 0 to 1, with 1 being the smoothest. `iterations` determines how many
 /// times the recursive subdivision algorithm is applied; the total number of triangles is
 /// 2 * (2 ^ (2 * iterations)). `width` determines both the width and depth of the patch. `height`
 /// is the maximum possible distance from the lowest point to the highest point on the patch.
+/// The terrain is split into chunks of `chunkSize` quads on a side, which is rounded down to a
+/// power of two and limited to the size of the terrain. The same `seed` always produces the same terrain.
 - (instancetype)initWithWidth:(float)width
                        height:(float)height
                    iterations:(uint16_t)iterations
                    smoothness:(float)smoothness
+                    chunkSize:(NSUInteger)chunkSize
+                         seed:(uint64_t)seed
                        device:(id<MTLDevice>)device;
 
+/// Generates a patch of terrain from a random seed, in chunks of the default size
+- (instancetype)initWithWidth:(float)width
+                       height:(float)height
+                   iterations:(uint16_t)iterations
+                   smoothness:(float)smoothness
+                       device:(id<MTLDevice>)device;
+
+/// The height of the terrain at (x, z). Positions outside the terrain take the height of its nearest edge.
 - (float)heightAtPositionX:(float)x z:(float)z;
 
+/// Looks up the terrain under `count` positions at once, which is much cheaper than asking for them one
+/// by one. `positions` holds (x, z) pairs. If `normals` is not NULL, it receives the unit surface normal
+/// at each position.
+- (void)getHeights:(float *)heights
+           normals:(vector_float3 *)normals
+       atPositions:(const vector_float2 *)positions
+             count:(NSUInteger)count;
+
+/// Finds where a ray first meets the terrain surface, if it does so within `maxDistance` units along
+/// `direction`. On success, `distance` receives the distance in units of `direction`.
+- (BOOL)intersectRayWithOrigin:(vector_float3)origin
+                     direction:(vector_float3)direction
+                   maxDistance:(float)maxDistance
+                      distance:(float *)distance;
+
+/// Chooses a level of detail for each chunk, so that no chunk's geometric error appears larger than
+/// `pixelTolerance` pixels from `cameraPosition`. `projectionScale` is the viewport height in pixels
+/// divided by 2 tan(fovy / 2). Neighboring chunks never differ by more than one level, and finer
+/// chunks stitch their edges to coarser neighbors, so the surface has no cracks.
+- (void)selectLevelsOfDetailForCameraPosition:(vector_float3)cameraPosition
+                              projectionScale:(float)projectionScale
+                               pixelTolerance:(float)pixelTolerance;
+
+/// Draws every chunk at its selected level of detail, binding each chunk's vertices at buffer index 0.
+/// Until levels are selected, chunks are drawn at full detail.
+- (void)drawChunksWithCommandEncoder:(id<MTLRenderCommandEncoder>)commandEncoder;
+
 @end
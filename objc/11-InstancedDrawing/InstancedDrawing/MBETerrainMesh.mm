@@ -0,0 +1,291 @@
+#import "MBETerrainMesh.h"
+#import "MBETypes.h"
+#import "MBEHeightfield.h"
+#import "MBETerrainLOD.h"
+#import "MBEHeightfieldSampler.h"
+#import "MBEThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+const NSUInteger MBETerrainDefaultChunkSize = 128;
+const NSUInteger MBETerrainMaxIterations = 13;
+
+// Chunks with no more than this many vertices are drawn with 16-bit indices
+static const size_t MBEMaxVertexCountFor16BitIndices = 65536;
+
+// Normals are computed as if the terrain were this much taller, which exaggerates its relief under lighting
+static const float MBETerrainNormalHeightScale = 4;
+
+static const float MBETerrainTextureScale = 5;
+
+@interface MBETerrainMesh ()
+{
+    std::unique_ptr<MBEHeightfield> _heightfield;
+    std::unique_ptr<MBETerrainLOD> _levelsOfDetail;
+    std::unique_ptr<MBEHeightfieldSampler> _sampler;
+    std::vector<MBETerrainChunkLOD> _chunkLevels;
+}
+@property (nonatomic, weak) id<MTLDevice> device;
+@property (nonatomic, assign) float smoothness;
+@property (nonatomic, assign) uint16_t iterations;
+@property (nonatomic, assign) size_t stride; // number of vertices per edge
+@end
+
+@implementation MBETerrainMesh
+
+- (instancetype)initWithWidth:(float)width
+                       height:(float)height
+                   iterations:(uint16_t)iterations
+                   smoothness:(float)smoothness
+                       device:(id<MTLDevice>)device
+{
+    const uint64_t seed = ((uint64_t)arc4random() << 32) | arc4random();
+    return [self initWithWidth:width
+                        height:height
+                    iterations:iterations
+                    smoothness:smoothness
+                     chunkSize:MBETerrainDefaultChunkSize
+                          seed:seed
+                        device:device];
+}
+
+- (instancetype)initWithWidth:(float)width
+                       height:(float)height
+                   iterations:(uint16_t)iterations
+                   smoothness:(float)smoothness
+                    chunkSize:(NSUInteger)chunkSize
+                         seed:(uint64_t)seed
+                       device:(id<MTLDevice>)device
+{
+    if (iterations > MBETerrainMaxIterations)
+    {
+        NSLog(@"Too many terrain mesh subdivisions requested (%d). At most %d are supported.",
+              (int)iterations, (int)MBETerrainMaxIterations);
+        return nil;
+    }
+
+    if ((self = [super init]))
+    {
+        _width = width;
+        _depth = width;
+        _height = height;
+        _smoothness = smoothness;
+        _iterations = iterations;
+        _device = device;
+
+        // Chunks must tile the terrain exactly, so their size is a power of two no larger than the terrain
+        const NSUInteger quadsPerEdge = (NSUInteger)1 << iterations;
+        _chunkSize = 1;
+        while (_chunkSize * 2 <= std::min(chunkSize, quadsPerEdge))
+        {
+            _chunkSize *= 2;
+        }
+        _chunksPerEdge = quadsPerEdge / _chunkSize;
+
+        [self generateTerrainWithSeed:seed];
+    }
+    return self;
+}
+
+- (void)generateTerrainWithSeed:(uint64_t)seed
+{
+    _heightfield.reset(new MBEHeightfield(_iterations, _smoothness, seed));
+    _stride = _heightfield->stride();
+
+    _levelsOfDetail.reset(new MBETerrainLOD(*_heightfield, _chunkSize, _width / (_stride - 1), _height));
+    _sampler.reset(new MBEHeightfieldSampler(*_heightfield, _width / (_stride - 1), _height));
+    _levelCount = _levelsOfDetail->levelCount();
+
+    const size_t chunkStride = _chunkSize + 1;
+    const size_t chunkVertexCount = chunkStride * chunkStride;
+    const size_t chunkCount = _chunksPerEdge * _chunksPerEdge;
+
+    id<MTLBuffer> indexBuffer = [self newChunkIndexBuffer];
+    const MTLIndexType indexType = (chunkVertexCount <= MBEMaxVertexCountFor16BitIndices) ? MTLIndexTypeUInt16 : MTLIndexTypeUInt32;
+
+    // Buffers are allocated up front so that the chunks can be filled in parallel, straight into the memory
+    // the GPU will read
+    NSMutableArray *vertexBuffers = [NSMutableArray arrayWithCapacity:chunkCount];
+    std::vector<MBEVertex *> chunkVertices(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        id<MTLBuffer> vertexBuffer = [_device newBufferWithLength:sizeof(MBEVertex) * chunkVertexCount
+                                                          options:MTLResourceOptionCPUCacheModeDefault];
+        [vertexBuffer setLabel:[NSString stringWithFormat:@"Vertices (Terrain Chunk %d)", (int)i]];
+        [vertexBuffers addObject:vertexBuffer];
+        chunkVertices[i] = (MBEVertex *)[vertexBuffer contents];
+    }
+
+    std::vector<vector_float3> boundsMin(chunkCount);
+    std::vector<vector_float3> boundsMax(chunkCount);
+
+    MBEThreadPool::sharedPool().parallelFor(chunkCount, [&](size_t i)
+    {
+        const size_t firstRow = (i / _chunksPerEdge) * _chunkSize;
+        const size_t firstColumn = (i % _chunksPerEdge) * _chunkSize;
+        [self fillChunkVertices:chunkVertices[i]
+                       firstRow:firstRow
+                    firstColumn:firstColumn
+                      boundsMin:&boundsMin[i]
+                      boundsMax:&boundsMax[i]];
+    });
+
+    NSMutableArray *chunks = [NSMutableArray arrayWithCapacity:chunkCount];
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        MBETerrainChunk *chunk = [[MBETerrainChunk alloc] initWithVertexBuffer:vertexBuffers[i]
+                                                                   indexBuffer:indexBuffer
+                                                                     indexType:indexType
+                                                                    indexCount:_levelsOfDetail->levelRange(0).count
+                                                                     boundsMin:boundsMin[i]
+                                                                     boundsMax:boundsMax[i]];
+        [chunks addObject:chunk];
+    }
+    _chunks = [chunks copy];
+
+    _chunkLevels.assign(chunkCount, MBETerrainChunkLOD());
+    _triangleCount = chunkCount * _levelsOfDetail->levelRange(0).count / 3;
+}
+
+- (void)fillChunkVertices:(MBEVertex *)vertices
+                 firstRow:(size_t)firstRow
+              firstColumn:(size_t)firstColumn
+                boundsMin:(vector_float3 *)outBoundsMin
+                boundsMax:(vector_float3 *)outBoundsMax
+{
+    const size_t chunkStride = _chunkSize + 1;
+    const float spacing = _width / (_stride - 1);
+
+    vector_float3 boundsMin = { INFINITY, INFINITY, INFINITY };
+    vector_float3 boundsMax = { -INFINITY, -INFINITY, -INFINITY };
+
+    for (size_t r = 0; r < chunkStride; ++r)
+    {
+        for (size_t c = 0; c < chunkStride; ++c)
+        {
+            // Positions and texture coordinates are computed from the terrain-wide row and column, so
+            // vertices on the seam between two chunks are identical in both
+            const size_t row = firstRow + r;
+            const size_t column = firstColumn + c;
+            MBEVertex &vertex = vertices[r * chunkStride + c];
+
+            const float x = ((float)column / (_stride - 1) - 0.5) * _width;
+            const float y = _heightfield->height(row, column) * _height;
+            const float z = ((float)row / (_stride - 1) - 0.5) * _depth;
+            vertex.position = (vector_float4){ x, y, z, 1 };
+
+            float normal[3];
+            _heightfield->normal(row, column, spacing, _height * MBETerrainNormalHeightScale, normal);
+            vertex.normal = (vector_float4){ normal[0], normal[1], normal[2], 0 };
+
+            const float s = (float)column / (_stride - 1) * MBETerrainTextureScale;
+            const float t = (float)row / (_stride - 1) * MBETerrainTextureScale;
+            vertex.texCoords = (vector_float2){ s, t };
+
+            const vector_float3 position = { x, y, z };
+            boundsMin = vector_min(boundsMin, position);
+            boundsMax = vector_max(boundsMax, position);
+        }
+    }
+
+    *outBoundsMin = boundsMin;
+    *outBoundsMax = boundsMax;
+}
+
+- (id<MTLBuffer>)newChunkIndexBuffer
+{
+    // Every chunk is a grid of the same size, so they can all share the indices of every level of detail
+    const size_t chunkStride = _chunkSize + 1;
+    const std::vector<uint32_t> &indices = _levelsOfDetail->indices();
+
+    id<MTLBuffer> indexBuffer = nil;
+    if (chunkStride * chunkStride <= MBEMaxVertexCountFor16BitIndices)
+    {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        indexBuffer = [_device newBufferWithBytes:shortIndices.data()
+                                           length:sizeof(uint16_t) * shortIndices.size()
+                                          options:MTLResourceOptionCPUCacheModeDefault];
+    }
+    else
+    {
+        indexBuffer = [_device newBufferWithBytes:indices.data()
+                                           length:sizeof(uint32_t) * indices.size()
+                                          options:MTLResourceOptionCPUCacheModeDefault];
+    }
+    [indexBuffer setLabel:@"Indices (Terrain Chunks)"];
+    return indexBuffer;
+}
+
+- (void)selectLevelsOfDetailForCameraPosition:(vector_float3)cameraPosition
+                              projectionScale:(float)projectionScale
+                               pixelTolerance:(float)pixelTolerance
+{
+    const float position[3] = { cameraPosition.x, cameraPosition.y, cameraPosition.z };
+    _triangleCount = _levelsOfDetail->selectLevels(position, projectionScale, pixelTolerance, _chunkLevels);
+}
+
+- (void)drawChunksWithCommandEncoder:(id<MTLRenderCommandEncoder>)commandEncoder
+{
+    for (NSUInteger i = 0; i < _chunks.count; ++i)
+    {
+        MBETerrainChunk *chunk = _chunks[i];
+        const MBETerrainChunkLOD chunkLevel = _chunkLevels[i];
+        const size_t indexSize = (chunk.indexType == MTLIndexTypeUInt32) ? sizeof(uint32_t) : sizeof(uint16_t);
+
+        // An unstitched level is one contiguous range; otherwise the stitched border follows separately
+        MBETerrainIndexRange ranges[2];
+        size_t rangeCount = 0;
+        if (chunkLevel.stitchMask == 0)
+        {
+            ranges[rangeCount++] = _levelsOfDetail->levelRange(chunkLevel.level);
+        }
+        else
+        {
+            ranges[rangeCount++] = _levelsOfDetail->interiorRange(chunkLevel.level);
+            ranges[rangeCount++] = _levelsOfDetail->borderRange(chunkLevel.level, chunkLevel.stitchMask);
+        }
+
+        [commandEncoder setVertexBuffer:chunk.vertexBuffer offset:0 atIndex:0];
+        for (size_t r = 0; r < rangeCount; ++r)
+        {
+            if (ranges[r].count == 0)
+            {
+                continue;
+            }
+
+            [commandEncoder drawIndexedPrimitives:MTLPrimitiveTypeTriangle
+                                       indexCount:ranges[r].count
+                                        indexType:chunk.indexType
+                                      indexBuffer:chunk.indexBuffer
+                                indexBufferOffset:ranges[r].offset * indexSize];
+        }
+    }
+}
+
+- (float)heightAtPositionX:(float)x z:(float)z
+{
+    return _sampler->height(x, z);
+}
+
+- (void)getHeights:(float *)heights
+           normals:(vector_float3 *)normals
+       atPositions:(const vector_float2 *)positions
+             count:(NSUInteger)count
+{
+    static_assert(sizeof(vector_float2) == sizeof(float) * 2, "positions must be tightly packed (x, z) pairs");
+    _sampler->sampleHeights((const float *)positions, count, heights, (float *)normals, sizeof(vector_float3));
+}
+
+- (BOOL)intersectRayWithOrigin:(vector_float3)origin
+                     direction:(vector_float3)direction
+                   maxDistance:(float)maxDistance
+                      distance:(float *)distance
+{
+    const float rayOrigin[3] = { origin.x, origin.y, origin.z };
+    const float rayDirection[3] = { direction.x, direction.y, direction.z };
+    return _sampler->intersectRay(rayOrigin, rayDirection, maxDistance, distance);
+}
+
+@end
@@ -1,59 +1,17 @@
 #import "MBETextureLoader.h"
+#import "MBECachedTextureLoader.h"
 
 @implementation MBETextureLoader
 
-+ (uint8_t *)dataForImage:(UIImage *)image
-{
-    CGImageRef imageRef = [image CGImage];
-    
-    // Create a suitable bitmap context for extracting the bits of the image
-    const NSUInteger width = CGImageGetWidth(imageRef);
-    const NSUInteger height = CGImageGetHeight(imageRef);
-    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-    uint8_t *rawData = (uint8_t *)calloc(height * width * 4, sizeof(uint8_t));
-    const NSUInteger bytesPerPixel = 4;
-    const NSUInteger bytesPerRow = bytesPerPixel * width;
-    const NSUInteger bitsPerComponent = 8;
-    CGContextRef context = CGBitmapContextCreate(rawData, width, height,
-                                                 bitsPerComponent, bytesPerRow, colorSpace,
-                                                 kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
-    CGColorSpaceRelease(colorSpace);
-
-    CGContextTranslateCTM(context, 0, height);
-    CGContextScaleCTM(context, 1, -1);
-
-    CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
-    CGContextRelease(context);
-    
-    return rawData;
-}
-
 + (id<MTLTexture>)texture2DWithImageNamed:(NSString *)imageName device:(id<MTLDevice>)device commandQueue:(id<MTLCommandQueue>)commandQueue
 {
-    UIImage *image = [UIImage imageNamed:imageName];
-    CGSize imageSize = CGSizeMake(image.size.width * image.scale, image.size.height * image.scale);
-    const NSUInteger bytesPerPixel = 4;
-    const NSUInteger bytesPerRow = bytesPerPixel * imageSize.width;
-    uint8_t *imageData = [self dataForImage:image];
-    
-    MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA8Unorm
-                                                                                                 width:imageSize.width
-                                                                                                height:imageSize.height
-                                                                                             mipmapped:YES];
-    id<MTLTexture> texture = [device newTextureWithDescriptor:textureDescriptor];
-    
-    MTLRegion region = MTLRegionMake2D(0, 0, imageSize.width, imageSize.height);
-    [texture replaceRegion:region mipmapLevel:0 withBytes:imageData bytesPerRow:bytesPerRow];
-    
-    free(imageData);
-    
-    id<MTLCommandBuffer> mipmapCommandBuffer = [commandQueue commandBuffer];
-    id<MTLBlitCommandEncoder> blitCommandEncoder = [mipmapCommandBuffer blitCommandEncoder];
-    [blitCommandEncoder generateMipmapsForTexture:texture];
-    [blitCommandEncoder endEncoding];
-    [mipmapCommandBuffer commit];
-    
-    return texture;
+    // Mipmaps come from the texture cache, which builds them on the CPU once and keeps them on disk,
+    // so no blit needs to be encoded on `commandQueue`
+    return [[MBECachedTextureLoader sharedTextureLoader] texture2DWithImageNamed:imageName
+                                                                     pixelFormat:MTLPixelFormatRGBA8Unorm
+                                                                       mipmapped:YES
+                                                                         flipped:YES
+                                                                          device:device];
 }
 
 @end
@@ -19,3 +19,21 @@ typedef struct
     packed_float4 normal;
     packed_float2 texCoords;
 } MBEVertex;
+
+/// A 16-byte alternative to MBEVertex for meshes that are drawn many times. Positions are quantized
+/// to 16 bits across the mesh's bounding box (see MBEMeshBounds), normals are octahedral-encoded as
+/// two signed, normalized 16-bit values, and texture coordinates are half-precision floats.
+typedef struct
+{
+    uint16_t position[4]; // x, y, z; w is padding that keeps the normal 8-byte aligned
+    int16_t normal[2];
+    uint16_t texCoords[2];
+} MBECompactVertex;
+
+/// Recovers model-space positions from the normalized positions of compact vertices:
+/// position = origin + quantized / 65535 * extent
+typedef struct
+{
+    vector_float4 origin;
+    vector_float4 extent;
+} MBEMeshBounds;
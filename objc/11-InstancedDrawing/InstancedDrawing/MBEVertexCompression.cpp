@@ -0,0 +1,255 @@
+#include "MBEVertexCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    const float PositionScale = 65535.0f;
+    const float NormalScale = 32767.0f;
+
+    inline float SignNotZero(float value)
+    {
+        return (value >= 0) ? 1.0f : -1.0f;
+    }
+
+    // Matches the GPU's conversion of a signed, normalized 16-bit attribute to float
+    inline float SnormToFloat(int16_t value)
+    {
+        return std::max(value / NormalScale, -1.0f);
+    }
+
+    inline int16_t FloatToSnorm(float value)
+    {
+        return (int16_t)std::max(-NormalScale, std::min(NormalScale, value));
+    }
+
+    void OctahedralDecodeFloat(float ex, float ey, float *x, float *y, float *z)
+    {
+        float nx = ex;
+        float ny = ey;
+        float nz = 1 - fabsf(ex) - fabsf(ey);
+
+        // Points outside the central diamond belong to the lower hemisphere; fold them back
+        const float t = std::max(-nz, 0.0f);
+        nx += (nx >= 0) ? -t : t;
+        ny += (ny >= 0) ? -t : t;
+
+        const float length = sqrtf(nx * nx + ny * ny + nz * nz);
+        *x = nx / length;
+        *y = ny / length;
+        *z = nz / length;
+    }
+}
+
+void MBEOctahedralEncode(float x, float y, float z, int16_t encoded[2])
+{
+    const float l1 = fabsf(x) + fabsf(y) + fabsf(z);
+    if (l1 == 0)
+    {
+        encoded[0] = 0;
+        encoded[1] = 0;
+        return;
+    }
+
+    float px = x / l1;
+    float py = y / l1;
+    if (z < 0)
+    {
+        const float fx = (1 - fabsf(py)) * SignNotZero(px);
+        const float fy = (1 - fabsf(px)) * SignNotZero(py);
+        px = fx;
+        py = fy;
+    }
+
+    // Truncating to the grid can cost noticeably more accuracy than the format allows, so try all four
+    // neighboring grid points and keep the one whose decoded direction is closest to the input
+    const float gx = floorf(px * NormalScale);
+    const float gy = floorf(py * NormalScale);
+    float bestDot = -2;
+    for (int i = 0; i < 4; ++i)
+    {
+        const int16_t cx = FloatToSnorm(gx + (i & 1));
+        const int16_t cy = FloatToSnorm(gy + (i >> 1));
+
+        float dx, dy, dz;
+        OctahedralDecodeFloat(SnormToFloat(cx), SnormToFloat(cy), &dx, &dy, &dz);
+        const float dot = dx * x + dy * y + dz * z;
+        if (dot > bestDot)
+        {
+            bestDot = dot;
+            encoded[0] = cx;
+            encoded[1] = cy;
+        }
+    }
+}
+
+void MBEOctahedralDecode(const int16_t encoded[2], float *x, float *y, float *z)
+{
+    OctahedralDecodeFloat(SnormToFloat(encoded[0]), SnormToFloat(encoded[1]), x, y, z);
+}
+
+uint16_t MBEFloatToHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000;
+    const uint32_t exponent = (bits >> 23) & 0xff;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent == 0xff)
+    {
+        // Infinity stays infinity; NaNs keep their top payload bits and stay quiet
+        return (uint16_t)(sign | 0x7c00 | (mantissa ? (0x200 | (mantissa >> 13)) : 0));
+    }
+
+    const int32_t halfExponent = (int32_t)exponent - 127 + 15;
+    if (halfExponent >= 31)
+    {
+        return (uint16_t)(sign | 0x7c00);
+    }
+
+    if (halfExponent <= 0)
+    {
+        // The result is subnormal (or zero): shift the mantissa, with its implicit bit, into place
+        if (halfExponent < -10)
+        {
+            return (uint16_t)sign;
+        }
+
+        mantissa |= 0x800000;
+        const uint32_t shift = (uint32_t)(14 - halfExponent);
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))
+        {
+            ++half;
+        }
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = ((uint32_t)halfExponent << 10) | (mantissa >> 13);
+    const uint32_t remainder = mantissa & 0x1fff;
+
+    // A carry out of the mantissa correctly bumps the exponent, up to and including infinity
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+    {
+        ++half;
+    }
+    return (uint16_t)(sign | half);
+}
+
+float MBEHalfToFloat(uint16_t value)
+{
+    const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1f;
+    uint32_t mantissa = value & 0x3ff;
+    uint32_t bits;
+
+    if (exponent == 0x1f)
+    {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent == 0)
+    {
+        if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Renormalize the subnormal value
+            int32_t shift = 0;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                ++shift;
+            }
+            bits = sign | ((uint32_t)(127 - 14 - shift) << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    }
+    else
+    {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+MBEMeshBounds MBECompressVertices(const MBEVertex *vertices, size_t vertexCount, MBECompactVertex *compactVertices)
+{
+    float lower[3] = { 0, 0, 0 };
+    float upper[3] = { 0, 0, 0 };
+    if (vertexCount > 0)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            lower[k] = upper[k] = vertices[0].position[k];
+        }
+    }
+
+    for (size_t i = 1; i < vertexCount; ++i)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            lower[k] = std::min(lower[k], (float)vertices[i].position[k]);
+            upper[k] = std::max(upper[k], (float)vertices[i].position[k]);
+        }
+    }
+
+    MBEMeshBounds bounds;
+    for (int k = 0; k < 3; ++k)
+    {
+        bounds.origin[k] = lower[k];
+        bounds.extent[k] = upper[k] - lower[k];
+    }
+    bounds.origin[3] = 1;
+    bounds.extent[3] = 0;
+
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        const MBEVertex &vertex = vertices[i];
+        MBECompactVertex &compact = compactVertices[i];
+
+        for (int k = 0; k < 3; ++k)
+        {
+            // Flat axes quantize to zero, which decodes back to the origin exactly
+            const float normalized = (bounds.extent[k] > 0) ? (vertex.position[k] - lower[k]) / bounds.extent[k] : 0;
+            compact.position[k] = (uint16_t)lrintf(std::max(0.0f, std::min(1.0f, normalized)) * PositionScale);
+        }
+        compact.position[3] = 0;
+
+        MBEOctahedralEncode(vertex.normal[0], vertex.normal[1], vertex.normal[2], compact.normal);
+
+        compact.texCoords[0] = MBEFloatToHalf(vertex.texCoords[0]);
+        compact.texCoords[1] = MBEFloatToHalf(vertex.texCoords[1]);
+    }
+
+    return bounds;
+}
+
+MBEVertex MBEDecompressVertex(const MBECompactVertex *compactVertex, MBEMeshBounds bounds)
+{
+    MBEVertex vertex;
+    for (int k = 0; k < 3; ++k)
+    {
+        vertex.position[k] = bounds.origin[k] + (compactVertex->position[k] / PositionScale) * bounds.extent[k];
+    }
+    vertex.position[3] = 1;
+
+    float x, y, z;
+    MBEOctahedralDecode(compactVertex->normal, &x, &y, &z);
+    vertex.normal[0] = x;
+    vertex.normal[1] = y;
+    vertex.normal[2] = z;
+    vertex.normal[3] = 0;
+
+    vertex.texCoords[0] = MBEHalfToFloat(compactVertex->texCoords[0]);
+    vertex.texCoords[1] = MBEHalfToFloat(compactVertex->texCoords[1]);
+    return vertex;
+}
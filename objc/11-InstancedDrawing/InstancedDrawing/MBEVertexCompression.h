@@ -0,0 +1,34 @@
+#pragma once
+
+#import "MBETypes.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that mesh classes written in plain Objective-C can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Encodes `vertexCount` vertices as MBECompactVertex and returns the bounds that the shader needs
+/// to decode their positions. Normals are expected to be unit length.
+MBEMeshBounds MBECompressVertices(const MBEVertex *vertices, size_t vertexCount, MBECompactVertex *compactVertices);
+
+/// The inverse of MBECompressVertices, for a single vertex. Mirrors the decoding done by
+/// `vertex_project_compact` in Shaders.metal.
+MBEVertex MBEDecompressVertex(const MBECompactVertex *compactVertex, MBEMeshBounds bounds);
+
+/// Maps a unit vector onto the octahedron and unfolds it into the square [-1, 1]^2, stored as signed,
+/// normalized 16-bit values. Of the four nearest representable points, the one that decodes closest
+/// to the input is chosen.
+void MBEOctahedralEncode(float x, float y, float z, int16_t encoded[2]);
+void MBEOctahedralDecode(const int16_t encoded[2], float *x, float *y, float *z);
+
+/// Converts between single precision and IEEE 754 half precision, rounding to nearest even
+uint16_t MBEFloatToHalf(float value);
+float MBEHalfToFloat(uint16_t value);
+
+#ifdef __cplusplus
+}
+#endif
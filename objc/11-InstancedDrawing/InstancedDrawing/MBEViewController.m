@@ -5,6 +5,9 @@
 
 static const float MBERotationSpeed = 3; // radians per second
 
+// The size of the herd can be set with a launch argument, such as -MBECowCount 100000
+static NSString *const MBECowCountDefaultsKey = @"MBECowCount";
+
 @interface MBEViewController ()
 @property (nonatomic, readonly) MBEMetalView *metalView;
 @property (nonatomic, strong) MBERenderer *renderer;
@@ -18,7 +21,9 @@ static const float MBERotationSpeed = 3; // radians per second
 {
     [super viewDidLoad];
     
-    self.renderer = [[MBERenderer alloc] initWithLayer:self.metalView.metalLayer];
+    NSInteger cowCount = [[NSUserDefaults standardUserDefaults] integerForKey:MBECowCountDefaultsKey];
+    self.renderer = [[MBERenderer alloc] initWithLayer:self.metalView.metalLayer
+                                              cowCount:(cowCount > 0) ? cowCount : MBEDefaultCowCount];
     
     self.displayLink = [CADisplayLink displayLinkWithTarget:self
                                                    selector:@selector(displayLinkDidFire:)];
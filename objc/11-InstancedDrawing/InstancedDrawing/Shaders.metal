@@ -10,6 +10,15 @@ struct InVertex
     float2 texCoords [[attribute(2)]];
 };
 
+// The attribute formats declared in the vertex descriptor do the first step of decoding: positions
+// arrive normalized to [0, 1], normals to [-1, 1], and texture coordinates as floats
+struct InCompactVertex
+{
+    float4 position [[attribute(0)]];
+    float2 normal [[attribute(1)]];
+    float2 texCoords [[attribute(2)]];
+};
+
 struct ProjectedVertex
 {
     float4 position [[position]];
@@ -28,20 +37,60 @@ struct PerInstanceUniforms
     float3x3 normalMatrix;
 };
 
+struct MeshBounds
+{
+    float4 origin;
+    float4 extent;
+};
+
+static ProjectedVertex project_vertex(float4 position,
+                                      float3 normal,
+                                      float2 texCoords,
+                                      constant Uniforms &uniforms,
+                                      constant PerInstanceUniforms &instanceUniforms)
+{
+    ProjectedVertex outVert;
+    outVert.position = uniforms.viewProjectionMatrix * instanceUniforms.modelMatrix * position;
+    outVert.normal = instanceUniforms.normalMatrix * normal;
+    outVert.texCoords = texCoords;
+    return outVert;
+}
+
+// Unfolds a point in [-1, 1]^2 back onto the octahedron and projects it onto the unit sphere
+static float3 octahedral_decode(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += select(float2(t), float2(-t), n.xy >= 0);
+    return normalize(n);
+}
+
 vertex ProjectedVertex vertex_project(InVertex vertexIn [[stage_in]],
                                       constant Uniforms &uniforms [[buffer(1)]],
                                       constant PerInstanceUniforms *perInstanceUniforms [[buffer(2)]],
-                                      ushort vid [[vertex_id]],
-                                      ushort iid [[instance_id]])
+                                      uint vid [[vertex_id]],
+                                      uint iid [[instance_id]])
 {
-    float4x4 instanceModelMatrix = perInstanceUniforms[iid].modelMatrix;
-    float3x3 instanceNormalMatrix = perInstanceUniforms[iid].normalMatrix;
-    
-    ProjectedVertex outVert;
-    outVert.position = uniforms.viewProjectionMatrix * instanceModelMatrix * float4(vertexIn.position);
-    outVert.normal = instanceNormalMatrix * float4(vertexIn.normal).xyz;
-    outVert.texCoords = vertexIn.texCoords;
-    return outVert;
+    return project_vertex(float4(vertexIn.position),
+                          float4(vertexIn.normal).xyz,
+                          vertexIn.texCoords,
+                          uniforms,
+                          perInstanceUniforms[iid]);
+}
+
+vertex ProjectedVertex vertex_project_compact(InCompactVertex vertexIn [[stage_in]],
+                                              constant Uniforms &uniforms [[buffer(1)]],
+                                              constant PerInstanceUniforms *perInstanceUniforms [[buffer(2)]],
+                                              constant MeshBounds &bounds [[buffer(3)]],
+                                              uint vid [[vertex_id]],
+                                              uint iid [[instance_id]])
+{
+    float4 position = float4(bounds.origin.xyz + vertexIn.position.xyz * bounds.extent.xyz, 1);
+    return project_vertex(position,
+                          octahedral_decode(vertexIn.normal),
+                          vertexIn.texCoords,
+                          uniforms,
+                          perInstanceUniforms[iid]);
 }
 
 fragment half4 fragment_texture(ProjectedVertex vert [[stage_in]],
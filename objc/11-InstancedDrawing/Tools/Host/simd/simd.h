@@ -0,0 +1,14 @@
+// A stand-in for the parts of Apple's <simd/simd.h> that the shared headers use, so that host tools can
+// compile them with GCC or Clang on other platforms. Only the layouts match; there is no simd library.
+#pragma once
+
+#include <stdint.h>
+
+typedef float vector_float2 __attribute__((vector_size(8)));
+typedef float vector_float4 __attribute__((vector_size(16)));
+typedef vector_float4 vector_float3;
+typedef float packed_float2 __attribute__((vector_size(8), aligned(4)));
+typedef float packed_float4 __attribute__((vector_size(16), aligned(4)));
+
+typedef struct { vector_float3 columns[3]; } matrix_float3x3;
+typedef struct { vector_float4 columns[4]; } matrix_float4x4;
@@ -0,0 +1,394 @@
+// Checks the instance culling on the host, with 100,000 instances scattered in and around a view
+// frustum, each with its own rotation and non-uniform scale. Every instance is classified against the
+// frustum independently of the code under test, in view space and in double precision, as known to be
+// inside, known to be outside one of the planes, or straddling a plane. Culling must keep every instance
+// that is inside or straddling, drop every one that is outside, keep the survivors in order, and give
+// the same result when compacting in place. Instances too close to call are left out of the comparison.
+//
+// usage: MBECullingCheck [instances]
+
+#include "MBECulling.h"
+#include "MBETypes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const float MBEFieldOfView = 1.0f;
+const float MBEAspectRatio = 1.5f;
+const float MBENearPlane = 0.5f;
+const float MBEFarPlane = 100.0f;
+
+enum MBEClassification
+{
+    MBEClassificationInside,
+    MBEClassificationOutside,
+    MBEClassificationStraddling,
+    MBEClassificationTooClose,
+};
+
+int MBEFailureCount = 0;
+
+void MBECheck(bool condition, const char *description)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", description);
+        ++MBEFailureCount;
+    }
+}
+
+/// The instance's index is kept in the unused fourth lane of its normal matrix, so that culled output
+/// can be traced back to where it came from
+uint32_t MBEInstanceID(const PerInstanceUniforms &instance)
+{
+    return (uint32_t)instance.normalMatrix.columns[0][3];
+}
+
+/// Multiplies column-major 4x4 matrices
+void MBEMultiply(const float a[16], const float b[16], float result[16])
+{
+    for (int column = 0; column < 4; ++column)
+    {
+        for (int row = 0; row < 4; ++row)
+        {
+            float sum = 0;
+            for (int k = 0; k < 4; ++k)
+            {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            result[column * 4 + row] = sum;
+        }
+    }
+}
+
+/// The renderers' perspective projection, which maps view-space depth to [-1, 1]
+void MBEMakePerspective(float result[16])
+{
+    const float yScale = 1 / std::tan(MBEFieldOfView * 0.5f);
+    const float zRange = MBEFarPlane - MBENearPlane;
+    const float matrix[16] = {
+        yScale / MBEAspectRatio, 0, 0, 0,
+        0, yScale, 0, 0,
+        0, 0, -(MBEFarPlane + MBENearPlane) / zRange, -1,
+        0, 0, -2 * MBEFarPlane * MBENearPlane / zRange, 0,
+    };
+    std::memcpy(result, matrix, sizeof(matrix));
+}
+
+/// A view matrix that yaws and pitches the camera, then moves it to `eye`. Its rotation is orthonormal,
+/// so distances are the same in view and world space.
+void MBEMakeView(const float eye[3], float yaw, float pitch, float view[16], float inverseView[16])
+{
+    const float cy = std::cos(yaw), sy = std::sin(yaw), cp = std::cos(pitch), sp = std::sin(pitch);
+
+    // The camera's axes in world space: right, up and backward
+    const float axes[3][3] = { { cy, 0, -sy }, { sy * sp, cp, cy * sp }, { sy * cp, -sp, cy * cp } };
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            inverseView[axis * 4 + i] = axes[axis][i];
+            view[i * 4 + axis] = axes[axis][i];
+        }
+        inverseView[axis * 4 + 3] = 0;
+        inverseView[12 + axis] = eye[axis];
+        view[12 + axis] = -(axes[axis][0] * eye[0] + axes[axis][1] * eye[1] + axes[axis][2] * eye[2]);
+        view[axis * 4 + 3] = 0;
+    }
+    inverseView[15] = 1;
+    view[15] = 1;
+}
+
+void MBETransformPoint(const float m[16], const double point[3], double result[3])
+{
+    for (int i = 0; i < 3; ++i)
+    {
+        result[i] = m[i] * point[0] + m[4 + i] * point[1] + m[8 + i] * point[2] + m[12 + i];
+    }
+}
+
+/// The instance's bounds in world space, worked out in double precision
+void MBEWorldSphere(const MBEBoundingSphere &sphere, const PerInstanceUniforms &instance, double center[3], double *radius)
+{
+    float m[16];
+    std::memcpy(m, &instance.modelMatrix, sizeof(m));
+    const double modelCenter[3] = { sphere.center[0], sphere.center[1], sphere.center[2] };
+    MBETransformPoint(m, modelCenter, center);
+
+    double largestScale = 0;
+    for (int column = 0; column < 3; ++column)
+    {
+        const double x = m[column * 4], y = m[column * 4 + 1], z = m[column * 4 + 2];
+        largestScale = std::max(largestScale, std::sqrt(x * x + y * y + z * z));
+    }
+    *radius = sphere.radius * largestScale;
+}
+
+/// Classifies a world-space sphere against the frustum from the camera's own description, rather than
+/// from the planes MBEFrustumMake extracts
+MBEClassification MBEClassify(const float view[16], const double center[3], double radius)
+{
+    double p[3];
+    MBETransformPoint(view, center, p);
+
+    // Inward unit normals of the side planes, which pass through the eye; the camera looks down -z
+    const double tanY = std::tan(MBEFieldOfView * 0.5), tanX = tanY * MBEAspectRatio;
+    const double lengthX = std::sqrt(1 + tanX * tanX), lengthY = std::sqrt(1 + tanY * tanY);
+    const double distances[6] = {
+        (p[0] - p[2] * tanX) / lengthX,  // left: x >= z tan
+        (-p[0] - p[2] * tanX) / lengthX, // right
+        (p[1] - p[2] * tanY) / lengthY,  // bottom
+        (-p[1] - p[2] * tanY) / lengthY, // top
+        -p[2] - MBENearPlane,            // near
+        p[2] + MBEFarPlane,              // far
+    };
+    const double nearest = *std::min_element(distances, distances + 6);
+
+    const double margin = 1e-3 * (1 + radius + std::fabs(p[2]));
+    if (nearest < -radius - margin)
+    {
+        return MBEClassificationOutside;
+    }
+    if (nearest > radius + margin)
+    {
+        return MBEClassificationInside;
+    }
+    if (nearest > -radius + margin && nearest < radius - margin)
+    {
+        return MBEClassificationStraddling;
+    }
+    return MBEClassificationTooClose;
+}
+
+/// Places `count` instances with random rotations and non-uniform scales, so that the centers of their
+/// bounds are spread over a box in view space a little larger than the frustum
+std::vector<PerInstanceUniforms> MBEMakeInstances(size_t count, const MBEBoundingSphere &sphere, const float inverseView[16])
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(0, 1);
+    const float tanY = std::tan(MBEFieldOfView * 0.5f), tanX = tanY * MBEAspectRatio;
+
+    std::vector<PerInstanceUniforms> instances(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        // A rotation from a random unit quaternion, then a scale of 0.25 to 3 along each axis
+        float q[4];
+        float length = 0;
+        do
+        {
+            length = 0;
+            for (float &component : q)
+            {
+                component = unit(random) * 2 - 1;
+                length += component * component;
+            }
+        } while (length > 1 || length < 1e-4f);
+        for (float &component : q)
+        {
+            component /= std::sqrt(length);
+        }
+        const float w = q[0], x = q[1], y = q[2], z = q[3];
+        const float rotation[3][3] = {
+            { 1 - 2 * (y * y + z * z), 2 * (x * y + w * z), 2 * (x * z - w * y) },
+            { 2 * (x * y - w * z), 1 - 2 * (x * x + z * z), 2 * (y * z + w * x) },
+            { 2 * (x * z + w * y), 2 * (y * z - w * x), 1 - 2 * (x * x + y * y) },
+        };
+
+        float m[16] = {};
+        for (int column = 0; column < 3; ++column)
+        {
+            const float scale = 0.25f + 2.75f * unit(random);
+            for (int row = 0; row < 3; ++row)
+            {
+                m[column * 4 + row] = rotation[column][row] * scale;
+            }
+        }
+        m[15] = 1;
+
+        const float depth = -MBEFarPlane * 1.1f * unit(random) + 5;
+        const double viewCenter[3] = { (unit(random) * 2 - 1) * (std::fabs(depth) * tanX * 1.2f + 5),
+                                       (unit(random) * 2 - 1) * (std::fabs(depth) * tanY * 1.2f + 5), depth };
+        double worldCenter[3];
+        MBETransformPoint(inverseView, viewCenter, worldCenter);
+
+        // Translate so that the transformed center of the bounds lands on the chosen point
+        for (int row = 0; row < 3; ++row)
+        {
+            m[12 + row] = (float)worldCenter[row] - (m[row] * sphere.center[0] + m[4 + row] * sphere.center[1] +
+                                                     m[8 + row] * sphere.center[2]);
+        }
+
+        std::memcpy(&instances[i].modelMatrix, m, sizeof(m));
+        std::memset(&instances[i].normalMatrix, 0, sizeof(instances[i].normalMatrix));
+        instances[i].normalMatrix.columns[0][3] = (float)i;
+    }
+    return instances;
+}
+
+/// Checks culled output against the classification: nothing outside, everything inside or straddling,
+/// ascending order, and instances copied whole
+void MBECheckVisible(const std::vector<PerInstanceUniforms> &instances, const std::vector<MBEClassification> &classes,
+                     const PerInstanceUniforms *visible, size_t visibleCount, size_t instanceCount, const char *context)
+{
+    std::vector<bool> isVisible(instanceCount, false);
+    bool isInOrder = true;
+    bool isIntact = true;
+    uint32_t previousID = 0;
+    for (size_t i = 0; i < visibleCount; ++i)
+    {
+        const uint32_t id = MBEInstanceID(visible[i]);
+        isInOrder = isInOrder && id < instanceCount && (i == 0 || id > previousID);
+        if (id >= instanceCount)
+        {
+            continue;
+        }
+        isIntact = isIntact && std::memcmp(&visible[i], &instances[id], sizeof(PerInstanceUniforms)) == 0;
+        isVisible[id] = true;
+        previousID = id;
+    }
+
+    size_t culledInside = 0, culledStraddling = 0, keptOutside = 0;
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        culledInside += (classes[i] == MBEClassificationInside && !isVisible[i]);
+        culledStraddling += (classes[i] == MBEClassificationStraddling && !isVisible[i]);
+        keptOutside += (classes[i] == MBEClassificationOutside && isVisible[i]);
+    }
+
+    char description[160];
+    std::snprintf(description, sizeof(description), "%s: surviving instances keep their order", context);
+    MBECheck(isInOrder, description);
+    std::snprintf(description, sizeof(description), "%s: surviving instances are copied whole", context);
+    MBECheck(isIntact, description);
+    std::snprintf(description, sizeof(description), "%s: every instance inside the frustum is kept (%zu culled)",
+                  context, culledInside);
+    MBECheck(culledInside == 0, description);
+    std::snprintf(description, sizeof(description), "%s: every instance straddling a plane is kept (%zu culled)",
+                  context, culledStraddling);
+    MBECheck(culledStraddling == 0, description);
+    std::snprintf(description, sizeof(description), "%s: every instance outside a plane is culled (%zu kept)",
+                  context, keptOutside);
+    MBECheck(keptOutside == 0, description);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t instanceCount = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    if (instanceCount < 1000)
+    {
+        std::fprintf(stderr, "usage: %s [instances, at least 1000]\n", argv[0]);
+        return 1;
+    }
+
+    // Bounds for a mesh, from a cloud of points, which must all be inside them
+    std::mt19937 random(2);
+    std::normal_distribution<float> normal(0, 1);
+    std::vector<float> points(3 * 4096);
+    for (size_t i = 0; i < points.size(); i += 3)
+    {
+        points[i] = 0.5f + normal(random);
+        points[i + 1] = 1.0f + 0.4f * normal(random);
+        points[i + 2] = -0.25f + 0.7f * normal(random);
+    }
+    const MBEBoundingSphere sphere = MBEBoundingSphereMake(points.data(), points.size() / 3, 3 * sizeof(float));
+    bool isEnclosed = true;
+    for (size_t i = 0; i < points.size(); i += 3)
+    {
+        const float dx = points[i] - sphere.center[0], dy = points[i + 1] - sphere.center[1], dz = points[i + 2] - sphere.center[2];
+        isEnclosed = isEnclosed && std::sqrt(dx * dx + dy * dy + dz * dz) <= sphere.radius;
+    }
+    MBECheck(isEnclosed, "a mesh's bounding sphere encloses all of its points");
+
+    const float eye[3] = { 3, 4, -2 };
+    float view[16], inverseView[16], projection[16], viewProjection[16];
+    MBEMakeView(eye, 0.7f, -0.3f, view, inverseView);
+    MBEMakePerspective(projection);
+    MBEMultiply(projection, view, viewProjection);
+    const MBEFrustum frustum = MBEFrustumMake(viewProjection);
+
+    const std::vector<PerInstanceUniforms> instances = MBEMakeInstances(instanceCount, sphere, inverseView);
+    std::vector<MBEClassification> classes(instanceCount);
+    size_t classCounts[4] = {};
+    std::vector<MBEBoundingSphere> spheres(instanceCount);
+    MBETransformBoundingSpheres(sphere, instances.data(), instanceCount, sizeof(PerInstanceUniforms), spheres.data());
+    bool areSpheresTransformed = true;
+    for (size_t i = 0; i < instanceCount; ++i)
+    {
+        double center[3], radius;
+        MBEWorldSphere(sphere, instances[i], center, &radius);
+        classes[i] = MBEClassify(view, center, radius);
+        ++classCounts[classes[i]];
+
+        const double tolerance = 1e-4 * (1 + std::fabs(center[0]) + std::fabs(center[1]) + std::fabs(center[2]) + radius);
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            areSpheresTransformed = areSpheresTransformed && std::fabs(spheres[i].center[axis] - center[axis]) < tolerance;
+        }
+        areSpheresTransformed = areSpheresTransformed && std::fabs(spheres[i].radius - radius) < tolerance;
+    }
+    MBECheck(areSpheresTransformed, "instance bounds are moved, rotated and scaled with their instances");
+    MBECheck(classCounts[MBEClassificationInside] >= instanceCount / 20 &&
+             classCounts[MBEClassificationOutside] >= instanceCount / 20 &&
+             classCounts[MBEClassificationStraddling] >= instanceCount / 100,
+             "the instances include plenty that are inside, outside, and straddling");
+
+    // Into a separate array, timing the best of a few runs
+    std::vector<PerInstanceUniforms> visible(instanceCount);
+    MBECullingStats stats = { 0, 0 };
+    size_t visibleCount = 0;
+    double bestTime = INFINITY;
+    const int runCount = 5;
+    for (int run = 0; run < runCount; ++run)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        visibleCount = MBECullInstances(&frustum, sphere, instances.data(), instanceCount, sizeof(PerInstanceUniforms),
+                                        visible.data(), &stats);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        bestTime = std::min(bestTime, elapsed.count());
+    }
+    MBECheckVisible(instances, classes, visible.data(), visibleCount, instanceCount, "culling into another array");
+    MBECheck(stats.instancesTested == runCount * instanceCount && stats.instancesVisible == runCount * visibleCount,
+             "stats accumulate across calls");
+
+    // In place, which must give the same result
+    std::vector<PerInstanceUniforms> compacted = instances;
+    const size_t compactedCount = MBECullInstances(&frustum, sphere, compacted.data(), instanceCount,
+                                                   sizeof(PerInstanceUniforms), compacted.data(), nullptr);
+    MBECheck(compactedCount == visibleCount &&
+             std::memcmp(compacted.data(), visible.data(), visibleCount * sizeof(PerInstanceUniforms)) == 0,
+             "culling in place gives the same result as culling into another array");
+
+    // Counts that leave a partial block of lanes at the end
+    for (size_t count = 1; count <= 2 * 4 + 1; ++count)
+    {
+        std::vector<PerInstanceUniforms> prefixVisible(count);
+        const size_t prefixCount = MBECullInstances(&frustum, sphere, instances.data(), count, sizeof(PerInstanceUniforms),
+                                                    prefixVisible.data(), nullptr);
+        MBECheckVisible(instances, classes, prefixVisible.data(), prefixCount, count, "culling a few instances");
+    }
+
+    std::printf("%zu instances: %zu inside, %zu outside, %zu straddling, %zu too close to call\n", instanceCount,
+                classCounts[MBEClassificationInside], classCounts[MBEClassificationOutside],
+                classCounts[MBEClassificationStraddling], classCounts[MBEClassificationTooClose]);
+    std::printf("%zu visible, culled in %.2f ms (%.1f ns per instance)\n", visibleCount, bestTime * 1000,
+                bestTime * 1e9 / instanceCount);
+
+    if (MBEFailureCount > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", MBEFailureCount);
+        return 1;
+    }
+    std::printf("All culling checks passed\n");
+    return 0;
+}
@@ -0,0 +1,236 @@
+// Checks the frame ring and its CPU fence on the host, with a thread standing in for the GPU. The CPU
+// side begins frames, fills its allocations with a pattern unique to the frame, and submits them; the
+// simulated GPU executes each frame after a delay, verifies that the pattern is still intact, and signals
+// the fence, as a command buffer's completion handler would. The check fails if the CPU ever overwrites
+// memory the GPU hasn't finished with, runs more frames ahead than the ring allows, or fails to overlap
+// its work with the GPU's. The allocator's alignment and exhaustion rules are checked first.
+//
+// usage: MBEFrameRingCheck [frames]
+
+#include "MBEFrameRing.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+int MBEFailureCount = 0;
+
+void MBECheck(bool condition, const char *description)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", description);
+        ++MBEFailureCount;
+    }
+}
+
+void MBECheckAllocation()
+{
+    MBECPUFrameFence fence;
+    MBEFrameRing ring(fence, 3, 1000, 256);
+    MBECheck(ring.bytesPerFrame() == 1024, "slots are rounded up to the alignment");
+    MBECheck(ring.length() == 3 * 1024, "the ring is one slot per frame long");
+
+    size_t offset = 12345;
+    MBECheck(!ring.allocate(16, &offset), "nothing can be allocated before the first frame begins");
+    MBECheck(offset == 12345, "a failed allocation leaves the offset untouched");
+
+    MBECheck(ring.beginFrame() == 1, "frames are numbered from one");
+    MBECheck(ring.allocate(1, &offset) && offset == 0, "the first frame allocates from the first slot");
+    MBECheck(ring.allocate(300, &offset) && offset == 256, "allocations start on the alignment");
+    MBECheck(ring.bytesAllocated() == 768, "allocated bytes include alignment padding");
+    MBECheck(ring.allocate(256, &offset) && offset == 768, "an allocation can fill the rest of the slot");
+    offset = 12345;
+    MBECheck(!ring.allocate(1, &offset) && offset == 12345, "a full slot refuses further allocations");
+
+    fence.signal(1);
+    MBECheck(ring.beginFrame() == 2 && ring.currentSlot() == 1, "the second frame uses the second slot");
+    MBECheck(ring.allocate(1024, &offset) && offset == 1024, "a new frame starts with an empty slot");
+    MBECheck(!ring.allocate(1025, &offset), "an allocation larger than a slot fails");
+
+    ring.beginFrame();
+    ring.beginFrame();
+    MBECheck(ring.currentSlot() == 0, "the fourth frame reuses the first slot, whose frame has completed");
+
+    // Completion handlers can run on different threads, so signals may arrive out of order
+    fence.signal(3);
+    fence.signal(2);
+    MBECheck(fence.completedFrame() == 3, "a late signal for an earlier frame doesn't move the fence back");
+}
+
+/// A frame submitted to the simulated GPU: the range of the ring it reads and the byte it expects there
+struct MBESubmittedFrame
+{
+    uint64_t frame;
+    size_t offset;
+    size_t length;
+    uint8_t pattern;
+};
+
+/// Executes submitted frames in order on its own thread, taking `gpuTime` for each
+class MBESimulatedGPU
+{
+public:
+    MBESimulatedGPU(MBEFrameFence &fence, const std::vector<uint8_t> &memory, std::chrono::microseconds gpuTime)
+    : _fence(fence), _memory(memory), _gpuTime(gpuTime), _isStopping(false), _corruptFrames(0),
+      _thread(&MBESimulatedGPU::run, this)
+    {
+    }
+
+    ~MBESimulatedGPU()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _isStopping = true;
+        }
+        _submitted.notify_all();
+        _thread.join();
+    }
+
+    void submit(const MBESubmittedFrame &frame)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queue.push_back(frame);
+        }
+        _submitted.notify_all();
+    }
+
+    size_t corruptFrames() const { return _corruptFrames; }
+
+private:
+    void run()
+    {
+        for (;;)
+        {
+            MBESubmittedFrame frame;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _submitted.wait(lock, [&] { return _isStopping || !_queue.empty(); });
+                if (_queue.empty())
+                {
+                    return;
+                }
+                frame = _queue.front();
+                _queue.pop_front();
+            }
+
+            // Read the frame's memory at the start and the end of its execution, since the CPU could
+            // overwrite it at any point in between
+            bool isIntact = std::all_of(&_memory[frame.offset], &_memory[frame.offset + frame.length],
+                                        [&](uint8_t byte) { return byte == frame.pattern; });
+            std::this_thread::sleep_for(_gpuTime);
+            isIntact = isIntact && std::all_of(&_memory[frame.offset], &_memory[frame.offset + frame.length],
+                                               [&](uint8_t byte) { return byte == frame.pattern; });
+            if (!isIntact)
+            {
+                ++_corruptFrames;
+            }
+
+            _fence.signal(frame.frame);
+        }
+    }
+
+    MBEFrameFence &_fence;
+    const std::vector<uint8_t> &_memory;
+    std::chrono::microseconds _gpuTime;
+    std::mutex _mutex;
+    std::condition_variable _submitted;
+    std::deque<MBESubmittedFrame> _queue;
+    bool _isStopping;
+    std::atomic<size_t> _corruptFrames;
+    std::thread _thread;
+};
+
+/// Runs `frameCount` frames through a ring `framesInFlight` deep, and returns the time they took in seconds
+double MBERunFrames(unsigned framesInFlight, int frameCount, std::chrono::microseconds cpuTime,
+                    std::chrono::microseconds gpuTime)
+{
+    const size_t bytesPerFrame = 4096;
+    MBECPUFrameFence fence;
+    MBEFrameRing ring(fence, framesInFlight, bytesPerFrame, 256);
+    std::vector<uint8_t> memory(ring.length());
+
+    auto start = std::chrono::steady_clock::now();
+    size_t corruptFrames = 0;
+    uint64_t mostFramesInFlight = 0;
+    {
+        MBESimulatedGPU gpu(fence, memory, gpuTime);
+        for (int i = 0; i < frameCount; ++i)
+        {
+            const uint64_t frame = ring.beginFrame();
+            // Counting the frame just begun, which is the CPU's
+            const uint64_t framesAhead = frame - fence.completedFrame();
+            mostFramesInFlight = std::max(mostFramesInFlight, framesAhead);
+
+            // Write the whole slot, as a frame that used all of its uniforms would
+            size_t offset = 0;
+            ring.allocate(bytesPerFrame, &offset);
+            const uint8_t pattern = (uint8_t)(frame * 37 + 1);
+            std::fill(&memory[offset], &memory[offset + bytesPerFrame], pattern);
+            std::this_thread::sleep_for(cpuTime);
+
+            MBESubmittedFrame submitted = { frame, offset, bytesPerFrame, pattern };
+            gpu.submit(submitted);
+        }
+        fence.wait(ring.currentFrame());
+        corruptFrames = gpu.corruptFrames();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    char description[128];
+    std::snprintf(description, sizeof(description), "%u frames in flight: the GPU never sees memory the CPU overwrote",
+                  framesInFlight);
+    MBECheck(corruptFrames == 0, description);
+    std::snprintf(description, sizeof(description), "%u frames in flight: the CPU is never more than that many frames ahead",
+                  framesInFlight);
+    MBECheck(mostFramesInFlight <= framesInFlight, description);
+
+    std::printf("%u frames in flight: %d frames in %.0f ms, at most %u ahead, %zu corrupt\n", framesInFlight,
+                frameCount, elapsed.count() * 1000, (unsigned)mostFramesInFlight, corruptFrames);
+    return elapsed.count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int frameCount = (argc > 1) ? std::atoi(argv[1]) : 120;
+    if (frameCount < 10)
+    {
+        std::fprintf(stderr, "usage: %s [frames, at least 10]\n", argv[0]);
+        return 1;
+    }
+
+    MBECheckAllocation();
+
+    // With CPU and GPU taking equal time, a single slot serializes them, and more slots let them overlap
+    const std::chrono::microseconds frameTime(2000);
+    const double serialTime = MBERunFrames(1, frameCount, frameTime, frameTime);
+    for (unsigned framesInFlight = 2; framesInFlight <= 3; ++framesInFlight)
+    {
+        const double pipelinedTime = MBERunFrames(framesInFlight, frameCount, frameTime, frameTime);
+        MBECheck(pipelinedTime < serialTime * 0.8, "CPU work on one frame overlaps GPU work on the previous one");
+    }
+
+    // A slow GPU keeps the CPU waiting at the start of each frame, instead of letting it run away
+    MBERunFrames(3, frameCount, std::chrono::microseconds(200), std::chrono::microseconds(3000));
+
+    if (MBEFailureCount > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", MBEFailureCount);
+        return 1;
+    }
+    std::printf("All frame ring checks passed\n");
+    return 0;
+}
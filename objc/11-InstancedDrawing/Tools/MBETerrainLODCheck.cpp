@@ -0,0 +1,302 @@
+// Checks on the host that the terrain's levels of detail fit together without cracks. Every level is
+// built with every stitch mask, and each combination is checked to be watertight on its own: every
+// triangle is wound the same way, every interior edge is shared by exactly two triangles, and the
+// chunk is covered exactly once. The edges left on each side of the chunk must then be the ones the
+// neighbor on that side has, both for every pair of levels that may sit next to each other and for
+// the levels that selectLevels chooses from a few camera positions.
+//
+// usage: MBETerrainLODCheck [chunk size]
+
+#include "MBETerrainLOD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+const MBETerrainSide MBETerrainSides[] = { MBETerrainSideNorth, MBETerrainSideEast, MBETerrainSideSouth, MBETerrainSideWest };
+const char *const MBETerrainSideNames[] = { "north", "east", "south", "west" };
+
+/// The edges of a chunk along one side, as pairs of sample positions counted from the side's first corner
+typedef std::vector<std::pair<size_t, size_t>> MBESideEdges;
+
+int MBEFailureCount = 0;
+
+void MBECheck(bool condition, const std::string &context, const char *description)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s: %s\n", context.c_str(), description);
+        ++MBEFailureCount;
+    }
+}
+
+std::string MBEDescribe(size_t level, uint8_t stitchMask)
+{
+    char description[64];
+    std::snprintf(description, sizeof(description), "level %zu, stitch mask %x", level, stitchMask);
+    return description;
+}
+
+size_t MBESideIndex(MBETerrainSide side)
+{
+    return std::find(std::begin(MBETerrainSides), std::end(MBETerrainSides), side) - std::begin(MBETerrainSides);
+}
+
+MBETerrainSide MBEOppositeSide(MBETerrainSide side)
+{
+    return MBETerrainSides[(MBESideIndex(side) + 2) % 4];
+}
+
+/// The sides of the chunk that a vertex lies on, as a mask
+uint8_t MBEVertexSides(size_t row, size_t column, size_t chunkSize)
+{
+    return ((row == 0) ? MBETerrainSideNorth : 0) | ((row == chunkSize) ? MBETerrainSideSouth : 0) |
+           ((column == 0) ? MBETerrainSideWest : 0) | ((column == chunkSize) ? MBETerrainSideEast : 0);
+}
+
+/// Checks that a level drawn with a stitch mask is a watertight cover of the chunk, and returns the edges
+/// that are left open along each side
+std::vector<MBESideEdges> MBECheckChunk(const MBETerrainLOD &lod, size_t chunkSize, size_t level, uint8_t stitchMask)
+{
+    const std::string context = MBEDescribe(level, stitchMask);
+    const size_t chunkStride = chunkSize + 1;
+    const MBETerrainIndexRange ranges[2] = { lod.interiorRange(level), lod.borderRange(level, stitchMask) };
+
+    std::map<std::pair<uint32_t, uint32_t>, int> directedEdges;
+    bool isInRange = true;
+    bool isWoundConsistently = true;
+    double area = 0;
+    for (const MBETerrainIndexRange &range : ranges)
+    {
+        for (size_t i = range.offset; i < range.offset + range.count; i += 3)
+        {
+            const uint32_t *triangle = &lod.indices()[i];
+            if (triangle[0] >= chunkStride * chunkStride || triangle[1] >= chunkStride * chunkStride ||
+                triangle[2] >= chunkStride * chunkStride)
+            {
+                isInRange = false;
+                continue;
+            }
+
+            // Twice the signed area in the (column, row) plane, which the grid's winding makes negative
+            const double x0 = triangle[0] % chunkStride, z0 = triangle[0] / chunkStride;
+            const double x1 = triangle[1] % chunkStride, z1 = triangle[1] / chunkStride;
+            const double x2 = triangle[2] % chunkStride, z2 = triangle[2] / chunkStride;
+            const double signedArea = (x1 - x0) * (z2 - z0) - (x2 - x0) * (z1 - z0);
+            isWoundConsistently = isWoundConsistently && signedArea < 0;
+            area -= signedArea / 2;
+
+            for (int corner = 0; corner < 3; ++corner)
+            {
+                ++directedEdges[std::make_pair(triangle[corner], triangle[(corner + 1) % 3])];
+            }
+        }
+    }
+    MBECheck(isInRange, context, "indices refer to the chunk's vertices");
+    MBECheck(isWoundConsistently, context, "triangles are non-degenerate and wound the same way");
+    MBECheck(std::fabs(area - (double)(chunkSize * chunkSize)) < 0.5, context, "triangles cover the chunk exactly once");
+
+    // Inside the chunk, each edge must be used once in each direction; one that is only used one way has a
+    // crack or a T-junction along it, unless it lies on the chunk's border
+    std::vector<MBESideEdges> sideEdges(4);
+    bool isWatertight = true;
+    for (const auto &edge : directedEdges)
+    {
+        const uint32_t a = edge.first.first;
+        const uint32_t b = edge.first.second;
+        if (edge.second != 1)
+        {
+            isWatertight = false;
+            continue;
+        }
+        if (directedEdges.count(std::make_pair(b, a)))
+        {
+            continue;
+        }
+
+        const uint8_t sides = MBEVertexSides(a / chunkStride, a % chunkStride, chunkSize) &
+                              MBEVertexSides(b / chunkStride, b % chunkStride, chunkSize);
+        if (sides == 0)
+        {
+            isWatertight = false;
+            continue;
+        }
+        for (size_t side = 0; side < 4; ++side)
+        {
+            if (sides & MBETerrainSides[side])
+            {
+                const bool isRow = (MBETerrainSides[side] == MBETerrainSideNorth || MBETerrainSides[side] == MBETerrainSideSouth);
+                const size_t positionA = isRow ? a % chunkStride : a / chunkStride;
+                const size_t positionB = isRow ? b % chunkStride : b / chunkStride;
+                sideEdges[side].push_back(std::make_pair(std::min(positionA, positionB), std::max(positionA, positionB)));
+            }
+        }
+    }
+    MBECheck(isWatertight, context, "every interior edge is shared by exactly two triangles");
+
+    for (size_t side = 0; side < 4; ++side)
+    {
+        std::sort(sideEdges[side].begin(), sideEdges[side].end());
+
+        // A stitched side has only the vertices of the next level, so that it matches its coarser neighbor
+        const size_t step = (size_t)1 << (level + ((stitchMask & MBETerrainSides[side]) ? 1 : 0));
+        MBESideEdges expected;
+        for (size_t position = 0; position < chunkSize; position += step)
+        {
+            expected.push_back(std::make_pair(position, position + step));
+        }
+        MBECheck(sideEdges[side] == expected, context + ", " + MBETerrainSideNames[side] + " side",
+                 "the side's edges are exactly those of its level, or of the next level if it is stitched");
+    }
+    return sideEdges;
+}
+
+/// Checks that two chunks share the vertices along the side where they meet
+void MBECheckNeighbors(const std::vector<MBESideEdges> &first, const std::vector<MBESideEdges> &second,
+                       MBETerrainSide side, const std::string &context)
+{
+    MBECheck(first[MBESideIndex(side)] == second[MBESideIndex(MBEOppositeSide(side))], context,
+             "neighboring chunks share every edge vertex along their common side");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const size_t chunkSize = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 128;
+    if (chunkSize < 2 || (chunkSize & (chunkSize - 1)) != 0)
+    {
+        std::fprintf(stderr, "usage: %s [chunk size, a power of two]\n", argv[0]);
+        return 1;
+    }
+
+    // Eight chunks along each edge, so that the camera sees a spread of distances
+    unsigned iterations = 2;
+    while (((size_t)1 << iterations) < chunkSize * 8)
+    {
+        ++iterations;
+    }
+    const MBEHeightfield heightfield(iterations, 0.95f, 1);
+    const float spacing = 1.0f;
+    const float verticalScale = 64.0f;
+    const MBETerrainLOD lod(heightfield, chunkSize, spacing, verticalScale);
+
+    // Every level with every stitch mask. The coarsest level has no coarser neighbor, so it is never stitched.
+    std::vector<std::vector<MBESideEdges>> sideEdges(lod.levelCount() * 16);
+    for (size_t level = 0; level < lod.levelCount(); ++level)
+    {
+        const uint8_t maskCount = (level + 1 < lod.levelCount()) ? 16 : 1;
+        for (uint8_t stitchMask = 0; stitchMask < maskCount; ++stitchMask)
+        {
+            sideEdges[level * 16 + stitchMask] = MBECheckChunk(lod, chunkSize, level, stitchMask);
+        }
+    }
+
+    // Every pair of chunks that may be neighbors: at the same level, neither stitches the side between them,
+    // and at adjacent levels, only the finer one does. Both can have any stitching on their other sides.
+    for (size_t level = 0; level < lod.levelCount(); ++level)
+    {
+        for (MBETerrainSide side : MBETerrainSides)
+        {
+            const MBETerrainSide opposite = MBEOppositeSide(side);
+            const uint8_t finerMaskCount = (level + 1 < lod.levelCount()) ? 16 : 1;
+            const uint8_t coarserMaskCount = (level + 2 < lod.levelCount()) ? 16 : 1;
+            for (uint8_t first = 0; first < finerMaskCount; ++first)
+            {
+                for (uint8_t second = 0; second < finerMaskCount; ++second)
+                {
+                    if (!(first & side) && !(second & opposite))
+                    {
+                        MBECheckNeighbors(sideEdges[level * 16 + first], sideEdges[level * 16 + second], side,
+                                          MBEDescribe(level, first) + " beside " + MBEDescribe(level, second) +
+                                          " to the " + MBETerrainSideNames[MBESideIndex(side)]);
+                    }
+                }
+                if (level + 1 == lod.levelCount() || !(first & side))
+                {
+                    continue;
+                }
+                for (uint8_t second = 0; second < coarserMaskCount; ++second)
+                {
+                    if (!(second & opposite))
+                    {
+                        MBECheckNeighbors(sideEdges[level * 16 + first], sideEdges[(level + 1) * 16 + second], side,
+                                          MBEDescribe(level, first) + " beside " + MBEDescribe(level + 1, second) +
+                                          " to the " + MBETerrainSideNames[MBESideIndex(side)]);
+                    }
+                }
+            }
+        }
+    }
+
+    // The levels selectLevels chooses, with the camera low over a corner, high over the middle, and far away
+    const float terrainExtent = (heightfield.stride() - 1) * spacing;
+    const float cameraPositions[][3] = {
+        { -0.45f * terrainExtent, 0.1f * verticalScale, -0.45f * terrainExtent },
+        { 0, 2 * verticalScale, 0 },
+        { 4 * terrainExtent, verticalScale, 0 },
+    };
+    const float projectionScale = 1080 / (2 * std::tan((float)M_PI / 6));
+    const size_t chunksPerEdge = lod.chunksPerEdge();
+    std::vector<MBETerrainChunkLOD> selection;
+    for (const float *cameraPosition : cameraPositions)
+    {
+        const size_t triangleCount = lod.selectLevels(cameraPosition, projectionScale, 4.0f, selection);
+
+        size_t levelHistogram[16] = {};
+        size_t expectedTriangleCount = 0;
+        for (size_t chunk = 0; chunk < lod.chunkCount(); ++chunk)
+        {
+            const MBETerrainChunkLOD &chunkLOD = selection[chunk];
+            const std::string context = "selected " + MBEDescribe(chunkLOD.level, chunkLOD.stitchMask);
+            ++levelHistogram[chunkLOD.level];
+            expectedTriangleCount += (lod.interiorRange(chunkLOD.level).count +
+                                      lod.borderRange(chunkLOD.level, chunkLOD.stitchMask).count) / 3;
+
+            const size_t row = chunk / chunksPerEdge;
+            const size_t column = chunk % chunksPerEdge;
+            const size_t neighbors[2] = { (column + 1 < chunksPerEdge) ? chunk + 1 : chunk,
+                                          (row + 1 < chunksPerEdge) ? chunk + chunksPerEdge : chunk };
+            const MBETerrainSide sides[2] = { MBETerrainSideEast, MBETerrainSideSouth };
+            for (int i = 0; i < 2; ++i)
+            {
+                if (neighbors[i] == chunk)
+                {
+                    continue;
+                }
+                const MBETerrainChunkLOD &neighborLOD = selection[neighbors[i]];
+                MBECheck(std::abs(chunkLOD.level - neighborLOD.level) <= 1, context,
+                         "neighboring chunks differ by at most one level");
+                MBECheck(!(chunkLOD.stitchMask & sides[i]) == !(neighborLOD.level > chunkLOD.level), context,
+                         "a side is stitched exactly when its neighbor is coarser");
+                MBECheckNeighbors(sideEdges[chunkLOD.level * 16 + chunkLOD.stitchMask],
+                                  sideEdges[neighborLOD.level * 16 + neighborLOD.stitchMask], sides[i], context);
+            }
+        }
+        MBECheck(triangleCount == expectedTriangleCount, "selection", "the returned triangle count matches the ranges");
+
+        std::printf("camera (%6.0f, %4.0f, %6.0f): %6zu triangles, chunks per level:", cameraPosition[0],
+                    cameraPosition[1], cameraPosition[2], triangleCount);
+        for (size_t level = 0; level < lod.levelCount(); ++level)
+        {
+            std::printf(" %zu", levelHistogram[level]);
+        }
+        std::printf("\n");
+    }
+
+    if (MBEFailureCount > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", MBEFailureCount);
+        return 1;
+    }
+    std::printf("All terrain LOD checks passed for %zu levels of %zu-quad chunks\n", lod.levelCount(), chunkSize);
+    return 0;
+}
@@ -0,0 +1,207 @@
+// Round-trips meshes through the compact vertex format on the host and reports the largest errors it
+// introduces: the angle between each normal and its octahedral encoding, the distance between each
+// position and its quantized form, and the difference between each texture coordinate and its half.
+// Exits with a failure status if any error is larger than the format should allow.
+//
+// usage: MBEVertexCompressionCheck [file.obj ...]
+//
+// With no files, it checks the cow meshes bundled with this sample, at paths relative to this
+// directory, followed by a million random unit normals.
+
+#include "MBEOBJParser.h"
+#include "MBEVertexCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+const char *const MBEBundledModelPaths[] = {
+    "../InstancedDrawing/spot/spot.obj",
+    "../InstancedDrawing/spot/spot_triangulated.obj",
+    "../InstancedDrawing/spot/spot_quadrangulated.obj",
+    "../InstancedDrawing/spot/spot_control_mesh.obj",
+};
+
+// Half a diagonal step of the 16-bit grid is about 0.002 degrees where the octahedron touches the sphere,
+// but the map stretches the grid unevenly, and the worst case elsewhere is several times that. A hundredth
+// of a degree is still far below anything visible in shading.
+const double MBEMaximumNormalAngle = 0.01;
+// Half a quantization step of the largest axis of the mesh's bounds, plus float rounding
+const double MBEMaximumPositionError = 0.5 / 65535 + 1e-6;
+// Half of the spacing of half floats in [1, 2), relative to the magnitude of the texture coordinate
+const double MBEMaximumTexCoordError = 1.0 / 2048;
+
+struct MBECompressionErrors
+{
+    double normalAngle = 0;
+    double position = 0;
+    double texCoord = 0;
+};
+
+double MBEAngleInDegrees(const float a[3], const float b[3])
+{
+    // The cross product is accurate for the tiny angles measured here, where the dot product isn't
+    const double cx = (double)a[1] * b[2] - (double)a[2] * b[1];
+    const double cy = (double)a[2] * b[0] - (double)a[0] * b[2];
+    const double cz = (double)a[0] * b[1] - (double)a[1] * b[0];
+    const double dot = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+    return std::atan2(std::sqrt(cx * cx + cy * cy + cz * cz), dot) * 180 / M_PI;
+}
+
+void MBENormalize(float v[3])
+{
+    const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    for (int k = 0; k < 3; ++k)
+    {
+        v[k] = (length > 0) ? v[k] / length : ((k == 2) ? 1 : 0);
+    }
+}
+
+/// One vertex per face corner, with the file's normals if it has them and flat normals if it doesn't
+std::vector<MBEVertex> MBEVerticesOfOBJ(const MBEOBJData &data)
+{
+    std::vector<MBEVertex> vertices;
+    for (size_t f = 0; f < data.faceCount(); ++f)
+    {
+        const MBEOBJFaceCorner *corners = &data.corners[data.faceStarts[f]];
+        const size_t cornerCount = data.faceStarts[f + 1] - data.faceStarts[f];
+
+        const MBEOBJFloat3 &p0 = data.positions[corners[0].vi];
+        const MBEOBJFloat3 &p1 = data.positions[corners[1].vi];
+        const MBEOBJFloat3 &p2 = data.positions[corners[2].vi];
+        float faceNormal[3] = {
+            (p1.y - p0.y) * (p2.z - p0.z) - (p1.z - p0.z) * (p2.y - p0.y),
+            (p1.z - p0.z) * (p2.x - p0.x) - (p1.x - p0.x) * (p2.z - p0.z),
+            (p1.x - p0.x) * (p2.y - p0.y) - (p1.y - p0.y) * (p2.x - p0.x),
+        };
+        MBENormalize(faceNormal);
+
+        for (size_t c = 0; c < cornerCount; ++c)
+        {
+            const MBEOBJFaceCorner &corner = corners[c];
+            const MBEOBJFloat3 &position = data.positions[corner.vi];
+
+            float normal[3] = { faceNormal[0], faceNormal[1], faceNormal[2] };
+            if (corner.ni != MBEOBJInvalidIndex)
+            {
+                normal[0] = data.normals[corner.ni].x;
+                normal[1] = data.normals[corner.ni].y;
+                normal[2] = data.normals[corner.ni].z;
+                MBENormalize(normal);
+            }
+
+            MBEOBJFloat2 texCoords = { 0, 0 };
+            if (corner.ti != MBEOBJInvalidIndex)
+            {
+                texCoords = data.texCoords[corner.ti];
+            }
+
+            MBEVertex vertex;
+            vertex.position = (packed_float4){ position.x, position.y, position.z, 1 };
+            vertex.normal = (packed_float4){ normal[0], normal[1], normal[2], 0 };
+            vertex.texCoords = (packed_float2){ texCoords.x, texCoords.y };
+            vertices.push_back(vertex);
+        }
+    }
+    return vertices;
+}
+
+MBECompressionErrors MBEMeasureRoundTrip(const std::vector<MBEVertex> &vertices)
+{
+    std::vector<MBECompactVertex> compactVertices(vertices.size());
+    MBEMeshBounds bounds = MBECompressVertices(vertices.data(), vertices.size(), compactVertices.data());
+    const double largestExtent = std::max(std::max(bounds.extent[0], bounds.extent[1]), bounds.extent[2]);
+
+    MBECompressionErrors errors;
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const MBEVertex &original = vertices[i];
+        const MBEVertex decoded = MBEDecompressVertex(&compactVertices[i], bounds);
+
+        float originalNormal[3] = { original.normal[0], original.normal[1], original.normal[2] };
+        float decodedNormal[3] = { decoded.normal[0], decoded.normal[1], decoded.normal[2] };
+        errors.normalAngle = std::max(errors.normalAngle, MBEAngleInDegrees(originalNormal, decodedNormal));
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const double error = std::fabs((double)decoded.position[k] - original.position[k]);
+            errors.position = std::max(errors.position, (largestExtent > 0) ? error / largestExtent : error);
+        }
+
+        for (int k = 0; k < 2; ++k)
+        {
+            const double error = std::fabs((double)decoded.texCoords[k] - original.texCoords[k]);
+            const double magnitude = std::max(1.0, std::fabs((double)original.texCoords[k]));
+            errors.texCoord = std::max(errors.texCoord, error / magnitude);
+        }
+    }
+    return errors;
+}
+
+bool MBEReportErrors(const char *name, size_t vertexCount, const MBECompressionErrors &errors)
+{
+    const bool passed = errors.normalAngle <= MBEMaximumNormalAngle &&
+                        errors.position <= MBEMaximumPositionError &&
+                        errors.texCoord <= MBEMaximumTexCoordError;
+    std::printf("%-28s %9zu %14.5f %14.3g %14.3g  %s\n", name, vertexCount, errors.normalAngle,
+                errors.position, errors.texCoord, passed ? "ok" : "FAILED");
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<const char *> paths(argv + 1, argv + argc);
+    const bool checksBundledModels = paths.empty();
+    if (checksBundledModels)
+    {
+        paths.assign(std::begin(MBEBundledModelPaths), std::end(MBEBundledModelPaths));
+    }
+
+    std::printf("%-28s %9s %14s %14s %14s\n", "mesh", "vertices", "normal (deg)", "position", "tex coord");
+    std::printf("%-28s %9s %14.5f %14.3g %14.3g\n", "(limit)", "", MBEMaximumNormalAngle,
+                MBEMaximumPositionError, MBEMaximumTexCoordError);
+
+    bool passed = true;
+    for (const char *path : paths)
+    {
+        MBEOBJData data;
+        if (!MBEOBJParseFile(path, data))
+        {
+            std::fprintf(stderr, "Couldn't read %s\n", path);
+            passed = false;
+            continue;
+        }
+
+        const char *name = std::strrchr(path, '/') ? std::strrchr(path, '/') + 1 : path;
+        std::vector<MBEVertex> vertices = MBEVerticesOfOBJ(data);
+        passed = MBEReportErrors(name, vertices.size(), MBEMeasureRoundTrip(vertices)) && passed;
+    }
+
+    if (checksBundledModels)
+    {
+        // Meshes only sample the directions their surfaces happen to face, so also sweep the whole sphere
+        std::mt19937 generator(1);
+        std::normal_distribution<float> gaussian;
+        std::uniform_real_distribution<float> uniform(-4, 4);
+        std::vector<MBEVertex> vertices(1000000);
+        for (MBEVertex &vertex : vertices)
+        {
+            float normal[3] = { gaussian(generator), gaussian(generator), gaussian(generator) };
+            MBENormalize(normal);
+            vertex.position = (packed_float4){ uniform(generator), uniform(generator), uniform(generator), 1 };
+            vertex.normal = (packed_float4){ normal[0], normal[1], normal[2], 0 };
+            vertex.texCoords = (packed_float2){ uniform(generator), uniform(generator) };
+        }
+        passed = MBEReportErrors("random", vertices.size(), MBEMeasureRoundTrip(vertices)) && passed;
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#!/bin/sh
+# Builds the host-side tools for this sample into ./build, with any C++11 compiler and POSIX threads.
+# The tools share their sources with the app, so they check exactly what ships. Host/ stands in for the
+# Apple system headers that the shared headers include.
+set -e
+cd "$(dirname "$0")"
+
+CXX=${CXX:-c++}
+CXXFLAGS=${CXXFLAGS:--O2}
+SOURCES=../InstancedDrawing
+
+mkdir -p build
+$CXX -std=c++11 $CXXFLAGS -Wno-deprecated -IHost -I$SOURCES -o build/MBEVertexCompressionCheck \
+    MBEVertexCompressionCheck.cpp $SOURCES/MBEVertexCompression.cpp \
+    $SOURCES/MBEOBJParser.cpp $SOURCES/MBEMappedFile.cpp $SOURCES/MBEThreadPool.cpp -lpthread
+$CXX -std=c++11 $CXXFLAGS -I$SOURCES -o build/MBEFrameRingCheck MBEFrameRingCheck.cpp $SOURCES/MBEFrameRing.cpp -lpthread
+$CXX -std=c++11 $CXXFLAGS -I$SOURCES -o build/MBETerrainLODCheck MBETerrainLODCheck.cpp $SOURCES/MBETerrainLOD.cpp \
+    $SOURCES/MBEHeightfield.cpp $SOURCES/MBEMeshOptimizer.cpp $SOURCES/MBEThreadPool.cpp -lpthread
+$CXX -std=c++11 $CXXFLAGS -Wno-deprecated -IHost -I$SOURCES -o build/MBECullingCheck MBECullingCheck.cpp $SOURCES/MBECulling.cpp
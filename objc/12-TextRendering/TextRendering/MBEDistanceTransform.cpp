@@ -0,0 +1,326 @@
+#include "MBEDistanceTransform.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    typedef uint16_t UShort8 __attribute__((vector_size(16)));
+
+    // Wide enough that each row of a strip is a long sequential run, so the sweeps stream through memory
+    const size_t ColumnsPerStrip = 1024;
+    const size_t PixelsPerTask = 64 * 1024;
+
+    // Tall enough that the rows added above and below a band for context don't dominate its work
+    const size_t RowsPerBand = 128;
+
+    // The column distances of each pixel are packed into the output in place of the pixel's distance, the
+    // distance to the nearest outside pixel first and then the distance to the nearest inside pixel
+    static_assert(sizeof(float) == 2 * sizeof(uint16_t), "Column distances must fit in place of a float");
+
+    UShort8 Min(UShort8 a, UShort8 b)
+    {
+        const UShort8 aIsLess = (UShort8)(a < b);
+        return (a & aIsLess) | (b & ~aIsLess);
+    }
+
+    /// The lanes to keep for four pixels: the distance to the outside for inside pixels, and the distance to
+    /// the inside for outside pixels. The other distance of each pixel is zero.
+    UShort8 KeptLanes(const uint8_t *pixels)
+    {
+        const UShort8 values = { pixels[0], pixels[0], pixels[1], pixels[1], pixels[2], pixels[2], pixels[3], pixels[3] };
+        const UShort8 toInsideLanes = { 0, 0xffff, 0, 0xffff, 0, 0xffff, 0, 0xffff };
+        const UShort8 isInside = (UShort8)(values > 0x7f);
+        return isInside ^ toInsideLanes;
+    }
+
+    /// Finds, for every pixel of the columns [begin, end), the vertical distance to the nearest pixel of each
+    /// kind in its column, with one sweep down and one back up. Distances are capped at `far`, which stands
+    /// for "no such pixel". Each sweep works across a whole row of the strip at a time, four pixels to a
+    /// vector.
+    void ColumnDistances(const uint8_t *image, size_t bytesPerRow, size_t height, size_t begin, size_t end,
+                         uint16_t far, uint8_t *columns, size_t columnsPerRow)
+    {
+        const UShort8 one = { 1, 1, 1, 1, 1, 1, 1, 1 };
+        const UShort8 farVector = { far, far, far, far, far, far, far, far };
+        const size_t vectorEnd = begin + (end - begin) / 4 * 4;
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            const uint8_t *pixels = image + y * bytesPerRow;
+            uint8_t *row = columns + y * columnsPerRow;
+            const uint8_t *above = (y > 0) ? row - columnsPerRow : row;
+            for (size_t x = begin; x < vectorEnd; x += 4)
+            {
+                UShort8 distance = farVector;
+                if (y > 0)
+                {
+                    memcpy(&distance, above + x * 4, sizeof(distance));
+                    distance = Min(distance + one, farVector);
+                }
+                distance &= KeptLanes(pixels + x);
+                memcpy(row + x * 4, &distance, sizeof(distance));
+            }
+
+            for (size_t x = vectorEnd; x < end; ++x)
+            {
+                uint16_t distances[2] = { far, far };
+                if (y > 0)
+                {
+                    memcpy(distances, above + x * 4, sizeof(distances));
+                    distances[0] = std::min<uint16_t>(distances[0] + 1, far);
+                    distances[1] = std::min<uint16_t>(distances[1] + 1, far);
+                }
+                distances[(pixels[x] > 0x7f) ? 1 : 0] = 0;
+                memcpy(row + x * 4, distances, sizeof(distances));
+            }
+        }
+
+        for (size_t y = height - 1; y-- > 0;)
+        {
+            uint8_t *row = columns + y * columnsPerRow;
+            const uint8_t *below = row + columnsPerRow;
+            for (size_t x = begin; x < vectorEnd; x += 4)
+            {
+                UShort8 distance, distanceBelow;
+                memcpy(&distance, row + x * 4, sizeof(distance));
+                memcpy(&distanceBelow, below + x * 4, sizeof(distanceBelow));
+                distance = Min(distance, distanceBelow + one);
+                memcpy(row + x * 4, &distance, sizeof(distance));
+            }
+
+            for (size_t x = vectorEnd; x < end; ++x)
+            {
+                uint16_t distances[2], distancesBelow[2];
+                memcpy(distances, row + x * 4, sizeof(distances));
+                memcpy(distancesBelow, below + x * 4, sizeof(distancesBelow));
+                distances[0] = std::min<uint16_t>(distances[0], distancesBelow[0] + 1);
+                distances[1] = std::min<uint16_t>(distances[1], distancesBelow[1] + 1);
+                memcpy(row + x * 4, distances, sizeof(distances));
+            }
+        }
+    }
+
+    /// One parabola of a lower envelope: the column of its apex, its height there, and the column at which
+    /// it starts being the lowest. Whole numbers are kept in doubles, which hold every intermediate value
+    /// exactly and multiply and divide much faster than 64-bit integers do.
+    struct Parabola
+    {
+        double apex;
+        double height;
+        double start;
+    };
+
+    /// Writes the squared distance from each of `width` pixels of a row to the nearest pixel that the column
+    /// distances `columns` were measured to, using `parabolas` as scratch. Columns whose distance is `far`
+    /// have no such pixel near enough to matter and are left off the envelope, and pixels with nothing
+    /// nearer get `far` squared.
+    void SquaredDistances(const uint16_t *columns, int32_t width, uint16_t far, Parabola *parabolas,
+                          float *squaredDistances)
+    {
+        int32_t k = -1;
+        for (int32_t u = 0; u < width; ++u)
+        {
+            if (columns[u] >= far)
+            {
+                continue;
+            }
+
+            const double apex = u;
+            const double height = (double)columns[u] * columns[u];
+
+            // Drop the parabolas that the new one is lower than wherever they are the lowest
+            while (k >= 0)
+            {
+                const Parabola &last = parabolas[k];
+                if (last.height + (last.start - last.apex) * (last.start - last.apex) <= height + (last.start - apex) * (last.start - apex))
+                {
+                    break;
+                }
+                --k;
+            }
+
+            if (k < 0)
+            {
+                parabolas[++k] = { apex, height, 0 };
+                continue;
+            }
+
+            // The first whole column at which the new parabola is lower than the last one. Every quotient
+            // that isn't a whole number is far enough from one that rounding can't carry it across.
+            const Parabola &last = parabolas[k];
+            const double separation = (height + apex * apex - last.height - last.apex * last.apex) / (2 * (apex - last.apex));
+            int64_t start = (int64_t)separation;
+            start += (start <= separation) ? 1 : 0;
+            if (start < width)
+            {
+                parabolas[++k] = { apex, height, (double)start };
+            }
+        }
+
+        const float farSquared = (float)far * far;
+        for (int32_t u = width - 1; u >= 0; --u)
+        {
+            if (k < 0)
+            {
+                squaredDistances[u] = farSquared;
+                continue;
+            }
+
+            const Parabola &nearest = parabolas[k];
+            const double offset = u - nearest.apex;
+            squaredDistances[u] = std::min((float)(nearest.height + offset * offset), farSquared);
+            if (u == nearest.start)
+            {
+                --k;
+            }
+        }
+    }
+}
+
+void MBESignedDistanceTransform(const uint8_t *image, size_t width, size_t height, size_t bytesPerRow,
+                                float maximumDistance, float *distances, size_t distancesPerRow)
+{
+    if (width == 0 || height == 0)
+    {
+        return;
+    }
+
+    // Any pixel within the maximum distance of the boundary has its nearest pixel on the other side fewer
+    // than `far` rows away, so column distances never need to count any higher
+    size_t far = std::min<size_t>(width + height, UINT16_MAX - 1);
+    if (maximumDistance < far)
+    {
+        far = std::max<size_t>((size_t)(maximumDistance + 0.5f) + 1, 1);
+    }
+
+    // The column distances are kept in the output itself, so the transform needs no image-sized scratch
+    uint8_t *columns = (uint8_t *)distances;
+    const size_t columnsPerRow = distancesPerRow * sizeof(float);
+
+    MBEThreadPool &pool = MBEThreadPool::sharedPool();
+
+    const size_t stripCount = (width + ColumnsPerStrip - 1) / ColumnsPerStrip;
+    pool.parallelFor(stripCount, [&](size_t strip) {
+        const size_t begin = strip * ColumnsPerStrip;
+        ColumnDistances(image, bytesPerRow, height, begin, std::min(begin + ColumnsPerStrip, width),
+                        (uint16_t)far, columns, columnsPerRow);
+    });
+
+    // Pixels with nothing on the other side of the boundary within `far` take the largest distance
+    const float farSquared = (float)far * far;
+    const float farDistance = std::isinf(maximumDistance) ? (float)(width + height) : maximumDistance;
+
+    const size_t rowsPerTask = std::max<size_t>(1, PixelsPerTask / width);
+    const size_t taskCount = (height + rowsPerTask - 1) / rowsPerTask;
+    pool.parallelFor(taskCount, [&](size_t task) {
+        std::vector<Parabola> parabolas(width);
+        std::vector<uint16_t> toOutside(width);
+        std::vector<uint16_t> toInside(width);
+        std::vector<float> squaredDistances(width);
+
+        const size_t end = std::min((task + 1) * rowsPerTask, height);
+        for (size_t y = task * rowsPerTask; y < end; ++y)
+        {
+            const uint8_t *pixels = image + y * bytesPerRow;
+            float *row = distances + y * distancesPerRow;
+
+            // Take the row's column distances out of the output before the distances overwrite them
+            for (size_t x = 0; x < width; ++x)
+            {
+                uint16_t packed[2];
+                memcpy(packed, columns + y * columnsPerRow + x * 4, sizeof(packed));
+                toOutside[x] = packed[0];
+                toInside[x] = packed[1];
+            }
+
+            // Nothing beyond the pixels that bound a run in this row can be nearer to the pixels of the run
+            // than those bounding pixels themselves, so each run only needs the envelope of its own columns
+            // and theirs. This makes the work per row proportional to its width, not twice its width.
+            size_t runStart = 0;
+            while (runStart < width)
+            {
+                const bool isInside = pixels[runStart] > 0x7f;
+                size_t runEnd = runStart + 1;
+                while (runEnd < width && (pixels[runEnd] > 0x7f) == isInside)
+                {
+                    ++runEnd;
+                }
+
+                const size_t first = (runStart > 0) ? runStart - 1 : 0;
+                const size_t last = std::min(runEnd + 1, width);
+                const uint16_t *runColumns = isInside ? toOutside.data() : toInside.data();
+                SquaredDistances(runColumns + first, (int32_t)(last - first), (uint16_t)far,
+                                 parabolas.data(), &squaredDistances[first]);
+
+                const float sign = isInside ? 1 : -1;
+                for (size_t x = runStart; x < runEnd; ++x)
+                {
+                    const float distance = (squaredDistances[x] < farSquared) ? std::sqrt(squaredDistances[x]) - 0.5f : farDistance;
+                    row[x] = sign * std::min(distance, maximumDistance);
+                }
+
+                runStart = runEnd;
+            }
+        }
+    });
+}
+
+void MBEQuantizedSignedDistanceField(const uint8_t *image, size_t width, size_t height, size_t bytesPerRow,
+                                     size_t scaleFactor, float spread, uint8_t *field, size_t fieldBytesPerRow)
+{
+    const size_t fieldWidth = width / scaleFactor;
+    const size_t fieldHeight = height / scaleFactor;
+    if (fieldWidth == 0 || fieldHeight == 0)
+    {
+        return;
+    }
+
+    // A boundary more than this many rows away is beyond the spread of every pixel of a band, so this many
+    // rows on either side of it are all the context it needs
+    const size_t contextRows = (size_t)(spread + 0.5f) + 1;
+    const size_t fieldRowsPerBand = std::max<size_t>(1, std::max(RowsPerBand, 2 * contextRows) / scaleFactor);
+    const size_t bandCount = (fieldHeight + fieldRowsPerBand - 1) / fieldRowsPerBand;
+
+    const float averageScale = 1.0f / (scaleFactor * scaleFactor);
+
+    // Each band's transform finds the pool busy and runs on the band's thread, so the bands themselves are
+    // what spread across the cores
+    MBEThreadPool::sharedPool().parallelFor(bandCount, [&](size_t band) {
+        const size_t fieldBegin = band * fieldRowsPerBand;
+        const size_t fieldEnd = std::min(fieldBegin + fieldRowsPerBand, fieldHeight);
+        const size_t windowBegin = (fieldBegin * scaleFactor > contextRows) ? fieldBegin * scaleFactor - contextRows : 0;
+        const size_t windowEnd = std::min(fieldEnd * scaleFactor + contextRows, height);
+
+        std::vector<float> distances(width * (windowEnd - windowBegin));
+        MBESignedDistanceTransform(image + windowBegin * bytesPerRow, width, windowEnd - windowBegin, bytesPerRow,
+                                   spread, distances.data(), width);
+
+        std::vector<float> sums(fieldWidth);
+        for (size_t fieldY = fieldBegin; fieldY < fieldEnd; ++fieldY)
+        {
+            std::fill(sums.begin(), sums.end(), 0.0f);
+            for (size_t y = fieldY * scaleFactor; y < (fieldY + 1) * scaleFactor; ++y)
+            {
+                const float *row = &distances[(y - windowBegin) * width];
+                for (size_t fieldX = 0; fieldX < fieldWidth; ++fieldX)
+                {
+                    for (size_t x = 0; x < scaleFactor; ++x)
+                    {
+                        sums[fieldX] += row[fieldX * scaleFactor + x];
+                    }
+                }
+            }
+
+            uint8_t *fieldRow = field + fieldY * fieldBytesPerRow;
+            for (size_t fieldX = 0; fieldX < fieldWidth; ++fieldX)
+            {
+                const float distance = std::max(-spread, std::min(sums[fieldX] * averageScale, spread));
+                fieldRow[fieldX] = (uint8_t)((distance / spread + 1) * 0.5f * UINT8_MAX);
+            }
+        }
+    });
+}
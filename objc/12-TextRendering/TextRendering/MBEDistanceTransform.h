@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that the font atlas, which is written in plain Objective-C, can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Computes the exact Euclidean signed distance field of a binary image, in which pixels whose value is
+/// greater than 127 are inside the shape. Each distance is measured in pixels from the pixel's center to
+/// the boundary halfway between it and the nearest pixel on the other side, so it is positive inside the
+/// shape, negative outside, and never smaller in magnitude than one half. Pixels beyond the edges of the
+/// image are treated as though they don't exist.
+///
+/// Distances are clamped to [-maximumDistance, maximumDistance]. Callers that quantize the field to a
+/// fixed range should pass that range, which lets the transform stop looking for boundaries beyond it
+/// and makes it several times faster. Pixels with nothing on the other side of the boundary get the
+/// maximum distance, or, if it is INFINITY, the sum of the image's width and height.
+///
+/// The transform is the separable one of Meijster et al.: a vertical pass over strips of columns finds
+/// the distance to the nearest pixel of each kind in every column, then a horizontal pass over rows finds
+/// the lower envelope of the parabolas those distances describe. Both passes run across the threads of
+/// the shared pool, and the time taken is linear in the number of pixels. Width plus height must be less
+/// than 65535.
+void MBESignedDistanceTransform(const uint8_t *image, size_t width, size_t height, size_t bytesPerRow,
+                                float maximumDistance, float *distances, size_t distancesPerRow);
+
+/// Computes the signed distance field of a binary image as MBESignedDistanceTransform does, averages
+/// each `scaleFactor` x `scaleFactor` block of distances, and quantizes the averages to 8 bits, with 0
+/// standing for `spread` or more outside the shape and 255 for `spread` or more inside it. The width and
+/// height of the image must be multiples of the scale factor, and the spread must be finite.
+///
+/// The image is processed in bands of rows, each of which is transformed with just enough rows above and
+/// below it to find every boundary within the spread, then downsampled and quantized at once. Bands run in
+/// parallel across the shared thread pool, and none of them holds more than a few megabytes of distances,
+/// so the full-resolution field never exists.
+void MBEQuantizedSignedDistanceField(const uint8_t *image, size_t width, size_t height, size_t bytesPerRow,
+                                     size_t scaleFactor, float spread, uint8_t *field, size_t fieldBytesPerRow);
+
+#ifdef __cplusplus
+}
+#endif
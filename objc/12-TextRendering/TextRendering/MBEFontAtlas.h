@@ -6,12 +6,46 @@
 @property (nonatomic, assign) CGPoint bottomRightTexCoord;
 @end
 
-@interface MBEFontAtlas : NSObject <NSSecureCoding>
+typedef NS_ENUM(NSInteger, MBEFontAtlasFieldType)
+{
+    /// One channel of signed distance, computed from a high-resolution raster of the glyphs
+    MBEFontAtlasFieldTypeSingleChannel,
+    /// Three channels of signed pseudo-distance, computed directly from the glyphs' outlines, whose median
+    /// is the distance to the outline. Corners stay sharp, so the texture can have far fewer texels.
+    MBEFontAtlasFieldTypeMultiChannel,
+};
+
+/// Appends the verbs and points of a path's elements to an outline of the kind MBEGenerateMSDF takes.
+/// A NULL path, which is what an empty glyph has, appends nothing.
+void MBEAppendOutlineOfPath(CGPathRef path, NSMutableData *verbs, NSMutableData *points);
+
+/// Something that holds distance fields of a font's glyphs in a texture, and knows where each one is
+@protocol MBEGlyphSource <NSObject>
+
+@property (nonatomic, readonly) UIFont *parentFont;
+@property (nonatomic, readonly) MBEFontAtlasFieldType fieldType;
+
+/// The descriptor of the glyph, or nil if the source has no field for it
+- (MBEGlyphDescriptor *)descriptorForGlyph:(CGGlyph)glyph;
+
+@optional
+
+/// Makes ready the fields of a set of glyphs that are about to be looked up, which may be faster than
+/// looking them up one at a time. Glyphs may repeat.
+- (void)prepareGlyphs:(const CGGlyph *)glyphs count:(NSUInteger)count;
+
+@end
+
+/// A font atlas holds the distance field of every glyph of a font, generated up front
+@interface MBEFontAtlas : NSObject <NSSecureCoding, MBEGlyphSource>
 
 @property (nonatomic, readonly) UIFont *parentFont;
 @property (nonatomic, readonly) CGFloat fontPointSize;
 @property (nonatomic, readonly) CGFloat spread;
 @property (nonatomic, readonly) NSInteger textureSize;
+/// The kind of distance field in the texture data, which has one byte per texel for a single-channel
+/// field and four (RGBA, with opaque alpha) for a multi-channel field
+@property (nonatomic, readonly) MBEFontAtlasFieldType fieldType;
 @property (nonatomic, readonly) NSArray *glyphDescriptors;
 @property (nonatomic, readonly) NSData *textureData;
 
@@ -19,4 +53,7 @@
 /// The supplied font will be resized to fit all available glyphs in the texture.
 - (instancetype)initWithFont:(UIFont *)font textureSize:(NSInteger)textureSize;
 
+/// Create a font atlas holding the specified kind of distance field.
+- (instancetype)initWithFont:(UIFont *)font textureSize:(NSInteger)textureSize fieldType:(MBEFontAtlasFieldType)fieldType;
+
 @end
@@ -1,4 +1,7 @@
 #import "MBEFontAtlas.h"
+#import "MBEDistanceTransform.h"
+#import "MBEMSDFGenerator.h"
+#import "MBERectanglePacker.h"
 @import CoreText;
 
 #define MBE_GENERATE_DEBUG_ATLAS_IMAGE 1
@@ -20,6 +23,62 @@ static NSString *const MBETextureDataKey = @"textureData";
 static NSString *const MBETextureWidthKey = @"textureWidth";
 static NSString *const MBETextureHeightKey = @"textureHeight";
 static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
+static NSString *const MBEFieldTypeKey = @"fieldType";
+
+/// Collects the elements of a glyph's path as the verbs and points of an outline
+typedef struct
+{
+    __unsafe_unretained NSMutableData *verbs;
+    __unsafe_unretained NSMutableData *points;
+} MBEOutlineBuilder;
+
+static void MBEAppendPathElementToOutline(void *info, const CGPathElement *element)
+{
+    MBEOutlineBuilder *builder = info;
+    uint8_t verb;
+    NSInteger pointCount;
+    switch (element->type)
+    {
+        case kCGPathElementMoveToPoint:
+            verb = MBEOutlineVerbMoveTo;
+            pointCount = 1;
+            break;
+        case kCGPathElementAddLineToPoint:
+            verb = MBEOutlineVerbLineTo;
+            pointCount = 1;
+            break;
+        case kCGPathElementAddQuadCurveToPoint:
+            verb = MBEOutlineVerbQuadraticCurveTo;
+            pointCount = 2;
+            break;
+        case kCGPathElementAddCurveToPoint:
+            verb = MBEOutlineVerbCubicCurveTo;
+            pointCount = 3;
+            break;
+        case kCGPathElementCloseSubpath:
+            verb = MBEOutlineVerbClose;
+            pointCount = 0;
+            break;
+        default:
+            return;
+    }
+
+    [builder->verbs appendBytes:&verb length:sizeof(verb)];
+    for (NSInteger i = 0; i < pointCount; ++i)
+    {
+        float point[2] = { element->points[i].x, element->points[i].y };
+        [builder->points appendBytes:point length:sizeof(point)];
+    }
+}
+
+void MBEAppendOutlineOfPath(CGPathRef path, NSMutableData *verbs, NSMutableData *points)
+{
+    if (path)
+    {
+        MBEOutlineBuilder builder = { verbs, points };
+        CGPathApply(path, &builder, MBEAppendPathElementToOutline);
+    }
+}
 
 @implementation MBEGlyphDescriptor
 
@@ -56,6 +115,11 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
 @implementation MBEFontAtlas
 
 - (instancetype)initWithFont:(UIFont *)font textureSize:(NSInteger)textureSize
+{
+    return [self initWithFont:font textureSize:textureSize fieldType:MBEFontAtlasFieldTypeSingleChannel];
+}
+
+- (instancetype)initWithFont:(UIFont *)font textureSize:(NSInteger)textureSize fieldType:(MBEFontAtlasFieldType)fieldType
 {
     if ((self = [super init]))
     {
@@ -64,6 +128,7 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
         _spread = [self estimatedLineWidthForFont:font] * 0.5;
         _glyphDescriptors = [NSMutableArray array];
         _textureSize = textureSize;
+        _fieldType = fieldType;
         [self createTextureData];
     }
 
@@ -106,6 +171,15 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
 
         _textureSize = width;
 
+        // Atlases persisted before multi-channel fields existed have no field type, which decodes as zero
+        _fieldType = [aDecoder decodeIntegerForKey:MBEFieldTypeKey];
+
+        if (_fieldType != MBEFontAtlasFieldTypeSingleChannel && _fieldType != MBEFontAtlasFieldTypeMultiChannel)
+        {
+            NSLog(@"Encountered invalid persisted font (unknown distance field type). Aborting...");
+            return nil;
+        }
+
         _textureData = [aDecoder decodeObjectForKey:MBETextureDataKey];
 
         if (_textureData == nil)
@@ -125,6 +199,7 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
     [aCoder encodeObject:self.textureData forKey:MBETextureDataKey];
     [aCoder encodeInt64:self.textureSize forKey:MBETextureWidthKey];
     [aCoder encodeInt64:self.textureSize forKey:MBETextureHeightKey];
+    [aCoder encodeInteger:self.fieldType forKey:MBEFieldTypeKey];
     [aCoder encodeObject:self.glyphDescriptors forKey:MBEGlyphDescriptorsKey];
 }
 
@@ -133,14 +208,9 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
     return YES;
 }
 
-- (CGSize)estimatedGlyphSizeForFont:(UIFont *)font
+- (MBEGlyphDescriptor *)descriptorForGlyph:(CGGlyph)glyph
 {
-    NSString *exemplarString = @"{ǺOJMQYZa@jmqyw";
-    CGSize exemplarStringSize = [exemplarString sizeWithAttributes:@{ NSFontAttributeName : font }];
-    CGFloat averageGlyphWidth = ceilf(exemplarStringSize.width / exemplarString.length);
-    CGFloat maxGlyphHeight = ceilf(exemplarStringSize.height);
-
-    return CGSizeMake(averageGlyphWidth, maxGlyphHeight);
+    return (glyph < self.glyphDescriptors.count) ? self.glyphDescriptors[glyph] : nil;
 }
 
 - (CGFloat)estimatedLineWidthForFont:(UIFont *)font
@@ -149,33 +219,178 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
     return ceilf(estimatedStrokeWidth);
 }
 
-- (BOOL)font:(UIFont *)font atSize:(CGFloat)size isLikelyToFitInAtlasRect:(CGRect)rect
+/// The margin on each side of a glyph's bounds that takes in every texel within the spread of its outline,
+/// plus `extraPadding` texels so that the fields of neighboring glyphs don't run into each other
+- (CGFloat)paddingForFont:(UIFont *)font extraPadding:(CGFloat)extraPadding
 {
-    const float textureArea = rect.size.width * rect.size.height;
-    UIFont *trialFont = [UIFont fontWithName:font.fontName size:size];
-    CTFontRef trialCTFont = CTFontCreateWithName((__bridge CFStringRef)font.fontName, size, NULL);
-    CFIndex fontGlyphCount = CTFontGetGlyphCount(trialCTFont);
-    CGFloat glyphMargin = [self estimatedLineWidthForFont:trialFont];
-    CGSize averageGlyphSize = [self estimatedGlyphSizeForFont:trialFont];
-    float estimatedGlyphTotalArea = (averageGlyphSize.width + glyphMargin) * (averageGlyphSize.height + glyphMargin) * fontGlyphCount;
-    CFRelease(trialCTFont);
-    BOOL fits = (estimatedGlyphTotalArea < textureArea);
-    return fits;
+    return ceil([self estimatedLineWidthForFont:font] * 0.5) + extraPadding;
 }
 
-- (CGFloat)pointSizeThatFitsForFont:(UIFont *)font inAtlasRect:(CGRect)rect
+/// Packs a cell for each glyph of the font at the given size, holding its bounds and padding, into a
+/// square atlas. Cells of glyphs with empty bounds are empty, and take up no space.
+- (BOOL)packGlyphsOfFont:(UIFont *)font
+                  atSize:(CGFloat)pointSize
+            extraPadding:(CGFloat)extraPadding
+                  packer:(MBERectanglePacker *)packer
+                   cells:(MBEPackedRectangle *)cells
 {
-    CGFloat fittedSize = font.pointSize;
+    CTFontRef ctFont = CTFontCreateWithName((__bridge CFStringRef)font.fontName, pointSize, NULL);
+    CFIndex fontGlyphCount = CTFontGetGlyphCount(ctFont);
+    CGFloat padding = [self paddingForFont:[UIFont fontWithName:font.fontName size:pointSize] extraPadding:extraPadding];
+
+    CGGlyph *glyphs = malloc(fontGlyphCount * sizeof(CGGlyph));
+    CGRect *boundingRects = malloc(fontGlyphCount * sizeof(CGRect));
+    for (CFIndex glyph = 0; glyph < fontGlyphCount; ++glyph)
+    {
+        glyphs[glyph] = glyph;
+    }
+    CTFontGetBoundingRectsForGlyphs(ctFont, kCTFontOrientationHorizontal, glyphs, boundingRects, fontGlyphCount);
+
+    for (CFIndex glyph = 0; glyph < fontGlyphCount; ++glyph)
+    {
+        CGRect boundingRect = boundingRects[glyph];
+        BOOL isEmpty = CGRectIsEmpty(boundingRect);
+        cells[glyph].width = isEmpty ? 0 : (uint32_t)(ceil(CGRectGetWidth(boundingRect)) + 2 * padding);
+        cells[glyph].height = isEmpty ? 0 : (uint32_t)(ceil(CGRectGetHeight(boundingRect)) + 2 * padding);
+    }
+
+    free(boundingRects);
+    free(glyphs);
+    CFRelease(ctFont);
+
+    MBERectanglePackerReset(packer);
+    return MBERectanglePackerInsertBatch(packer, cells, fontGlyphCount);
+}
+
+/// Finds the largest point size, to within a quarter of a point, at which every glyph of the font packs
+/// into a square atlas of `size` texels, and fills in each glyph's cell at that size. Returns zero if the
+/// glyphs don't fit at any size. `cells` must have room for every glyph of the font.
+- (CGFloat)pointSizeThatFitsForFont:(UIFont *)font
+                          atlasSize:(NSInteger)size
+                       extraPadding:(CGFloat)extraPadding
+                              cells:(MBEPackedRectangle *)cells
+{
+    CTFontRef ctFont = CTFontCreateWithName((__bridge CFStringRef)font.fontName, font.pointSize, NULL);
+    CFIndex fontGlyphCount = CTFontGetGlyphCount(ctFont);
+
+    // Glyph bounds scale with the point size, and the atlas can't hold more than its area of them, which
+    // bounds the search from above
+    CGRect totalRect = CGRectZero;
+    double totalArea = 0;
+    for (CGGlyph glyph = 0; glyph < fontGlyphCount; ++glyph)
+    {
+        CGRect boundingRect;
+        CTFontGetBoundingRectsForGlyphs(ctFont, kCTFontOrientationHorizontal, &glyph, &boundingRect, 1);
+        totalArea += CGRectGetWidth(boundingRect) * CGRectGetHeight(boundingRect);
+        totalRect = CGRectUnion(totalRect, boundingRect);
+    }
+    CFRelease(ctFont);
 
-    while ([self font:font atSize:fittedSize isLikelyToFitInAtlasRect:rect])
-        ++fittedSize;
+    CGFloat largestSize = font.pointSize * MIN(sqrt(size * size / MAX(totalArea, 1)),
+                                               size / MAX(MAX(CGRectGetWidth(totalRect), CGRectGetHeight(totalRect)), 1));
+    CGFloat smallestSize = 1;
 
-    while (![self font:font atSize:fittedSize isLikelyToFitInAtlasRect:rect])
-        --fittedSize;
+    MBERectanglePacker *packer = MBERectanglePackerCreate((uint32_t)size, (uint32_t)size,
+                                                          MBERectanglePackingMaxRectsBestShortSideFit);
+    if (![self packGlyphsOfFont:font atSize:smallestSize extraPadding:extraPadding packer:packer cells:cells])
+    {
+        MBERectanglePackerDestroy(packer);
+        return 0;
+    }
+
+    // Packing fails fast when the cells can't fit by area, so most of the probes above the answer are cheap
+    MBEPackedRectangle *trialCells = malloc(fontGlyphCount * sizeof(MBEPackedRectangle));
+    CGFloat fittedSize = smallestSize;
+    while (largestSize - smallestSize > 0.25)
+    {
+        CGFloat trialSize = (smallestSize + largestSize) * 0.5;
+        if ([self packGlyphsOfFont:font atSize:trialSize extraPadding:extraPadding packer:packer cells:trialCells])
+        {
+            memcpy(cells, trialCells, fontGlyphCount * sizeof(MBEPackedRectangle));
+            fittedSize = smallestSize = trialSize;
+        }
+        else
+        {
+            largestSize = trialSize;
+        }
+    }
+
+    free(trialCells);
+    MBERectanglePackerDestroy(packer);
+
+#if DEBUG
+    double usedArea = 0;
+    for (CFIndex glyph = 0; glyph < fontGlyphCount; ++glyph)
+    {
+        usedArea += (double)cells[glyph].width * cells[glyph].height;
+    }
+    NSLog(@"Packed glyphs of font %@ at %.2f pt into a %d x %d atlas, %.1f%% occupied",
+          font.fontName, fittedSize, (int)size, (int)size, usedArea / (size * size) * 100);
+#endif
 
     return fittedSize;
 }
 
+/// The transform that places a glyph's path in its cell, flipped so that y increases downward, with the
+/// top left of its bounds at the padding
+- (CGAffineTransform)transformForGlyphWithBoundingRect:(CGRect)boundingRect
+                                                inCell:(MBEPackedRectangle)cell
+                                               padding:(CGFloat)padding
+{
+    CGFloat glyphOriginX = cell.x + padding - boundingRect.origin.x;
+    CGFloat glyphOriginY = cell.y + padding + CGRectGetMaxY(boundingRect);
+    return CGAffineTransformMake(1, 0, 0, -1, glyphOriginX, glyphOriginY);
+}
+
+- (void)addDescriptorForGlyph:(CGGlyph)glyph withPath:(CGPathRef)path atlasSize:(NSInteger)size
+{
+    CGRect glyphPathBoundingRect = path ? CGPathGetPathBoundingBox(path) : CGRectNull;
+
+    // The null rect (i.e., the bounding rect of an empty path) is problematic
+    // because it has its origin at (+inf, +inf); we fix that up here
+    if (CGRectEqualToRect(glyphPathBoundingRect, CGRectNull))
+    {
+        glyphPathBoundingRect = CGRectZero;
+    }
+
+    CGFloat texCoordLeft = glyphPathBoundingRect.origin.x / size;
+    CGFloat texCoordRight = (glyphPathBoundingRect.origin.x + glyphPathBoundingRect.size.width) / size;
+    CGFloat texCoordTop = (glyphPathBoundingRect.origin.y) / size;
+    CGFloat texCoordBottom = (glyphPathBoundingRect.origin.y + glyphPathBoundingRect.size.height) / size;
+
+    MBEGlyphDescriptor *descriptor = [MBEGlyphDescriptor new];
+    descriptor.glyphIndex = glyph;
+    descriptor.topLeftTexCoord = CGPointMake(texCoordLeft, texCoordTop);
+    descriptor.bottomRightTexCoord = CGPointMake(texCoordRight, texCoordBottom);
+    [(NSMutableArray *)self.glyphDescriptors addObject:descriptor];
+}
+
+/// Resizes the font to the largest size at which its glyphs pack into a square atlas of `size` texels,
+/// and returns the cell of each glyph at that size, or NULL if they don't fit at any size. The caller
+/// frees the cells.
+- (MBEPackedRectangle *)createGlyphCellsForAtlasSize:(NSInteger)size extraPadding:(CGFloat)extraPadding
+{
+    CTFontRef ctFont = CTFontCreateWithName((__bridge CFStringRef)self.parentFont.fontName, self.parentFont.pointSize, NULL);
+    CFIndex fontGlyphCount = CTFontGetGlyphCount(ctFont);
+    CFRelease(ctFont);
+
+    MBEPackedRectangle *cells = malloc(fontGlyphCount * sizeof(MBEPackedRectangle));
+    CGFloat pointSize = [self pointSizeThatFitsForFont:self.parentFont atlasSize:size extraPadding:extraPadding cells:cells];
+
+    if (pointSize == 0)
+    {
+        NSLog(@"Glyphs of font %@ don't fit in a %d x %d atlas at any size", self.parentFont.fontName, (int)size, (int)size);
+        free(cells);
+        return NULL;
+    }
+
+    _fontPointSize = pointSize;
+    _parentFont = [UIFont fontWithName:self.parentFont.fontName size:pointSize];
+    _spread = [self estimatedLineWidthForFont:_parentFont] * 0.5;
+
+    return cells;
+}
+
 - (uint8_t *)createAtlasForFont:(UIFont *)font width:(NSInteger)width height:(NSInteger)height
 {
     uint8_t *imageData = malloc(width * height);
@@ -202,74 +417,45 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
     CGContextSetRGBFillColor(context, 0, 0, 0, 1);
     CGContextFillRect(context, CGRectMake(0, 0, width, height));
 
-    _fontPointSize = [self pointSizeThatFitsForFont:font inAtlasRect:CGRectMake(0, 0, width, height)];
-    CTFontRef ctFont = CTFontCreateWithName((__bridge CFStringRef)font.fontName, _fontPointSize, NULL);
-    _parentFont = [UIFont fontWithName:font.fontName size:_fontPointSize];
-
-    CFIndex fontGlyphCount = CTFontGetGlyphCount(ctFont);
-
-    CGFloat glyphMargin = [self estimatedLineWidthForFont:_parentFont];
-
-    // Set fill color so that glyphs are solid white
-    CGContextSetRGBFillColor(context, 1, 1, 1, 1);
+    // Leave at least one texel of the downsampled field between the spreads of neighboring glyphs
+    CGFloat scaleFactor = width / self.textureSize;
+    MBEPackedRectangle *cells = [self createGlyphCellsForAtlasSize:width extraPadding:scaleFactor];
 
     NSMutableArray *mutableGlyphs = (NSMutableArray *)self.glyphDescriptors;
     [mutableGlyphs removeAllObjects];
 
-    CGFloat fontAscent = CTFontGetAscent(ctFont);
-    CGFloat fontDescent = CTFontGetDescent(ctFont);
-
-    CGPoint origin = CGPointMake(0, fontAscent);
-    CGFloat maxYCoordForLine = -1;
-    for (CGGlyph glyph = 0; glyph < fontGlyphCount; ++glyph)
+    if (cells)
     {
-        CGRect boundingRect;
-        CTFontGetBoundingRectsForGlyphs(ctFont, kCTFontOrientationHorizontal, &glyph, &boundingRect, 1);
+        CTFontRef ctFont = CTFontCreateWithName((__bridge CFStringRef)font.fontName, _fontPointSize, NULL);
+        CFIndex fontGlyphCount = CTFontGetGlyphCount(ctFont);
+        CGFloat padding = [self paddingForFont:_parentFont extraPadding:scaleFactor];
 
-        if (origin.x + CGRectGetMaxX(boundingRect) + glyphMargin > width)
-        {
-            origin.x = 0;
-            origin.y = maxYCoordForLine + glyphMargin + fontDescent;
-            maxYCoordForLine = -1;
-        }
+        // Set fill color so that glyphs are solid white
+        CGContextSetRGBFillColor(context, 1, 1, 1, 1);
 
-        if (origin.y + CGRectGetMaxY(boundingRect) > maxYCoordForLine)
+        for (CGGlyph glyph = 0; glyph < fontGlyphCount; ++glyph)
         {
-            maxYCoordForLine = origin.y + CGRectGetMaxY(boundingRect);
-        }
+            CGRect boundingRect;
+            CTFontGetBoundingRectsForGlyphs(ctFont, kCTFontOrientationHorizontal, &glyph, &boundingRect, 1);
 
-        CGFloat glyphOriginX = origin.x - boundingRect.origin.x + (glyphMargin * 0.5);
-        CGFloat glyphOriginY = origin.y + (glyphMargin * 0.5);
+            CGAffineTransform glyphTransform = [self transformForGlyphWithBoundingRect:boundingRect
+                                                                                inCell:cells[glyph]
+                                                                               padding:padding];
 
-        CGAffineTransform glyphTransform = CGAffineTransformMake(1, 0, 0, -1, glyphOriginX, glyphOriginY);
-
-        CGPathRef path = CTFontCreatePathForGlyph(ctFont, glyph, &glyphTransform);
-        CGContextAddPath(context, path);
-        CGContextFillPath(context);
+            CGPathRef path = CTFontCreatePathForGlyph(ctFont, glyph, &glyphTransform);
+            if (path)
+            {
+                CGContextAddPath(context, path);
+                CGContextFillPath(context);
+            }
 
-        CGRect glyphPathBoundingRect = CGPathGetPathBoundingBox(path);
+            [self addDescriptorForGlyph:glyph withPath:path atlasSize:width];
 
-        // The null rect (i.e., the bounding rect of an empty path) is problematic
-        // because it has its origin at (+inf, +inf); we fix that up here
-        if (CGRectEqualToRect(glyphPathBoundingRect, CGRectNull))
-        {
-            glyphPathBoundingRect = CGRectZero;
+            CGPathRelease(path);
         }
 
-        CGFloat texCoordLeft = glyphPathBoundingRect.origin.x / width;
-        CGFloat texCoordRight = (glyphPathBoundingRect.origin.x + glyphPathBoundingRect.size.width) / width;
-        CGFloat texCoordTop = (glyphPathBoundingRect.origin.y) / height;
-        CGFloat texCoordBottom = (glyphPathBoundingRect.origin.y + glyphPathBoundingRect.size.height) / height;
-
-        MBEGlyphDescriptor *descriptor = [MBEGlyphDescriptor new];
-        descriptor.glyphIndex = glyph;
-        descriptor.topLeftTexCoord = CGPointMake(texCoordLeft, texCoordTop);
-        descriptor.bottomRightTexCoord = CGPointMake(texCoordRight, texCoordBottom);
-        [mutableGlyphs addObject:descriptor];
-
-        CGPathRelease(path);
-
-        origin.x += CGRectGetWidth(boundingRect) + glyphMargin;
+        CFRelease(ctFont);
+        free(cells);
     }
 
 #if MBE_GENERATE_DEBUG_ATLAS_IMAGE
@@ -280,195 +466,86 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
     CGImageRelease(contextImage);
 #endif
 
-    CFRelease(ctFont);
     CGContextRelease(context);
     CGColorSpaceRelease(colorSpace);
 
     return imageData;
 }
 
-/// Compute signed-distance field for an 8-bpp grayscale image (values greater than 127 are considered "on")
-/// For details of this algorithm, see "The 'dead reckoning' signed distance transform" [Grevera 2004]
-- (float *)createSignedDistanceFieldForGrayscaleImage:(const uint8_t *)imageData
-                                                width:(NSInteger)width
-                                               height:(NSInteger)height
+- (void)createMultiChannelTextureData
 {
-    if (imageData == NULL || width == 0 || height == 0)
-        return NULL;
-
-    typedef struct { unsigned short x, y; } intpoint_t;
-
-    float *distanceMap = malloc(width * height * sizeof(float)); // distance to nearest boundary point map
-    intpoint_t *boundaryPointMap = malloc(width * height * sizeof(intpoint_t)); // nearest boundary point map
-
-    // Some helpers for manipulating the above arrays
-#define image(_x, _y) (imageData[(_y) * width + (_x)] > 0x7f)
-#define distance(_x, _y) distanceMap[(_y) * width + (_x)]
-#define nearestpt(_x, _y) boundaryPointMap[(_y) * width + (_x)]
+    const NSInteger size = self.textureSize;
 
-    const float maxDist = hypot(width, height);
-    const float distUnit = 1;
-    const float distDiag = sqrt(2);
+    // The field is generated at the size of the texture, so the spread and padding are in texels
+    MBEPackedRectangle *cells = [self createGlyphCellsForAtlasSize:size extraPadding:1];
 
-    // Initialization phase: set all distances to "infinity"; zero out nearest boundary point map
-    for (long y = 0; y < height; ++y)
-    {
-        for (long x = 0; x < width; ++x)
-        {
-            distance(x, y) = maxDist;
-            nearestpt(x, y) = (intpoint_t){ 0, 0 };
-        }
-    }
-
-    // Immediate interior/exterior phase: mark all points along the boundary as such
-    for (long y = 1; y < height - 1; ++y)
-    {
-        for (long x = 1; x < width - 1; ++x)
-        {
-            bool inside = image(x, y);
-            if (image(x - 1, y) != inside ||
-                image(x + 1, y) != inside ||
-                image(x, y - 1) != inside ||
-                image(x, y + 1) != inside)
-            {
-                distance(x, y) = 0;
-                nearestpt(x, y) = (intpoint_t){ x, y };
-            }
-        }
-    }
+    NSMutableArray *mutableGlyphs = (NSMutableArray *)self.glyphDescriptors;
+    [mutableGlyphs removeAllObjects];
 
-    // Forward dead-reckoning pass
-    for (long y = 1; y < height - 2; ++y)
-    {
-        for (long x = 1; x < width - 2; ++x)
-        {
-            if (distanceMap[(y - 1) * width + (x - 1)] + distDiag < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x - 1, y - 1);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-            if (distance(x, y - 1) + distUnit < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x, y - 1);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-            if (distance(x + 1, y - 1) + distDiag < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x + 1, y - 1);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-            if (distance(x - 1, y) + distUnit < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x - 1, y);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-        }
-    }
+    // The generator reads the outlines straight out of these, so they must outlive it
+    NS_VALID_UNTIL_END_OF_SCOPE NSMutableArray *outlineData = [NSMutableArray array];
+    MBEMSDFGlyph *glyphs = NULL;
+    CFIndex fontGlyphCount = 0;
 
-    // Backward dead-reckoning pass
-    for (long y = height - 2; y >= 1; --y)
+    if (cells)
     {
-        for (long x = width - 2; x >= 1; --x)
-        {
-            if (distance(x + 1, y) + distUnit < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x + 1, y);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-            if (distance(x - 1, y + 1) + distDiag < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x - 1, y + 1);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-            if (distance(x, y + 1) + distUnit < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x, y + 1);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-            if (distance(x + 1, y + 1) + distDiag < distance(x, y))
-            {
-                nearestpt(x, y) = nearestpt(x + 1, y + 1);
-                distance(x, y) = hypot(x - nearestpt(x, y).x, y - nearestpt(x, y).y);
-            }
-        }
-    }
+        CTFontRef ctFont = CTFontCreateWithName((__bridge CFStringRef)self.parentFont.fontName, self.fontPointSize, NULL);
+        fontGlyphCount = CTFontGetGlyphCount(ctFont);
+        glyphs = malloc(fontGlyphCount * sizeof(MBEMSDFGlyph));
+        CGFloat padding = [self paddingForFont:self.parentFont extraPadding:1];
 
-    // Interior distance negation pass; distances outside the figure are considered negative
-    for (long y = 0; y < height; ++y)
-    {
-        for (long x = 0; x < width; ++x)
+        // Cells don't overlap, so their fields can be generated independently
+        for (CGGlyph glyph = 0; glyph < fontGlyphCount; ++glyph)
         {
-            if (!image(x, y))
-                distance(x, y) = -distance(x, y);
-        }
-    }
+            CGRect boundingRect;
+            CTFontGetBoundingRectsForGlyphs(ctFont, kCTFontOrientationHorizontal, &glyph, &boundingRect, 1);
 
-    free(boundaryPointMap);
+            CGAffineTransform glyphTransform = [self transformForGlyphWithBoundingRect:boundingRect
+                                                                                inCell:cells[glyph]
+                                                                               padding:padding];
 
-    return distanceMap;
+            CGPathRef path = CTFontCreatePathForGlyph(ctFont, glyph, &glyphTransform);
 
-#undef image
-#undef distance
-#undef nearestpt
-}
-
-- (float *)createResampledData:(float *)inData
-                          width:(NSInteger)width
-                         height:(NSInteger)height
-                    scaleFactor:(NSInteger)scaleFactor
-{
-    NSAssert(width % scaleFactor == 0 && height % scaleFactor == 0,
-             @"Scale factor does not evenly divide width and height of source distance field");
+            NSMutableData *verbs = [NSMutableData data];
+            NSMutableData *points = [NSMutableData data];
+            MBEAppendOutlineOfPath(path, verbs, points);
+            [outlineData addObject:verbs];
+            [outlineData addObject:points];
 
-    NSInteger scaledWidth = width / scaleFactor;
-    NSInteger scaledHeight = height / scaleFactor;
-    float *outData = malloc(scaledWidth * scaledHeight * sizeof(float));
+            glyphs[glyph].verbs = verbs.bytes;
+            glyphs[glyph].verbCount = verbs.length;
+            glyphs[glyph].points = points.bytes;
+            glyphs[glyph].pointCount = points.length / (2 * sizeof(float));
+            glyphs[glyph].x = cells[glyph].x;
+            glyphs[glyph].y = cells[glyph].y;
+            glyphs[glyph].width = cells[glyph].width;
+            glyphs[glyph].height = cells[glyph].height;
 
-    for (int y = 0; y < height; y += scaleFactor)
-    {
-        for (int x = 0; x < width; x += scaleFactor)
-        {
-            float accum = 0;
-            for (int ky = 0; ky < scaleFactor; ++ky)
-            {
-                for (int kx = 0; kx < scaleFactor; ++kx)
-                {
-                    accum += inData[(y + ky) * width + (x + kx)];
-                }
-            }
-            accum = accum / (scaleFactor * scaleFactor);
+            [self addDescriptorForGlyph:glyph withPath:path atlasSize:size];
 
-            outData[(y / scaleFactor) * scaledWidth + (x / scaleFactor)] = accum;
+            CGPathRelease(path);
         }
+
+        CFRelease(ctFont);
+        free(cells);
     }
 
-    return outData;
+    // Texels outside every cell stay zero, which is outside in every channel
+    uint8_t *texture = calloc(size * size, 4);
+    MBEGenerateMSDF(glyphs, fontGlyphCount, self.spread, texture, size * 4);
+    free(glyphs);
+
+    _textureData = [NSData dataWithBytesNoCopy:texture length:size * size * 4 freeWhenDone:YES];
 }
 
-- (uint8_t *)createQuantizedDistanceField:(float *)inData
-                                    width:(NSInteger)width
-                                   height:(NSInteger)height
-                      normalizationFactor:(float)normalizationFactor
+- (void)createTextureData
 {
-    uint8_t *outData = malloc(width * height);
-
-    for (int y = 0; y < height; ++y)
+    if (self.fieldType == MBEFontAtlasFieldTypeMultiChannel)
     {
-        for (int x = 0; x < width; ++x)
-        {
-            float dist = inData[y * width + x];
-            float clampDist = fmax(-normalizationFactor, fmin(dist, normalizationFactor));
-            float scaledDist = clampDist / normalizationFactor;
-            uint8_t value = ((scaledDist + 1) / 2) * UINT8_MAX;
-            outData[y * width + x] = value;
-        }
+        [self createMultiChannelTextureData];
+        return;
     }
 
-    return outData;
-}
-
-- (void)createTextureData
-{
     NSAssert(MBEFontAtlasSize >= self.textureSize,
              @"Requested font atlas texture size (%d) must be smaller than intermediate texture size (%d)",
              (int)MBEFontAtlasSize, (int)self.textureSize);
@@ -484,29 +561,17 @@ static NSString *const MBEGlyphDescriptorsKey = @"glyphDescriptors";
 
     NSInteger scaleFactor = MBEFontAtlasSize / self.textureSize;
 
-    // Create the signed-distance field representation of the font atlas from the rasterized glyph image.
-    float *distanceField = [self createSignedDistanceFieldForGrayscaleImage:atlasData
-                                                                      width:MBEFontAtlasSize
-                                                                     height:MBEFontAtlasSize];
-
-    free(atlasData);
-
-    // Downsample the signed-distance field to the expected texture resolution
-    void *scaledField = [self createResampledData:distanceField
-                                             width:MBEFontAtlasSize
-                                            height:MBEFontAtlasSize
-                                       scaleFactor:scaleFactor];
-
-    free(distanceField);
-
+    // Distances beyond the spread all quantize to the same value, so the transform needn't measure them
     CGFloat spread = [self estimatedLineWidthForFont:self.parentFont] * 0.5;
-    // Quantize the downsampled distance field into an 8-bit grayscale array suitable for use as a texture
-    uint8_t *texture = [self createQuantizedDistanceField:scaledField
-                                                    width:self.textureSize
-                                                   height:self.textureSize
-                                      normalizationFactor:spread];
 
-    free(scaledField);
+    // Compute the signed-distance field of the rasterized glyph image, downsample it to the expected
+    // texture resolution, and quantize it into an 8-bit grayscale array suitable for use as a texture.
+    // This happens a band of rows at a time, so the full-resolution distance field is never stored.
+    uint8_t *texture = malloc(self.textureSize * self.textureSize);
+    MBEQuantizedSignedDistanceField(atlasData, MBEFontAtlasSize, MBEFontAtlasSize, MBEFontAtlasSize,
+                                    scaleFactor, spread, texture, self.textureSize);
+
+    free(atlasData);
 
     NSInteger textureByteCount = self.textureSize * self.textureSize;
     _textureData = [NSData dataWithBytesNoCopy:texture length:textureByteCount freeWhenDone:YES];
@@ -0,0 +1,46 @@
+@import Foundation;
+@import Metal;
+
+/// The number of frames the CPU may encode while the GPU is still executing earlier ones
+extern const NSUInteger MBEDefaultFramesInFlight;
+
+/// Every allocation starts on a multiple of this many bytes, which satisfies the offset alignment
+/// of constant buffers. Size a frame by rounding each of its allocations up to it.
+extern const NSUInteger MBEFrameResourceAlignment;
+
+/// Per-frame uniform storage for a renderer. A single buffer is divided into one slot per frame
+/// in flight, and each frame sub-allocates its uniforms from its own slot, so the CPU can write
+/// frame N + 1 while the GPU is still reading frame N. Beginning a frame blocks until the GPU has
+/// finished with the frame that last used the slot.
+///
+/// Call -beginFrame once per frame before allocating, and -endFrameWithCommandBuffer: once per
+/// frame, before the command buffer is committed. Both must be called from the same thread.
+@interface MBEFrameResources : NSObject
+
+/// The buffer that every allocation comes from. Bind it with the offset returned by an allocation.
+@property (nonatomic, readonly) id<MTLBuffer> buffer;
+@property (nonatomic, readonly) NSUInteger framesInFlight;
+/// The number of bytes available to each frame
+@property (nonatomic, readonly) NSUInteger bytesPerFrame;
+
+- (instancetype)initWithDevice:(id<MTLDevice>)device
+                framesInFlight:(NSUInteger)framesInFlight
+                 bytesPerFrame:(NSUInteger)bytesPerFrame;
+
+/// Waits until a slot is free and makes it the target of subsequent allocations
+- (void)beginFrame;
+
+/// Waits until the GPU has finished every frame before the current one, so that a resource every frame
+/// reads, but that isn't divided into slots, such as a texture, can be updated in place
+- (void)waitForPreviousFrames;
+
+/// Reserves `length` bytes for the current frame and returns a pointer to them, storing their
+/// offset within `buffer` in `offset`. Returns NULL if the frame has run out of space, in which case
+/// the caller must skip whatever needed the allocation for this frame.
+- (void *)allocateLength:(NSUInteger)length offset:(NSUInteger *)offset;
+
+/// Releases the current frame's slot once `commandBuffer` completes. Frames must be ended with
+/// command buffers from the same queue, committed in order, even when a frame draws nothing.
+- (void)endFrameWithCommandBuffer:(id<MTLCommandBuffer>)commandBuffer;
+
+@end
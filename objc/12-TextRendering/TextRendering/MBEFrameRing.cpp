@@ -0,0 +1,73 @@
+#include "MBEFrameRing.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+    size_t AlignUp(size_t value, size_t alignment)
+    {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+}
+
+void MBECPUFrameFence::signal(uint64_t frame)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Completion handlers may run on different threads, so a signal can arrive after a later one
+        _completedFrame = std::max(_completedFrame, frame);
+    }
+    _completed.notify_all();
+}
+
+void MBECPUFrameFence::wait(uint64_t frame)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _completed.wait(lock, [&] { return _completedFrame >= frame; });
+}
+
+uint64_t MBECPUFrameFence::completedFrame() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _completedFrame;
+}
+
+MBEFrameRing::MBEFrameRing(MBEFrameFence &fence, unsigned frameCount, size_t bytesPerFrame, size_t alignment)
+: _fence(fence),
+  _frameCount(std::max(frameCount, 1u)),
+  _alignment(std::max(alignment, (size_t)1)),
+  _bytesPerFrame(0),
+  _currentFrame(0),
+  _cursor(0)
+{
+    assert((_alignment & (_alignment - 1)) == 0 && "frame ring alignment must be a power of two");
+    _bytesPerFrame = AlignUp(bytesPerFrame, _alignment);
+}
+
+uint64_t MBEFrameRing::beginFrame()
+{
+    const uint64_t frame = _currentFrame + 1;
+
+    // The slot was last used `frameCount` frames ago, and the GPU may still be reading it
+    if (frame > _frameCount)
+    {
+        _fence.wait(frame - _frameCount);
+    }
+
+    _currentFrame = frame;
+    _cursor = 0;
+    return frame;
+}
+
+bool MBEFrameRing::allocate(size_t length, size_t *offset)
+{
+    if (_currentFrame == 0 || length > _bytesPerFrame - _cursor)
+    {
+        return false;
+    }
+
+    *offset = currentSlot() * _bytesPerFrame + _cursor;
+    _cursor = std::min(AlignUp(_cursor + length, _alignment), _bytesPerFrame);
+    return true;
+}
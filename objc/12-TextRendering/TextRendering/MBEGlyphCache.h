@@ -0,0 +1,45 @@
+@import UIKit;
+#import "MBEFontAtlas.h"
+
+/// A glyph cache holds the distance fields of the glyphs of a font that are actually in use, generating
+/// each one the first time it's looked up, so the work and memory it takes scale with the text displayed
+/// rather than with the size of the font.
+///
+/// The texture is divided into square plots, each of which packs glyphs as they arrive. When no plot has
+/// room for a new glyph, the least recently used plot is emptied, and the descriptors of its glyphs
+/// become invalid. Plots holding glyphs used since the last call to -beginFrame are never emptied, so
+/// descriptors looked up since then stay valid until the next call. A renderer calls -beginFrame once per
+/// frame and then looks up every glyph it will draw; if it never calls it, every glyph counts as used, so
+/// nothing is evicted and glyphs that don't fit once the texture is full are skipped.
+@interface MBEGlyphCache : NSObject <MBEGlyphSource>
+
+/// The font whose glyphs are cached, at the size the fields are generated at, with one point to a texel
+@property (nonatomic, readonly) UIFont *parentFont;
+/// The distance, in texels, at which fields saturate
+@property (nonatomic, readonly) CGFloat spread;
+@property (nonatomic, readonly) NSInteger textureSize;
+/// The kind of distance field in the texture data, which has one byte per texel for a single-channel
+/// field and four (RGBA, with opaque alpha) for a multi-channel field
+@property (nonatomic, readonly) MBEFontAtlasFieldType fieldType;
+/// A copy of the contents of the texture, which holds the fields of the cached glyphs
+@property (nonatomic, readonly) NSData *textureData;
+
+/// Create an empty glyph cache, whose glyphs are generated at the point size of the font, with plots that
+/// are a quarter of the texture size on a side.
+- (instancetype)initWithFont:(UIFont *)font textureSize:(NSInteger)textureSize fieldType:(MBEFontAtlasFieldType)fieldType;
+
+/// Create an empty glyph cache with plots of the specified size, which must divide the texture size and
+/// be large enough to hold any glyph with its padding.
+- (instancetype)initWithFont:(UIFont *)font
+                 textureSize:(NSInteger)textureSize
+                    plotSize:(NSInteger)plotSize
+                   fieldType:(MBEFontAtlasFieldType)fieldType;
+
+/// Marks the start of a frame, after which the glyphs looked up before it may be evicted
+- (void)beginFrame;
+
+/// Calls the block with each rectangle of texels that has changed since the last call, in texels, so
+/// that just those regions of the texture can be updated from the texture data.
+- (void)flushDirtyRectsUsingBlock:(void (^)(CGRect dirtyRect))block;
+
+@end
@@ -0,0 +1,462 @@
+#import "MBEGlyphCache.h"
+#import "MBEDistanceTransform.h"
+#import "MBEMSDFGenerator.h"
+#import "MBERectanglePacker.h"
+@import CoreText;
+
+// Single-channel fields are computed from a raster of each glyph at this many times the resolution of the
+// field, in order to capture its fine details, as they are in the font atlas
+static const NSInteger MBEGlyphCacheRasterScale = 4;
+
+/// A glyph whose field is about to be generated, in the cell it has been given in a plot
+typedef struct
+{
+    CGGlyph glyph;
+    CGRect boundingRect;
+    MBEPackedRectangle cell;
+    NSInteger plotIndex;
+} MBEPendingGlyph;
+
+static int MBEComparePendingGlyphHeights(const void *a, const void *b)
+{
+    const MBEPendingGlyph *first = a;
+    const MBEPendingGlyph *second = b;
+    return (int)second->cell.height - (int)first->cell.height;
+}
+
+/// A square region of the cache's texture, whose glyphs are packed together and evicted together
+@interface MBEGlyphCachePlot : NSObject
+@property (nonatomic, readonly) CGRect rect;
+@property (nonatomic, readonly) MBERectanglePacker *packer;
+@property (nonatomic, readonly) NSMutableArray *glyphs;
+@property (nonatomic, assign) NSUInteger lastUsedFrame;
+@property (nonatomic, assign) CGRect dirtyRect;
+@end
+
+@implementation MBEGlyphCachePlot
+
+- (instancetype)initWithRect:(CGRect)rect
+{
+    if ((self = [super init]))
+    {
+        _rect = rect;
+        // Glyphs arrive a few at a time, and are all of about the same height, which suits the skyline
+        _packer = MBERectanglePackerCreate((uint32_t)CGRectGetWidth(rect), (uint32_t)CGRectGetHeight(rect),
+                                           MBERectanglePackingSkylineBottomLeft);
+        _glyphs = [NSMutableArray array];
+        // The texture starts out undefined, so the whole plot must be uploaded at least once
+        _dirtyRect = rect;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    MBERectanglePackerDestroy(_packer);
+}
+
+@end
+
+/// Where a cached glyph's field is, and which plot holds it, if any
+@interface MBEGlyphCacheEntry : NSObject
+@property (nonatomic, strong) MBEGlyphDescriptor *descriptor;
+@property (nonatomic, strong) MBEGlyphCachePlot *plot;
+@end
+
+@implementation MBEGlyphCacheEntry
+@end
+
+@interface MBEGlyphCache ()
+@property (nonatomic, assign) CTFontRef ctFont;
+@property (nonatomic, assign) NSInteger plotSize;
+@property (nonatomic, strong) NSArray *plots;
+@property (nonatomic, strong) NSMutableDictionary *entries;
+@property (nonatomic, strong) NSMutableData *mutableTextureData;
+@property (nonatomic, assign) NSUInteger frame;
+@end
+
+@implementation MBEGlyphCache
+
+- (instancetype)initWithFont:(UIFont *)font textureSize:(NSInteger)textureSize fieldType:(MBEFontAtlasFieldType)fieldType
+{
+    return [self initWithFont:font textureSize:textureSize plotSize:textureSize / 4 fieldType:fieldType];
+}
+
+- (instancetype)initWithFont:(UIFont *)font
+                 textureSize:(NSInteger)textureSize
+                    plotSize:(NSInteger)plotSize
+                   fieldType:(MBEFontAtlasFieldType)fieldType
+{
+    NSAssert(plotSize > 0 && textureSize % plotSize == 0,
+             @"Glyph cache plot size (%d) does not evenly divide texture size (%d)",
+             (int)plotSize, (int)textureSize);
+
+    if ((self = [super init]))
+    {
+        _parentFont = font;
+        _ctFont = CTFontCreateWithName((__bridge CFStringRef)font.fontName, font.pointSize, NULL);
+        _spread = ceilf([@"!" sizeWithAttributes:@{ NSFontAttributeName : font }].width) * 0.5;
+        _textureSize = textureSize;
+        _plotSize = plotSize;
+        _fieldType = fieldType;
+        _entries = [NSMutableDictionary dictionary];
+        _frame = 1;
+
+        // Texels outside every glyph stay zero, which is outside in every channel
+        NSInteger bytesPerTexel = (fieldType == MBEFontAtlasFieldTypeMultiChannel) ? 4 : 1;
+        _mutableTextureData = [NSMutableData dataWithLength:textureSize * textureSize * bytesPerTexel];
+
+        NSMutableArray *plots = [NSMutableArray array];
+        for (NSInteger y = 0; y < textureSize; y += plotSize)
+        {
+            for (NSInteger x = 0; x < textureSize; x += plotSize)
+            {
+                [plots addObject:[[MBEGlyphCachePlot alloc] initWithRect:CGRectMake(x, y, plotSize, plotSize)]];
+            }
+        }
+        _plots = plots;
+    }
+
+    return self;
+}
+
+- (void)dealloc
+{
+    CFRelease(_ctFont);
+}
+
+- (NSData *)textureData
+{
+    return self.mutableTextureData;
+}
+
+- (NSInteger)bytesPerTexel
+{
+    return (self.fieldType == MBEFontAtlasFieldTypeMultiChannel) ? 4 : 1;
+}
+
+- (void)beginFrame
+{
+    ++self.frame;
+}
+
+- (void)flushDirtyRectsUsingBlock:(void (^)(CGRect dirtyRect))block
+{
+    for (MBEGlyphCachePlot *plot in self.plots)
+    {
+        if (!CGRectIsNull(plot.dirtyRect))
+        {
+            block(plot.dirtyRect);
+            plot.dirtyRect = CGRectNull;
+        }
+    }
+}
+
+- (MBEGlyphDescriptor *)descriptorForGlyph:(CGGlyph)glyph
+{
+    [self prepareGlyphs:&glyph count:1];
+    MBEGlyphCacheEntry *entry = self.entries[@(glyph)];
+    return entry.descriptor;
+}
+
+/// Empties the least recently used plot that hasn't been used this frame, and returns its index, or
+/// NSNotFound if every plot has been used this frame
+- (NSInteger)evictLeastRecentlyUsedPlot
+{
+    NSInteger victimIndex = NSNotFound;
+    NSUInteger victimLastUsedFrame = self.frame;
+    for (NSInteger i = 0; i < self.plots.count; ++i)
+    {
+        MBEGlyphCachePlot *plot = self.plots[i];
+        if (plot.lastUsedFrame < victimLastUsedFrame)
+        {
+            victimIndex = i;
+            victimLastUsedFrame = plot.lastUsedFrame;
+        }
+    }
+
+    if (victimIndex == NSNotFound)
+    {
+        return NSNotFound;
+    }
+
+    MBEGlyphCachePlot *victim = self.plots[victimIndex];
+    [self.entries removeObjectsForKeys:victim.glyphs];
+    [victim.glyphs removeAllObjects];
+    MBERectanglePackerReset(victim.packer);
+
+    // Zero the plot, so the fields of evicted glyphs can't show through the padding of new ones
+    const NSInteger bytesPerTexel = [self bytesPerTexel];
+    const NSInteger bytesPerRow = self.textureSize * bytesPerTexel;
+    uint8_t *texture = self.mutableTextureData.mutableBytes;
+    for (NSInteger y = CGRectGetMinY(victim.rect); y < CGRectGetMaxY(victim.rect); ++y)
+    {
+        memset(texture + y * bytesPerRow + (NSInteger)CGRectGetMinX(victim.rect) * bytesPerTexel, 0,
+               self.plotSize * bytesPerTexel);
+    }
+    victim.dirtyRect = victim.rect;
+
+    return victimIndex;
+}
+
+/// Finds room for a cell in a plot, evicting a plot if none has any, and returns the plot's index, or
+/// NSNotFound if the cache is full of glyphs used this frame
+- (NSInteger)placeCell:(MBEPackedRectangle *)cell
+{
+    for (NSInteger i = 0; i < self.plots.count; ++i)
+    {
+        MBEGlyphCachePlot *plot = self.plots[i];
+        if (MBERectanglePackerInsert(plot.packer, cell))
+        {
+            return i;
+        }
+    }
+
+    NSInteger plotIndex = [self evictLeastRecentlyUsedPlot];
+    if (plotIndex != NSNotFound)
+    {
+        MBEGlyphCachePlot *plot = self.plots[plotIndex];
+        MBERectanglePackerInsert(plot.packer, cell);
+    }
+
+    return plotIndex;
+}
+
+/// The transform that places a glyph's path in the texture, flipped so that y increases downward, with
+/// the top left of its bounds at the padding of its cell
+- (CGAffineTransform)transformForPendingGlyph:(const MBEPendingGlyph *)pending padding:(CGFloat)padding
+{
+    MBEGlyphCachePlot *plot = self.plots[pending->plotIndex];
+    CGFloat glyphOriginX = CGRectGetMinX(plot.rect) + pending->cell.x + padding - pending->boundingRect.origin.x;
+    CGFloat glyphOriginY = CGRectGetMinY(plot.rect) + pending->cell.y + padding + CGRectGetMaxY(pending->boundingRect);
+    return CGAffineTransformMake(1, 0, 0, -1, glyphOriginX, glyphOriginY);
+}
+
+- (void)generateSingleChannelFieldsOfPendingGlyphs:(const MBEPendingGlyph *)pendingGlyphs
+                                             count:(NSInteger)count
+                                           padding:(CGFloat)padding
+{
+    const NSInteger scale = MBEGlyphCacheRasterScale;
+    uint8_t *texture = self.mutableTextureData.mutableBytes;
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceGray();
+    CGBitmapInfo bitmapInfo = (kCGBitmapAlphaInfoMask & kCGImageAlphaNone);
+
+    for (NSInteger i = 0; i < count; ++i)
+    {
+        const MBEPendingGlyph *pending = &pendingGlyphs[i];
+        MBEGlyphCachePlot *plot = self.plots[pending->plotIndex];
+        const NSInteger x = CGRectGetMinX(plot.rect) + pending->cell.x;
+        const NSInteger y = CGRectGetMinY(plot.rect) + pending->cell.y;
+        const NSInteger width = pending->cell.width * scale;
+        const NSInteger height = pending->cell.height * scale;
+
+        // Rasterize the glyph into its cell alone, at a multiple of the field's resolution
+        uint8_t *raster = calloc(width * height, 1);
+        CGContextRef context = CGBitmapContextCreate(raster, width, height, 8, width, colorSpace, bitmapInfo);
+        CGContextSetAllowsAntialiasing(context, false);
+        CGContextTranslateCTM(context, 0, height);
+        CGContextScaleCTM(context, 1, -1);
+        CGContextSetRGBFillColor(context, 1, 1, 1, 1);
+
+        CGAffineTransform cellTransform = [self transformForPendingGlyph:pending padding:padding];
+        cellTransform = CGAffineTransformConcat(cellTransform, CGAffineTransformMakeTranslation(-x, -y));
+        cellTransform = CGAffineTransformConcat(cellTransform, CGAffineTransformMakeScale(scale, scale));
+        CGPathRef path = CTFontCreatePathForGlyph(self.ctFont, pending->glyph, &cellTransform);
+        if (path)
+        {
+            CGContextAddPath(context, path);
+            CGContextFillPath(context);
+        }
+        CGPathRelease(path);
+        CGContextRelease(context);
+
+        MBEQuantizedSignedDistanceField(raster, width, height, width, scale, self.spread * scale,
+                                        texture + y * self.textureSize + x, self.textureSize);
+        free(raster);
+    }
+
+    CGColorSpaceRelease(colorSpace);
+}
+
+- (void)generateMultiChannelFieldsOfPendingGlyphs:(const MBEPendingGlyph *)pendingGlyphs
+                                            count:(NSInteger)count
+                                          padding:(CGFloat)padding
+{
+    // The generator reads the outlines straight out of these, so they must outlive it
+    NS_VALID_UNTIL_END_OF_SCOPE NSMutableArray *outlineData = [NSMutableArray array];
+    MBEMSDFGlyph *glyphs = malloc(count * sizeof(MBEMSDFGlyph));
+
+    for (NSInteger i = 0; i < count; ++i)
+    {
+        const MBEPendingGlyph *pending = &pendingGlyphs[i];
+        MBEGlyphCachePlot *plot = self.plots[pending->plotIndex];
+
+        CGAffineTransform glyphTransform = [self transformForPendingGlyph:pending padding:padding];
+        CGPathRef path = CTFontCreatePathForGlyph(self.ctFont, pending->glyph, &glyphTransform);
+
+        NSMutableData *verbs = [NSMutableData data];
+        NSMutableData *points = [NSMutableData data];
+        MBEAppendOutlineOfPath(path, verbs, points);
+        CGPathRelease(path);
+        [outlineData addObject:verbs];
+        [outlineData addObject:points];
+
+        glyphs[i].verbs = verbs.bytes;
+        glyphs[i].verbCount = verbs.length;
+        glyphs[i].points = points.bytes;
+        glyphs[i].pointCount = points.length / (2 * sizeof(float));
+        glyphs[i].x = CGRectGetMinX(plot.rect) + pending->cell.x;
+        glyphs[i].y = CGRectGetMinY(plot.rect) + pending->cell.y;
+        glyphs[i].width = pending->cell.width;
+        glyphs[i].height = pending->cell.height;
+    }
+
+    // Glyphs that miss together are generated together, in parallel
+    MBEGenerateMSDF(glyphs, count, self.spread, self.mutableTextureData.mutableBytes, self.textureSize * 4);
+    free(glyphs);
+}
+
+- (MBEGlyphDescriptor *)makeDescriptorForGlyph:(CGGlyph)glyph withTransform:(CGAffineTransform)transform
+{
+    CGPathRef path = CTFontCreatePathForGlyph(self.ctFont, glyph, &transform);
+    CGRect glyphPathBoundingRect = path ? CGPathGetPathBoundingBox(path) : CGRectNull;
+    CGPathRelease(path);
+
+    // The null rect (i.e., the bounding rect of an empty path) is problematic
+    // because it has its origin at (+inf, +inf); we fix that up here
+    if (CGRectEqualToRect(glyphPathBoundingRect, CGRectNull))
+    {
+        glyphPathBoundingRect = CGRectZero;
+    }
+
+    const CGFloat size = self.textureSize;
+    CGFloat texCoordLeft = glyphPathBoundingRect.origin.x / size;
+    CGFloat texCoordRight = (glyphPathBoundingRect.origin.x + glyphPathBoundingRect.size.width) / size;
+    CGFloat texCoordTop = (glyphPathBoundingRect.origin.y) / size;
+    CGFloat texCoordBottom = (glyphPathBoundingRect.origin.y + glyphPathBoundingRect.size.height) / size;
+
+    MBEGlyphDescriptor *descriptor = [MBEGlyphDescriptor new];
+    descriptor.glyphIndex = glyph;
+    descriptor.topLeftTexCoord = CGPointMake(texCoordLeft, texCoordTop);
+    descriptor.bottomRightTexCoord = CGPointMake(texCoordRight, texCoordBottom);
+    return descriptor;
+}
+
+- (void)prepareGlyphs:(const CGGlyph *)glyphs count:(NSUInteger)count
+{
+    // Mark the plots of cached glyphs as used, so that they're safe from eviction, and collect the
+    // distinct glyphs that miss
+    NSMutableIndexSet *missingGlyphs = [NSMutableIndexSet indexSet];
+    for (NSUInteger i = 0; i < count; ++i)
+    {
+        MBEGlyphCacheEntry *entry = self.entries[@(glyphs[i])];
+        if (entry)
+        {
+            entry.plot.lastUsedFrame = self.frame;
+        }
+        else
+        {
+            [missingGlyphs addIndex:glyphs[i]];
+        }
+    }
+
+    if (missingGlyphs.count == 0)
+    {
+        return;
+    }
+
+    const NSInteger missingCount = missingGlyphs.count;
+    CGGlyph *missing = malloc(missingCount * sizeof(CGGlyph));
+    CGRect *boundingRects = malloc(missingCount * sizeof(CGRect));
+    __block NSInteger missingIndex = 0;
+    [missingGlyphs enumerateIndexesUsingBlock:^(NSUInteger glyph, BOOL *stop) {
+        missing[missingIndex++] = glyph;
+    }];
+    CTFontGetBoundingRectsForGlyphs(self.ctFont, kCTFontOrientationHorizontal, missing, boundingRects, missingCount);
+
+    // Each glyph's cell holds its bounds with enough padding around them to take in every texel within
+    // the spread of its outline, and one more, so that the fields of neighboring glyphs don't overlap
+    const CGFloat padding = ceil(self.spread) + 1;
+    MBEPendingGlyph *pendingGlyphs = malloc(missingCount * sizeof(MBEPendingGlyph));
+    NSInteger pendingCount = 0;
+    for (NSInteger i = 0; i < missingCount; ++i)
+    {
+        if (CGRectIsEmpty(boundingRects[i]))
+        {
+            // Glyphs with nothing to draw, like spaces, take up no room in the texture
+            MBEGlyphCacheEntry *entry = [MBEGlyphCacheEntry new];
+            entry.descriptor = [MBEGlyphDescriptor new];
+            entry.descriptor.glyphIndex = missing[i];
+            self.entries[@(missing[i])] = entry;
+            continue;
+        }
+
+        MBEPendingGlyph *pending = &pendingGlyphs[pendingCount++];
+        pending->glyph = missing[i];
+        pending->boundingRect = boundingRects[i];
+        pending->cell.width = ceil(CGRectGetWidth(boundingRects[i])) + 2 * padding;
+        pending->cell.height = ceil(CGRectGetHeight(boundingRects[i])) + 2 * padding;
+    }
+
+    // Placing the tallest glyphs first leaves less room under the skyline of each plot
+    qsort(pendingGlyphs, pendingCount, sizeof(MBEPendingGlyph), MBEComparePendingGlyphHeights);
+
+    NSInteger placedCount = 0;
+    for (NSInteger i = 0; i < pendingCount; ++i)
+    {
+        MBEPendingGlyph pending = pendingGlyphs[i];
+
+        if (pending.cell.width > self.plotSize || pending.cell.height > self.plotSize)
+        {
+            NSLog(@"Glyph #%d of font %@ is too large for a glyph cache plot; Skipping...",
+                  pending.glyph, self.parentFont.fontName);
+            continue;
+        }
+
+        pending.plotIndex = [self placeCell:&pending.cell];
+        if (pending.plotIndex == NSNotFound)
+        {
+            NSLog(@"Glyph cache is full of glyphs used this frame; Skipping glyph #%d...", pending.glyph);
+            continue;
+        }
+
+        MBEGlyphCachePlot *plot = self.plots[pending.plotIndex];
+        plot.lastUsedFrame = self.frame;
+        pendingGlyphs[placedCount++] = pending;
+    }
+
+    if (self.fieldType == MBEFontAtlasFieldTypeMultiChannel)
+    {
+        [self generateMultiChannelFieldsOfPendingGlyphs:pendingGlyphs count:placedCount padding:padding];
+    }
+    else
+    {
+        [self generateSingleChannelFieldsOfPendingGlyphs:pendingGlyphs count:placedCount padding:padding];
+    }
+
+    for (NSInteger i = 0; i < placedCount; ++i)
+    {
+        const MBEPendingGlyph *pending = &pendingGlyphs[i];
+        MBEGlyphCachePlot *plot = self.plots[pending->plotIndex];
+
+        MBEGlyphCacheEntry *entry = [MBEGlyphCacheEntry new];
+        entry.descriptor = [self makeDescriptorForGlyph:pending->glyph
+                                          withTransform:[self transformForPendingGlyph:pending padding:padding]];
+        entry.plot = plot;
+        self.entries[@(pending->glyph)] = entry;
+        [plot.glyphs addObject:@(pending->glyph)];
+
+        CGRect cellRect = CGRectMake(CGRectGetMinX(plot.rect) + pending->cell.x,
+                                     CGRectGetMinY(plot.rect) + pending->cell.y,
+                                     pending->cell.width,
+                                     pending->cell.height);
+        plot.dirtyRect = CGRectUnion(plot.dirtyRect, cellRect);
+    }
+
+    free(pendingGlyphs);
+    free(boundingRects);
+    free(missing);
+}
+
+@end
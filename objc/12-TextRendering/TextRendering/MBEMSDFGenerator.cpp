@@ -0,0 +1,1161 @@
+#include "MBEMSDFGenerator.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    struct Vector2
+    {
+        double x, y;
+    };
+
+    Vector2 operator+(Vector2 a, Vector2 b) { Vector2 result = { a.x + b.x, a.y + b.y }; return result; }
+    Vector2 operator-(Vector2 a, Vector2 b) { Vector2 result = { a.x - b.x, a.y - b.y }; return result; }
+    Vector2 operator*(double s, Vector2 a) { Vector2 result = { s * a.x, s * a.y }; return result; }
+    bool operator==(Vector2 a, Vector2 b) { return a.x == b.x && a.y == b.y; }
+
+    double Dot(Vector2 a, Vector2 b) { return a.x * b.x + a.y * b.y; }
+    double Cross(Vector2 a, Vector2 b) { return a.x * b.y - a.y * b.x; }
+    double Length(Vector2 a) { return std::sqrt(Dot(a, a)); }
+    Vector2 Mix(Vector2 a, Vector2 b, double t) { return a + t * (b - a); }
+
+    Vector2 Normalize(Vector2 a)
+    {
+        const double length = Length(a);
+        if (length == 0)
+        {
+            Vector2 zero = { 0, 0 };
+            return zero;
+        }
+        return (1 / length) * a;
+    }
+
+    double NonZeroSign(double value)
+    {
+        return (value > 0) ? 1 : -1;
+    }
+
+    float Median(float a, float b, float c)
+    {
+        return std::max(std::min(a, b), std::min(std::max(a, b), c));
+    }
+
+    /// The channels an edge contributes to, as a bit mask of red, green and blue
+    enum EdgeColor
+    {
+        EdgeColorBlack = 0,
+        EdgeColorRed = 1,
+        EdgeColorGreen = 2,
+        EdgeColorYellow = 3,
+        EdgeColorBlue = 4,
+        EdgeColorMagenta = 5,
+        EdgeColorCyan = 6,
+        EdgeColorWhite = 7,
+    };
+
+    // Where the directions of adjacent edges differ by more than this many radians, they meet at a corner
+    const double CornerAngleThreshold = 3;
+
+    // Curves are flattened for the winding number test finely enough that no point of the polyline is
+    // farther than this many texels from the curve
+    const double FlatteningTolerance = 0.05;
+    const int MaximumFlatteningSteps = 64;
+
+    // Texels whose distance is smaller than this many texels are too close to the outline for the winding
+    // number test, which works on the flattened outline, to overrule the sign of their distance
+    const double SignCorrectionDistance = 0.5;
+
+    // Neighboring texels whose channels differ by more than this many texels' worth of distance interpolate
+    // to a false edge between them
+    const double ClashThreshold = 1.001;
+
+    // Interpolated medians that land on the wrong side of the outline by less than this many texels are
+    // left alone, since interpolating the true distance rounds off corners that the field keeps sharp
+    const double ArtifactTolerance = 0.25;
+
+    /// The distance from a point to an edge, with the absolute cosine of the angle between the edge's
+    /// tangent and the direction to the point, for breaking ties between edges that share an endpoint
+    struct SignedDistance
+    {
+        double distance;
+        double dot;
+    };
+
+    bool operator<(const SignedDistance &a, const SignedDistance &b)
+    {
+        const double aDistance = std::fabs(a.distance), bDistance = std::fabs(b.distance);
+        return aDistance < bDistance || (aDistance == bDistance && a.dot < b.dot);
+    }
+
+    int SolveQuadratic(double roots[2], double a, double b, double c)
+    {
+        if (a == 0 || std::fabs(b) > 1e12 * std::fabs(a))
+        {
+            if (b == 0)
+            {
+                return 0;
+            }
+            roots[0] = -c / b;
+            return 1;
+        }
+
+        double discriminant = b * b - 4 * a * c;
+        if (discriminant > 0)
+        {
+            discriminant = std::sqrt(discriminant);
+            roots[0] = (-b + discriminant) / (2 * a);
+            roots[1] = (-b - discriminant) / (2 * a);
+            return 2;
+        }
+        else if (discriminant == 0)
+        {
+            roots[0] = -b / (2 * a);
+            return 1;
+        }
+        return 0;
+    }
+
+    /// Solves x^3 + a x^2 + b x + c = 0 with Cardano's method
+    int SolveNormalizedCubic(double roots[3], double a, double b, double c)
+    {
+        const double a2 = a * a;
+        double q = (a2 - 3 * b) / 9;
+        const double r = (a * (2 * a2 - 9 * b) + 27 * c) / 54;
+        const double r2 = r * r;
+        const double q3 = q * q * q;
+        a /= 3;
+        if (r2 < q3)
+        {
+            const double t = std::acos(std::max(-1.0, std::min(1.0, r / std::sqrt(q3))));
+            q = -2 * std::sqrt(q);
+            roots[0] = q * std::cos(t / 3) - a;
+            roots[1] = q * std::cos((t + 2 * M_PI) / 3) - a;
+            roots[2] = q * std::cos((t - 2 * M_PI) / 3) - a;
+            return 3;
+        }
+
+        const double u = ((r < 0) ? 1 : -1) * std::pow(std::fabs(r) + std::sqrt(r2 - q3), 1.0 / 3);
+        const double v = (u == 0) ? 0 : q / u;
+        roots[0] = (u + v) - a;
+        if (u == v || std::fabs(u - v) < 1e-12 * std::fabs(u + v))
+        {
+            roots[1] = -0.5 * (u + v) - a;
+            return 2;
+        }
+        return 1;
+    }
+
+    int SolveCubic(double roots[3], double a, double b, double c, double d)
+    {
+        if (a != 0)
+        {
+            const double normalizedB = b / a;
+            // Past this ratio the cubic term is lost in rounding, and the equation is better treated as a quadratic
+            if (std::fabs(normalizedB) < 1e6)
+            {
+                return SolveNormalizedCubic(roots, normalizedB, c / a, d / a);
+            }
+        }
+        return SolveQuadratic(roots, b, c, d);
+    }
+
+    /// A line or a quadratic or cubic Bézier curve of an outline
+    struct Segment
+    {
+        int degree;
+        Vector2 p[4];
+        EdgeColor color;
+
+        Vector2 point(double t) const
+        {
+            Vector2 levels[4];
+            std::copy(p, p + degree + 1, levels);
+            for (int level = 1; level <= degree; ++level)
+            {
+                for (int i = 0; i <= degree - level; ++i)
+                {
+                    levels[i] = Mix(levels[i], levels[i + 1], t);
+                }
+            }
+            return levels[0];
+        }
+
+        /// The direction of the tangent at `t`, which isn't normalized. Where a control point coincides with
+        /// an endpoint, the tangent there is taken from the next control point along.
+        Vector2 direction(double t) const
+        {
+            if (degree == 1)
+            {
+                return p[1] - p[0];
+            }
+            if (degree == 2)
+            {
+                const Vector2 tangent = Mix(p[1] - p[0], p[2] - p[1], t);
+                return (tangent.x == 0 && tangent.y == 0) ? p[2] - p[0] : tangent;
+            }
+
+            const Vector2 tangent = Mix(Mix(p[1] - p[0], p[2] - p[1], t), Mix(p[2] - p[1], p[3] - p[2], t), t);
+            if (tangent.x == 0 && tangent.y == 0)
+            {
+                if (t == 0)
+                {
+                    return p[2] - p[0];
+                }
+                if (t == 1)
+                {
+                    return p[3] - p[1];
+                }
+            }
+            return tangent;
+        }
+
+        /// Splits the segment at `t` with de Casteljau's algorithm
+        void split(double t, Segment &first, Segment &second) const
+        {
+            Vector2 levels[4];
+            std::copy(p, p + degree + 1, levels);
+            first = second = *this;
+            for (int level = 1; level <= degree; ++level)
+            {
+                for (int i = 0; i <= degree - level; ++i)
+                {
+                    levels[i] = Mix(levels[i], levels[i + 1], t);
+                }
+                first.p[level] = levels[0];
+                second.p[degree - level] = levels[degree - level];
+            }
+        }
+
+        /// The squared distance from `origin` to the bounding box of the control points, which is never
+        /// more than the squared distance to the segment itself
+        double boundsDistanceSquared(Vector2 origin) const
+        {
+            double minX = p[0].x, maxX = p[0].x, minY = p[0].y, maxY = p[0].y;
+            for (int i = 1; i <= degree; ++i)
+            {
+                minX = std::min(minX, p[i].x);
+                maxX = std::max(maxX, p[i].x);
+                minY = std::min(minY, p[i].y);
+                maxY = std::max(maxY, p[i].y);
+            }
+            const double dx = std::max(0.0, std::max(minX - origin.x, origin.x - maxX));
+            const double dy = std::max(0.0, std::max(minY - origin.y, origin.y - maxY));
+            return dx * dx + dy * dy;
+        }
+
+        /// The signed distance from `origin` to the nearest point of the segment, which is positive when
+        /// the origin is to the right of the segment's direction, and the parameter of that point, which
+        /// lies outside [0, 1] when the origin is past one of the ends
+        SignedDistance signedDistance(Vector2 origin, double &param) const
+        {
+            if (degree == 1)
+            {
+                return lineSignedDistance(origin, param);
+            }
+            if (degree == 2)
+            {
+                return quadraticSignedDistance(origin, param);
+            }
+            return cubicSignedDistance(origin, param);
+        }
+
+        /// Replaces `distance` with the distance to the line that extends the segment along its tangent
+        /// past the end nearest `origin`, when that's nearer. The extended edges of the channels are what
+        /// keep corners sharp.
+        void convertToPseudoDistance(SignedDistance &distance, Vector2 origin, double param) const
+        {
+            if (param < 0)
+            {
+                const Vector2 tangent = Normalize(direction(0));
+                const Vector2 offset = origin - p[0];
+                if (Dot(offset, tangent) < 0)
+                {
+                    const double pseudoDistance = Cross(offset, tangent);
+                    if (std::fabs(pseudoDistance) <= std::fabs(distance.distance))
+                    {
+                        distance.distance = pseudoDistance;
+                        distance.dot = 0;
+                    }
+                }
+            }
+            else if (param > 1)
+            {
+                const Vector2 tangent = Normalize(direction(1));
+                const Vector2 offset = origin - p[degree];
+                if (Dot(offset, tangent) > 0)
+                {
+                    const double pseudoDistance = Cross(offset, tangent);
+                    if (std::fabs(pseudoDistance) <= std::fabs(distance.distance))
+                    {
+                        distance.distance = pseudoDistance;
+                        distance.dot = 0;
+                    }
+                }
+            }
+        }
+
+    private:
+        SignedDistance lineSignedDistance(Vector2 origin, double &param) const
+        {
+            const Vector2 aq = origin - p[0];
+            const Vector2 ab = p[1] - p[0];
+            param = Dot(aq, ab) / Dot(ab, ab);
+            const Vector2 eq = ((param > 0.5) ? p[1] : p[0]) - origin;
+            const double endpointDistance = Length(eq);
+            if (param > 0 && param < 1)
+            {
+                const double orthogonalDistance = Cross(aq, ab) / Length(ab);
+                if (std::fabs(orthogonalDistance) < endpointDistance)
+                {
+                    SignedDistance result = { orthogonalDistance, 0 };
+                    return result;
+                }
+            }
+            SignedDistance result = { NonZeroSign(Cross(aq, ab)) * endpointDistance,
+                                      std::fabs(Dot(Normalize(ab), Normalize(eq))) };
+            return result;
+        }
+
+        /// Finds the nearest point by solving for where the offset to the curve is perpendicular to its
+        /// tangent, which for a quadratic curve is a cubic equation in t
+        SignedDistance quadraticSignedDistance(Vector2 origin, double &param) const
+        {
+            const Vector2 qa = p[0] - origin;
+            const Vector2 ab = p[1] - p[0];
+            const Vector2 br = p[2] - p[1] - ab;
+            double roots[3];
+            const int rootCount = SolveCubic(roots, Dot(br, br), 3 * Dot(ab, br), 2 * Dot(ab, ab) + Dot(qa, br), Dot(qa, ab));
+
+            Vector2 endTangent = direction(0);
+            double minimumDistance = NonZeroSign(Cross(endTangent, qa)) * Length(qa);
+            param = -Dot(qa, endTangent) / Dot(endTangent, endTangent);
+
+            endTangent = direction(1);
+            const double endDistance = Length(p[2] - origin);
+            if (endDistance < std::fabs(minimumDistance))
+            {
+                minimumDistance = NonZeroSign(Cross(endTangent, p[2] - origin)) * endDistance;
+                param = Dot(origin - p[1], endTangent) / Dot(endTangent, endTangent);
+            }
+
+            for (int i = 0; i < rootCount; ++i)
+            {
+                const double t = roots[i];
+                if (t > 0 && t < 1)
+                {
+                    const Vector2 qe = qa + 2 * t * ab + t * t * br;
+                    const double distance = Length(qe);
+                    if (distance <= std::fabs(minimumDistance))
+                    {
+                        minimumDistance = NonZeroSign(Cross(ab + t * br, qe)) * distance;
+                        param = t;
+                    }
+                }
+            }
+
+            return distanceWithEndpointDot(origin, minimumDistance, param);
+        }
+
+        /// Finds the nearest point with a few steps of Newton's method from evenly spaced starting points,
+        /// since the exact solution for a cubic curve is a quintic equation
+        SignedDistance cubicSignedDistance(Vector2 origin, double &param) const
+        {
+            const int SearchStarts = 4;
+            const int SearchSteps = 4;
+
+            const Vector2 qa = p[0] - origin;
+            const Vector2 ab = p[1] - p[0];
+            const Vector2 br = p[2] - p[1] - ab;
+            const Vector2 as = (p[3] - p[2]) - (p[2] - p[1]) - br;
+
+            Vector2 endTangent = direction(0);
+            double minimumDistance = NonZeroSign(Cross(endTangent, qa)) * Length(qa);
+            param = -Dot(qa, endTangent) / Dot(endTangent, endTangent);
+
+            endTangent = direction(1);
+            const double endDistance = Length(p[3] - origin);
+            if (endDistance < std::fabs(minimumDistance))
+            {
+                minimumDistance = NonZeroSign(Cross(endTangent, p[3] - origin)) * endDistance;
+                param = Dot(endTangent - (p[3] - origin), endTangent) / Dot(endTangent, endTangent);
+            }
+
+            for (int start = 0; start <= SearchStarts; ++start)
+            {
+                double t = (double)start / SearchStarts;
+                Vector2 qe = qa + 3 * t * ab + 3 * t * t * br + t * t * t * as;
+                for (int step = 0; step < SearchSteps; ++step)
+                {
+                    const Vector2 d1 = 3 * ab + 6 * t * br + 3 * t * t * as;
+                    const Vector2 d2 = 6 * br + 6 * t * as;
+                    t -= Dot(qe, d1) / (Dot(d1, d1) + Dot(qe, d2));
+                    if (!(t > 0 && t < 1))
+                    {
+                        break;
+                    }
+                    qe = qa + 3 * t * ab + 3 * t * t * br + t * t * t * as;
+                    const double distance = Length(qe);
+                    if (distance < std::fabs(minimumDistance))
+                    {
+                        minimumDistance = NonZeroSign(Cross(direction(t), qe)) * distance;
+                        param = t;
+                    }
+                }
+            }
+
+            return distanceWithEndpointDot(origin, minimumDistance, param);
+        }
+
+        SignedDistance distanceWithEndpointDot(Vector2 origin, double distance, double param) const
+        {
+            SignedDistance result = { distance, 0 };
+            if (param < 0)
+            {
+                result.dot = std::fabs(Dot(Normalize(direction(0)), Normalize(p[0] - origin)));
+            }
+            else if (param > 1)
+            {
+                result.dot = std::fabs(Dot(Normalize(direction(1)), Normalize(p[degree] - origin)));
+            }
+            return result;
+        }
+    };
+
+    typedef std::vector<Segment> Contour;
+
+    /// Reads the glyph's outline into closed contours, dropping segments that have collapsed to a point
+    void ParseOutline(const MBEMSDFGlyph &glyph, std::vector<Contour> &contours)
+    {
+        static const size_t PointsPerVerb[] = { 1, 1, 2, 3, 0 };
+
+        Vector2 start = { 0, 0 };
+        Vector2 current = start;
+        size_t pointIndex = 0;
+        bool isOpen = false;
+
+        auto closeContour = [&]() {
+            if (isOpen && !(current == start))
+            {
+                Segment line = { 1, { current, start }, EdgeColorWhite };
+                contours.back().push_back(line);
+            }
+            if (isOpen && contours.back().empty())
+            {
+                contours.pop_back();
+            }
+            current = start;
+            isOpen = false;
+        };
+
+        for (size_t i = 0; i < glyph.verbCount; ++i)
+        {
+            const uint8_t verb = glyph.verbs[i];
+            if (verb > MBEOutlineVerbClose || pointIndex + PointsPerVerb[verb] > glyph.pointCount)
+            {
+                break;
+            }
+
+            Segment segment = { (int)PointsPerVerb[verb], { current }, EdgeColorWhite };
+            for (size_t j = 0; j < PointsPerVerb[verb]; ++j, ++pointIndex)
+            {
+                Vector2 point = { glyph.points[2 * pointIndex], glyph.points[2 * pointIndex + 1] };
+                segment.p[j + 1] = point;
+            }
+
+            if (verb == MBEOutlineVerbMoveTo)
+            {
+                closeContour();
+                start = current = segment.p[1];
+                contours.push_back(Contour());
+                isOpen = true;
+            }
+            else if (verb == MBEOutlineVerbClose)
+            {
+                closeContour();
+            }
+            else
+            {
+                if (!isOpen)
+                {
+                    contours.push_back(Contour());
+                    isOpen = true;
+                }
+                bool isDegenerate = true;
+                for (int j = 1; j <= segment.degree; ++j)
+                {
+                    isDegenerate = isDegenerate && segment.p[j] == segment.p[0];
+                }
+                if (!isDegenerate)
+                {
+                    contours.back().push_back(segment);
+                }
+                current = segment.p[segment.degree];
+            }
+        }
+        closeContour();
+    }
+
+    /// Moves to the next color in a sequence determined by `seed`, avoiding `banned` where the color shares
+    /// only one channel with it
+    void SwitchColor(EdgeColor &color, uint64_t &seed, EdgeColor banned = EdgeColorBlack)
+    {
+        const EdgeColor combined = (EdgeColor)(color & banned);
+        if (combined == EdgeColorRed || combined == EdgeColorGreen || combined == EdgeColorBlue)
+        {
+            color = (EdgeColor)(combined ^ EdgeColorWhite);
+            return;
+        }
+        if (color == EdgeColorBlack || color == EdgeColorWhite)
+        {
+            static const EdgeColor starts[3] = { EdgeColorCyan, EdgeColorMagenta, EdgeColorYellow };
+            color = starts[seed % 3];
+            seed /= 3;
+            return;
+        }
+        const int shifted = color << (1 + (seed & 1));
+        color = (EdgeColor)((shifted | shifted >> 3) & EdgeColorWhite);
+        seed >>= 1;
+    }
+
+    bool IsCorner(Vector2 incoming, Vector2 outgoing, double crossThreshold)
+    {
+        return Dot(incoming, outgoing) <= 0 || std::fabs(Cross(incoming, outgoing)) > crossThreshold;
+    }
+
+    /// Colors the edges of each contour so that the two edges at every corner have exactly one channel in
+    /// common, following Chlumsky's simple edge coloring. Smooth contours are white. A contour with a single
+    /// corner, like a teardrop, is split into three runs of colors, which means splitting its edges when it
+    /// has fewer than three.
+    void ColorEdges(std::vector<Contour> &contours)
+    {
+        const double crossThreshold = std::sin(CornerAngleThreshold);
+        uint64_t seed = 0;
+
+        for (Contour &contour : contours)
+        {
+            std::vector<size_t> corners;
+            Vector2 incoming = Normalize(contour.back().direction(1));
+            for (size_t i = 0; i < contour.size(); ++i)
+            {
+                const Vector2 outgoing = Normalize(contour[i].direction(0));
+                if (IsCorner(incoming, outgoing, crossThreshold))
+                {
+                    corners.push_back(i);
+                }
+                incoming = Normalize(contour[i].direction(1));
+            }
+
+            const size_t edgeCount = contour.size();
+            if (corners.empty())
+            {
+                for (Segment &segment : contour)
+                {
+                    segment.color = EdgeColorWhite;
+                }
+            }
+            else if (corners.size() == 1)
+            {
+                EdgeColor colors[3] = { EdgeColorWhite, EdgeColorWhite, EdgeColorWhite };
+                SwitchColor(colors[0], seed);
+                colors[2] = colors[0];
+                SwitchColor(colors[2], seed);
+
+                const size_t corner = corners[0];
+                if (edgeCount >= 3)
+                {
+                    for (size_t i = 0; i < edgeCount; ++i)
+                    {
+                        const int run = (int)(3 + 2.875 * i / (edgeCount - 1) - 1.4375 + 0.5) - 3;
+                        contour[(corner + i) % edgeCount].color = colors[run + 1];
+                    }
+                }
+                else
+                {
+                    // Split each edge in thirds, starting from the corner, and spread the colors over the parts
+                    Contour parts;
+                    for (size_t i = 0; i < edgeCount; ++i)
+                    {
+                        Segment first, rest, second, third;
+                        contour[(corner + i) % edgeCount].split(1.0 / 3, first, rest);
+                        rest.split(0.5, second, third);
+                        parts.push_back(first);
+                        parts.push_back(second);
+                        parts.push_back(third);
+                    }
+                    for (size_t i = 0; i < parts.size(); ++i)
+                    {
+                        parts[i].color = colors[i * 3 / parts.size()];
+                    }
+                    contour.swap(parts);
+                }
+            }
+            else
+            {
+                EdgeColor color = EdgeColorWhite;
+                SwitchColor(color, seed);
+                const EdgeColor initialColor = color;
+                size_t spline = 0;
+                for (size_t i = 0; i < edgeCount; ++i)
+                {
+                    const size_t index = (corners[0] + i) % edgeCount;
+                    if (spline + 1 < corners.size() && corners[spline + 1] == index)
+                    {
+                        ++spline;
+                        // The last run mustn't share just one channel with the first, which it meets at the first corner
+                        SwitchColor(color, seed, (spline == corners.size() - 1) ? initialColor : EdgeColorBlack);
+                    }
+                    contour[index].color = color;
+                }
+            }
+        }
+    }
+
+    /// A line of the flattened outline
+    struct Line
+    {
+        Vector2 a, b;
+    };
+
+    void FlattenContour(const Contour &contour, std::vector<Line> &lines)
+    {
+        for (const Segment &segment : contour)
+        {
+            int steps = 1;
+            if (segment.degree > 1)
+            {
+                // The polyline strays from the curve by at most 1/8 of the curve's largest second
+                // derivative over the square of the number of steps
+                double secondDifference = Length(segment.p[0] - 2 * segment.p[1] + segment.p[2]);
+                if (segment.degree == 3)
+                {
+                    secondDifference = std::max(secondDifference, Length(segment.p[1] - 2 * segment.p[2] + segment.p[3]));
+                }
+                const double secondDerivative = segment.degree * (segment.degree - 1) * secondDifference;
+                steps = (int)std::ceil(std::sqrt(secondDerivative / (8 * FlatteningTolerance)));
+                steps = std::max(1, std::min(MaximumFlatteningSteps, steps));
+            }
+
+            Vector2 previous = segment.p[0];
+            for (int i = 1; i <= steps; ++i)
+            {
+                const Vector2 next = (i == steps) ? segment.p[segment.degree] : segment.point((double)i / steps);
+                Line line = { previous, next };
+                lines.push_back(line);
+                previous = next;
+            }
+        }
+    }
+
+    struct Crossing
+    {
+        double x;
+        int winding;
+
+        bool operator<(const Crossing &other) const { return x < other.x; }
+    };
+
+    /// Marks the texels of one row whose centers have a non-zero winding number
+    void FillRow(const std::vector<Line> &lines, double y, double firstCenter, size_t width,
+                 std::vector<Crossing> &crossings, uint8_t *isInside)
+    {
+        crossings.clear();
+        for (const Line &line : lines)
+        {
+            if ((line.a.y <= y) != (line.b.y <= y))
+            {
+                Crossing crossing = { line.a.x + (y - line.a.y) * (line.b.x - line.a.x) / (line.b.y - line.a.y),
+                                      (line.b.y > line.a.y) ? 1 : -1 };
+                crossings.push_back(crossing);
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+
+        int winding = 0;
+        size_t next = 0;
+        for (size_t x = 0; x < width; ++x)
+        {
+            const double center = firstCenter + x;
+            while (next < crossings.size() && crossings[next].x < center)
+            {
+                winding += crossings[next++].winding;
+            }
+            isInside[x] = (winding != 0);
+        }
+    }
+
+    /// Whether texel `a` differs so much from its neighbor `b` in two channels that interpolating between
+    /// them would cross the edge where it isn't. Only the texel of the pair farther from the edge is
+    /// reported, so that the correction touches as little as possible.
+    bool Clashes(const float *a, const float *b, float threshold)
+    {
+        float a0 = a[0], a1 = a[1], a2 = a[2];
+        float b0 = b[0], b1 = b[1], b2 = b[2];
+        // Sort the channels from the largest difference to the smallest
+        if (std::fabs(b0 - a0) < std::fabs(b1 - a1))
+        {
+            std::swap(a0, a1);
+            std::swap(b0, b1);
+        }
+        if (std::fabs(b1 - a1) < std::fabs(b2 - a2))
+        {
+            std::swap(a1, a2);
+            std::swap(b1, b2);
+            if (std::fabs(b0 - a0) < std::fabs(b1 - a1))
+            {
+                std::swap(a0, a1);
+                std::swap(b0, b1);
+            }
+        }
+        return std::fabs(b1 - a1) >= threshold &&
+               !(b0 == b1 && b0 == b2) &&
+               std::fabs(a2 - 0.5f) >= std::fabs(b2 - 0.5f);
+    }
+
+    /// The area enclosed by a flattened contour, which is positive when the contour runs clockwise on
+    /// screen, so that its inside is on the negative side of its edges
+    double SignedArea(const std::vector<Line> &lines)
+    {
+        double area = 0;
+        for (const Line &line : lines)
+        {
+            area += Cross(line.a, line.b);
+        }
+        return 0.5 * area;
+    }
+
+    struct MultiDistance
+    {
+        double channels[3];
+
+        double median() const
+        {
+            return std::max(std::min(channels[0], channels[1]), std::min(std::max(channels[0], channels[1]), channels[2]));
+        }
+    };
+
+    /// The nearest edge of one color found so far
+    struct Channel
+    {
+        SignedDistance distance;
+        const Segment *edge;
+        double param;
+        /// The channel's distance when it has no edge within reach
+        double saturated;
+    };
+
+    /// The nearest edges of each color to a texel among some set of contours
+    struct EdgeSelection
+    {
+        Channel channels[3];
+
+        /// A selection of no edges, which is farther than any other
+        static EdgeSelection empty()
+        {
+            EdgeSelection selection;
+            for (Channel &channel : selection.channels)
+            {
+                channel.distance.distance = std::numeric_limits<double>::infinity();
+                channel.distance.dot = 0;
+                channel.edge = nullptr;
+                channel.param = 0;
+                channel.saturated = -std::numeric_limits<double>::max();
+            }
+            return selection;
+        }
+
+        void merge(const EdgeSelection &other)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                if (other.channels[c].distance < channels[c].distance)
+                {
+                    channels[c] = other.channels[c];
+                }
+            }
+        }
+
+        MultiDistance distance(Vector2 origin) const
+        {
+            MultiDistance result;
+            for (int c = 0; c < 3; ++c)
+            {
+                Channel channel = channels[c];
+                if (channel.edge)
+                {
+                    channel.edge->convertToPseudoDistance(channel.distance, origin, channel.param);
+                    result.channels[c] = channel.distance.distance;
+                }
+                else
+                {
+                    result.channels[c] = channel.saturated;
+                }
+            }
+            return result;
+        }
+    };
+
+    /// Combines the distances to each contour into the distance to the outline, so that edges of one
+    /// contour that lie inside another, where contours overlap, don't count as edges of the outline. A
+    /// winding of 1 means the contour's inside is on the positive side of its edges, and -1 the negative
+    /// side. This is the overlapping contour combiner of Chlumsky's msdfgen.
+    MultiDistance CombineContours(const std::vector<EdgeSelection> &selections, const std::vector<int> &windings,
+                                  Vector2 origin, std::vector<MultiDistance> &distances)
+    {
+        EdgeSelection shape = EdgeSelection::empty(), inner = EdgeSelection::empty(), outer = EdgeSelection::empty();
+        for (size_t i = 0; i < selections.size(); ++i)
+        {
+            distances[i] = selections[i].distance(origin);
+            const double distance = distances[i].median();
+            shape.merge(selections[i]);
+            if (windings[i] > 0 && distance >= 0)
+            {
+                inner.merge(selections[i]);
+            }
+            if (windings[i] < 0 && distance <= 0)
+            {
+                outer.merge(selections[i]);
+            }
+        }
+
+        const MultiDistance shapeDistance = shape.distance(origin);
+        const MultiDistance innerDistance = inner.distance(origin);
+        const MultiDistance outerDistance = outer.distance(origin);
+        const double innerScalar = innerDistance.median();
+        const double outerScalar = outerDistance.median();
+
+        MultiDistance distance;
+        int winding;
+        if (innerScalar >= 0 && std::fabs(innerScalar) <= std::fabs(outerScalar))
+        {
+            distance = innerDistance;
+            winding = 1;
+            for (size_t i = 0; i < selections.size(); ++i)
+            {
+                const double contourScalar = distances[i].median();
+                if (windings[i] > 0 && std::fabs(contourScalar) < std::fabs(outerScalar) && contourScalar > distance.median())
+                {
+                    distance = distances[i];
+                }
+            }
+        }
+        else if (outerScalar <= 0 && std::fabs(outerScalar) < std::fabs(innerScalar))
+        {
+            distance = outerDistance;
+            winding = -1;
+            for (size_t i = 0; i < selections.size(); ++i)
+            {
+                const double contourScalar = distances[i].median();
+                if (windings[i] < 0 && std::fabs(contourScalar) < std::fabs(innerScalar) && contourScalar < distance.median())
+                {
+                    distance = distances[i];
+                }
+            }
+        }
+        else
+        {
+            return shapeDistance;
+        }
+
+        for (size_t i = 0; i < selections.size(); ++i)
+        {
+            const double contourScalar = distances[i].median();
+            if (windings[i] != winding && contourScalar * distance.median() >= 0 &&
+                std::fabs(contourScalar) < std::fabs(distance.median()))
+            {
+                distance = distances[i];
+            }
+        }
+        return (distance.median() == shapeDistance.median()) ? shapeDistance : distance;
+    }
+
+    /// Whether the median of the field interpolated between `texels` with `weights` lands on the other side
+    /// of the outline from the interpolated true distance, by more than `tolerance`
+    bool IsArtifact(const float *distances, const float *trueDistances, const size_t *texels, const float *weights,
+                    int count, float tolerance)
+    {
+        float channels[3] = { 0, 0, 0 };
+        float trueDistance = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                channels[c] += weights[i] * distances[3 * texels[i] + c];
+            }
+            trueDistance += weights[i] * trueDistances[texels[i]];
+        }
+        const float median = Median(channels[0], channels[1], channels[2]);
+        return (median > 0.5f) != (trueDistance > 0.5f) && std::fabs(trueDistance - 0.5f) > tolerance;
+    }
+
+    void GenerateGlyph(const MBEMSDFGlyph &glyph, float spread, uint8_t *image, size_t bytesPerRow)
+    {
+        const size_t width = glyph.width, height = glyph.height;
+        const size_t texelCount = width * height;
+        if (texelCount == 0)
+        {
+            return;
+        }
+
+        std::vector<Contour> contours;
+        ParseOutline(glyph, contours);
+        ColorEdges(contours);
+
+        // Each contour's own winding number test tells which side of the contour a texel is on when its
+        // edges are too far away to measure, and the test of all of them together tells which side of the
+        // outline it's on
+        std::vector<Line> lines, contourLines;
+        std::vector<int> windings(contours.size());
+        std::vector<uint8_t> isInsideContour(contours.size() * texelCount);
+        std::vector<uint8_t> isInside(texelCount);
+        std::vector<Crossing> crossings;
+        for (size_t i = 0; i < contours.size(); ++i)
+        {
+            contourLines.clear();
+            FlattenContour(contours[i], contourLines);
+            const double area = SignedArea(contourLines);
+            windings[i] = (area > 0) ? -1 : (area < 0) ? 1 : 0;
+            for (size_t y = 0; y < height; ++y)
+            {
+                FillRow(contourLines, glyph.y + y + 0.5, glyph.x + 0.5, width, crossings, &isInsideContour[i * texelCount + y * width]);
+            }
+            lines.insert(lines.end(), contourLines.begin(), contourLines.end());
+        }
+        for (size_t y = 0; y < height; ++y)
+        {
+            FillRow(lines, glyph.y + y + 0.5, glyph.x + 0.5, width, crossings, &isInside[y * width]);
+        }
+
+        // Edges farther away than this can only produce channels that quantize to 0 or 255, so they're
+        // skipped, and channels with no nearer edge are saturated on the side of the contour the texel is on
+        const double reach = 2.0 * spread + 1;
+
+        std::vector<float> distances(texelCount * 3);
+        std::vector<float> trueDistances(texelCount);
+        std::vector<EdgeSelection> selections(contours.size());
+        std::vector<MultiDistance> contourDistances(contours.size());
+        for (size_t y = 0; y < height; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                const size_t texel = y * width + x;
+                const Vector2 origin = { glyph.x + x + 0.5, glyph.y + y + 0.5 };
+                for (size_t i = 0; i < contours.size(); ++i)
+                {
+                    const int insideSign = (windings[i] != 0) ? windings[i] : 1;
+                    Channel *channels = selections[i].channels;
+                    for (int c = 0; c < 3; ++c)
+                    {
+                        channels[c].distance.distance = reach;
+                        channels[c].distance.dot = 0;
+                        channels[c].edge = nullptr;
+                        channels[c].param = 0;
+                        channels[c].saturated = isInsideContour[i * texelCount + texel] ? insideSign * reach : -insideSign * reach;
+                    }
+
+                    for (const Segment &edge : contours[i])
+                    {
+                        double bound = 0;
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            if (edge.color & (1 << c))
+                            {
+                                bound = std::max(bound, std::fabs(channels[c].distance.distance));
+                            }
+                        }
+                        if (edge.boundsDistanceSquared(origin) > bound * bound)
+                        {
+                            continue;
+                        }
+
+                        double param;
+                        const SignedDistance distance = edge.signedDistance(origin, param);
+                        for (int c = 0; c < 3; ++c)
+                        {
+                            if ((edge.color & (1 << c)) && distance < channels[c].distance)
+                            {
+                                channels[c].distance = distance;
+                                channels[c].edge = &edge;
+                                channels[c].param = param;
+                            }
+                        }
+                    }
+                }
+
+                MultiDistance distance;
+                if (contours.empty())
+                {
+                    distance.channels[0] = distance.channels[1] = distance.channels[2] = -reach;
+                }
+                else if (contours.size() == 1)
+                {
+                    distance = selections[0].distance(origin);
+                }
+                else
+                {
+                    distance = CombineContours(selections, windings, origin, contourDistances);
+                }
+                for (int c = 0; c < 3; ++c)
+                {
+                    distances[3 * texel + c] = (float)distance.channels[c];
+                }
+
+                double nearest = reach;
+                for (const EdgeSelection &selection : selections)
+                {
+                    for (const Channel &channel : selection.channels)
+                    {
+                        nearest = std::min(nearest, std::fabs(channel.distance.distance));
+                    }
+                }
+                trueDistances[texel] = (float)(isInside[texel] ? nearest : -nearest);
+            }
+        }
+
+        // Outer contours run clockwise in some fonts and counterclockwise in others, which decides the sign
+        // of every distance. The winding number test settles which way this outline runs, by majority over
+        // the texels far enough from it to trust the test.
+        size_t agreements = 0, disagreements = 0;
+        for (size_t texel = 0; texel < texelCount; ++texel)
+        {
+            const float *d = &distances[3 * texel];
+            const float median = Median(d[0], d[1], d[2]);
+            if (std::fabs(median) > SignCorrectionDistance && std::fabs(median) < reach)
+            {
+                ((median > 0) == (bool)isInside[texel]) ? ++agreements : ++disagreements;
+            }
+        }
+        if (disagreements > agreements)
+        {
+            for (float &distance : distances)
+            {
+                distance = -distance;
+            }
+        }
+
+        // Where the nearest edges of all three channels mislead, as they can around contours that cross
+        // themselves, the median can still land on the wrong side away from the outline, so those texels are
+        // flipped to agree with the test
+        const float scale = 0.5f / spread;
+        for (size_t texel = 0; texel < texelCount; ++texel)
+        {
+            float *d = &distances[3 * texel];
+            const float median = Median(d[0], d[1], d[2]);
+            const bool isFlipped = std::fabs(median) > SignCorrectionDistance && (median > 0) != (bool)isInside[texel];
+            for (int c = 0; c < 3; ++c)
+            {
+                d[c] = (isFlipped ? -d[c] : d[c]) * scale + 0.5f;
+            }
+        }
+
+        // Even with every texel on the right side, the median of channels interpolated between texels whose
+        // channels come from different edges can land on the wrong side, which shows as notches and specks
+        // around tight concave corners. The texels around any point between them where that happens fall
+        // back to the true distance in every channel.
+        for (float &trueDistance : trueDistances)
+        {
+            trueDistance = trueDistance * scale + 0.5f;
+        }
+        const float tolerance = (float)ArtifactTolerance * scale;
+        std::vector<uint8_t> isArtifact(texelCount);
+        for (size_t y = 0; y < height; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                const size_t texel = y * width + x;
+                const float one = 1;
+                if (IsArtifact(&distances[0], &trueDistances[0], &texel, &one, 1, tolerance))
+                {
+                    isArtifact[texel] = true;
+                }
+                for (int axis = 0; axis < 2; ++axis)
+                {
+                    const size_t neighbor = texel + ((axis == 0) ? 1 : width);
+                    if ((axis == 0) ? (x + 1 == width) : (y + 1 == height))
+                    {
+                        continue;
+                    }
+                    const size_t texels[2] = { texel, neighbor };
+                    for (float t = 0.25f; t < 1; t += 0.25f)
+                    {
+                        const float weights[2] = { 1 - t, t };
+                        if (IsArtifact(&distances[0], &trueDistances[0], texels, weights, 2, tolerance))
+                        {
+                            isArtifact[texel] = isArtifact[neighbor] = true;
+                        }
+                    }
+                }
+                if (x + 1 < width && y + 1 < height)
+                {
+                    const size_t texels[4] = { texel, texel + 1, texel + width, texel + width + 1 };
+                    const float weights[4] = { 0.25f, 0.25f, 0.25f, 0.25f };
+                    if (IsArtifact(&distances[0], &trueDistances[0], texels, weights, 4, tolerance))
+                    {
+                        for (size_t cornerTexel : texels)
+                        {
+                            isArtifact[cornerTexel] = true;
+                        }
+                    }
+                }
+            }
+        }
+        for (size_t texel = 0; texel < texelCount; ++texel)
+        {
+            if (isArtifact[texel])
+            {
+                float *d = &distances[3 * texel];
+                d[0] = d[1] = d[2] = trueDistances[texel];
+            }
+        }
+
+        // Channels from different edges can disagree so much between neighbors that bilinear filtering
+        // produces a false edge between them. Those texels lose their corner information and fall back to
+        // the median in every channel.
+        const float threshold = (float)ClashThreshold * scale;
+        std::vector<size_t> clashes;
+        for (size_t y = 0; y < height; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                const float *d = &distances[3 * (y * width + x)];
+                if ((x > 0 && Clashes(d, d - 3, threshold)) ||
+                    (x + 1 < width && Clashes(d, d + 3, threshold)) ||
+                    (y > 0 && Clashes(d, d - 3 * width, threshold)) ||
+                    (y + 1 < height && Clashes(d, d + 3 * width, threshold)))
+                {
+                    clashes.push_back(y * width + x);
+                }
+            }
+        }
+        for (size_t texel : clashes)
+        {
+            float *d = &distances[3 * texel];
+            d[0] = d[1] = d[2] = Median(d[0], d[1], d[2]);
+        }
+
+        for (size_t y = 0; y < height; ++y)
+        {
+            uint8_t *row = image + (glyph.y + y) * bytesPerRow + glyph.x * 4;
+            const float *d = &distances[3 * y * width];
+            for (size_t x = 0; x < width; ++x, row += 4, d += 3)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    row[c] = (uint8_t)(std::max(0.0f, std::min(1.0f, d[c])) * 255 + 0.5f);
+                }
+                row[3] = 255;
+            }
+        }
+    }
+}
+
+void MBEGenerateMSDF(const MBEMSDFGlyph *glyphs, size_t glyphCount, float spread,
+                     uint8_t *image, size_t bytesPerRow)
+{
+    MBEThreadPool::sharedPool().parallelFor(glyphCount, [&](size_t i) {
+        GenerateGlyph(glyphs[i], spread, image, bytesPerRow);
+    });
+}
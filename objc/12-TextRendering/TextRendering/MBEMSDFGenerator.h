@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that the font atlas, which is written in plain Objective-C, can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// The elements of a glyph outline, which match those of a CGPath
+typedef enum
+{
+    MBEOutlineVerbMoveTo,
+    MBEOutlineVerbLineTo,
+    MBEOutlineVerbQuadraticCurveTo,
+    MBEOutlineVerbCubicCurveTo,
+    MBEOutlineVerbClose,
+} MBEOutlineVerb;
+
+/// One glyph to render into a multi-channel signed distance field
+typedef struct
+{
+    /// The verbs of the glyph's outline, one per path element
+    const uint8_t *verbs;
+    size_t verbCount;
+    /// The points of each verb in turn, as x, y pairs: one point for a move or a line, two for a quadratic
+    /// curve, three for a cubic curve and none for a close. Coordinates are in texels of the field, with
+    /// the origin at the top left corner of the first texel.
+    const float *points;
+    size_t pointCount;
+    /// The rectangle of texels the glyph's field covers, which must not overlap that of any other glyph
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+} MBEMSDFGlyph;
+
+/// Renders the multi-channel signed distance field of each glyph into its rectangle of an RGBA8 image.
+/// The outline's edges are colored so that every corner lies between edges of different colors, and each
+/// of the red, green and blue channels of a texel holds the signed pseudo-distance to the nearest edge of
+/// its color, which extends the edge along its tangents past its ends. The median of the three channels
+/// is then the distance to the outline, with corners that stay sharp under bilinear filtering.
+///
+/// Distances are positive inside the glyph, where its outline has a non-zero winding number, and are
+/// quantized with 0 standing for `spread` texels or more outside and 255 for `spread` or more inside.
+/// Alpha is always 255. Contours may run in either direction, as long as they are consistent.
+///
+/// Glyphs are rendered in parallel across the threads of the shared pool, one glyph to a task. The time
+/// taken for each glyph is proportional to its area times the number of edges near each texel.
+void MBEGenerateMSDF(const MBEMSDFGlyph *glyphs, size_t glyphCount, float spread,
+                     uint8_t *image, size_t bytesPerRow);
+
+#ifdef __cplusplus
+}
+#endif
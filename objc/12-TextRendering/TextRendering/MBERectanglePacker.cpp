@@ -0,0 +1,334 @@
+#include "MBERectanglePacker.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    struct Rectangle
+    {
+        uint32_t x, y, width, height;
+
+        bool contains(const Rectangle &other) const
+        {
+            return other.x >= x && other.y >= y &&
+                   other.x + other.width <= x + width && other.y + other.height <= y + height;
+        }
+
+        bool intersects(const Rectangle &other) const
+        {
+            return other.x < x + width && x < other.x + other.width &&
+                   other.y < y + height && y < other.y + other.height;
+        }
+    };
+
+    /// A horizontal segment of the skyline, at height y above the columns [x, x + width)
+    struct SkylineSegment
+    {
+        uint32_t x, y, width;
+    };
+}
+
+struct MBERectanglePacker
+{
+    uint32_t width;
+    uint32_t height;
+    MBERectanglePackingHeuristic heuristic;
+    uint64_t usedArea;
+    /// The skyline, from left to right, for the skyline heuristic
+    std::vector<SkylineSegment> skyline;
+    /// Every maximal free rectangle, none of which contains another, for the MaxRects heuristic
+    std::vector<Rectangle> freeRectangles;
+};
+
+namespace
+{
+    /// The lowest the bottom of a rectangle of `width` can sit with its left side at the start of
+    /// `segment`, or false if it would stick out of the bin
+    bool SkylineFit(const MBERectanglePacker &packer, size_t segment, uint32_t width, uint32_t height, uint32_t &y)
+    {
+        const std::vector<SkylineSegment> &skyline = packer.skyline;
+        if (skyline[segment].x + width > packer.width)
+        {
+            return false;
+        }
+
+        y = 0;
+        uint32_t covered = 0;
+        for (size_t i = segment; covered < width; ++i)
+        {
+            y = std::max(y, skyline[i].y);
+            if (y + height > packer.height)
+            {
+                return false;
+            }
+            covered += skyline[i].width;
+        }
+        return true;
+    }
+
+    bool SkylineInsert(MBERectanglePacker &packer, MBEPackedRectangle &rectangle)
+    {
+        std::vector<SkylineSegment> &skyline = packer.skyline;
+
+        size_t bestSegment = skyline.size();
+        uint32_t bestTop = std::numeric_limits<uint32_t>::max();
+        uint32_t bestWidth = std::numeric_limits<uint32_t>::max();
+        uint32_t bestY = 0;
+        for (size_t i = 0; i < skyline.size(); ++i)
+        {
+            uint32_t y;
+            if (SkylineFit(packer, i, rectangle.width, rectangle.height, y))
+            {
+                const uint32_t top = y + rectangle.height;
+                if (top < bestTop || (top == bestTop && skyline[i].width < bestWidth))
+                {
+                    bestSegment = i;
+                    bestTop = top;
+                    bestWidth = skyline[i].width;
+                    bestY = y;
+                }
+            }
+        }
+
+        if (bestSegment == skyline.size())
+        {
+            return false;
+        }
+
+        rectangle.x = skyline[bestSegment].x;
+        rectangle.y = bestY;
+
+        // Raise the skyline over the new rectangle, trimming or removing the segments it covers
+        SkylineSegment raised = { rectangle.x, bestTop, rectangle.width };
+        skyline.insert(skyline.begin() + bestSegment, raised);
+        const uint32_t right = raised.x + raised.width;
+        size_t next = bestSegment + 1;
+        while (next < skyline.size() && skyline[next].x < right)
+        {
+            const uint32_t overlap = right - skyline[next].x;
+            if (overlap < skyline[next].width)
+            {
+                skyline[next].x += overlap;
+                skyline[next].width -= overlap;
+                break;
+            }
+            skyline.erase(skyline.begin() + next);
+        }
+
+        // Merge neighbors at the same height, so the number of segments stays small
+        for (size_t i = 0; i + 1 < skyline.size();)
+        {
+            if (skyline[i].y == skyline[i + 1].y)
+            {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        return true;
+    }
+
+    /// Cuts `used` out of `free`, appending the up to four maximal rectangles of what remains
+    void SplitFreeRectangle(const Rectangle &free, const Rectangle &used, std::vector<Rectangle> &pieces)
+    {
+        if (used.y > free.y)
+        {
+            Rectangle above = { free.x, free.y, free.width, used.y - free.y };
+            pieces.push_back(above);
+        }
+        if (used.y + used.height < free.y + free.height)
+        {
+            Rectangle below = { free.x, used.y + used.height, free.width, free.y + free.height - (used.y + used.height) };
+            pieces.push_back(below);
+        }
+        if (used.x > free.x)
+        {
+            Rectangle left = { free.x, free.y, used.x - free.x, free.height };
+            pieces.push_back(left);
+        }
+        if (used.x + used.width < free.x + free.width)
+        {
+            Rectangle right = { used.x + used.width, free.y, free.x + free.width - (used.x + used.width), free.height };
+            pieces.push_back(right);
+        }
+    }
+
+    bool MaxRectsInsert(MBERectanglePacker &packer, MBEPackedRectangle &rectangle)
+    {
+        std::vector<Rectangle> &freeRectangles = packer.freeRectangles;
+
+        const Rectangle *best = nullptr;
+        uint32_t bestShortSide = std::numeric_limits<uint32_t>::max();
+        uint32_t bestLongSide = std::numeric_limits<uint32_t>::max();
+        for (const Rectangle &free : freeRectangles)
+        {
+            if (free.width >= rectangle.width && free.height >= rectangle.height)
+            {
+                const uint32_t leftoverWidth = free.width - rectangle.width;
+                const uint32_t leftoverHeight = free.height - rectangle.height;
+                const uint32_t shortSide = std::min(leftoverWidth, leftoverHeight);
+                const uint32_t longSide = std::max(leftoverWidth, leftoverHeight);
+                if (shortSide < bestShortSide || (shortSide == bestShortSide && longSide < bestLongSide))
+                {
+                    best = &free;
+                    bestShortSide = shortSide;
+                    bestLongSide = longSide;
+                }
+            }
+        }
+
+        if (!best)
+        {
+            return false;
+        }
+
+        rectangle.x = best->x;
+        rectangle.y = best->y;
+        const Rectangle used = { rectangle.x, rectangle.y, rectangle.width, rectangle.height };
+
+        // Every free rectangle the new one overlaps is replaced by the pieces of it that remain free
+        std::vector<Rectangle> pieces;
+        size_t kept = 0;
+        for (size_t i = 0; i < freeRectangles.size(); ++i)
+        {
+            if (freeRectangles[i].intersects(used))
+            {
+                SplitFreeRectangle(freeRectangles[i], used, pieces);
+            }
+            else
+            {
+                freeRectangles[kept++] = freeRectangles[i];
+            }
+        }
+        freeRectangles.resize(kept);
+
+        // A piece can be contained in an untouched free rectangle or in another piece, but an untouched
+        // free rectangle can't be contained in a piece, since it wasn't contained in the piece's parent
+        for (size_t i = 0; i < pieces.size(); ++i)
+        {
+            bool isRedundant = false;
+            for (size_t j = 0; j < kept && !isRedundant; ++j)
+            {
+                isRedundant = freeRectangles[j].contains(pieces[i]);
+            }
+            for (size_t j = 0; j < pieces.size() && !isRedundant; ++j)
+            {
+                // Of two identical pieces, only the first survives
+                isRedundant = (j != i) && pieces[j].contains(pieces[i]) && (j < i || !pieces[i].contains(pieces[j]));
+            }
+            if (!isRedundant)
+            {
+                freeRectangles.push_back(pieces[i]);
+            }
+        }
+
+        return true;
+    }
+}
+
+MBERectanglePacker *MBERectanglePackerCreate(uint32_t width, uint32_t height, MBERectanglePackingHeuristic heuristic)
+{
+    MBERectanglePacker *packer = new MBERectanglePacker();
+    packer->width = width;
+    packer->height = height;
+    packer->heuristic = heuristic;
+    MBERectanglePackerReset(packer);
+    return packer;
+}
+
+void MBERectanglePackerDestroy(MBERectanglePacker *packer)
+{
+    delete packer;
+}
+
+void MBERectanglePackerReset(MBERectanglePacker *packer)
+{
+    packer->usedArea = 0;
+    packer->skyline.clear();
+    packer->freeRectangles.clear();
+    if (packer->width > 0 && packer->height > 0)
+    {
+        SkylineSegment ground = { 0, 0, packer->width };
+        packer->skyline.push_back(ground);
+        Rectangle bin = { 0, 0, packer->width, packer->height };
+        packer->freeRectangles.push_back(bin);
+    }
+}
+
+bool MBERectanglePackerInsert(MBERectanglePacker *packer, MBEPackedRectangle *rectangle)
+{
+    if (rectangle->width == 0 || rectangle->height == 0)
+    {
+        rectangle->x = rectangle->y = 0;
+        return true;
+    }
+    if (rectangle->width > packer->width || rectangle->height > packer->height)
+    {
+        return false;
+    }
+
+    const bool inserted = (packer->heuristic == MBERectanglePackingSkylineBottomLeft) ?
+                          SkylineInsert(*packer, *rectangle) : MaxRectsInsert(*packer, *rectangle);
+    if (inserted)
+    {
+        packer->usedArea += (uint64_t)rectangle->width * rectangle->height;
+    }
+    return inserted;
+}
+
+bool MBERectanglePackerInsertBatch(MBERectanglePacker *packer, MBEPackedRectangle *rectangles, size_t count)
+{
+    uint64_t area = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (rectangles[i].width > packer->width || rectangles[i].height > packer->height)
+        {
+            return false;
+        }
+        area += (uint64_t)rectangles[i].width * rectangles[i].height;
+    }
+    if (area > (uint64_t)packer->width * packer->height - packer->usedArea)
+    {
+        return false;
+    }
+
+    std::vector<size_t> order(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (rectangles[a].height != rectangles[b].height)
+        {
+            return rectangles[a].height > rectangles[b].height;
+        }
+        if (rectangles[a].width != rectangles[b].width)
+        {
+            return rectangles[a].width > rectangles[b].width;
+        }
+        return a < b;
+    });
+
+    const MBERectanglePacker saved = *packer;
+    for (size_t i : order)
+    {
+        if (!MBERectanglePackerInsert(packer, &rectangles[i]))
+        {
+            *packer = saved;
+            return false;
+        }
+    }
+    return true;
+}
+
+double MBERectanglePackerOccupancy(const MBERectanglePacker *packer)
+{
+    const uint64_t area = (uint64_t)packer->width * packer->height;
+    return (area > 0) ? (double)packer->usedArea / area : 0;
+}
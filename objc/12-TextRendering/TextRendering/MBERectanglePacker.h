@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// This header is C-compatible so that the font atlas, which is written in plain Objective-C, can call it.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// How a packer chooses where each rectangle goes. Rectangles are never rotated.
+typedef enum
+{
+    /// Keeps the outline of the tops of the packed rectangles, and places each rectangle where its top
+    /// would be lowest. Fast, and tight for rectangles of similar heights, like glyphs, but any space
+    /// left under a rectangle that overhangs a lower neighbor is lost.
+    MBERectanglePackingSkylineBottomLeft,
+    /// Keeps every maximal free rectangle, and places each rectangle in the free one it fits most snugly
+    /// along its shorter leftover side, after Jylänki's MaxRects-BSSF. Reuses space the skyline loses,
+    /// at a cost that grows with the number of free rectangles.
+    MBERectanglePackingMaxRectsBestShortSideFit,
+} MBERectanglePackingHeuristic;
+
+/// A rectangle to pack, whose position is filled in by the packer
+typedef struct
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t x;
+    uint32_t y;
+} MBEPackedRectangle;
+
+/// Packs rectangles into a fixed-size bin, either one at a time as they're needed or in batches
+typedef struct MBERectanglePacker MBERectanglePacker;
+
+MBERectanglePacker *MBERectanglePackerCreate(uint32_t width, uint32_t height, MBERectanglePackingHeuristic heuristic);
+void MBERectanglePackerDestroy(MBERectanglePacker *packer);
+
+/// Empties the bin
+void MBERectanglePackerReset(MBERectanglePacker *packer);
+
+/// Places one rectangle and fills in its position, or returns false if there's no room for it
+bool MBERectanglePackerInsert(MBERectanglePacker *packer, MBEPackedRectangle *rectangle);
+
+/// Places a set of rectangles, tallest first, which packs more tightly than inserting them in an
+/// arbitrary order, and fills in their positions. If they can't all be placed, returns false and leaves
+/// the bin as it was. A set whose total area is more than the free area of the bin, or which has a
+/// rectangle larger than the bin, fails before any placement is tried.
+bool MBERectanglePackerInsertBatch(MBERectanglePacker *packer, MBEPackedRectangle *rectangles, size_t count);
+
+/// The fraction of the bin's area covered by packed rectangles
+double MBERectanglePackerOccupancy(const MBERectanglePacker *packer);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,10 +2,9 @@
 #import "MBERenderer.h"
 #import "MBEMathUtilities.h"
 #import "MBETypes.h"
-#import "MBEFontAtlas.h"
+#import "MBEGlyphCache.h"
 #import "MBETextMesh.h"
-
-#define MBE_FORCE_REGENERATE_FONT_ATLAS 0
+#import "MBEFrameResources.h"
 
 static NSString *const MBEFontName = @"HoeflerText-Regular";
 static float MBEFontDisplaySize = 72;
@@ -15,7 +14,11 @@ static NSString *const MBESampleText = @"It was the best of times, it was the wo
                                         "каждая несчастливая семья несчастлива по-своему.";
 static vector_float4 MBETextColor = { 0.1, 0.1, 0.1, 1 };
 static MTLClearColor MBEClearColor = { 1, 1, 1, 1 };
-static float MBEFontAtlasSize = 2048;
+// A multi-channel field keeps glyph corners sharp with a quarter of the texels a single-channel field needs
+static MBEFontAtlasFieldType MBEFontFieldType = MBEFontAtlasFieldTypeMultiChannel;
+static float MBEFontAtlasSize = 1024;
+// Glyph fields are generated at this size, in texels per em, as the text needs them
+static float MBEFontAtlasGlyphSize = 48;
 
 @interface MBERenderer ()
 @property (nonatomic, strong) CAMetalLayer *layer;
@@ -26,9 +29,10 @@ static float MBEFontAtlasSize = 2048;
 @property (nonatomic, strong) id<MTLSamplerState> sampler;
 // Resources
 @property (nonatomic, strong) id<MTLTexture> depthTexture;
-@property (nonatomic, strong) MBEFontAtlas *fontAtlas;
+@property (nonatomic, strong) MBEGlyphCache *glyphCache;
 @property (nonatomic, strong) MBETextMesh *textMesh;
-@property (nonatomic, strong) id<MTLBuffer> uniformBuffer;
+@property (nonatomic, strong) MBEFrameResources *frameResources;
+@property (nonatomic, assign) NSUInteger uniformOffset;
 @property (nonatomic, strong) id<MTLTexture> fontTexture;
 @end
 
@@ -109,45 +113,64 @@ static float MBEFontAtlasSize = 2048;
     return vertexDescriptor;
 }
 
-- (NSURL *)documentsURL
-{
-    NSArray *candidates = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
-    NSString *documentsPath = [candidates firstObject];
-    return [NSURL fileURLWithPath:documentsPath isDirectory:YES];
-}
-
 - (void)buildResources
 {
-    [self buildFontAtlas];
+    [self buildFrameResources];
+    [self buildGlyphCache];
     [self buildTextMesh];
-    [self buildUniformBuffer];
+    [self updateFontTexture];
 }
 
-- (void)buildFontAtlas
+- (void)buildGlyphCache
 {
-    NSURL *fontURL = [[self.documentsURL URLByAppendingPathComponent:MBEFontName] URLByAppendingPathExtension:@"sdff"];
+    UIFont *font = [UIFont fontWithName:MBEFontName size:MBEFontAtlasGlyphSize];
+    _glyphCache = [[MBEGlyphCache alloc] initWithFont:font textureSize:MBEFontAtlasSize fieldType:MBEFontFieldType];
 
-#if !MBE_FORCE_REGENERATE_FONT_ATLAS
-    _fontAtlas = [NSKeyedUnarchiver unarchiveObjectWithFile:fontURL.path];
-#endif
-
-    // Cache miss: if we don't have a serialized version of the font atlas, build it now
-    if (!_fontAtlas)
-    {
-        UIFont *font = [UIFont fontWithName:MBEFontName size:32];
-        _fontAtlas = [[MBEFontAtlas alloc] initWithFont:font textureSize:MBEFontAtlasSize];
-        [NSKeyedArchiver archiveRootObject:_fontAtlas toFile:fontURL.path];
-    }
+    BOOL isMultiChannel = (_glyphCache.fieldType == MBEFontAtlasFieldTypeMultiChannel);
+    MTLPixelFormat pixelFormat = isMultiChannel ? MTLPixelFormatRGBA8Unorm : MTLPixelFormatR8Unorm;
 
-    MTLTextureDescriptor *textureDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatR8Unorm
+    MTLTextureDescriptor *textureDesc = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:pixelFormat
                                                                                            width:MBEFontAtlasSize
                                                                                           height:MBEFontAtlasSize
                                                                                        mipmapped:NO];
     textureDesc.usage = MTLTextureUsageShaderRead;
-    MTLRegion region = MTLRegionMake2D(0, 0, MBEFontAtlasSize, MBEFontAtlasSize);
     _fontTexture = [_device newTextureWithDescriptor:textureDesc];
     [_fontTexture setLabel:@"Font Atlas"];
-    [_fontTexture replaceRegion:region mipmapLevel:0 withBytes:_fontAtlas.textureData.bytes bytesPerRow:MBEFontAtlasSize];
+}
+
+- (void)updateFontTexture
+{
+    BOOL isMultiChannel = (self.glyphCache.fieldType == MBEFontAtlasFieldTypeMultiChannel);
+    NSUInteger bytesPerTexel = isMultiChannel ? 4 : 1;
+    NSUInteger bytesPerRow = MBEFontAtlasSize * bytesPerTexel;
+    const uint8_t *textureBytes = self.glyphCache.textureData.bytes;
+
+    // Only the regions of the texture holding glyphs generated since the last update are copied. Those
+    // regions may have held evicted glyphs that frames in flight still sample, so the first copy waits for
+    // the GPU to finish them. Frames that bring no new glyphs don't wait.
+    __block BOOL hasWaited = NO;
+    [self.glyphCache flushDirtyRectsUsingBlock:^(CGRect dirtyRect) {
+        if (!hasWaited)
+        {
+            [self.frameResources waitForPreviousFrames];
+            hasWaited = YES;
+        }
+
+        MTLRegion region = MTLRegionMake2D(CGRectGetMinX(dirtyRect), CGRectGetMinY(dirtyRect),
+                                           CGRectGetWidth(dirtyRect), CGRectGetHeight(dirtyRect));
+        const uint8_t *regionBytes = textureBytes + (NSUInteger)CGRectGetMinY(dirtyRect) * bytesPerRow +
+                                     (NSUInteger)CGRectGetMinX(dirtyRect) * bytesPerTexel;
+        [self.fontTexture replaceRegion:region mipmapLevel:0 withBytes:regionBytes bytesPerRow:bytesPerRow];
+    }];
+}
+
+- (void)updateGlyphCache
+{
+    // Plots not used since the frame began may be evicted to make room for new glyphs, so the glyphs of
+    // the text on screen are looked up again every frame to keep the mesh's texture coordinates valid
+    [self.glyphCache beginFrame];
+    [self.glyphCache prepareGlyphs:self.textMesh.glyphs.bytes count:self.textMesh.glyphs.length / sizeof(CGGlyph)];
+    [self updateFontTexture];
 }
 
 - (void)buildTextMesh
@@ -156,16 +179,16 @@ static float MBEFontAtlasSize = 2048;
 
     _textMesh = [[MBETextMesh alloc] initWithString:MBESampleText
                                              inRect:textRect
-                                      withFontAtlas:_fontAtlas
+                                      withFontAtlas:_glyphCache
                                              atSize:MBEFontDisplaySize
                                              device:_device];
 }
 
-- (void)buildUniformBuffer
+- (void)buildFrameResources
 {
-    _uniformBuffer = [_device newBufferWithLength:sizeof(MBEUniforms)
-                                          options:MTLResourceOptionCPUCacheModeDefault];
-    [_uniformBuffer setLabel:@"Uniform Buffer"];
+    _frameResources = [[MBEFrameResources alloc] initWithDevice:_device
+                                                 framesInFlight:MBEDefaultFramesInFlight
+                                                  bytesPerFrame:sizeof(MBEUniforms)];
 }
 
 - (void)buildDepthTexture
@@ -215,14 +238,30 @@ static float MBEFontAtlasSize = 2048;
 
     uniforms.foregroundColor = MBETextColor;
 
-    memcpy([self.uniformBuffer contents], &uniforms, sizeof(MBEUniforms));
+    uniforms.isMultiChannelField = (self.glyphCache.fieldType == MBEFontAtlasFieldTypeMultiChannel);
+
+    NSUInteger offset = 0;
+    void *contents = [self.frameResources allocateLength:sizeof(MBEUniforms) offset:&offset];
+    if (contents)
+    {
+        memcpy(contents, &uniforms, sizeof(MBEUniforms));
+    }
+    self.uniformOffset = contents ? offset : NSNotFound;
 }
 
 - (void)draw
 {
+    // Waits only if the GPU is still executing the frame that last used this frame's uniforms
+    [self.frameResources beginFrame];
+
+    [self updateGlyphCache];
+    [self updateUniforms];
+
+    id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
+
     id<CAMetalDrawable> drawable = [self.layer nextDrawable];
 
-    if (drawable)
+    if (drawable && self.uniformOffset != NSNotFound)
     {
         CGSize drawableSize = self.layer.drawableSize;
 
@@ -231,21 +270,17 @@ static float MBEFontAtlasSize = 2048;
             [self buildDepthTexture];
         }
 
-        [self updateUniforms];
-
         MTLRenderPassDescriptor *renderPass = [self newRenderPassWithColorAttachmentTexture:[drawable texture]];
 
-        id<MTLCommandBuffer> commandBuffer = [self.commandQueue commandBuffer];
-
         id<MTLRenderCommandEncoder> commandEncoder = [commandBuffer renderCommandEncoderWithDescriptor:renderPass];
         [commandEncoder setFrontFacingWinding:MTLWindingCounterClockwise];
         [commandEncoder setCullMode:MTLCullModeNone];
         [commandEncoder setRenderPipelineState:self.pipelineState];
 
         [commandEncoder setVertexBuffer:self.textMesh.vertexBuffer offset:0 atIndex:0];
-        [commandEncoder setVertexBuffer:self.uniformBuffer offset:0 atIndex:1];
+        [commandEncoder setVertexBuffer:self.frameResources.buffer offset:self.uniformOffset atIndex:1];
 
-        [commandEncoder setFragmentBuffer:self.uniformBuffer offset:0 atIndex:0];
+        [commandEncoder setFragmentBuffer:self.frameResources.buffer offset:self.uniformOffset atIndex:0];
         [commandEncoder setFragmentTexture:self.fontTexture atIndex:0];
         [commandEncoder setFragmentSamplerState:self.sampler atIndex:0];
 
@@ -258,8 +293,12 @@ static float MBEFontAtlasSize = 2048;
         [commandEncoder endEncoding];
 
         [commandBuffer presentDrawable:drawable];
-        [commandBuffer commit];
     }
+
+    // The command buffer is committed even when there was no drawable, so that its completion releases
+    // this frame's uniforms and lets later atlas updates proceed
+    [self.frameResources endFrameWithCommandBuffer:commandBuffer];
+    [commandBuffer commit];
 }
 
 @end
@@ -4,9 +4,13 @@
 
 @interface MBETextMesh : MBEMesh
 
+/// The glyphs the mesh displays, as an array of CGGlyph, which a glyph source that evicts glyphs must
+/// keep in use for as long as the mesh is drawn
+@property (nonatomic, readonly) NSData *glyphs;
+
 - (instancetype)initWithString:(NSString *)string
                         inRect:(CGRect)rect
-                      withFontAtlas:(MBEFontAtlas *)fontAtlas
+                      withFontAtlas:(id<MBEGlyphSource>)fontAtlas
                         atSize:(CGFloat)fontSize
                         device:(id<MTLDevice>)device;
 
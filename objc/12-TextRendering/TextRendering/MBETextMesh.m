@@ -13,7 +13,7 @@ typedef void (^MBEGlyphPositionEnumerationBlock)(CGGlyph glyph,
 
 - (instancetype)initWithString:(NSString *)string
                         inRect:(CGRect)rect
-                      withFontAtlas:(MBEFontAtlas *)fontAtlas
+                      withFontAtlas:(id<MBEGlyphSource>)fontAtlas
                         atSize:(CGFloat)fontSize
                         device:(id<MTLDevice>)device
 {
@@ -26,7 +26,7 @@ typedef void (^MBEGlyphPositionEnumerationBlock)(CGGlyph glyph,
 
 - (void)buildMeshWithString:(NSString *)string
                      inRect:(CGRect)rect
-                   withFont:(MBEFontAtlas *)fontAtlas
+                   withFont:(id<MBEGlyphSource>)fontAtlas
                      atSize:(CGFloat)fontSize
                      device:(id<MTLDevice>)device
 {
@@ -44,6 +44,26 @@ typedef void (^MBEGlyphPositionEnumerationBlock)(CGGlyph glyph,
         frameGlyphCount += CTLineGetGlyphCount((__bridge CTLineRef)lineObject);
     }];
 
+    NSMutableData *frameGlyphs = [NSMutableData dataWithCapacity:frameGlyphCount * sizeof(CGGlyph)];
+    for (id lineObject in lines)
+    {
+        for (id runObject in (__bridge id)CTLineGetGlyphRuns((__bridge CTLineRef)lineObject))
+        {
+            CTRunRef run = (__bridge CTRunRef)runObject;
+            NSInteger glyphCount = CTRunGetGlyphCount(run);
+            NSUInteger offset = frameGlyphs.length;
+            [frameGlyphs increaseLengthBy:glyphCount * sizeof(CGGlyph)];
+            CTRunGetGlyphs(run, CFRangeMake(0, 0), (CGGlyph *)((uint8_t *)frameGlyphs.mutableBytes + offset));
+        }
+    }
+    _glyphs = frameGlyphs;
+
+    // A glyph source that generates fields on demand can do so for all of the frame's glyphs at once
+    if ([fontAtlas respondsToSelector:@selector(prepareGlyphs:count:)])
+    {
+        [fontAtlas prepareGlyphs:frameGlyphs.bytes count:frameGlyphs.length / sizeof(CGGlyph)];
+    }
+
     const NSInteger vertexCount = frameGlyphCount * 4;
     const NSInteger indexCount = frameGlyphCount * 6;
     MBEVertex *vertices = malloc(vertexCount * sizeof(MBEVertex));
@@ -51,12 +71,14 @@ typedef void (^MBEGlyphPositionEnumerationBlock)(CGGlyph glyph,
 
     __block MBEIndexType v = 0, i = 0;
     [self enumerateGlyphsInFrame:frame block:^(CGGlyph glyph, NSInteger glyphIndex, CGRect glyphBounds) {
-        if (glyph >= fontAtlas.glyphDescriptors.count)
+        MBEGlyphDescriptor *glyphInfo = [fontAtlas descriptorForGlyph:glyph];
+        if (!glyphInfo)
         {
             NSLog(@"Font atlas has no entry corresponding to glyph #%d; Skipping...", glyph);
             return;
         }
-        MBEGlyphDescriptor *glyphInfo = fontAtlas.glyphDescriptors[glyph];
+        // Skipped glyphs have no vertices, so each quad's indices follow from the vertices written so far
+        MBEIndexType firstVertex = v;
         float minX = CGRectGetMinX(glyphBounds);
         float maxX = CGRectGetMaxX(glyphBounds);
         float minY = CGRectGetMinY(glyphBounds);
@@ -69,20 +91,20 @@ typedef void (^MBEGlyphPositionEnumerationBlock)(CGGlyph glyph,
         vertices[v++] = (MBEVertex){ { minX, minY, 0, 1 }, { minS, minT } };
         vertices[v++] = (MBEVertex){ { maxX, minY, 0, 1 }, { maxS, minT } };
         vertices[v++] = (MBEVertex){ { maxX, maxY, 0, 1 }, { maxS, maxT } };
-        indices[i++] = glyphIndex * 4;
-        indices[i++] = glyphIndex * 4 + 1;
-        indices[i++] = glyphIndex * 4 + 2;
-        indices[i++] = glyphIndex * 4 + 2;
-        indices[i++] = glyphIndex * 4 + 3;
-        indices[i++] = glyphIndex * 4;
+        indices[i++] = firstVertex;
+        indices[i++] = firstVertex + 1;
+        indices[i++] = firstVertex + 2;
+        indices[i++] = firstVertex + 2;
+        indices[i++] = firstVertex + 3;
+        indices[i++] = firstVertex;
     }];
 
     _vertexBuffer = [device newBufferWithBytes:vertices
-                                        length:vertexCount * sizeof(MBEVertex)
+                                        length:v * sizeof(MBEVertex)
                                        options:MTLResourceOptionCPUCacheModeDefault];
     [_vertexBuffer setLabel:@"Text Mesh Vertices"];
     _indexBuffer = [device newBufferWithBytes:indices
-                                       length:indexCount * sizeof(MBEIndexType)
+                                       length:i * sizeof(MBEIndexType)
                                       options:MTLResourceOptionCPUCacheModeDefault];
     [_indexBuffer setLabel:@"Text Mesh Indices"];
 
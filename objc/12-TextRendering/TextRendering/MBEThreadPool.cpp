@@ -0,0 +1,108 @@
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+
+MBEThreadPool::MBEThreadPool(unsigned threadCount) :
+    _dispatchingThread(std::thread::id()), _body(nullptr), _count(0), _nextIteration(0), _busyWorkers(0), _generation(0),
+    _stopping(false)
+{
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (unsigned i = 1; i < threadCount; ++i)
+    {
+        _workers.push_back(std::thread(&MBEThreadPool::workerMain, this));
+    }
+}
+
+MBEThreadPool::~MBEThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _wakeCondition.notify_all();
+
+    for (std::thread &worker : _workers)
+    {
+        worker.join();
+    }
+}
+
+MBEThreadPool &MBEThreadPool::sharedPool()
+{
+    static MBEThreadPool pool;
+    return pool;
+}
+
+void MBEThreadPool::parallelFor(size_t count, const std::function<void(size_t)> &body)
+{
+    // A body that calls back in on the thread that started the loop must not try to lock the dispatch
+    // mutex that thread already holds. Any other thread just fails to get it while a loop is running.
+    std::unique_lock<std::mutex> dispatchLock(_dispatchMutex, std::defer_lock);
+    const bool isNested = (_dispatchingThread.load() == std::this_thread::get_id());
+
+    if (count < 2 || _workers.empty() || isNested || !dispatchLock.try_lock())
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            body(i);
+        }
+        return;
+    }
+
+    _dispatchingThread = std::this_thread::get_id();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _body = &body;
+        _count = count;
+        _nextIteration = 0;
+        _busyWorkers = _workers.size();
+        ++_generation;
+    }
+    _wakeCondition.notify_all();
+
+    runIterations();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _doneCondition.wait(lock, [this] { return _busyWorkers == 0; });
+    _body = nullptr;
+    _dispatchingThread = std::thread::id();
+}
+
+void MBEThreadPool::runIterations()
+{
+    size_t i;
+    while ((i = _nextIteration.fetch_add(1)) < _count)
+    {
+        (*_body)(i);
+    }
+}
+
+void MBEThreadPool::workerMain()
+{
+    size_t lastGeneration = 0;
+
+    while (1)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wakeCondition.wait(lock, [&] { return _stopping || _generation != lastGeneration; });
+            if (_stopping)
+            {
+                return;
+            }
+            lastGeneration = _generation;
+        }
+
+        runIterations();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_busyWorkers == 0)
+        {
+            _doneCondition.notify_one();
+        }
+    }
+}
@@ -7,6 +7,7 @@ typedef struct
     matrix_float4x4 modelMatrix;
     matrix_float4x4 viewProjectionMatrix;
     vector_float4 foregroundColor;
+    uint32_t isMultiChannelField;
 } MBEUniforms;
 
 typedef struct
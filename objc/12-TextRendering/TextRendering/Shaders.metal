@@ -18,8 +18,15 @@ struct Uniforms
     float4x4 modelMatrix;
     float4x4 viewProjectionMatrix;
     float4 foregroundColor;
+    uint isMultiChannelField;
 };
 
+// The median of three channels of a multi-channel distance field is the distance to the outline, cf. Chlumsky 2015
+float median(float r, float g, float b)
+{
+    return max(min(r, g), min(max(r, g), b));
+}
+
 vertex TransformedVertex vertex_shade(constant Vertex *vertices [[buffer(0)]],
                                       constant Uniforms &uniforms [[buffer(1)]],
                                       uint vid [[vertex_id]])
@@ -39,7 +46,8 @@ fragment half4 fragment_shade(TransformedVertex vert [[stage_in]],
     // Outline of glyph is the isocontour with value 50%
     float edgeDistance = 0.5;
     // Sample the signed-distance field to find distance from this fragment to the glyph outline
-    float sampleDistance = texture.sample(samplr, vert.texCoords).r;
+    float4 texel = texture.sample(samplr, vert.texCoords);
+    float sampleDistance = uniforms.isMultiChannelField ? median(texel.r, texel.g, texel.b) : texel.r;
     // Use local automatic gradients to find anti-aliased anisotropic edge width, cf. Gustavson 2012
     float edgeWidth = 0.75 * length(float2(dfdx(sampleDistance), dfdy(sampleDistance)));
     // Smooth the glyph edge by interpolating across the boundary in a band with the width determined above
@@ -0,0 +1,220 @@
+// Measures the distance transforms on the host, outside of the app, on a 4096 x 4096 image laid out
+// like the font atlas: a grid of cells holding glyph-like strokes, rings and dots. It times the exact
+// transform with no distance limit and with the atlas spread, the banded field the atlas actually builds,
+// and, for comparison, the dead-reckoning transform the exact one replaced. The atlas is expected to
+// build its field in well under 100 ms on a device; this gives a figure to compare against on the host.
+//
+// usage: MBEDistanceTransformBenchmark [iterations] [size]
+
+#include "MBEDistanceTransform.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+namespace
+{
+
+/// The spread of a typical font at the atlas size, in pixels, and the downsampling from the atlas bitmap
+/// to the texture
+const float MBEAtlasSpread = 16;
+const size_t MBEAtlasScaleFactor = 8;
+
+/// Draws a repeatable pattern of glyph-like shapes, roughly 100 pixels to a cell
+std::vector<uint8_t> MBEMakeAtlasImage(size_t size)
+{
+    std::vector<uint8_t> image(size * size);
+    const size_t cellSize = 96;
+    uint64_t state = 1;
+    auto random = [&state](uint32_t n) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (uint32_t)(state >> 33) % n;
+    };
+
+    for (size_t cellY = 0; cellY + cellSize <= size; cellY += cellSize)
+    {
+        for (size_t cellX = 0; cellX + cellSize <= size; cellX += cellSize)
+        {
+            const uint32_t strokeCount = 1 + random(4);
+            for (uint32_t i = 0; i < strokeCount; ++i)
+            {
+                // Each stroke is an elliptical ring or a thick bar, as in the bowls and stems of letters
+                const float centerX = 24 + random(48);
+                const float centerY = 24 + random(48);
+                const float radiusX = 8 + random(24);
+                const float radiusY = 8 + random(32);
+                const float thickness = 4 + random(8);
+                const bool isRing = random(2) == 0;
+                for (size_t y = 0; y < cellSize; ++y)
+                {
+                    for (size_t x = 0; x < cellSize; ++x)
+                    {
+                        const float dx = x - centerX;
+                        const float dy = y - centerY;
+                        bool isInside;
+                        if (isRing)
+                        {
+                            const float r = std::sqrt((dx * dx) / (radiusX * radiusX) + (dy * dy) / (radiusY * radiusY));
+                            isInside = std::fabs(r - 1) * std::min(radiusX, radiusY) < thickness * 0.5f;
+                        }
+                        else
+                        {
+                            isInside = std::fabs(dx) < thickness * 0.5f && std::fabs(dy) < radiusY;
+                        }
+                        if (isInside)
+                        {
+                            image[(cellY + y) * size + cellX + x] = 0xff;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return image;
+}
+
+/// The dead-reckoning transform of Grevera that the font atlas used before the exact transform, as it was,
+/// including its failure to visit the last two rows and columns. Kept only to compare against.
+void MBEDeadReckoningSignedDistance(const uint8_t *imageData, long width, long height, float *distanceMap)
+{
+    struct IntPoint { unsigned short x, y; };
+    std::vector<IntPoint> boundaryPointMap(width * height);
+
+#define image(_x, _y) (imageData[(_y) * width + (_x)] > 0x7f)
+#define distance(_x, _y) distanceMap[(_y) * width + (_x)]
+#define nearestpt(_x, _y) boundaryPointMap[(_y) * width + (_x)]
+
+    const float maxDist = std::hypot((float)width, (float)height);
+    const float distUnit = 1;
+    const float distDiag = std::sqrt(2.0f);
+
+    for (long y = 0; y < height; ++y)
+    {
+        for (long x = 0; x < width; ++x)
+        {
+            distance(x, y) = maxDist;
+            nearestpt(x, y) = IntPoint{ 0, 0 };
+        }
+    }
+
+    for (long y = 1; y < height - 1; ++y)
+    {
+        for (long x = 1; x < width - 1; ++x)
+        {
+            bool inside = image(x, y);
+            if (image(x - 1, y) != inside ||
+                image(x + 1, y) != inside ||
+                image(x, y - 1) != inside ||
+                image(x, y + 1) != inside)
+            {
+                distance(x, y) = 0;
+                nearestpt(x, y) = IntPoint{ (unsigned short)x, (unsigned short)y };
+            }
+        }
+    }
+
+#define relax(_dx, _dy, _step) \
+    if (distance(x + (_dx), y + (_dy)) + (_step) < distance(x, y)) \
+    { \
+        nearestpt(x, y) = nearestpt(x + (_dx), y + (_dy)); \
+        distance(x, y) = std::hypot((float)(x - nearestpt(x, y).x), (float)(y - nearestpt(x, y).y)); \
+    }
+
+    for (long y = 1; y < height - 2; ++y)
+    {
+        for (long x = 1; x < width - 2; ++x)
+        {
+            relax(-1, -1, distDiag);
+            relax(0, -1, distUnit);
+            relax(1, -1, distDiag);
+            relax(-1, 0, distUnit);
+        }
+    }
+
+    for (long y = height - 2; y >= 1; --y)
+    {
+        for (long x = width - 2; x >= 1; --x)
+        {
+            relax(1, 0, distUnit);
+            relax(-1, 1, distDiag);
+            relax(0, 1, distUnit);
+            relax(1, 1, distDiag);
+        }
+    }
+
+    for (long y = 0; y < height; ++y)
+    {
+        for (long x = 0; x < width; ++x)
+        {
+            if (!image(x, y))
+                distance(x, y) = -distance(x, y);
+        }
+    }
+
+#undef relax
+#undef image
+#undef distance
+#undef nearestpt
+}
+
+/// The shortest of `iterations` runs of `work`, in milliseconds
+double MBEBestTime(int iterations, const std::function<void()> &work)
+{
+    double bestTime = 1e30;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        bestTime = std::min(bestTime, elapsed.count());
+    }
+    return bestTime;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int iterations = (argc > 1) ? std::atoi(argv[1]) : 5;
+    const size_t size = (argc > 2) ? (size_t)std::atoi(argv[2]) : 4096;
+    if (iterations < 1 || size < MBEAtlasScaleFactor || size % MBEAtlasScaleFactor != 0 || size >= 32768)
+    {
+        std::fprintf(stderr, "usage: %s [iterations] [size, a multiple of %zu]\n", argv[0], MBEAtlasScaleFactor);
+        return 1;
+    }
+
+    const std::vector<uint8_t> image = MBEMakeAtlasImage(size);
+    std::vector<float> distances(size * size);
+    std::vector<uint8_t> field((size / MBEAtlasScaleFactor) * (size / MBEAtlasScaleFactor));
+
+    std::printf("%u threads, %zu x %zu image, best of %d runs\n",
+                MBEThreadPool::sharedPool().threadCount(), size, size, iterations);
+
+    const double exactTime = MBEBestTime(iterations, [&] {
+        MBESignedDistanceTransform(image.data(), size, size, size, INFINITY, distances.data(), size);
+    });
+    std::printf("%-40s %9.1f ms\n", "exact transform, unbounded", exactTime);
+
+    const double boundedTime = MBEBestTime(iterations, [&] {
+        MBESignedDistanceTransform(image.data(), size, size, size, MBEAtlasSpread, distances.data(), size);
+    });
+    std::printf("%-40s %9.1f ms\n", "exact transform, clamped to the spread", boundedTime);
+
+    const double fieldTime = MBEBestTime(iterations, [&] {
+        MBEQuantizedSignedDistanceField(image.data(), size, size, size, MBEAtlasScaleFactor, MBEAtlasSpread,
+                                        field.data(), size / MBEAtlasScaleFactor);
+    });
+    std::printf("%-40s %9.1f ms\n", "banded, downsampled, quantized field", fieldTime);
+
+    const double deadReckoningTime = MBEBestTime(iterations, [&] {
+        MBEDeadReckoningSignedDistance(image.data(), (long)size, (long)size, distances.data());
+    });
+    std::printf("%-40s %9.1f ms\n", "dead reckoning (replaced)", deadReckoningTime);
+
+    return 0;
+}
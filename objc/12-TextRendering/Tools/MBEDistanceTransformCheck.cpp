@@ -0,0 +1,254 @@
+// Checks the distance transform on the host against brute force. Every pixel of each random image is
+// compared with the distance to the nearest pixel on the other side of the boundary, found by visiting
+// every pixel, and the banded, quantized field is compared with one made by downsampling and quantizing
+// the brute-force distances. The images mix noise with filled and hollow ellipses, at sizes that aren't
+// multiples of anything, with and without row padding and a distance limit.
+//
+// usage: MBEDistanceTransformCheck [image count] [seed]
+//
+// Prints the worst error found and exits nonzero if any distance is off by more than rounding or any
+// quantized texel differs.
+
+#include "MBEDistanceTransform.h"
+#include "MBEThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+
+/// A small, repeatable generator, so a failing seed can be rerun
+struct MBERandom
+{
+    uint64_t state;
+
+    uint32_t next()
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return (uint32_t)(state >> 33);
+    }
+
+    /// A value in [0, n)
+    uint32_t below(uint32_t n) { return next() % n; }
+};
+
+struct MBETestImage
+{
+    size_t width, height, bytesPerRow;
+    std::vector<uint8_t> pixels;
+
+    bool isInside(size_t x, size_t y) const { return pixels[y * bytesPerRow + x] > 0x7f; }
+};
+
+MBETestImage MBEMakeTestImage(size_t width, size_t height, size_t padding, MBERandom &random)
+{
+    MBETestImage image = { width, height, width + padding, std::vector<uint8_t>((width + padding) * height) };
+
+    // Padding bytes are garbage that the transform must ignore
+    for (uint8_t &pixel : image.pixels)
+    {
+        pixel = (uint8_t)random.next();
+    }
+
+    const uint32_t style = random.below(4);
+    for (size_t y = 0; y < height; ++y)
+    {
+        for (size_t x = 0; x < width; ++x)
+        {
+            // Noise for style 0, and all outside or all inside for styles 1 and 2, which have no boundary
+            uint8_t value = (uint8_t)random.next();
+            if (style > 0)
+            {
+                value = (style == 2) ? 0xff : 0x00;
+            }
+            image.pixels[y * image.bytesPerRow + x] = value;
+        }
+    }
+
+    // Style 3 draws glyph-like shapes over an empty background
+    const uint32_t shapeCount = (style == 3) ? 1 + random.below(6) : 0;
+    for (uint32_t i = 0; i < shapeCount; ++i)
+    {
+        const float centerX = random.below((uint32_t)width * 16) / 16.0f;
+        const float centerY = random.below((uint32_t)height * 16) / 16.0f;
+        const float radiusX = 1 + random.below((uint32_t)width * 8) / 16.0f;
+        const float radiusY = 1 + random.below((uint32_t)height * 8) / 16.0f;
+        const float hole = (random.below(2) == 0) ? random.below(80) / 100.0f : 0;
+        const uint8_t value = (random.below(4) == 0) ? 0x00 : 0xff;
+        for (size_t y = 0; y < height; ++y)
+        {
+            for (size_t x = 0; x < width; ++x)
+            {
+                const float dx = (x - centerX) / radiusX;
+                const float dy = (y - centerY) / radiusY;
+                const float r = dx * dx + dy * dy;
+                if (r <= 1 && r >= hole * hole)
+                {
+                    image.pixels[y * image.bytesPerRow + x] = value;
+                }
+            }
+        }
+    }
+
+    return image;
+}
+
+/// The distance MBESignedDistanceTransform is documented to produce, found by visiting every pixel
+std::vector<float> MBEBruteForceDistances(const MBETestImage &image, float maximumDistance)
+{
+    const float farDistance = std::isinf(maximumDistance) ? (float)(image.width + image.height) : maximumDistance;
+
+    std::vector<float> distances(image.width * image.height);
+    for (size_t y = 0; y < image.height; ++y)
+    {
+        for (size_t x = 0; x < image.width; ++x)
+        {
+            const bool isInside = image.isInside(x, y);
+            long nearestSquared = -1;
+            for (size_t v = 0; v < image.height; ++v)
+            {
+                for (size_t u = 0; u < image.width; ++u)
+                {
+                    if (image.isInside(u, v) != isInside)
+                    {
+                        const long dx = (long)u - (long)x;
+                        const long dy = (long)v - (long)y;
+                        const long squared = dx * dx + dy * dy;
+                        if (nearestSquared < 0 || squared < nearestSquared)
+                        {
+                            nearestSquared = squared;
+                        }
+                    }
+                }
+            }
+
+            const float distance = (nearestSquared < 0) ? farDistance : std::sqrt((float)nearestSquared) - 0.5f;
+            distances[y * image.width + x] = (isInside ? 1 : -1) * std::min(distance, maximumDistance);
+        }
+    }
+    return distances;
+}
+
+/// The field MBEQuantizedSignedDistanceField is documented to produce, from full-resolution distances
+std::vector<uint8_t> MBEQuantizeDistances(const std::vector<float> &distances, size_t width, size_t height,
+                                          size_t scaleFactor, float spread)
+{
+    const size_t fieldWidth = width / scaleFactor;
+    const size_t fieldHeight = height / scaleFactor;
+    const float averageScale = 1.0f / (scaleFactor * scaleFactor);
+    std::vector<uint8_t> field(fieldWidth * fieldHeight);
+    for (size_t fieldY = 0; fieldY < fieldHeight; ++fieldY)
+    {
+        for (size_t fieldX = 0; fieldX < fieldWidth; ++fieldX)
+        {
+            float sum = 0;
+            for (size_t y = fieldY * scaleFactor; y < (fieldY + 1) * scaleFactor; ++y)
+            {
+                for (size_t x = fieldX * scaleFactor; x < (fieldX + 1) * scaleFactor; ++x)
+                {
+                    sum += distances[y * width + x];
+                }
+            }
+            const float distance = std::max(-spread, std::min(sum * averageScale, spread));
+            field[fieldY * fieldWidth + fieldX] = (uint8_t)((distance / spread + 1) * 0.5f * UINT8_MAX);
+        }
+    }
+    return field;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const int imageCount = (argc > 1) ? std::atoi(argv[1]) : 300;
+    MBERandom random = { (argc > 2) ? (uint64_t)std::strtoull(argv[2], nullptr, 10) : 1 };
+    if (imageCount < 1)
+    {
+        std::fprintf(stderr, "usage: %s [image count] [seed]\n", argv[0]);
+        return 1;
+    }
+
+    const float maximumDistances[] = { INFINITY, 2.5f, 7 };
+
+    double worstError = 0;
+    size_t distanceFailures = 0;
+    size_t fieldFailures = 0;
+    for (int i = 0; i < imageCount; ++i)
+    {
+        const size_t width = 1 + random.below(72);
+        const size_t height = 1 + random.below(72);
+        const size_t padding = random.below(2) ? random.below(13) : 0;
+        const MBETestImage image = MBEMakeTestImage(width, height, padding, random);
+
+        for (float maximumDistance : maximumDistances)
+        {
+            const std::vector<float> expected = MBEBruteForceDistances(image, maximumDistance);
+
+            // Pad the output rows too, so a transform that ignored distancesPerRow would show up
+            const size_t distancesPerRow = width + 3;
+            std::vector<float> distances(distancesPerRow * height);
+            MBESignedDistanceTransform(image.pixels.data(), width, height, image.bytesPerRow, maximumDistance,
+                                       distances.data(), distancesPerRow);
+
+            for (size_t y = 0; y < height; ++y)
+            {
+                for (size_t x = 0; x < width; ++x)
+                {
+                    const double error = std::fabs((double)distances[y * distancesPerRow + x] - expected[y * width + x]);
+                    worstError = std::max(worstError, error);
+                    if (error > 1e-4 * std::max(1.0f, std::fabs(expected[y * width + x])))
+                    {
+                        if (distanceFailures++ < 10)
+                        {
+                            std::fprintf(stderr, "image %d (%zux%zu, limit %g): distance at (%zu, %zu) is %g, expected %g\n",
+                                         i, width, height, maximumDistance, x, y,
+                                         distances[y * distancesPerRow + x], expected[y * width + x]);
+                        }
+                    }
+                }
+            }
+        }
+
+        // The banded field, at every scale factor that divides the image
+        for (size_t scaleFactor = 1; scaleFactor <= std::min<size_t>(std::min(width, height), 8); ++scaleFactor)
+        {
+            const size_t fieldWidth = width / scaleFactor;
+            const size_t fieldHeight = height / scaleFactor;
+            const size_t croppedWidth = fieldWidth * scaleFactor;
+            const size_t croppedHeight = fieldHeight * scaleFactor;
+            const float spread = 0.5f + random.below(24) / 2.0f;
+
+            MBETestImage cropped = image;
+            cropped.width = croppedWidth;
+            cropped.height = croppedHeight;
+            const std::vector<uint8_t> expected = MBEQuantizeDistances(MBEBruteForceDistances(cropped, spread),
+                                                                       croppedWidth, croppedHeight, scaleFactor, spread);
+
+            const size_t fieldBytesPerRow = fieldWidth + 5;
+            std::vector<uint8_t> field(fieldBytesPerRow * fieldHeight);
+            MBEQuantizedSignedDistanceField(cropped.pixels.data(), croppedWidth, croppedHeight, cropped.bytesPerRow,
+                                            scaleFactor, spread, field.data(), fieldBytesPerRow);
+
+            for (size_t y = 0; y < fieldHeight; ++y)
+            {
+                for (size_t x = 0; x < fieldWidth; ++x)
+                {
+                    if (field[y * fieldBytesPerRow + x] != expected[y * fieldWidth + x] && fieldFailures++ < 10)
+                    {
+                        std::fprintf(stderr, "image %d (%zux%zu, scale %zu, spread %g): texel (%zu, %zu) is %d, expected %d\n",
+                                     i, croppedWidth, croppedHeight, scaleFactor, spread, x, y,
+                                     field[y * fieldBytesPerRow + x], expected[y * fieldWidth + x]);
+                    }
+                }
+            }
+        }
+    }
+
+    std::printf("%u threads, %d images: worst distance error %.3g, %zu distances and %zu texels wrong\n",
+                MBEThreadPool::sharedPool().threadCount(), imageCount, worstError, distanceFailures, fieldFailures);
+    return (distanceFailures == 0 && fieldFailures == 0) ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+#import "MBECachedTextureLoader.h"
+#import "MBEMappedFile.h"
+#import "MBEContentHash.h"
+#import "MBETextureCache.h"
+#import "MBEMipmapGenerator.h"
+
+#include <cstring>
+#include <vector>
+
+static NSString *const MBETextureCachePathExtension = @"mbetexture";
+
+// Bump this whenever a change to this file or to the mipmap generator alters the pixels it produces,
+// so that previously written caches are rebuilt rather than reused
+static const uint32_t MBETextureCacheBuilderVersion = 2;
+
+static const uint32_t MBETextureCacheFlagFlipped = 1 << 0;
+static const uint32_t MBETextureCacheFlagMipmapped = 1 << 1;
+
+static const uint32_t MBEBytesPerPixel = 4;
+
+@implementation MBECachedTextureLoader
+
++ (instancetype)sharedTextureLoader
+{
+    static dispatch_once_t onceToken;
+    static MBECachedTextureLoader *instance = nil;
+    dispatch_once(&onceToken, ^{
+        instance = [MBECachedTextureLoader new];
+    });
+    return instance;
+}
+
+- (id<MTLTexture>)texture2DWithImageNamed:(NSString *)imageName
+                              pixelFormat:(MTLPixelFormat)pixelFormat
+                                mipmapped:(BOOL)mipmapped
+                                  flipped:(BOOL)flipped
+                                   device:(id<MTLDevice>)device
+{
+    if (pixelFormat != MTLPixelFormatRGBA8Unorm && pixelFormat != MTLPixelFormatRGBA8Unorm_sRGB)
+    {
+        return nil;
+    }
+
+    MBETextureCacheKey key;
+    if (![self getCacheKey:&key forImageNamed:imageName])
+    {
+        // Without a source file there is nothing to key a cache on, so decode the image every time
+        return [self decodeImageNamed:imageName cacheURL:nil key:key pixelFormat:pixelFormat
+                            mipmapped:mipmapped flipped:flipped device:device];
+    }
+
+    key.pixelFormat = (uint32_t)pixelFormat;
+    key.builderVersion = MBETextureCacheBuilderVersion;
+    key.flags = (flipped ? MBETextureCacheFlagFlipped : 0) | (mipmapped ? MBETextureCacheFlagMipmapped : 0);
+
+    NSURL *bakedCacheURL = [[NSBundle mainBundle] URLForResource:imageName withExtension:MBETextureCachePathExtension];
+    NSURL *userCacheURL = [self userTextureCacheURLForKey:key];
+
+    id<MTLTexture> texture = nil;
+    if ((bakedCacheURL && (texture = [self textureWithCacheAtURL:bakedCacheURL key:key label:imageName device:device])) ||
+        (userCacheURL && (texture = [self textureWithCacheAtURL:userCacheURL key:key label:imageName device:device])))
+    {
+        return texture;
+    }
+
+    return [self decodeImageNamed:imageName cacheURL:userCacheURL key:key pixelFormat:pixelFormat
+                        mipmapped:mipmapped flipped:flipped device:device];
+}
+
+- (NSURL *)sourceURLForImageNamed:(NSString *)imageName
+{
+    NSBundle *bundle = [NSBundle mainBundle];
+    if ([[imageName pathExtension] length] > 0)
+    {
+        return [bundle URLForResource:imageName withExtension:nil];
+    }
+
+    for (NSString *extension in @[ @"png", @"jpg", @"jpeg" ])
+    {
+        NSURL *url = [bundle URLForResource:imageName withExtension:extension];
+        if (url)
+        {
+            return url;
+        }
+    }
+    return nil;
+}
+
+- (BOOL)getCacheKey:(MBETextureCacheKey *)key forImageNamed:(NSString *)imageName
+{
+    memset(key, 0, sizeof(MBETextureCacheKey));
+
+    // Images in an asset catalog are compiled into one archive, so the archive stands in for the source,
+    // with the name mixed in so that each image in it gets its own key
+    uint64_t seed = 0;
+    NSURL *sourceURL = [self sourceURLForImageNamed:imageName];
+    if (!sourceURL)
+    {
+        const char *name = [imageName UTF8String];
+        seed = MBEContentHash64(name, strlen(name));
+        sourceURL = [[NSBundle mainBundle] URLForResource:@"Assets" withExtension:@"car"];
+    }
+
+    if (!sourceURL)
+    {
+        return NO;
+    }
+
+    MBEMappedFile source([[sourceURL path] fileSystemRepresentation]);
+    if (!source.isValid())
+    {
+        return NO;
+    }
+
+    // Hashing the encoded image is far cheaper than decoding it, and it lets us detect stale caches reliably
+    key->sourceHash = MBEContentHash64(source.bytes(), source.length(), seed);
+    key->sourceLength = source.length();
+    return YES;
+}
+
+- (NSURL *)userTextureCacheURLForKey:(const MBETextureCacheKey &)key
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    NSURL *cachesURL = [[fileManager URLsForDirectory:NSCachesDirectory inDomains:NSUserDomainMask] firstObject];
+    NSURL *directoryURL = [cachesURL URLByAppendingPathComponent:@"MBETextureCache" isDirectory:YES];
+    if (![fileManager createDirectoryAtURL:directoryURL withIntermediateDirectories:YES attributes:nil error:nil])
+    {
+        return nil;
+    }
+
+    // Caches are named by content, so an image that appears under several names is only cached once
+    NSString *fileName = [NSString stringWithFormat:@"%016llx-%u-%x.%@", (unsigned long long)key.sourceHash,
+                          key.pixelFormat, key.flags, MBETextureCachePathExtension];
+    return [directoryURL URLByAppendingPathComponent:fileName];
+}
+
+- (id<MTLTexture>)textureWithCacheAtURL:(NSURL *)cacheURL
+                                    key:(const MBETextureCacheKey &)key
+                                  label:(NSString *)label
+                                 device:(id<MTLDevice>)device
+{
+    std::shared_ptr<MBETextureCache> cache = MBETextureCache::open([[cacheURL path] fileSystemRepresentation], key);
+    if (!cache || cache->bytesPerPixel() != MBEBytesPerPixel)
+    {
+        return nil;
+    }
+
+    // The mapping is released when `cache` goes out of scope, once every level has been copied out of it
+    return [self newTextureWithLevels:cache->levels() label:label pixelFormat:(MTLPixelFormat)key.pixelFormat device:device];
+}
+
+- (id<MTLTexture>)decodeImageNamed:(NSString *)imageName
+                          cacheURL:(NSURL *)cacheURL
+                               key:(const MBETextureCacheKey &)key
+                       pixelFormat:(MTLPixelFormat)pixelFormat
+                         mipmapped:(BOOL)mipmapped
+                           flipped:(BOOL)flipped
+                            device:(id<MTLDevice>)device
+{
+    UIImage *image = [UIImage imageNamed:imageName];
+    if (image == nil)
+    {
+        return nil;
+    }
+
+    CGImageRef imageRef = [image CGImage];
+    const uint32_t width = (uint32_t)CGImageGetWidth(imageRef);
+    const uint32_t height = (uint32_t)CGImageGetHeight(imageRef);
+
+    // Every level goes into one allocation, laid out the way the cache will lay it out
+    const MBEMipmapPixelFormat mipmapFormat = (pixelFormat == MTLPixelFormatRGBA8Unorm_sRGB) ?
+                                              MBEMipmapPixelFormatRGBA8Unorm_sRGB : MBEMipmapPixelFormatRGBA8Unorm;
+    const uint32_t levelCount = mipmapped ? MBEMipmapLevelCount(width, height) : 1;
+    std::vector<MBEMipmapLevel> chainLevels(levelCount);
+    std::vector<uint8_t> pixels(MBEMipmapChainLayout(width, height, levelCount, mipmapFormat,
+                                                     MBETextureCacheLevelAlignment, chainLevels.data()));
+
+    std::vector<MBETextureCacheLevel> levels(levelCount);
+    for (uint32_t i = 0; i < levelCount; ++i)
+    {
+        levels[i].bytes = pixels.data() + chainLevels[i].offset;
+        levels[i].width = chainLevels[i].width;
+        levels[i].height = chainLevels[i].height;
+        levels[i].bytesPerRow = chainLevels[i].bytesPerRow;
+    }
+
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate((void *)levels[0].bytes, width, height,
+                                                 8, levels[0].bytesPerRow, colorSpace,
+                                                 kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
+    CGColorSpaceRelease(colorSpace);
+
+    if (flipped)
+    {
+        CGContextTranslateCTM(context, 0, height);
+        CGContextScaleCTM(context, 1, -1);
+    }
+
+    CGContextDrawImage(context, CGRectMake(0, 0, width, height), imageRef);
+    CGContextRelease(context);
+
+    // Textures are cached at the best quality we can afford, since the filtering only runs once per image.
+    // Color in sRGB textures is filtered in linear space, so that bright and dark texels average correctly.
+    MBEGenerateMipmapChain(pixels.data(), chainLevels.data(), levelCount, mipmapFormat,
+                           MBEMipmapFilterKaiser, MBEMipmapEdgeModeClamp);
+
+    if (cacheURL)
+    {
+        MBETextureCache::write([[cacheURL path] fileSystemRepresentation], key, MBEBytesPerPixel, levels);
+    }
+
+    return [self newTextureWithLevels:levels label:imageName pixelFormat:pixelFormat device:device];
+}
+
+- (id<MTLTexture>)newTextureWithLevels:(const std::vector<MBETextureCacheLevel> &)levels
+                                 label:(NSString *)label
+                           pixelFormat:(MTLPixelFormat)pixelFormat
+                                device:(id<MTLDevice>)device
+{
+    MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:pixelFormat
+                                                                                                 width:levels[0].width
+                                                                                                height:levels[0].height
+                                                                                             mipmapped:NO];
+    textureDescriptor.mipmapLevelCount = levels.size();
+    textureDescriptor.usage = MTLTextureUsageShaderRead;
+    id<MTLTexture> texture = [device newTextureWithDescriptor:textureDescriptor];
+
+    [texture setLabel:label];
+
+    // Levels that come from a cache are copied straight out of the mapped file
+    for (size_t i = 0; i < levels.size(); ++i)
+    {
+        const MBETextureCacheLevel &level = levels[i];
+        MTLRegion region = MTLRegionMake2D(0, 0, level.width, level.height);
+        [texture replaceRegion:region mipmapLevel:i withBytes:level.bytes bytesPerRow:level.bytesPerRow];
+    }
+
+    return texture;
+}
+
+@end
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/// Computes the 64-bit xxHash (XXH64) of a block of memory. It is not cryptographic, but it is
+/// fast enough to fingerprint multi-megabyte source assets on every launch to decide whether a
+/// derived cache is still fresh.
+uint64_t MBEContentHash64(const void *bytes, size_t length, uint64_t seed = 0);
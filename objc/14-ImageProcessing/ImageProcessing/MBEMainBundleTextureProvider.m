@@ -1,5 +1,6 @@
 #import "MBEMainBundleTextureProvider.h"
 #import "MBEContext.h"
+#import "MBECachedTextureLoader.h"
 
 @import Metal;
 
@@ -18,49 +19,20 @@
 {
     if ((self = [super init]))
     {
-        UIImage *image = [UIImage imageNamed:imageName];
-        _texture = [self textureForImage:image context:context];
+        _texture = [self textureForImageNamed:imageName context:context];
     }
     return self;
 }
 
-- (id<MTLTexture>)textureForImage:(UIImage *)image context:(MBEContext *)context
+- (id<MTLTexture>)textureForImageNamed:(NSString *)imageName context:(MBEContext *)context
 {
-    CGImageRef imageRef = [image CGImage];
-    
-    // Create a suitable bitmap context for extracting the bits of the image
-    NSUInteger width = CGImageGetWidth(imageRef);
-    NSUInteger height = CGImageGetHeight(imageRef);
-    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
-    uint8_t *rawData = (uint8_t *)calloc(height * width * 4, sizeof(uint8_t));
-    NSUInteger bytesPerPixel = 4;
-    NSUInteger bytesPerRow = bytesPerPixel * width;
-    NSUInteger bitsPerComponent = 8;
-    CGContextRef bitmapContext = CGBitmapContextCreate(rawData, width, height,
-                                                       bitsPerComponent, bytesPerRow, colorSpace,
-                                                       kCGImageAlphaPremultipliedLast | kCGBitmapByteOrder32Big);
-    CGColorSpaceRelease(colorSpace);
-    
-    // Flip the context so the positive Y axis points down
-    CGContextTranslateCTM(bitmapContext, 0, height);
-    CGContextScaleCTM(bitmapContext, 1, -1);
-    
-    CGContextDrawImage(bitmapContext, CGRectMake(0, 0, width, height), imageRef);
-    CGContextRelease(bitmapContext);
-    
-    MTLTextureDescriptor *textureDescriptor = [MTLTextureDescriptor texture2DDescriptorWithPixelFormat:MTLPixelFormatRGBA8Unorm
-                                                                                                 width:width
-                                                                                                height:height
-                                                                                             mipmapped:NO];
-    textureDescriptor.usage = MTLTextureUsageShaderRead;
-    id<MTLTexture> texture = [context.device newTextureWithDescriptor:textureDescriptor];
-    
-    MTLRegion region = MTLRegionMake2D(0, 0, width, height);
-    [texture replaceRegion:region mipmapLevel:0 withBytes:rawData bytesPerRow:bytesPerRow];
-    
-    free(rawData);
-    
-    return texture;
+    // The decoded pixels are cached on disk, so only the first launch pays for decoding the image.
+    // Flip the image so the positive Y axis points down.
+    return [[MBECachedTextureLoader sharedTextureLoader] texture2DWithImageNamed:imageName
+                                                                     pixelFormat:MTLPixelFormatRGBA8Unorm
+                                                                       mipmapped:NO
+                                                                         flipped:YES
+                                                                          device:context.device];
 }
 
 - (void)provideTexture:(void (^)(id<MTLTexture>))textureBlock
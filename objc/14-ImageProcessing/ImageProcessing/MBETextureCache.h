@@ -0,0 +1,69 @@
+#pragma once
+
+#include "MBEMappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Every level starts on a multiple of this many bytes, which satisfies the offset alignment of
+/// buffer-to-texture copies for every pixel format we store
+static const size_t MBETextureCacheLevelAlignment = 256;
+
+/// Identifies the source image and the processing that produced a texture cache. A cache is only
+/// used when every field matches what the loader would produce from the current source file.
+struct MBETextureCacheKey
+{
+    /// `MBEContentHash64` of the encoded source image
+    uint64_t sourceHash;
+    uint64_t sourceLength;
+    /// The `MTLPixelFormat` the levels were converted to
+    uint32_t pixelFormat;
+    /// Bumped by the loader whenever the way it decodes images or builds mipmaps changes
+    uint32_t builderVersion;
+    /// Loader options that affect the baked pixels, such as flipping or mipmapping
+    uint32_t flags;
+};
+
+/// One mipmap level of a texture cache. When the level comes from `MBETextureCache::open`, `bytes`
+/// points directly into the mapped file.
+struct MBETextureCacheLevel
+{
+    const void *bytes;
+    uint32_t width;
+    uint32_t height;
+    size_t bytesPerRow;
+};
+
+/// A versioned binary container for the decoded pixels of a texture and its mipmaps, written once
+/// when an image is first loaded (or by a bake step) and mapped read-only afterward, so that later
+/// loads upload the levels straight from the file without decoding the image or allocating memory
+/// for its pixels. Level i is max(1, width >> i) by max(1, height >> i) pixels.
+class MBETextureCache
+{
+public:
+    /// Maps the cache at `path` and validates its header and level table. Returns null if the
+    /// file is missing, malformed, from another format version, or doesn't match `key`.
+    static std::shared_ptr<MBETextureCache> open(const char *path, const MBETextureCacheKey &key);
+
+    /// Writes `levels` to a temporary file next to `path` and renames it into place, so that
+    /// readers never observe a partially written cache. Returns false on I/O failure or if the
+    /// levels do not form a mipmap chain.
+    static bool write(const char *path, const MBETextureCacheKey &key, uint32_t bytesPerPixel,
+                      const std::vector<MBETextureCacheLevel> &levels);
+
+    uint32_t bytesPerPixel() const { return _bytesPerPixel; }
+    const std::vector<MBETextureCacheLevel> &levels() const { return _levels; }
+
+private:
+    explicit MBETextureCache(const char *path);
+    MBETextureCache(const MBETextureCache &) = delete;
+    MBETextureCache &operator=(const MBETextureCache &) = delete;
+
+    bool validate(const MBETextureCacheKey &key);
+
+    MBEMappedFile _file;
+    uint32_t _bytesPerPixel;
+    std::vector<MBETextureCacheLevel> _levels;
+};